@@ -48,7 +48,7 @@ namespace Dragonfly.BaseModule
         {
             RenderTarget depthTarget = baseMod.DepthPrepass.GetTarget();
             if (depthTarget != null)
-                Shader.SetParam("depthInput", baseMod.DepthPrepass.GetTarget());
+                Shader.SetParam("depthInput", depthTarget);
             Shader.SetParam("atmosphereLightColorLUT", AtmosphereModule.Atmosphere.LightColorGpuLUT);
             Shader.SetParam("lightColorOffset", LightColorOffset);
         }
@@ -48,7 +48,13 @@ namespace Dragonfly.BaseModule
             }
         }
 
-        public bool LoadingRequired { get; private set; }
+        private bool loadingRequired;
+
+        public bool LoadingRequired
+        {
+            get { return loadingRequired; }
+            private set { SetLoadingRequired(ref loadingRequired, value); }
+        }
 
         public AABox BoundingBox { get; private set; }
 
@@ -69,6 +75,7 @@ namespace Dragonfly.BaseModule
             if (IndexBuffer == null && TessellationType == BakedGeometryTessellation.VertexGrid)
             {
                 ushort[] indices = Primitives.GridIndices(0, VertexBaker.VertexGridSize.Width, VertexBaker.VertexGridSize.Height);
+                MeshOptimizer.OptimizeVertexCache(indices, indices.Length, VertexBaker.VertexCount);
                 IndexBuffer = g.CreateIndexBuffer(indices.Length);
                 IndexBuffer.SetIndices(indices);
                 ownIndexBuffer = true;
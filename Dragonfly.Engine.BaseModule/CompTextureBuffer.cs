@@ -35,7 +35,13 @@ namespace Dragonfly.BaseModule
             LoadingRequired = true;
         }
 
-        public bool LoadingRequired { get; private set; }
+        private bool loadingRequired;
+
+        public bool LoadingRequired
+        {
+            get { return loadingRequired; }
+            private set { SetLoadingRequired(ref loadingRequired, value); }
+        }
 
         public void UploadValues()
         {
@@ -130,6 +130,7 @@ namespace Dragonfly.BaseModule
         {
             // create a buffer that will be used by both solid and depth pre-pass to share the same z-buffer
             CompRenderBuffer gBuffer = new CompRenderBuffer(root, new SurfaceFormat[] { SurfaceFormat.Color /*HDR Color*/, SurfaceFormat.Half /* SS Depth */}, RenderBufferResizeStyle.MatchBackbuffer);
+            gBuffer.Transient = true; // only read during the frame through render target references, its targets are bound by the frame graph
 
             // Solid forward pass
             {
@@ -161,6 +162,7 @@ namespace Dragonfly.BaseModule
                 ToScreenPass.ClearValue = Color.Red.ToFloat4();
                 ToScreenPass.Camera = new CompCamIdentity(ToScreenPass);
                 ToScreenPass.RequiredPasses.Add(LastCompositionPass);
+                ToScreenPass.InputBuffers.Add(gBuffer); // depth is read by the post process, even after other composition passes are pushed
 
                 // Default UI panel
                 UiContainer = new CompUiContainer(root, new UiRenderPassCanvas(ToScreenPass), "100% 100%", "0px 0px", PositionOrigin.TopLeft);
@@ -237,6 +239,17 @@ namespace Dragonfly.BaseModule
             return previousCompPass;
         }
 
+        /// <summary>
+        /// Create a transient buffer for a composition pass, that match the backbuffer size. Each composition pass only reads the output of the previous one, 
+        /// so the frame graph aliases the buffers of a chain of composition passes to two sets of render targets.
+        /// </summary>
+        public CompRenderBuffer CreateCompositionBuffer(Component parent)
+        {
+            CompRenderBuffer buffer = new CompRenderBuffer(parent, SurfaceFormat.Color, RenderBufferResizeStyle.MatchBackbuffer);
+            buffer.Transient = true;
+            return buffer;
+        }
+
         public CompUiContainer UiContainer { get; private set; }
 
         public CompAudioEngine Sound { get; private set; }
@@ -7,7 +7,7 @@ namespace Dragonfly.BaseModule
     /// <summary>
     /// Perform an acton when the value of the specified component changes
     /// </summary>
-    public class CompActionOnChange : Component, ICompUpdatable
+    public class CompActionOnChange : Component, ICompDeclaredUpdatable
     {
         public static CompActionOnChange MonitorValue<T>(Component<T> monitoredComponent, Action<T> onValueChanged)
         {
@@ -42,6 +42,11 @@ namespace Dragonfly.BaseModule
             }
         }
 
+        public void GetUpdateAccess(UpdateType updateType, UpdateAccess access)
+        {
+            access.Write(typeof(object)); // the callback can modify any component
+        }
+
         public void Execute()
         {
             Update(UpdateType.FrameStart2);
@@ -4,7 +4,7 @@ using System.Threading.Tasks;
 
 namespace Dragonfly.BaseModule
 {
-    public class CompActionOnEvent : Component, ICompUpdatable
+    public class CompActionOnEvent : Component, ICompDeclaredUpdatable
     {
         private Component<bool> eventComp;
 
@@ -26,6 +26,11 @@ namespace Dragonfly.BaseModule
 
         public UpdateType NeededUpdates => eventComp.GetValue() ? UpdateType.FrameStart2 : UpdateType.None;
 
+        public void GetUpdateAccess(UpdateType updateType, UpdateAccess access)
+        {
+            access.Write(typeof(object)); // the action can modify any component
+        }
+
         public bool DisposeOnceExecuted { get; set; }
 
         public void Update(UpdateType updateType)
@@ -2,6 +2,7 @@
 using Dragonfly.Utils;
 using System;
 using System.IO;
+using System.Runtime.ExceptionServices;
 
 namespace Dragonfly.BaseModule
 {
@@ -9,17 +10,28 @@ namespace Dragonfly.BaseModule
     {
         public const string Extension = ".hdr";
         private const string HDR_FILE_TOKEN = "#?RADIANCE";
+        private const int SCANLINE_BLOCK_SIZE = 16; // number of scanlines decoded or encoded by each parallel job
+        private const int MIN_RUN_LENGTH = 4; // shorter sequences of equal values are stored in dumps by the encoder
+        private const int MAX_RUN_LENGTH = 127, MAX_DUMP_LENGTH = 128;
 
         private byte[] colorBytes;
+        private int dataStart; // offset of the first scanline in colorBytes, which can also contain the file header
+        private int[] scanlineOffsets; // start of each scanline in colorBytes
 
-        public HdrFile(string path)
+        public HdrFile(string path) : this(File.ReadAllBytes(path)) { }
+
+        /// <summary>
+        /// Parse an hdr file from its content in memory. The specified array is referenced by this image without being copied, and should not be modified by the caller.
+        /// </summary>
+        public HdrFile(byte[] fileBytes)
         {
-            FileStream fs = new FileStream(path, FileMode.Open);
-            BinaryReader reader = new BinaryReader(fs);
-            LoadHeader(reader);
-            colorBytes = new byte[fs.Length - fs.Position];
-            fs.Read(colorBytes, 0, colorBytes.Length);
-            IsCompressed = ReadScanlineType(0) != ScanlineType.Uncompressed; // writing on compressed files not currently supported
+            using (MemoryStream ms = new MemoryStream(fileBytes, false))
+            {
+                LoadHeader(new BinaryReader(ms));
+                dataStart = (int)ms.Position;
+            }
+            colorBytes = fileBytes;
+            FindScanlineOffsets();
         }
 
         /// <summary>
@@ -40,6 +52,9 @@ namespace Dragonfly.BaseModule
 
             // create an empty file byte array with the header 
             colorBytes = new byte[width * height * 4];
+            scanlineOffsets = new int[height];
+            for (int y = 0; y < height; y++)
+                scanlineOffsets[y] = y * width * 4;
         }
 
 
@@ -129,13 +144,17 @@ namespace Dragonfly.BaseModule
             if (destRgbPixels.Length != Header.Width * Header.Height * 3)
                 throw new ArgumentException("The specified buffer is of an invalid length (should be equal to width * height * 3)");
 
-            // read  and decode all image scanlines
-            byte[] destRawPixels = new byte[Header.Width * 4];
-            for (int y = 0, dataOffset = 0, rgbOffset = 0; y < Header.Height; y++, rgbOffset += 3 * Header.Width)
+            // read and decode all image scanlines
+            float multiplier = 1 / Header.Exposure;
+            ForEachScanlineBlock((fromY, toY) =>
             {
-                ReadScanlineTo(destRawPixels, 0, ref dataOffset);
-                DecodeScanline(destRawPixels, 0, destRgbPixels, rgbOffset, 1 / Header.Exposure);
-            }
+                byte[] destRawPixels = new byte[Header.Width * 4];
+                for (int y = fromY; y < toY; y++)
+                {
+                    ReadScanlineTo(destRawPixels, 0, y);
+                    DecodeScanline(destRawPixels, 0, destRgbPixels, y * Header.Width * 3, multiplier);
+                }
+            });
         }
 
         /// <summary>
@@ -143,18 +162,22 @@ namespace Dragonfly.BaseModule
         /// </summary>
         public void CopyRgbDataTo(byte[] destRgbPixels, HdrColorEncoder encoder)
         {
-            if (destRgbPixels.Length != Header.Width * Header.Height)
-                throw new ArgumentException("The specified buffer is of an invalid length (should be equal to width * height)");
+            if (destRgbPixels.Length != Header.Width * Header.Height * 4)
+                throw new ArgumentException("The specified buffer is of an invalid length (should be equal to width * height * 4)");
 
-            // read  and decode all image scanlines
-            byte[] destRawPixels = new byte[Header.Width * 4];
-            float[] destHdrPixels = new float[Header.Width * 3];
-            for (int y = 0, dataOffset = 0, rgbOffset = 0; y < Header.Height; y++, rgbOffset += 4 * Header.Width)
+            // read and decode all image scanlines
+            float multiplier = 1 / Header.Exposure;
+            ForEachScanlineBlock((fromY, toY) =>
             {
-                ReadScanlineTo(destRawPixels, 0, ref dataOffset);
-                DecodeScanline(destRawPixels, 0, destHdrPixels, 0, 1 / Header.Exposure);
-                encoder(destHdrPixels, 0, destHdrPixels.Length, destRgbPixels, rgbOffset);
-            }
+                byte[] destRawPixels = new byte[Header.Width * 4];
+                float[] destHdrPixels = new float[Header.Width * 3];
+                for (int y = fromY; y < toY; y++)
+                {
+                    ReadScanlineTo(destRawPixels, 0, y);
+                    DecodeScanline(destRawPixels, 0, destHdrPixels, 0, multiplier);
+                    encoder(destHdrPixels, 0, destHdrPixels.Length, destRgbPixels, y * Header.Width * 4);
+                }
+            });
         }
 
         /// <summary>
@@ -165,9 +188,12 @@ namespace Dragonfly.BaseModule
             if (destRgbePixels.Length != Header.Width * Header.Height * 4)
                 throw new ArgumentException("The specified buffer is of an invalid length (should be equal to width * height * 4)");
 
-            // read  and decode all image scanlines
-            for (int y = 0, dataOffset = 0, rgbOffset = 0; y < Header.Height; y++, rgbOffset += Header.Width * 4)
-                ReadScanlineTo(destRgbePixels, rgbOffset, ref dataOffset);
+            // read all image scanlines
+            ForEachScanlineBlock((fromY, toY) =>
+            {
+                for (int y = fromY; y < toY; y++)
+                    ReadScanlineTo(destRgbePixels, y * Header.Width * 4, y);
+            });
         }
 
         /// <summary>
@@ -191,39 +217,113 @@ namespace Dragonfly.BaseModule
             RGBE.Encoder(srcHdrPixels, srcOffset, srcOffset + Header.Width * 3, destRgbeData, destOffset);
         }
 
+        /// <summary>
+        /// Split the image scanlines in blocks, and execute the specified operation on each block in parallel.
+        /// </summary>
+        private void ForEachScanlineBlock(ScanlineBlockOperation operation)
+        {
+            ScanlineBlockBody body = new ScanlineBlockBody() { Operation = operation, Height = Header.Height };
+            SlimParallel.For(0, (Header.Height + SCANLINE_BLOCK_SIZE - 1) / SCANLINE_BLOCK_SIZE, 1, body);
+
+            if (body.Error != null)
+                ExceptionDispatchInfo.Capture(body.Error).Throw();
+        }
+
+        /// <summary>
+        /// Find the start of each scanline, validating the file pixel data.
+        /// Run-length encoded scanlines have a variable size, so this is done sequentially by skipping over runs and dumps, which allows the scanlines to be decoded in parallel later.
+        /// </summary>
+        private void FindScanlineOffsets()
+        {
+            scanlineOffsets = new int[Header.Height];
+            int stride = Header.Width * 4;
+            for (int y = 0, offset = dataStart; y < Header.Height; y++)
+            {
+                scanlineOffsets[y] = offset;
+                if (offset + 4 > colorBytes.Length)
+                    throw new InvalidDataException("Corrupted file: missing scanlines.");
+
+                switch (ReadScanlineType(ref offset))
+                {
+                    case ScanlineType.Uncompressed:
+                        offset += stride;
+                        break;
+
+                    case ScanlineType.NewRunLenght:
+                        IsCompressed = true;
+                        for (int channelID = 0; channelID < 4; channelID++)
+                        {
+                            int readPixCount = 0;
+                            while (readPixCount < Header.Width && offset < colorBytes.Length)
+                            {
+                                int seqLen = colorBytes[offset++];
+                                if (seqLen > MAX_DUMP_LENGTH)
+                                {
+                                    // repeated value
+                                    readPixCount += seqLen & 0x7F;
+                                    offset++;
+                                }
+                                else
+                                {
+                                    // value dump
+                                    if (seqLen == 0)
+                                        throw new InvalidDataException("Corrupted file: empty scanline sequence.");
+                                    readPixCount += seqLen;
+                                    offset += seqLen;
+                                }
+                            }
+
+                            if (readPixCount != Header.Width)
+                                throw new InvalidDataException("Corrupted file: invalid scanline length.");
+                        }
+                        break;
+
+                    case ScanlineType.LegacyRunLength:
+                        throw new Exception("Unsupported file format!");
+                }
+
+                if (offset > colorBytes.Length)
+                    throw new InvalidDataException("Corrupted file: missing scanlines.");
+            }
+        }
+
         /// <summary>
         /// Read a scanline to the specified byte buffer in the native RGBE format.
         /// </summary>
-        private void ReadScanlineTo(byte[] destRawPixels, int destOffset, ref int fileBytesOffset)
+        private void ReadScanlineTo(byte[] destRawPixels, int destOffset, int y)
         {
-            ScanlineType scType = ReadScanlineType(ref fileBytesOffset);
+            int fileBytesOffset = scanlineOffsets[y];
+            ScanlineType scType = IsCompressed ? ReadScanlineType(ref fileBytesOffset) : ScanlineType.Uncompressed;
 
             switch (scType)
             {
                 case ScanlineType.Uncompressed:
-                    int stride = Header.Width * 4;
-                    Array.Copy(colorBytes, fileBytesOffset, destRawPixels, destOffset, stride);
-                    fileBytesOffset += stride;
+                    Buffer.BlockCopy(colorBytes, fileBytesOffset, destRawPixels, destOffset, Header.Width * 4);
                     break;
 
                 case ScanlineType.NewRunLenght:
+                    // channels are stored one after the other: unpack each of them to the interleaved destination
                     for (int channelID = 0; channelID < 4; channelID++)
-                        for (int readPixCount = 0; readPixCount < Header.Width;)
+                    {
+                        int curOffset = destOffset + channelID, endOffset = curOffset + Header.Width * 4;
+                        while (curOffset < endOffset)
                         {
                             int seqLen = colorBytes[fileBytesOffset++];
-                            int isValueDump = seqLen > 128 ? 0 : 1; // differentiate between value sequences (dumps) and repeated values
-                            seqLen = seqLen * isValueDump + (seqLen & 0x7F) * (1 - isValueDump);
-                            int curOffset = destOffset + channelID + readPixCount * 4;
-                            readPixCount += seqLen;
-
-                            for (int i = 0; i < seqLen; i++, curOffset += 4)
+                            if (seqLen > MAX_DUMP_LENGTH)
                             {
-                                destRawPixels[curOffset] = colorBytes[fileBytesOffset];
-                                fileBytesOffset += isValueDump; // move to the next value if is not repeated
+                                // repeated value
+                                byte value = colorBytes[fileBytesOffset++];
+                                for (seqLen &= 0x7F; seqLen > 0; seqLen--, curOffset += 4)
+                                    destRawPixels[curOffset] = value;
+                            }
+                            else
+                            {
+                                // value dump
+                                for (; seqLen > 0; seqLen--, curOffset += 4)
+                                    destRawPixels[curOffset] = colorBytes[fileBytesOffset++];
                             }
-
-                            fileBytesOffset += (1 - isValueDump); // move after the sequence value
                         }
+                    }
                     break;
 
                 case ScanlineType.LegacyRunLength:
@@ -234,11 +334,70 @@ namespace Dragonfly.BaseModule
             }
         }
 
-        private void WriteScanline(byte[] srcRawPixels, int srcOffset, ref int fileBytesOffset)
+        /// <summary>
+        /// Run-length encode a scanline in the native RGBE format to the specified buffer, returning the number of bytes written.
+        /// The destination should have space for at least GetMaxEncodedScanlineSize() bytes.
+        /// </summary>
+        private int EncodeRunLengthScanline(byte[] srcRawPixels, int srcOffset, byte[] destBytes, int destOffset)
         {
-            int stride = Header.Width * 4;
-            Array.Copy(srcRawPixels, srcOffset, colorBytes, fileBytesOffset, stride);
-            fileBytesOffset += stride;
+            int width = Header.Width, startOffset = destOffset;
+            destBytes[destOffset++] = 2;
+            destBytes[destOffset++] = 2;
+            destBytes[destOffset++] = (byte)(width >> 8);
+            destBytes[destOffset++] = (byte)(width & 0xFF);
+
+            for (int channelID = 0; channelID < 4; channelID++)
+            {
+                int channelOffset = srcOffset + channelID;
+                for (int x = 0; x < width;)
+                {
+                    // search the next run long enough to be encoded
+                    int runStart = x, runLen = 0;
+                    while (runStart < width)
+                    {
+                        byte value = srcRawPixels[channelOffset + runStart * 4];
+                        for (runLen = 1; runLen < MAX_RUN_LENGTH && runStart + runLen < width && srcRawPixels[channelOffset + (runStart + runLen) * 4] == value; runLen++) ;
+                        if (runLen >= MIN_RUN_LENGTH)
+                            break;
+                        runStart += runLen;
+                    }
+
+                    // dump the values that precede the run
+                    while (x < runStart)
+                    {
+                        int dumpLen = System.Math.Min(MAX_DUMP_LENGTH, runStart - x);
+                        destBytes[destOffset++] = (byte)dumpLen;
+                        for (int srcPixOffset = channelOffset + x * 4; dumpLen > 0; dumpLen--, x++, srcPixOffset += 4)
+                            destBytes[destOffset++] = srcRawPixels[srcPixOffset];
+                    }
+
+                    // write the run
+                    if (runLen >= MIN_RUN_LENGTH)
+                    {
+                        destBytes[destOffset++] = (byte)(128 + runLen);
+                        destBytes[destOffset++] = srcRawPixels[channelOffset + x * 4];
+                        x += runLen;
+                    }
+                }
+            }
+
+            return destOffset - startOffset;
+        }
+
+        private int GetMaxEncodedScanlineSize()
+        {
+            // 4 bytes of scanline header, plus the worst case in which each channel is stored as a sequence of dumps
+            return 4 + 4 * (Header.Width + (Header.Width + MAX_DUMP_LENGTH - 1) / MAX_DUMP_LENGTH);
+        }
+
+        private bool CanBeRunLengthEncoded
+        {
+            get { return Header.Width >= 8 && Header.Width < 0x8000; }
+        }
+
+        private void WriteScanline(byte[] srcRawPixels, int srcOffset, int y)
+        {
+            Buffer.BlockCopy(srcRawPixels, srcOffset, colorBytes, scanlineOffsets[y], Header.Width * 4);
         }
 
         ScanlineType ReadScanlineType(ref int fileDataOffset)
@@ -253,19 +412,47 @@ namespace Dragonfly.BaseModule
         {
             if (colorBytes[fileDataOffset] == 1 && colorBytes[fileDataOffset + 1] == 1 && colorBytes[fileDataOffset + 2] == 1)
                 return ScanlineType.LegacyRunLength;
-            if (colorBytes[fileDataOffset] == 2 && colorBytes[fileDataOffset + 1] == 2)
+            if (colorBytes[fileDataOffset] == 2 && colorBytes[fileDataOffset + 1] == 2 && (colorBytes[fileDataOffset + 2] << 8 | colorBytes[fileDataOffset + 3]) == Header.Width)
                 return ScanlineType.NewRunLenght;
 
             return ScanlineType.Uncompressed;
         }
 
+        /// <summary>
+        /// Save this image to the specified path. Uncompressed images are run-length encoded in parallel.
+        /// </summary>
         public void Save(string filePath)
         {
-            using (FileStream fs = new FileStream(filePath, FileMode.OpenOrCreate, FileAccess.Write))
+            using (FileStream fs = new FileStream(filePath, FileMode.Create, FileAccess.Write))
             {
                 BinaryWriter writer = new BinaryWriter(fs);
                 WriteHeader(writer);
-                writer.Write(colorBytes);
+
+                if (IsCompressed || !CanBeRunLengthEncoded)
+                {
+                    // already encoded, or not supported by the run-length encoding
+                    writer.Write(colorBytes, dataStart, colorBytes.Length - dataStart);
+                    return;
+                }
+
+                // encode each block of scanlines to a separate buffer
+                int blockCount = (Header.Height + SCANLINE_BLOCK_SIZE - 1) / SCANLINE_BLOCK_SIZE;
+                byte[][] encodedBlocks = new byte[blockCount][];
+                int[] encodedBlockSizes = new int[blockCount];
+                ForEachScanlineBlock((fromY, toY) =>
+                {
+                    int blockID = fromY / SCANLINE_BLOCK_SIZE, blockSize = 0;
+                    byte[] encodedBytes = new byte[(toY - fromY) * GetMaxEncodedScanlineSize()];
+                    for (int y = fromY; y < toY; y++)
+                        blockSize += EncodeRunLengthScanline(colorBytes, scanlineOffsets[y], encodedBytes, blockSize);
+
+                    encodedBlocks[blockID] = encodedBytes;
+                    encodedBlockSizes[blockID] = blockSize;
+                });
+
+                // write blocks in order
+                for (int i = 0; i < blockCount; i++)
+                    writer.Write(encodedBlocks[i], 0, encodedBlockSizes[i]);
             }
         }
 
@@ -280,7 +467,7 @@ namespace Dragonfly.BaseModule
             ThrowIfCompressed();
 
             Byte4 rgbe = ColorEncoding.EncodeHdr(rgb, RGBE.Encoder);
-            long pixelOffset = 4 * (x + y * Header.Width);
+            long pixelOffset = dataStart + 4 * (x + y * Header.Width);
             colorBytes[pixelOffset + 0] = rgbe.R;
             colorBytes[pixelOffset + 1] = rgbe.G;
             colorBytes[pixelOffset + 2] = rgbe.B;
@@ -291,7 +478,7 @@ namespace Dragonfly.BaseModule
         {
             ThrowIfCompressed();
 
-            long pixelOffset = 4 * (x + y * Header.Width);
+            long pixelOffset = dataStart + 4 * (x + y * Header.Width);
             Byte4 rgbe;
             rgbe.R = colorBytes[pixelOffset + 0];
             rgbe.G = colorBytes[pixelOffset + 1];
@@ -308,7 +495,7 @@ namespace Dragonfly.BaseModule
             if (data.Length != Header.Width * Header.Height * 4)
                 throw new Exception("The provided array is not of the right size!");
 
-            Array.Copy(data, 0, colorBytes, 0, data.Length);
+            Buffer.BlockCopy(data, 0, colorBytes, dataStart, data.Length);
         }
 
         /// <summary>
@@ -322,12 +509,15 @@ namespace Dragonfly.BaseModule
                 throw new ArgumentException("The specified buffer is of an invalid length (should be equal to width * height * 3)");
 
             // encode all the image scanlines
-            byte[] destRawPixels = new byte[Header.Width * 4];
-            for (int y = 0, dataOffset = 0, rgbOffset = 0; y < Header.Height; y++, rgbOffset += 3 * Header.Width)
+            ForEachScanlineBlock((fromY, toY) =>
             {
-                EncodeScanline(srcRgbPixels, rgbOffset, destRawPixels, 0);
-                WriteScanline(destRawPixels, 0, ref dataOffset);
-            }
+                byte[] destRawPixels = new byte[Header.Width * 4];
+                for (int y = fromY; y < toY; y++)
+                {
+                    EncodeScanline(srcRgbPixels, y * Header.Width * 3, destRawPixels, 0);
+                    WriteScanline(destRawPixels, 0, y);
+                }
+            });
         }
 
         /// <summary>
@@ -335,6 +525,17 @@ namespace Dragonfly.BaseModule
         /// </summary>
         public byte[] GetRGBEDataPtr()
         {
+            if (dataStart > 0)
+            {
+                // images parsed from memory share their array with the file header: copy the color data to a separate one
+                byte[] dataBytes = new byte[colorBytes.Length - dataStart];
+                Buffer.BlockCopy(colorBytes, dataStart, dataBytes, 0, dataBytes.Length);
+                for (int y = 0; y < scanlineOffsets.Length; y++)
+                    scanlineOffsets[y] -= dataStart;
+                colorBytes = dataBytes;
+                dataStart = 0;
+            }
+
             return colorBytes;
         }
 
@@ -355,5 +556,28 @@ namespace Dragonfly.BaseModule
             LegacyRunLength,
             NewRunLenght
         }
+
+        private delegate void ScanlineBlockOperation(int fromY, int toY);
+
+        private class ScanlineBlockBody : SlimParallel.IForBody
+        {
+            public ScanlineBlockOperation Operation;
+            public int Height;
+            public Exception Error; // first exception thrown by a block, rethrown to the calling thread
+
+            public void Execute(int i)
+            {
+                try
+                {
+                    int fromY = i * SCANLINE_BLOCK_SIZE;
+                    Operation(fromY, System.Math.Min(fromY + SCANLINE_BLOCK_SIZE, Height));
+                }
+                catch (Exception e)
+                {
+                    if (Error == null)
+                        Error = e;
+                }
+            }
+        }
     }
 }
@@ -0,0 +1,385 @@
+﻿using Dragonfly.Graphics.Math;
+using Dragonfly.Utils;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Runtime.InteropServices;
+
+namespace Dragonfly.BaseModule
+{
+    /// <summary>
+    /// A binary cache of the meshes converted from an obj file, that can be loaded with a single read and without parsing.
+    /// Stores interleaved VertexTexNorm vertices and 32-bit indices for all the meshes, followed by the ranges used by each mesh, their material and optimization statistics.
+    /// </summary>
+    internal class MeshCacheFile
+    {
+        public const string Extension = ".dfmesh";
+        private const int FILE_TOKEN = 0x434D4644; // "DFMC"
+        private const int VERSION = 3;
+
+        /// <summary>
+        /// Size of the range at the start of the file that usually contains the whole header, which can be read to validate the cache before loading its data.
+        /// </summary>
+        public const int HeaderReadSize = 4096;
+
+        public MeshCacheFile()
+        {
+            Sources = new List<SourceFile>();
+            Ranges = new List<MeshRange>();
+        }
+
+        /// <summary>
+        /// The files from which the meshes were created. The cache is out of date if any of them has been modified.
+        /// </summary>
+        public List<SourceFile> Sources { get; private set; }
+
+        /// <summary>
+        /// The face orientation setting used to create the cached indices.
+        /// </summary>
+        public bool ChangeFaceOrientation { get; set; }
+
+        /// <summary>
+        /// True if the obj groups that share the same material have been merged into a single mesh.
+        /// </summary>
+        public bool MergeGroupsByMaterial { get; set; }
+
+        /// <summary>
+        /// True if the cached meshes have not been optimized for rendering.
+        /// </summary>
+        public bool DisableMeshOptimization { get; set; }
+
+        public VertexTexNorm[] Vertices { get; set; }
+
+        public uint[] Indices { get; set; }
+
+        public AABox Bounds { get; set; }
+
+        public List<MeshRange> Ranges { get; private set; }
+
+        public void AddSource(string filePath)
+        {
+            FileInfo info = new FileInfo(filePath);
+            Sources.Add(new SourceFile() { Path = filePath, Length = info.Length, LastWriteTicks = info.LastWriteTimeUtc.Ticks });
+        }
+
+        /// <summary>
+        /// Returns true if all the source files still exist unmodified.
+        /// </summary>
+        public bool IsUpToDate()
+        {
+            foreach (SourceFile src in Sources)
+            {
+                FileInfo info = new FileInfo(src.Path);
+                if (!info.Exists || info.Length != src.Length || info.LastWriteTimeUtc.Ticks != src.LastWriteTicks)
+                    return false;
+            }
+            return true;
+        }
+
+        /// <summary>
+        /// Invert the winding of all the cached triangles.
+        /// </summary>
+        public void FlipFaceOrientation()
+        {
+            for (int i = 0; i + 2 < Indices.Length; i += 3)
+            {
+                uint tmp = Indices[i + 1];
+                Indices[i + 1] = Indices[i + 2];
+                Indices[i + 2] = tmp;
+            }
+            ChangeFaceOrientation = !ChangeFaceOrientation;
+        }
+
+        public void Save(string filePath)
+        {
+            using (FileStream fs = new FileStream(filePath, FileMode.Create, FileAccess.Write))
+            {
+                BinaryWriter writer = new BinaryWriter(fs);
+                writer.Write(FILE_TOKEN);
+                writer.Write(VERSION);
+                writer.Write(Marshal.SizeOf(typeof(VertexTexNorm)));
+                writer.Write(ChangeFaceOrientation);
+                writer.Write(MergeGroupsByMaterial);
+                writer.Write(DisableMeshOptimization);
+
+                // source files
+                writer.Write(Sources.Count);
+                foreach (SourceFile src in Sources)
+                {
+                    writer.Write(src.Path);
+                    writer.Write(src.Length);
+                    writer.Write(src.LastWriteTicks);
+                }
+
+                // mesh ranges
+                WriteBox(writer, Bounds);
+                writer.Write(Vertices.Length);
+                writer.Write(Indices.Length);
+                writer.Write(Ranges.Count);
+                foreach (MeshRange r in Ranges)
+                {
+                    writer.Write(r.Name);
+                    WriteMaterial(writer, r.Material);
+                    writer.Write(r.VertexStart);
+                    writer.Write(r.VertexCount);
+                    writer.Write(r.IndexStart);
+                    writer.Write(r.IndexCount);
+                    WriteBox(writer, r.Bounds);
+                    WriteStats(writer, r.OptimizationStats);
+                }
+
+                // vertex and index data
+                writer.Write(ToBytes(Vertices, Vertices.Length * Marshal.SizeOf(typeof(VertexTexNorm))));
+                writer.Write(ToBytes(Indices, Indices.Length * sizeof(uint)));
+            }
+        }
+
+        /// <summary>
+        /// Load a cache from the content of its file. Returns false if the file is corrupted or has been created by a different version of this format.
+        /// </summary>
+        public static bool TryLoad(byte[] fileBytes, out MeshCacheFile cache)
+        {
+            cache = null;
+            try
+            {
+                using (MemoryStream ms = new MemoryStream(fileBytes, false))
+                {
+                    BinaryReader reader = new BinaryReader(ms);
+                    MeshCacheFile loaded = ReadHeader(reader);
+                    if (loaded == null)
+                        return false;
+
+                    // mesh ranges
+                    loaded.Bounds = ReadBox(reader);
+                    int vertexCount = reader.ReadInt32(), indexCount = reader.ReadInt32(), rangeCount = reader.ReadInt32();
+                    for (int i = 0; i < rangeCount; i++)
+                    {
+                        MeshRange r = new MeshRange();
+                        r.Name = reader.ReadString();
+                        r.Material = ReadMaterial(reader);
+                        r.VertexStart = reader.ReadInt32();
+                        r.VertexCount = reader.ReadInt32();
+                        r.IndexStart = reader.ReadInt32();
+                        r.IndexCount = reader.ReadInt32();
+                        r.Bounds = ReadBox(reader);
+                        r.OptimizationStats = ReadStats(reader);
+                        if (r.VertexStart < 0 || r.VertexCount < 0 || r.VertexStart > vertexCount - r.VertexCount || r.IndexStart < 0 || r.IndexCount < 0 || r.IndexStart > indexCount - r.IndexCount)
+                            return false;
+                        loaded.Ranges.Add(r);
+                    }
+
+                    // vertex and index data are copied directly from the file bytes
+                    int dataOffset = (int)ms.Position;
+                    int vertexByteSize = vertexCount * Marshal.SizeOf(typeof(VertexTexNorm)), indexByteSize = indexCount * sizeof(uint);
+                    if (dataOffset + vertexByteSize + indexByteSize != fileBytes.Length)
+                        return false;
+                    loaded.Vertices = new VertexTexNorm[vertexCount];
+                    FromBytes(fileBytes, dataOffset, loaded.Vertices, vertexByteSize);
+                    loaded.Indices = new uint[indexCount];
+                    Buffer.BlockCopy(fileBytes, dataOffset + vertexByteSize, loaded.Indices, 0, indexByteSize);
+
+                    // indices are relative to the range vertices
+                    foreach (MeshRange r in loaded.Ranges)
+                        for (int i = r.IndexStart; i < r.IndexStart + r.IndexCount; i++)
+                            if (loaded.Indices[i] >= (uint)r.VertexCount)
+                                return false;
+
+                    cache = loaded;
+                    return true;
+                }
+            }
+            catch (Exception)
+            {
+                // any decoding failure (truncated data, invalid strings or sizes) means that the cache must be created again
+                return false;
+            }
+        }
+
+        /// <summary>
+        /// Load only the settings and the source files of a cache from the start of its file, without meshes. 
+        /// Returns false if the header is corrupted, has been created by a different version of this format, or does not fit in the specified data.
+        /// </summary>
+        public static bool TryReadHeader(ArrayRange<byte> headerBytes, out MeshCacheFile header)
+        {
+            header = null;
+            try
+            {
+                using (MemoryStream ms = new MemoryStream(headerBytes.Buffer, headerBytes.StartIndex, headerBytes.Count, false))
+                {
+                    header = ReadHeader(new BinaryReader(ms));
+                    return header != null;
+                }
+            }
+            catch (Exception)
+            {
+                return false; // truncated or invalid
+            }
+        }
+
+        private static MeshCacheFile ReadHeader(BinaryReader reader)
+        {
+            if (reader.ReadInt32() != FILE_TOKEN || reader.ReadInt32() != VERSION || reader.ReadInt32() != Marshal.SizeOf(typeof(VertexTexNorm)))
+                return null;
+
+            MeshCacheFile header = new MeshCacheFile();
+            header.ChangeFaceOrientation = reader.ReadBoolean();
+            header.MergeGroupsByMaterial = reader.ReadBoolean();
+            header.DisableMeshOptimization = reader.ReadBoolean();
+
+            // source files
+            int sourceCount = reader.ReadInt32();
+            for (int i = 0; i < sourceCount; i++)
+                header.Sources.Add(new SourceFile() { Path = reader.ReadString(), Length = reader.ReadInt64(), LastWriteTicks = reader.ReadInt64() });
+            return header;
+        }
+
+        private static byte[] ToBytes<T>(T[] values, int byteSize) where T : struct
+        {
+            byte[] bytes = new byte[byteSize];
+            GCHandle pinned = GCHandle.Alloc(values, GCHandleType.Pinned);
+            try
+            {
+                Marshal.Copy(pinned.AddrOfPinnedObject(), bytes, 0, byteSize);
+            }
+            finally
+            {
+                pinned.Free();
+            }
+            return bytes;
+        }
+
+        private static void FromBytes<T>(byte[] bytes, int offset, T[] destValues, int byteSize) where T : struct
+        {
+            GCHandle pinned = GCHandle.Alloc(destValues, GCHandleType.Pinned);
+            try
+            {
+                Marshal.Copy(bytes, offset, pinned.AddrOfPinnedObject(), byteSize);
+            }
+            finally
+            {
+                pinned.Free();
+            }
+        }
+
+        private static void WriteBox(BinaryWriter writer, AABox box)
+        {
+            WriteFloat3(writer, box.Min);
+            WriteFloat3(writer, box.Max);
+        }
+
+        private static AABox ReadBox(BinaryReader reader)
+        {
+            return new AABox(ReadFloat3(reader), ReadFloat3(reader));
+        }
+
+        private static void WriteFloat3(BinaryWriter writer, Float3 value)
+        {
+            writer.Write(value.X);
+            writer.Write(value.Y);
+            writer.Write(value.Z);
+        }
+
+        private static Float3 ReadFloat3(BinaryReader reader)
+        {
+            return new Float3(reader.ReadSingle(), reader.ReadSingle(), reader.ReadSingle());
+        }
+
+        private static void WriteStats(BinaryWriter writer, MeshOptimizationStats stats)
+        {
+            writer.Write(stats.TriangleCount);
+            writer.Write(stats.VertexCountBefore);
+            writer.Write(stats.VertexCountAfter);
+            writer.Write(stats.ACMRBefore);
+            writer.Write(stats.ACMRAfter);
+            writer.Write(stats.ATVRBefore);
+            writer.Write(stats.ATVRAfter);
+        }
+
+        private static MeshOptimizationStats ReadStats(BinaryReader reader)
+        {
+            MeshOptimizationStats stats = new MeshOptimizationStats();
+            stats.TriangleCount = reader.ReadInt32();
+            stats.VertexCountBefore = reader.ReadInt32();
+            stats.VertexCountAfter = reader.ReadInt32();
+            stats.ACMRBefore = reader.ReadSingle();
+            stats.ACMRAfter = reader.ReadSingle();
+            stats.ATVRBefore = reader.ReadSingle();
+            stats.ATVRAfter = reader.ReadSingle();
+            return stats;
+        }
+
+        private static void WriteMaterial(BinaryWriter writer, ObjMaterial m)
+        {
+            writer.Write(m != null);
+            if (m == null)
+                return;
+
+            writer.Write(m.Name);
+            WriteFloat3(writer, m.AmbientColor);
+            WriteFloat3(writer, m.DiffuseColor);
+            WriteFloat3(writer, m.SpecularColor);
+            writer.Write(m.SpecularCoefficient);
+            writer.Write(m.Transparency);
+            writer.Write(m.IlluminationModel);
+            foreach (string mapPath in new string[] { m.AmbientTextureMap, m.DiffuseTextureMap, m.SpecularTextureMap, m.SpecularHighlightTextureMap, m.BumpMap, m.DisplacementMap, m.StencilDecalMap, m.AlphaTextureMap, m.NormalMap, m.RoughnessMap, m.Cull })
+                WriteOptionalString(writer, mapPath);
+        }
+
+        private static ObjMaterial ReadMaterial(BinaryReader reader)
+        {
+            if (!reader.ReadBoolean())
+                return null;
+
+            ObjMaterial m = new ObjMaterial(reader.ReadString());
+            m.AmbientColor = ReadFloat3(reader);
+            m.DiffuseColor = ReadFloat3(reader);
+            m.SpecularColor = ReadFloat3(reader);
+            m.SpecularCoefficient = reader.ReadSingle();
+            m.Transparency = reader.ReadSingle();
+            m.IlluminationModel = reader.ReadInt32();
+            m.AmbientTextureMap = ReadOptionalString(reader);
+            m.DiffuseTextureMap = ReadOptionalString(reader);
+            m.SpecularTextureMap = ReadOptionalString(reader);
+            m.SpecularHighlightTextureMap = ReadOptionalString(reader);
+            m.BumpMap = ReadOptionalString(reader);
+            m.DisplacementMap = ReadOptionalString(reader);
+            m.StencilDecalMap = ReadOptionalString(reader);
+            m.AlphaTextureMap = ReadOptionalString(reader);
+            m.NormalMap = ReadOptionalString(reader);
+            m.RoughnessMap = ReadOptionalString(reader);
+            m.Cull = ReadOptionalString(reader);
+            return m;
+        }
+
+        private static void WriteOptionalString(BinaryWriter writer, string value)
+        {
+            writer.Write(value != null);
+            if (value != null)
+                writer.Write(value);
+        }
+
+        private static string ReadOptionalString(BinaryReader reader)
+        {
+            return reader.ReadBoolean() ? reader.ReadString() : null;
+        }
+
+        public struct SourceFile
+        {
+            public string Path;
+            public long Length, LastWriteTicks;
+        }
+
+        /// <summary>
+        /// The vertices and indices of a single mesh. Indices are relative to the first vertex of the range.
+        /// </summary>
+        public class MeshRange
+        {
+            public string Name; // unique name of the mesh in the source file
+            public ObjMaterial Material;
+            public int VertexStart, VertexCount;
+            public int IndexStart, IndexCount;
+            public AABox Bounds;
+            public MeshOptimizationStats OptimizationStats; // empty if the mesh has not been optimized
+        }
+    }
+}
@@ -3,32 +3,41 @@ using Dragonfly.Utils;
 using System;
 using System.Collections.Generic;
 using System.IO;
+using System.Runtime.ExceptionServices;
 using System.Text;
 using System.Text.RegularExpressions;
+using System.Threading;
 
 namespace Dragonfly.BaseModule
 {
     internal class ObjFile : ILoadedFileHandler
     {
+        private const int MIN_CHUNK_SIZE = 256 * 1024; // minimum size in bytes of the obj portions parsed in parallel
         private static char[] objNewLineChars = new char[] { '\n', '\r' };
         private static char[] objValueSeparatorChars = new char[] { ' ', '\t' };
-        private static char[] objVertexElemsSeparator = new char[] { '/' };
+        private static double[] powersOf10;
+
+        static ObjFile()
+        {
+            powersOf10 = new double[23];
+            powersOf10[0] = 1;
+            for (int i = 1; i < powersOf10.Length; i++)
+                powersOf10[i] = powersOf10[i - 1] * 10;
+        }
 
         // parser state
         private Dictionary<MutableStringRange, Action<MutableStringRange>> commands;
         private Action<ObjFile> onLoadingComplete;
 
         // obj file loading state
-        private bool objLoaded;
         private int mtlLeftToLoad;
-        private MutableString objFileContent;
-        private MutableString mtlFilesContent;
+        private ObjChunk[] objChunks;
+        private string[] mtlFilesContent; // material libraries content, in the order they are referenced
 
         // obj parsing state
         private ObjGroup curGroup;
         private int lastGrpDefIndex;
         private int nextGrpID;
-        private List<ObjVertex> faceCache;
 
         // parsed state
         public List<Float3> Vertices { get; private set; }
@@ -45,8 +54,18 @@ namespace Dragonfly.BaseModule
 
         public bool Loaded { get; private set; }
 
+        /// <summary>
+        /// The exception that stopped the loading of this file, if any. The completion callback is called with Loaded set to false in this case.
+        /// </summary>
+        public Exception Error { get; private set; }
+
         public string FilePath { get; private set; }
 
+        /// <summary>
+        /// The paths of the obj file and of all the material libraries it references.
+        /// </summary>
+        public List<string> SourceFiles { get; private set; }
+
         public ObjFile()
         {
             MutableString cmdNameBuff = new MutableString();
@@ -76,122 +95,165 @@ namespace Dragonfly.BaseModule
             commands[cmdNameBuff.AppendAsRange("cull")] = args => LastMaterial.Cull = args.ToString();
             commands[cmdNameBuff.AppendAsRange("map_Pr")] = args => LastMaterial.RoughnessMap = args.ToString();
 
-            // object commands
-            commands[cmdNameBuff.AppendAsRange("v")] = args => Vertices.Add(Parse_Float3(args));
-            commands[cmdNameBuff.AppendAsRange("vt")] = args => TexCoords.Add(Parse_Float2(args));
-            commands[cmdNameBuff.AppendAsRange("vn")] = args => Normals.Add(Parse_Float3(args));
-            commands[cmdNameBuff.AppendAsRange("usemtl")] = Parse_usemtl;
-            commands[cmdNameBuff.AppendAsRange("g")] = Parse_g;
-            commands[cmdNameBuff.AppendAsRange("f")] = Parse_f;
-
             // prepare parsed state
             Vertices = new List<Float3>();
             TexCoords = new List<Float2>();
             Normals = new List<Float3>();
             Groups = new List<ObjGroup>();
             Materials = new List<ObjMaterial>();
+            SourceFiles = new List<string>();
             curGroup = new ObjGroup();
             curGroup.Name = "default" + nextGrpID;
             Groups.Add(curGroup);
-            faceCache = new List<ObjVertex>();
         }
 
         public void LoadFromFile(string objFilePath, Action<ObjFile> onLoadingComplete)
         {
             this.onLoadingComplete = onLoadingComplete;
-            AsyncFileLoader.LoadFile(objFilePath, this, false);
             FilePath = objFilePath;
+            SourceFiles.Add(objFilePath);
+            IOScheduler.Default.RequestFile(0, objFilePath, this, true, IOPriority.Nearby);
         }
 
-        public void OnFileLoaded(int requestID, string filePath, string loadedText)
+        public void OnFileLoaded(int requestID, string filePath, byte[] loadedBytes) // === OBJ FILE LOADED
         {
-            if (!objLoaded) // === OBJ FILE LOADED
+            try
             {
-                objLoaded = true;
-                objFileContent = new MutableString(loadedText);
-                
-                // search for material libraries
-                List<string> matLibraries = new List<string>();
-                MutableStringRange objStream = objFileContent.FullRange;
-                do
-                {
-                    MutableStringRange objLine = objStream.SplitAt(objNewLineChars, out objStream).Trim();
-
-                    if (objLine.Size == 0 || !objLine.StartsWith("mtllib "))
-                        continue;
-
-                    MutableStringRange matlibName;
-                    objLine.SplitAt(objValueSeparatorChars, out matlibName);
-                    matLibraries.Add(matlibName.ToString());
+                ParseObj(loadedBytes);
+            }
+            catch (Exception e)
+            {
+                OnLoadingFailed(e);
+                throw;
+            }
 
-                } while (objStream.Size > 0);
+            // search for material libraries
+            List<string> matLibraries = new List<string>();
+            foreach (ObjChunk chunk in objChunks)
+                foreach (ObjStatement s in chunk.Statements)
+                    if (s.Type == ObjStatementType.MaterialLibrary)
+                        matLibraries.Add(s.Args);
 
-                if (matLibraries.Count > 0)
-                {
-                    // start loading mtls 
-                    mtlFilesContent = new MutableString("");
-                    mtlLeftToLoad = matLibraries.Count;
-                    string mtlDir = Path.GetDirectoryName(filePath);
-                    for (int i = 0; i < matLibraries.Count; i++)
-                        matLibraries[i] = Path.Combine(mtlDir, matLibraries[i]);
-                    AsyncFileLoader.LoadAllFiles(matLibraries.ToArray(), this, false);
-                }
-                else
-                {
-                    ParseLines();
-                }
+            if (matLibraries.Count > 0)
+            {
+                // start loading mtls, the library index is used as request ID
+                mtlFilesContent = new string[matLibraries.Count];
+                mtlLeftToLoad = matLibraries.Count;
+                string mtlDir = Path.GetDirectoryName(filePath);
+                for (int i = 0; i < matLibraries.Count; i++)
+                    matLibraries[i] = Path.Combine(mtlDir, matLibraries[i]);
+                SourceFiles.AddRange(matLibraries);
+                for (int i = 0; i < matLibraries.Count; i++)
+                    IOScheduler.Default.RequestFile(i, matLibraries[i], this, false, IOPriority.Nearby);
             }
-            else // === MTL FILE LOADED
+            else
             {
-                mtlFilesContent.Append(loadedText).AppendLine();
-                mtlLeftToLoad--;
-                if (mtlLeftToLoad == 0) 
-                    ParseLines();
+                ParseLines();
             }
         }
 
-        private void ParseLines()
+        public void OnFileLoaded(int requestID, string filePath, string loadedText) // === MTL FILE LOADED
         {
-            // parse materials
-            MutableStringRange mtlStream = mtlFilesContent.FullRange;
-            do
+            // libraries are read concurrently, and completed in any order
+            bool allLoaded;
+            lock (mtlFilesContent)
+            {
+                mtlFilesContent[requestID] = loadedText;
+                mtlLeftToLoad--;
+                allLoaded = mtlLeftToLoad == 0;
+            }
+
+            if (!allLoaded)
+                return;
+
+            try
+            {
+                ParseLines();
+            }
+            catch (Exception e)
             {
-                MutableStringRange mtlLine = mtlStream.SplitAt(objNewLineChars, out mtlStream).Trim();
+                OnLoadingFailed(e);
+                throw;
+            }
+        }
 
-                if (mtlLine.Size == 0 || mtlLine.StartsWith('#'))
-                    continue;
+        public void OnFileLoadFailed(int requestID, string filePath, Exception error)
+        {
+            OnLoadingFailed(error);
+        }
 
-                MutableStringRange args;
-                MutableStringRange cmdName = mtlLine.SplitAt(objValueSeparatorChars, out args).ToLower();
-                if (commands.ContainsKey(cmdName))
-                    commands[cmdName](args);
+        private void OnLoadingFailed(Exception error)
+        {
+            Error = error;
+            objChunks = null;
+            CallLoadingComplete();
+        }
 
-            } while (mtlStream.Size > 0);
+        /// <summary>
+        /// Call the completion callback, only the first time this is called.
+        /// </summary>
+        private void CallLoadingComplete()
+        {
+            Action<ObjFile> callback = Interlocked.Exchange(ref onLoadingComplete, null);
+            if (callback != null)
+                callback(this);
+        }
 
-            // parse obj
-            MutableStringRange objStream = objFileContent.FullRange;
-            do
+        private void ParseLines()
+        {
+            // parse materials, appending the libraries in the order they are referenced
+            if (mtlFilesContent != null)
             {
-                MutableStringRange objLine = objStream.SplitAt(objNewLineChars, out objStream).Trim();
+                MutableString mtlText = new MutableString("");
+                foreach (string mtlFileText in mtlFilesContent)
+                    mtlText.Append(mtlFileText).AppendLine();
+
+                MutableStringRange mtlStream = mtlText.FullRange;
+                do
+                {
+                    MutableStringRange mtlLine = mtlStream.SplitAt(objNewLineChars, out mtlStream).Trim();
 
-                if (objLine.Size == 0 || objLine.StartsWith('#'))
-                    continue;
+                    if (mtlLine.Size == 0 || mtlLine.StartsWith('#'))
+                        continue;
 
-                MutableStringRange args;
-                MutableStringRange cmdName = objLine.SplitAt(objValueSeparatorChars, out args).ToLower();
-                if (commands.ContainsKey(cmdName))
-                    commands[cmdName](args);
+                    MutableStringRange args;
+                    MutableStringRange cmdName = mtlLine.SplitAt(objValueSeparatorChars, out args).ToLower();
+                    if (commands.ContainsKey(cmdName))
+                        commands[cmdName](args);
 
-            } while (objStream.Size > 0);
+                } while (mtlStream.Size > 0);
+            }
+
+            // assign the parsed faces to their groups, in file order
+            foreach (ObjChunk chunk in objChunks)
+            {
+                int faceID = 0, cornerID = 0;
+                foreach (ObjStatement s in chunk.Statements)
+                {
+                    AddFacesToCurGroup(chunk, s.FaceCount, ref faceID, ref cornerID);
+                    if (s.Type == ObjStatementType.Group)
+                        Parse_g(s.Args);
+                    else if (s.Type == ObjStatementType.UseMaterial)
+                        Parse_usemtl(s.Args);
+                }
+                AddFacesToCurGroup(chunk, chunk.FaceSizes.Count, ref faceID, ref cornerID);
+            }
 
             // free memory and signal completion
             Loaded = true;
-            objFileContent = null;
+            objChunks = null;
             mtlFilesContent = null;
-            if (onLoadingComplete != null)
+            CallLoadingComplete();
+        }
+
+        private void AddFacesToCurGroup(ObjChunk chunk, int faceEnd, ref int faceID, ref int cornerID)
+        {
+            for (; faceID < faceEnd; faceID++)
             {
-                onLoadingComplete(this);
-                onLoadingComplete = null;
+                int faceSize = chunk.FaceSizes[faceID];
+                curGroup.Faces.Add(new ObjFace() { FirstVertex = curGroup.FaceVertices.Count, VertexCount = faceSize });
+                for (int cornerEnd = cornerID + faceSize; cornerID < cornerEnd; cornerID++)
+                    curGroup.FaceVertices.Add(chunk.FaceVertices[cornerID]);
             }
         }
 
@@ -219,52 +281,281 @@ namespace Dragonfly.BaseModule
             }
         }
 
-        #region STDs
+        #region Parallel obj parsing
 
-        private void Parse_newmtl(MutableStringRange args)
+        /// <summary>
+        /// Split the obj bytes in chunks at line boundaries, parse them in parallel and merge their vertex attributes.
+        /// Faces and group statements are kept in their chunks, and assigned to groups once the materials are available.
+        /// </summary>
+        private void ParseObj(byte[] objBytes)
         {
-            Materials.Add(new ObjMaterial(args.ToString()));
+            // skip the UTF-8 byte order mark, if any, so that it is not parsed as part of the first command
+            int dataStart = 0;
+            if (objBytes.Length >= 3 && objBytes[0] == 0xEF && objBytes[1] == 0xBB && objBytes[2] == 0xBF)
+                dataStart = 3;
+
+            // split the file in chunks that start at the beginning of a line
+            int chunkCount = Math.Max(1, Math.Min(objBytes.Length / MIN_CHUNK_SIZE, SlimParallel.WorkerCount * 4));
+            objChunks = new ObjChunk[chunkCount];
+            for (int i = 0, chunkStart = dataStart; i < chunkCount; i++)
+            {
+                int chunkEnd = objBytes.Length;
+                if (i < chunkCount - 1)
+                {
+                    chunkEnd = Array.IndexOf(objBytes, (byte)'\n', Math.Max(chunkStart, (int)((long)objBytes.Length * (i + 1) / chunkCount)));
+                    chunkEnd = chunkEnd < 0 ? objBytes.Length : chunkEnd + 1;
+                }
+                objChunks[i] = new ObjChunk() { Bytes = objBytes, From = chunkStart, To = chunkEnd };
+                chunkStart = chunkEnd;
+            }
+
+            // parse chunks
+            ObjChunkParsingBody parsingBody = new ObjChunkParsingBody() { Chunks = objChunks };
+            SlimParallel.For(0, chunkCount, 1, parsingBody);
+            if (parsingBody.Error != null)
+                ExceptionDispatchInfo.Capture(parsingBody.Error).Throw();
+
+            // merge vertex attributes, resolving the face indices relative to the chunk
+            foreach (ObjChunk chunk in objChunks)
+            {
+                for (int i = 0; i < chunk.RelativeIndices.Count; i++)
+                {
+                    int cornerID = chunk.RelativeIndices[i] / 3;
+                    ObjVertex v = chunk.FaceVertices[cornerID];
+                    switch (chunk.RelativeIndices[i] % 3)
+                    {
+                        case 0: v.VertexIndex += Vertices.Count; break;
+                        case 1: v.TexCoordIndex += TexCoords.Count; break;
+                        case 2: v.NormalIndex += Normals.Count; break;
+                    }
+                    chunk.FaceVertices[cornerID] = v;
+                }
+
+                Vertices.AddRange(chunk.Vertices);
+                TexCoords.AddRange(chunk.TexCoords);
+                Normals.AddRange(chunk.Normals);
+                chunk.Bytes = null;
+                chunk.Vertices = null;
+                chunk.TexCoords = null;
+                chunk.Normals = null;
+            }
         }
 
-        private Float3 Parse_Float3(MutableStringRange args)
+        private static void ParseChunk(ObjChunk c)
         {
-            MutableStringRange xStr = args.SplitAt(objValueSeparatorChars, out args);
-            MutableStringRange yStr = args.SplitAt(objValueSeparatorChars, out args);
-            MutableStringRange zStr = args;
-            return new Float3(xStr.ToFloat(), yStr.ToFloat(), zStr.ToFloat());
+            byte[] s = c.Bytes;
+            for (int lineStart = c.From; lineStart < c.To;)
+            {
+                int lineEnd = Array.IndexOf(s, (byte)'\n', lineStart, c.To - lineStart);
+                if (lineEnd < 0)
+                    lineEnd = c.To;
+
+                int i = lineStart;
+                SkipSpaces(s, ref i, lineEnd);
+                if (i < lineEnd && s[i] != '#')
+                    ParseLine(c, i, lineEnd);
+
+                lineStart = lineEnd + 1;
+            }
         }
 
-        private Float2 Parse_Float2(MutableStringRange args)
+        private static void ParseLine(ObjChunk c, int i, int end)
         {
-            MutableStringRange xStr = args.SplitAt(objValueSeparatorChars, out args);
-            MutableStringRange yStr = args;
-            return new Float2(xStr.ToFloat(), yStr.ToFloat());
+            byte[] s = c.Bytes;
+            if (IsCommand(s, i, end, "v"))
+            {
+                i += 1;
+                c.Vertices.Add(new Float3(ParseFloat(s, ref i, end), ParseFloat(s, ref i, end), ParseFloat(s, ref i, end)));
+            }
+            else if (IsCommand(s, i, end, "vt"))
+            {
+                i += 2;
+                c.TexCoords.Add(new Float2(ParseFloat(s, ref i, end), ParseFloat(s, ref i, end)));
+            }
+            else if (IsCommand(s, i, end, "vn"))
+            {
+                i += 2;
+                c.Normals.Add(new Float3(ParseFloat(s, ref i, end), ParseFloat(s, ref i, end), ParseFloat(s, ref i, end)));
+            }
+            else if (IsCommand(s, i, end, "f"))
+            {
+                i += 1;
+                int faceSize = 0;
+                for (SkipSpaces(s, ref i, end); i < end; SkipSpaces(s, ref i, end))
+                {
+                    // parse a v/vt/vn triplet, where vt and vn are optional
+                    int cornerID = c.FaceVertices.Count;
+                    ObjVertex v = new ObjVertex();
+                    v.VertexIndex = ParseIndex(c, s, ref i, end, c.Vertices.Count, cornerID * 3);
+                    if (i < end && s[i] == '/')
+                    {
+                        i++;
+                        if (i < end && s[i] != '/')
+                            v.TexCoordIndex = ParseIndex(c, s, ref i, end, c.TexCoords.Count, cornerID * 3 + 1);
+                        if (i < end && s[i] == '/')
+                        {
+                            i++;
+                            v.NormalIndex = ParseIndex(c, s, ref i, end, c.Normals.Count, cornerID * 3 + 2);
+                        }
+                    }
+
+                    // skip any unexpected character up to the next vertex
+                    for (; i < end && !IsSpace(s[i]); i++) ;
+
+                    c.FaceVertices.Add(v);
+                    faceSize++;
+                }
+                c.FaceSizes.Add(faceSize);
+            }
+            else if (IsCommand(s, i, end, "g"))
+            {
+                c.AddStatement(ObjStatementType.Group, s, i + 1, end);
+            }
+            else if (IsCommand(s, i, end, "usemtl"))
+            {
+                c.AddStatement(ObjStatementType.UseMaterial, s, i + 6, end);
+            }
+            else if (IsCommand(s, i, end, "mtllib"))
+            {
+                c.AddStatement(ObjStatementType.MaterialLibrary, s, i + 6, end);
+            }
         }
 
-        private void Parse_f(MutableStringRange args)
+        /// <summary>
+        /// Parse a 1-based obj index. Negative indices are relative to the attributes declared before them, and are resolved to the chunk attributes, recording their position for a later fix-up.
+        /// </summary>
+        private static int ParseIndex(ObjChunk c, byte[] s, ref int i, int end, int chunkAttribCount, int indexPosition)
         {
-            faceCache.Clear();
-            do
+            int index = ParseInt(s, ref i, end);
+            if (index < 0)
             {
-                MutableStringRange vertexStr = args.SplitAt(objValueSeparatorChars, out args).Trim();
+                index += chunkAttribCount + 1;
+                c.RelativeIndices.Add(indexPosition);
+            }
+            return index;
+        }
+
+        private static bool IsCommand(byte[] s, int i, int end, string name)
+        {
+            if (end - i < name.Length)
+                return false;
+            for (int ci = 0; ci < name.Length; ci++)
+                if ((s[i + ci] | 0x20) != name[ci])
+                    return false; // case insensitive compare
+            return i + name.Length == end || IsSpace(s[i + name.Length]);
+        }
+
+        private static bool IsSpace(byte c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
 
-                if (vertexStr.Size > 0)
+        private static bool IsDigit(byte c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        private static void SkipSpaces(byte[] s, ref int i, int end)
+        {
+            for (; i < end && IsSpace(s[i]); i++) ;
+        }
+
+        private static int ParseInt(byte[] s, ref int i, int end)
+        {
+            SkipSpaces(s, ref i, end);
+            bool negative = false;
+            if (i < end && (s[i] == '-' || s[i] == '+'))
+                negative = s[i++] == '-';
+
+            int value = 0;
+            for (; i < end && IsDigit(s[i]); i++)
+                value = value * 10 + (s[i] - '0');
+            return negative ? -value : value;
+        }
+
+        private static float ParseFloat(byte[] s, ref int i, int end)
+        {
+            SkipSpaces(s, ref i, end);
+            bool negative = false;
+            if (i < end && (s[i] == '-' || s[i] == '+'))
+                negative = s[i++] == '-';
+
+            // read up to 18 significant digits as an integer, and the position of the decimal point as an exponent
+            long mantissa = 0;
+            int exponent = 0, digitCount = 0;
+            for (; i < end && IsDigit(s[i]); i++)
+            {
+                if (digitCount < 18)
                 {
-                    ObjVertex v;
-                    v.VertexIndex = vertexStr.SplitAt(objVertexElemsSeparator, out vertexStr).ToInt();
-                    v.TexCoordIndex = vertexStr.SplitAt(objVertexElemsSeparator, out vertexStr).ToInt();
-                    v.NormalIndex = vertexStr.SplitAt(objVertexElemsSeparator, out vertexStr).ToInt();
-                    faceCache.Add(v);
+                    mantissa = mantissa * 10 + (s[i] - '0');
+                    if (mantissa > 0) digitCount++;
                 }
-            } while (args.Size > 0);
+                else exponent++;
+            }
+            if (i < end && s[i] == '.')
+            {
+                for (i++; i < end && IsDigit(s[i]); i++)
+                {
+                    if (digitCount < 18)
+                    {
+                        mantissa = mantissa * 10 + (s[i] - '0');
+                        if (mantissa > 0) digitCount++;
+                        exponent--;
+                    }
+                }
+            }
+            if (i < end && (s[i] == 'e' || s[i] == 'E'))
+            {
+                i++;
+                exponent += ParseInt(s, ref i, end);
+            }
 
-            curGroup.Faces.Add(new ObjFace() { Vertices = faceCache.ToArray() });
+            double value = mantissa;
+            if (exponent > 0)
+                value *= exponent < powersOf10.Length ? powersOf10[exponent] : Math.Pow(10, exponent);
+            else if (exponent < 0)
+                value /= -exponent < powersOf10.Length ? powersOf10[-exponent] : Math.Pow(10, -exponent);
+            return (float)(negative ? -value : value);
         }
 
-        private void Parse_usemtl(MutableStringRange args)
+        private class ObjChunkParsingBody : SlimParallel.IForBody
         {
-            string matName = args.ToString();
+            public ObjChunk[] Chunks;
+            public Exception Error; // first exception thrown by a chunk, rethrown to the loading thread
 
+            public void Execute(int i)
+            {
+                try
+                {
+                    ParseChunk(Chunks[i]);
+                }
+                catch (Exception e)
+                {
+                    if (Error == null)
+                        Error = e;
+                }
+            }
+        }
+
+        #endregion
+
+        #region STDs
+
+        private void Parse_newmtl(MutableStringRange args)
+        {
+            Materials.Add(new ObjMaterial(args.ToString()));
+        }
+
+        private Float3 Parse_Float3(MutableStringRange args)
+        {
+            MutableStringRange xStr = args.SplitAt(objValueSeparatorChars, out args);
+            MutableStringRange yStr = args.SplitAt(objValueSeparatorChars, out args);
+            MutableStringRange zStr = args;
+            return new Float3(xStr.ToFloat(), yStr.ToFloat(), zStr.ToFloat());
+        }
+
+        private void Parse_usemtl(string matName)
+        {
             // search and reuse a compatible default or last declared group
             ObjGroup compatibleGrp = null;
             for (int i = lastGrpDefIndex; i < Groups.Count; i++)
@@ -288,11 +579,11 @@ namespace Dragonfly.BaseModule
             }
         }
 
-        private void Parse_g(MutableStringRange args)
+        private void Parse_g(string groupName)
         {
             if (curGroup.Faces.Count > 0)
                 CreateNewDefaultGroup();
-            curGroup.Name = args.ToString();
+            curGroup.Name = groupName;
             lastGrpDefIndex = Groups.Count - 1;
         }
 
@@ -305,17 +596,70 @@ namespace Dragonfly.BaseModule
             Groups.Add(curGroup);
         }
 
-        public void OnFileLoaded(int requestID, string filePath, byte[] loadedBytes) { throw new NotImplementedException(); }
+        /// <summary>
+        /// A portion of the obj file, parsed independently from the others.
+        /// </summary>
+        private class ObjChunk
+        {
+            public byte[] Bytes;
+            public int From, To;
+            public List<Float3> Vertices = new List<Float3>();
+            public List<Float2> TexCoords = new List<Float2>();
+            public List<Float3> Normals = new List<Float3>();
+            public List<ObjVertex> FaceVertices = new List<ObjVertex>();
+            public List<int> FaceSizes = new List<int>();
+            public List<ObjStatement> Statements = new List<ObjStatement>();
+            public List<int> RelativeIndices = new List<int>(); // positions of the indices relative to this chunk, as 3 * corner + attribute
+
+            public void AddStatement(ObjStatementType type, byte[] s, int argsStart, int argsEnd)
+            {
+                SkipSpaces(s, ref argsStart, argsEnd);
+                for (; argsEnd > argsStart && IsSpace(s[argsEnd - 1]); argsEnd--) ;
+                Statements.Add(new ObjStatement() { Type = type, Args = Encoding.UTF8.GetString(s, argsStart, argsEnd - argsStart), FaceCount = FaceSizes.Count });
+            }
+        }
+
+        private enum ObjStatementType
+        {
+            Group,
+            UseMaterial,
+            MaterialLibrary
+        }
+
+        private struct ObjStatement
+        {
+            public ObjStatementType Type;
+            public string Args;
+            public int FaceCount; // number of faces in the chunk that precede this statement
+        }
     }
 
-    public struct ObjVertex
+    public struct ObjVertex : IEquatable<ObjVertex>
     {
         public int VertexIndex, TexCoordIndex, NormalIndex;
+
+        public bool Equals(ObjVertex other)
+        {
+            return VertexIndex == other.VertexIndex && TexCoordIndex == other.TexCoordIndex && NormalIndex == other.NormalIndex;
+        }
+
+        public override bool Equals(object obj)
+        {
+            return obj is ObjVertex && Equals((ObjVertex)obj);
+        }
+
+        public override int GetHashCode()
+        {
+            return (VertexIndex * 73856093) ^ (TexCoordIndex * 19349663) ^ (NormalIndex * 83492791);
+        }
     }
 
+    /// <summary>
+    /// A polygon of an obj group, stored as a range of its FaceVertices list.
+    /// </summary>
     public struct ObjFace
     {
-        public ObjVertex[] Vertices;
+        public int FirstVertex, VertexCount;
     }
 
     public class ObjGroup
@@ -323,10 +667,12 @@ namespace Dragonfly.BaseModule
         public ObjGroup()
         {
             Faces = new List<ObjFace>();
+            FaceVertices = new List<ObjVertex>();
         }
 
         public string Name;
         public List<ObjFace> Faces;
+        public List<ObjVertex> FaceVertices;
         public ObjMaterial Material;
 
         public override string ToString() { return Name; }
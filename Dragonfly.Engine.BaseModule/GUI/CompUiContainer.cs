@@ -45,7 +45,9 @@ namespace Dragonfly.BaseModule
             // text renderering
             fontIndex = new TextSpriteIndex();
             string fontFolderPath = Context.GetResourcePath(Path.Combine("fonts", FontPackageName));
-            AsyncFileLoader.LoadAllFiles(Directory.GetFiles(fontFolderPath, "*.fnt"), new TextFileHandler(OnFontIndexLoaded), false);
+            TextFileHandler fontIndexHandler = new TextFileHandler(OnFontIndexLoaded);
+            foreach (string fontIndexPath in Directory.GetFiles(fontFolderPath, "*.fnt"))
+                IOScheduler.Default.RequestFile(0, fontIndexPath, fontIndexHandler, false, IOPriority.Visible);
             textMesh = CompUiControl.CreateMesh(Controls);
             textMesh.Active = false; // skip draw until text is available
             textMaterial = new CompMtlText(this, Path.Combine(fontFolderPath, FontPackageName + ".dds"));
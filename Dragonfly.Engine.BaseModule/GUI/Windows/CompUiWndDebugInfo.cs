@@ -30,7 +30,7 @@ namespace Dragonfly.BaseModule
 
         public int PolygonCount { get; private set; }
 
-        private CompUiCtrlLabel lblCamPos, lblCamTile, lblCamDir, lblFPS, lblCompCount, lblOthers, lblPolyCount, lblDrawCallCount, lblDrawableProcCount;
+        private CompUiCtrlLabel lblCamPos, lblCamTile, lblCamDir, lblFPS, lblCompCount, lblOthers, lblPolyCount, lblDrawCallCount, lblStateChangeCount, lblDrawableProcCount;
         private CompUiCtrlGraph fpsGraph;
 
         public CompUiWndDebugInfo(Component owner) : base(owner)
@@ -43,7 +43,7 @@ namespace Dragonfly.BaseModule
             BaseModUiSettings uiSettings = Context.GetModule<BaseMod>().Settings.UI;
 
             BaseMod baseMod = Context.GetModule<BaseMod>();
-            Window = new CompUiWindow(baseMod.UiContainer, "22em 18em", "10px 10px");
+            Window = new CompUiWindow(baseMod.UiContainer, "22em 19em", "10px 10px");
             Window.Title = "Rendering Stats";
             Window.PositionLocked = true;
             Window.CloseButtonEnabled = false;
@@ -53,8 +53,9 @@ namespace Dragonfly.BaseModule
             lblFPS = new CompUiCtrlLabel(Window, "FPS: XXXX (Min: XXXX, Max: XXXX, Avg: XXXX)", UiPositioning.Below(lblCamDir));
             lblCompCount = new CompUiCtrlLabel(Window, "Active components: XXXXXX (XXXXXX drawable)", UiPositioning.Below(lblFPS));
             lblPolyCount = new CompUiCtrlLabel(Window, "Polygon count: XXXXXXXX", UiPositioning.Below(lblCompCount));
-            lblDrawCallCount = new CompUiCtrlLabel(Window, "Draw calls: XXXXXXXX", UiPositioning.Below(lblPolyCount));
-            lblDrawableProcCount = new CompUiCtrlLabel(Window, "Total processed drawables: XXXXXXXXXX", UiPositioning.Below(lblDrawCallCount));
+            lblDrawCallCount = new CompUiCtrlLabel(Window, "Draw calls: XXXXXXXX (XXXXXXXX occluded)", UiPositioning.Below(lblPolyCount));
+            lblStateChangeCount = new CompUiCtrlLabel(Window, "State changes: XXXXXXXX (XXXXXXXX avoided)", UiPositioning.Below(lblDrawCallCount));
+            lblDrawableProcCount = new CompUiCtrlLabel(Window, "Total processed drawables: XXXXXXXXXX", UiPositioning.Below(lblStateChangeCount));
             lblOthers = new CompUiCtrlLabel(Window, "Tasks: XXXX, Frame ID: XXXXXXXXX", UiPositioning.Below(lblDrawableProcCount));
             fpsGraph = new CompUiCtrlGraph(Window, UiPositioning.Below(lblOthers), "16em 4em");
             fpsGraph.TracesAlpha = new Float3(1.0f, 1.0f, 0);
@@ -112,7 +113,8 @@ namespace Dragonfly.BaseModule
                 lblFPS.Text.InsertLeft(5, 4, fps).InsertLeft(16, 4, FpsMin).InsertLeft(27, 4, FpsMax).InsertLeft(38, 4, (int)FpsAvg);
                 lblCompCount.Text.InsertLeft(19, 6, Context.Statistics.ComponentCount).InsertLeft(27, 6, Context.Statistics.DrawableCount);
                 lblPolyCount.Text.InsertLeft(15, 8, Context.Statistics.LastFrame.PolygonCount);
-                lblDrawCallCount.Text.InsertLeft(12, 8, Context.Statistics.LastFrame.DrawCallCount);
+                lblDrawCallCount.Text.InsertLeft(12, 8, Context.Statistics.LastFrame.DrawCallCount).InsertLeft(22, 8, Context.Statistics.LastFrame.OcclusionCulledCount);
+                lblStateChangeCount.Text.InsertLeft(15, 8, Context.Statistics.LastFrame.StateChangeCount).InsertLeft(25, 8, Context.Statistics.LastFrame.AvoidedStateChangeCount);
                 lblDrawableProcCount.Text.InsertLeft(27, 10, Context.Statistics.LastFrame.ProcessedDrawableCount);
                 lblOthers.Text.InsertLeft(7, 4, GetComponent<CompTaskScheduler>().LastFrameTaskCount).InsertLeft(23, 9, Context.Time.FrameIndex);
 
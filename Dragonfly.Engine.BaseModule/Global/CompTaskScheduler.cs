@@ -9,7 +9,7 @@ namespace Dragonfly.BaseModule
     /// Helper component that manage engine-synchronous user tasks returning a value indicating if it should be run or not.
     /// The ammount of work per frame is automatically adjusted to accomodate for the ammount of tasks.
     /// </summary>
-    public class CompTaskScheduler : Component, ICompUpdatable
+    public class CompTaskScheduler : Component, ICompDeclaredUpdatable
     {
         private IndexedList<Task> scheduledTasks;
         private int skippedTaskCount; // number of task not processed in the last update
@@ -40,6 +40,11 @@ namespace Dragonfly.BaseModule
             }
         }
 
+        public void GetUpdateAccess(UpdateType updateType, UpdateAccess access)
+        {
+            access.Write(typeof(object)); // the started tasks can modify any component
+        }
+
         public int LastFrameTaskCount { get; private set; }
 
         public void Update(UpdateType updateType)
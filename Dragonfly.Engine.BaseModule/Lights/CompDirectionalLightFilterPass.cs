@@ -17,6 +17,7 @@ namespace Dragonfly.BaseModule
             BaseMod baseMod = Context.GetModule<BaseMod>();
 
             CompRenderBuffer renderBuffer = new CompRenderBuffer(this, Graphics.SurfaceFormat.Color, RenderBufferResizeStyle.HalfBackbuffer);
+            renderBuffer.Transient = true; // only read by the main pass, its targets are bound by the frame graph
             Pass = new CompRenderPass(this, "DirectionalLightFilterPass", renderBuffer);
             Pass.MainClass = baseMod.Settings.MaterialClasses.DirectionalLightFilter;
             Pass.ClearValue = Float4.One;
@@ -33,7 +34,7 @@ namespace Dragonfly.BaseModule
 
         public CompTextureRef LightFilterTexture { get; private set; }
 
-        public UpdateType NeededUpdates => UpdateType.FrameStart1;
+        public UpdateType NeededUpdates => UpdateType.ResourceLoaded; // the filter buffer target is only bound once the frame graph is updated
 
         public void Update(UpdateType updateType)
         {
@@ -6,13 +6,21 @@ using System.Collections.Generic;
 
 namespace Dragonfly.BaseModule
 {
-    internal class CompLightTableManager : Component, ICompUpdatable
+    internal class CompLightTableManager : Component, ICompParallelUpdatable
     {
         private LightTable lightTable;
+        private AABoxArray lightBoxes; // boxes of the point lights, followed by the spot lights
+        private ulong[] visibleLights;
+        private List<CompLightPoint> visiblePointLights; // point lights that intersect the camera volume, found by ParallelUpdate()
+        private List<CompLightSpot> visibleSpotLights; // spot lights that intersect the camera volume, found by ParallelUpdate()
 
         internal CompLightTableManager(Component parent) : base(parent)
         {
             lightTable = new LightTable(this);
+            lightBoxes = new AABoxArray(64);
+            visibleLights = new ulong[1];
+            visiblePointLights = new List<CompLightPoint>();
+            visibleSpotLights = new List<CompLightSpot>();
         }
 
         internal CompCamera GetReferenceCamera()
@@ -22,6 +30,45 @@ namespace Dragonfly.BaseModule
 
         public UpdateType NeededUpdates => UpdateType.FrameStart2;
 
+        public void GetUpdateAccess(UpdateType updateType, UpdateAccess access)
+        {
+            access.Read(typeof(CompLightPoint));
+            access.Read(typeof(CompLightSpot));
+            access.Read(typeof(CompCamera));
+            access.Read(typeof(CompTransform));
+            access.Read(typeof(CompLightDirectional));
+            access.Write(typeof(CompShadowAtlas));
+            access.Write(Context.Scene.Globals);
+            access.Write(this);
+        }
+
+        public void ParallelUpdate(UpdateType updateType)
+        {
+            visiblePointLights.Clear();
+            visibleSpotLights.Clear();
+            CompCamera camera = GetReferenceCamera();
+            if (camera == null) return;
+
+            // query for lights that can be culled
+            IReadOnlyList<CompLightPoint> pointLightList = GetComponents<CompLightPoint>();
+            IReadOnlyList<CompLightSpot> spotLightList = GetComponents<CompLightSpot>();
+
+            // cull point and spot lights with the camera volume
+            lightBoxes.Clear();
+            for (int i = 0; i < pointLightList.Count; i++)
+                lightBoxes.Add(pointLightList[i].GetBoundingBox());
+            for (int i = 0; i < spotLightList.Count; i++)
+                lightBoxes.Add(spotLightList[i].GetBoundingBox());
+            CullLights(camera.Volume);
+
+            for (int i = 0; i < pointLightList.Count; i++)
+                if (AABoxArray.IsMaskSet(visibleLights, i))
+                    visiblePointLights.Add(pointLightList[i]);
+            for (int i = 0; i < spotLightList.Count; i++)
+                if (AABoxArray.IsMaskSet(visibleLights, pointLightList.Count + i))
+                    visibleSpotLights.Add(spotLightList[i]);
+        }
+
         public void Update(UpdateType updateType)
         {
             // skip lights update if no reference camera that display them is available
@@ -32,13 +79,7 @@ namespace Dragonfly.BaseModule
             shadows.Update();
             shadows.FillShadowmapTable(lightTable);
 
-            // query for supported lights
-            IReadOnlyList<CompLightPoint> pointLightList = GetComponents<CompLightPoint>();
-            IReadOnlyList<CompLightSpot> spotLightList = GetComponents<CompLightSpot>();
             IReadOnlyList<CompLightDirectional> dirLightList = GetComponents<CompLightDirectional>();
-
-
-            IVolume cameraVolume = GetReferenceCamera().Volume;
             lightTable.Reset();
 
             // fill directional light parameters
@@ -47,21 +88,18 @@ namespace Dragonfly.BaseModule
                 lightTable.AddLightData(dirLightList[i], shadows.GetShadowmapsCount(dirLightList[i]), shadows.GetFirstShadowmapIndex(dirLightList[i]));
             }
 
-            // fill point light parameters
-            for (int i = 0; i < pointLightList.Count; i++)
+            // fill point and spot light parameters (lights deactivated by the updates that run after the culling are skipped)
+            for (int i = 0; i < visiblePointLights.Count; i++)
             {
-                if (!cameraVolume.Intersects(pointLightList[i].GetBoundingBox()))
+                if (!visiblePointLights[i].Active)
                     continue;
-
-                lightTable.AddLightData(pointLightList[i], shadows.GetShadowmapsCount(pointLightList[i]), shadows.GetFirstShadowmapIndex(pointLightList[i]));
+                lightTable.AddLightData(visiblePointLights[i], shadows.GetShadowmapsCount(visiblePointLights[i]), shadows.GetFirstShadowmapIndex(visiblePointLights[i]));
             }
-
-            // fill spot light parameters
-            for (int i = 0; i < spotLightList.Count; i++)
+            for (int i = 0; i < visibleSpotLights.Count; i++)
             {
-                if (!cameraVolume.Intersects(spotLightList[i].GetBoundingBox()))
+                if (!visibleSpotLights[i].Active)
                     continue;
-                lightTable.AddLightData(spotLightList[i], shadows.GetShadowmapsCount(spotLightList[i]), shadows.GetFirstShadowmapIndex(spotLightList[i]));
+                lightTable.AddLightData(visibleSpotLights[i], shadows.GetShadowmapsCount(visibleSpotLights[i]), shadows.GetFirstShadowmapIndex(visibleSpotLights[i]));
             }
 
             lightTable.UploadValues();
@@ -70,5 +108,24 @@ namespace Dragonfly.BaseModule
             Context.Scene.Globals.SetParam("lightCount", lightTable.LightCount);
             Context.Scene.Globals.SetParam("lightList", lightTable.Buffer);
         }
+
+        private void CullLights(IVolume cameraVolume)
+        {
+            int maskLength = AABoxArray.GetMaskLength(lightBoxes.Count);
+            if (visibleLights.Length < maskLength)
+                visibleLights = new ulong[maskLength];
+
+            IBatchVolume batchVolume = cameraVolume as IBatchVolume;
+            if (batchVolume != null)
+            {
+                batchVolume.Intersects(lightBoxes, visibleLights);
+                return;
+            }
+
+            Array.Clear(visibleLights, 0, maskLength);
+            for (int i = 0; i < lightBoxes.Count; i++)
+                if (cameraVolume.Intersects(lightBoxes[i]))
+                    visibleLights[i >> 6] |= 1UL << (i & 63);
+        }
     }
 }
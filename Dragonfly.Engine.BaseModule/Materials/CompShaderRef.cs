@@ -30,7 +30,13 @@ namespace Dragonfly.BaseModule
             }
         }
 
-        public bool LoadingRequired { get; private set; }
+        private bool loadingRequired;
+
+        public bool LoadingRequired
+        {
+            get { return loadingRequired; }
+            private set { SetLoadingRequired(ref loadingRequired, value); }
+        }
 
         public bool Available { get { return shader != null; } }
 
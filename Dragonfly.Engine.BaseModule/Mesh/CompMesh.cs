@@ -16,7 +16,7 @@ namespace Dragonfly.BaseModule
         {
             Geometry = geometry;
             if (Geometry == null)
-                EditableGeometry = new CompMeshGeometry(owner, new List<VertexTexNorm>(), new List<ushort>());
+                EditableGeometry = new CompMeshGeometry(owner, new List<VertexTexNorm>(), new List<uint>());
 
             if (material != null)
                 Materials.Add(material);
@@ -24,7 +24,7 @@ namespace Dragonfly.BaseModule
             CastShadows = true;
         }
 
-        public CompMesh(Component owner, CompMaterial material, List<VertexTexNorm> vertices, List<ushort> indices) : this(owner, material, new CompMeshGeometry(owner, vertices, indices))
+        public CompMesh(Component owner, CompMaterial material, List<VertexTexNorm> vertices, List<uint> indices) : this(owner, material, new CompMeshGeometry(owner, vertices, indices))
         {
             EditableGeometry = Geometry as CompMeshGeometry;
         }
@@ -111,6 +111,16 @@ namespace Dragonfly.BaseModule
 
         public bool Editable { get { return EditableGeometry != null; } }
 
+        /// <summary>
+        /// Optimize the geometry of an editable mesh for rendering, once it has been generated. See CompMeshGeometry.Optimize().
+        /// </summary>
+        public MeshOptimizationStats OptimizeGeometry()
+        {
+            if (!Editable)
+                throw new InvalidOperationException("This mesh is not editable and cannot be optimized.");
+            return EditableGeometry.Optimize();
+        }
+
         public override bool Ready
         {
             get { return Geometry.Available; }
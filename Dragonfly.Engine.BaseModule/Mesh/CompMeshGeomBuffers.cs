@@ -1,24 +1,44 @@
 ﻿using Dragonfly.Engine.Core;
+using Dragonfly.Graphics;
 using System;
 
 namespace Dragonfly.BaseModule
 {
     /// <summary>
-    /// A component that store caching buffers to load geometry to gpu resources
+    /// A component that store caching buffers to load geometry to gpu resources.
+    /// Buffers grow on demand when a bigger mesh is loaded.
     /// </summary>
     public class CompMeshGeomBuffers : Component
     {
-        public const int MAX_VERTEX_COUNT = 65536;
-        public const int MAX_INDEX_COUNT = 524288;
+        public const int INITIAL_VERTEX_COUNT = 65536;
+        public const int INITIAL_INDEX_COUNT = 524288;
 
         public CompMeshGeomBuffers(Component parent) : base(parent)
         {
-            VertexList = new VertexTexNorm[MAX_VERTEX_COUNT];
-            IndexList = new ushort[MAX_INDEX_COUNT];
+            VertexList = new VertexTexNorm[INITIAL_VERTEX_COUNT];
+            IndexList = new ushort[INITIAL_INDEX_COUNT];
+            IndexList32 = new uint[0];
         }
         
         public VertexTexNorm[] VertexList { get; private set; }
 
         public ushort[] IndexList { get; private set; }
+
+        public uint[] IndexList32 { get; private set; }
+
+        /// <summary>
+        /// Make sure that the buffers can store the specified number of vertices and indices of the specified format.
+        /// </summary>
+        public void Reserve(int vertexCount, int indexCount, IndexFormat indexFormat)
+        {
+            if (VertexList.Length < vertexCount)
+                VertexList = new VertexTexNorm[vertexCount];
+
+            if (indexFormat == IndexFormat.Index16 && IndexList.Length < indexCount)
+                IndexList = new ushort[indexCount];
+
+            if (indexFormat == IndexFormat.Index32 && IndexList32.Length < indexCount)
+                IndexList32 = new uint[System.Math.Max(indexCount, INITIAL_INDEX_COUNT)];
+        }
     }
 }
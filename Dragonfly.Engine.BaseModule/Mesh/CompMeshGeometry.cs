@@ -1,4 +1,5 @@
 ﻿using Dragonfly.Engine.Core;
+using Dragonfly.Graphics;
 using Dragonfly.Graphics.Math;
 using Dragonfly.Graphics.Resources;
 using System;
@@ -9,12 +10,13 @@ namespace Dragonfly.BaseModule
 
     /// <summary>
     /// A mesh geometry that support primitive / data input from CPU code. 
+    /// Indices are stored as 32-bit values, and uploaded as 16-bit indices when the vertex count allows it.
     /// </summary>
     public class CompMeshGeometry : Component, ICompAllocator, IObject3D, IMeshGeometry
     {
         private int nextObjPos, nextObjNorm, nextObjCoord; // IObject3D sequential state
 
-        public CompMeshGeometry(Component owner, List<VertexTexNorm> vertices, List<ushort> indices) : base(owner)
+        public CompMeshGeometry(Component owner, List<VertexTexNorm> vertices, List<uint> indices) : base(owner)
         {
             Vertices = vertices;
             Indices = indices;
@@ -24,9 +26,9 @@ namespace Dragonfly.BaseModule
             BoundingBox = AABox.Infinite;
         }
 
-        public CompMeshGeometry(Component owner) : this(owner, new List<VertexTexNorm>(), new List<ushort>()) { }
+        public CompMeshGeometry(Component owner) : this(owner, new List<VertexTexNorm>(), new List<uint>()) { }
 
-        public List<ushort> Indices { get; private set; }
+        public List<uint> Indices { get; private set; }
 
         public List<VertexTexNorm> Vertices { get; private set; }
 
@@ -36,13 +38,49 @@ namespace Dragonfly.BaseModule
 
         public bool Available { get; private set; }
 
-        public bool LoadingRequired { get; private set; }
+        private bool loadingRequired;
+
+        public bool LoadingRequired
+        {
+            get { return loadingRequired; }
+            private set { SetLoadingRequired(ref loadingRequired, value); }
+        }
 
         // used for caching and indexing purposes
         internal string Guid { get; set; }
 
         public AABox BoundingBox { get; private set; }
 
+        /// <summary>
+        /// Statistics of the last optimization of this geometry, if any.
+        /// </summary>
+        public MeshOptimizationStats OptimizationStats { get; internal set; }
+
+        /// <summary>
+        /// Weld duplicated vertices and reorder triangles and vertices to reduce the vertex shader cost and overdraw when this geometry is rendered.
+        /// Returns the vertex processing statistics before and after the optimization.
+        /// </summary>
+        public MeshOptimizationStats Optimize()
+        {
+            OptimizationStats = Optimize(Vertices, Indices);
+            nextObjPos = nextObjNorm = nextObjCoord = VertexCount;
+            UpdateGeometry();
+            return OptimizationStats;
+        }
+
+        internal static MeshOptimizationStats Optimize(List<VertexTexNorm> vertices, List<uint> indices)
+        {
+            VertexTexNorm[] optVertices = vertices.ToArray();
+            uint[] optIndices = indices.ToArray();
+            MeshOptimizationStats stats = MeshOptimizer.Optimize(ref optVertices, ref optIndices, v => v.Position, v => v.Normal);
+
+            vertices.Clear();
+            vertices.AddRange(optVertices);
+            indices.Clear();
+            indices.AddRange(optIndices);
+            return stats;
+        }
+
         #region IObject3D
 
         public int VertexCount { get { return Vertices.Count; } }
@@ -82,6 +120,11 @@ namespace Dragonfly.BaseModule
             Indices.Add(index);
         }
 
+        public void AddIndex(uint index)
+        {
+            Indices.Add(index);
+        }
+
         public void UpdateGeometry()
         {
             LoadingRequired = true;
@@ -107,11 +150,12 @@ namespace Dragonfly.BaseModule
             }
 
             CompMeshGeomBuffers buffers = GetComponent<CompMeshGeomBuffers>();
+            int vertexCount = Vertices.Count, indexCount = Indices.Count;
+            IndexFormat indexFormat = IndexBuffer.GetRequiredFormat(vertexCount);
+            buffers.Reserve(vertexCount, indexCount, indexFormat);
 
             // update vertex buffer
             {
-                int vertexCount = Math.Min(Vertices.Count, CompMeshGeomBuffers.MAX_VERTEX_COUNT);
-
                 // create a new buffer if the current capacity is exceeded
                 if (VertexBuffer == null || VertexBuffer.Capacity < vertexCount)
                 {
@@ -128,19 +172,26 @@ namespace Dragonfly.BaseModule
 
             // update index buffer
             {
-                int indexCount = Math.Min(Indices.Count, CompMeshGeomBuffers.MAX_INDEX_COUNT);
-                
-                // create a new buffer if the current capacity is exceeded
-                if (IndexBuffer == null || IndexBuffer.Capacity < indexCount)
+                // create a new buffer if the current capacity is exceeded or the vertex count requires a different index size
+                if (IndexBuffer == null || IndexBuffer.Capacity < indexCount || IndexBuffer.Format != indexFormat)
                 {
                     if (IndexBuffer != null)
                         IndexBuffer.Release();
-                    IndexBuffer = g.CreateIndexBuffer(indexCount);
+                    IndexBuffer = g.CreateIndexBuffer(indexCount, indexFormat);
                 }
 
                 // upload new indices
-                Indices.CopyTo(0, buffers.IndexList, 0, indexCount);
-                IndexBuffer.SetIndices(buffers.IndexList, indexCount);
+                if (indexFormat == IndexFormat.Index16)
+                {
+                    for (int i = 0; i < indexCount; i++)
+                        buffers.IndexList[i] = (ushort)Indices[i];
+                    IndexBuffer.SetIndices(buffers.IndexList, indexCount);
+                }
+                else
+                {
+                    Indices.CopyTo(0, buffers.IndexList32, 0, indexCount);
+                    IndexBuffer.SetIndices(buffers.IndexList32, indexCount);
+                }
             }
 
             // update bounding box
@@ -102,6 +102,104 @@ namespace Dragonfly.BaseModule
             mesh.Dispose();
         }
 
+        /// <summary>
+        /// Merge the static meshes of this list that use the same materials into a single mesh, so that they can be rendered with a single draw.
+        /// Only meshes with less vertices than the specified count are merged, merged meshes are removed from the list.
+        /// Meshes whose geometry has not been uploaded yet or that have their own instances are skipped.
+        /// Source geometries that are no longer used by other meshes are released, except the ones shared through the obj geometry cache, 
+        /// which are kept until CompObjToMesh collects its unused geometries: until then, their memory is duplicated by the merged mesh.
+        /// </summary>
+        /// <returns>The number of meshes removed from this list.</returns>
+        public int MergeStaticMeshes(int maxMeshVertexCount = 16384)
+        {
+            // group the meshes that can be merged by their materials
+            List<List<CompMesh>> mergeGroups = new List<List<CompMesh>>();
+            foreach (CompMesh mesh in blocks)
+            {
+                CompMeshGeometry geom = mesh.Geometry as CompMeshGeometry;
+                if (mesh.Editable || geom == null || geom.VertexCount == 0 || geom.VertexCount > maxMeshVertexCount)
+                    continue;
+                if (!geom.Available || geom.LoadingRequired || HasOwnInstances(mesh))
+                    continue; // the geometry is still being filled, or the merged mesh would not render the same instances
+
+                List<CompMesh> group = mergeGroups.Find(g => CanBeMerged(g[0], mesh));
+                if (group == null)
+                {
+                    group = new List<CompMesh>();
+                    mergeGroups.Add(group);
+                }
+                group.Add(mesh);
+            }
+
+            // replace each group with a single mesh
+            int removedCount = 0;
+            HashSet<CompMeshGeometry> sourceGeometries = new HashSet<CompMeshGeometry>();
+            foreach (List<CompMesh> group in mergeGroups)
+            {
+                if (group.Count < 2)
+                    continue;
+
+                List<VertexTexNorm> vertices = new List<VertexTexNorm>();
+                List<uint> indices = new List<uint>();
+                foreach (CompMesh mesh in group)
+                {
+                    CompMeshGeometry geom = (CompMeshGeometry)mesh.Geometry;
+                    uint baseVertex = (uint)vertices.Count;
+                    vertices.AddRange(geom.Vertices);
+                    foreach (uint index in geom.Indices)
+                        indices.Add(baseVertex + index);
+                    if (geom.Guid == null)
+                        sourceGeometries.Add(geom); // not cached by CompObjToMesh
+
+                    blocks.Remove(mesh);
+                    mesh.Dispose();
+                }
+
+                CompMesh mergedMesh = AddMesh(new CompMeshGeometry(this, vertices, indices));
+                mergedMesh.IsBounded = group[0].IsBounded;
+                foreach (CompMaterial m in group[0].Materials)
+                    mergedMesh.Materials.Add(m);
+                mergedMesh.CastShadows = group[0].CastShadows;
+                removedCount += group.Count - 1;
+            }
+
+            // release the merged geometries that are not referenced anymore
+            foreach (CompMesh mesh in GetComponents<CompMesh>())
+                if (!mesh.IsBeingDisposed && mesh.Geometry is CompMeshGeometry geom)
+                    sourceGeometries.Remove(geom);
+            foreach (CompMeshGeometry geom in sourceGeometries)
+                geom.Dispose();
+
+            return removedCount;
+        }
+
+        private static bool CanBeMerged(CompMesh m1, CompMesh m2)
+        {
+            if (m1.IsBounded != m2.IsBounded || m1.CastShadows != m2.CastShadows || m1.Materials.Count != m2.Materials.Count)
+                return false;
+
+            for (int i = 0; i < m1.Materials.Count; i++)
+                if (m1.Materials[i] != m2.Materials[i])
+                    return false;
+
+            return true;
+        }
+
+        /// <summary>
+        /// Returns true if the instances of the specified mesh differ from the ones set to this list.
+        /// </summary>
+        private bool HasOwnInstances(CompMesh mesh)
+        {
+            if (mesh.Instances.Count != instances.Count)
+                return true;
+
+            for (int i = 0; i < instances.Count; i++)
+                if (!mesh.Instances[i].Equals(instances[i]))
+                    return true;
+
+            return false;
+        }
+
         public void SetMainMaterial(CompMaterial m)
         {
             for (int i = 0; i < MeshCount; i++)
@@ -0,0 +1,91 @@
+﻿using Dragonfly.Engine.Core;
+using Dragonfly.Graphics.Math;
+using System.Collections.Generic;
+
+namespace Dragonfly.BaseModule
+{
+    /// <summary>
+    /// A simplified mesh that is never rendered, but hides the drawables behind it from cameras with occlusion culling enabled.
+    /// Its triangles must lie inside the geometry they stand for, and only hide what is behind their front face, pointed by the normal cross(v1 - v0, v2 - v0).
+    /// </summary>
+    public class CompMeshOccluder : Component, ICompOccluder
+    {
+        private List<Float3> vertices; // triangle list, in local coordinates
+
+        public CompMeshOccluder(Component owner) : base(owner)
+        {
+            vertices = new List<Float3>();
+        }
+
+        public int TriangleCount => vertices.Count / 3;
+
+        public void AddTriangle(Float3 v0, Float3 v1, Float3 v2)
+        {
+            vertices.Add(v0);
+            vertices.Add(v1);
+            vertices.Add(v2);
+        }
+
+        public void AddQuad(Float3 v0, Float3 v1, Float3 v2, Float3 v3)
+        {
+            AddTriangle(v0, v1, v2);
+            AddTriangle(v0, v2, v3);
+        }
+
+        public void Clear()
+        {
+            vertices.Clear();
+        }
+
+        /// <summary>
+        /// Add an occluder for a terrain created by Primitives.Terrain() with the same parameters. 
+        /// The occluder is a coarser grid, whose vertices are placed at the minimum height of the surrounding cells, so that it always lies below the terrain surface.
+        /// </summary>
+        /// <param name="cellSize">Number of height samples on each side of an occluder cell.</param>
+        public void AddTerrain(Float3 center, float[,] srcHeights, float terrainWidth, float terrainHeight, int cellSize)
+        {
+            int width = srcHeights.GetLength(0), height = srcHeights.GetLength(1);
+            Float2 size = new Float2(terrainWidth, terrainHeight);
+            Float2 start2d = center.XZ - size / 2.0f;
+            Float2 vspacing = size / new Float2(width - 1, height - 1);
+
+            // coarse grid vertices
+            int gridWidth = (width - 2) / cellSize + 2, gridHeight = (height - 2) / cellSize + 2;
+            Float3[,] grid = new Float3[gridWidth, gridHeight];
+            for (int y = 0; y < gridHeight; y++)
+            {
+                for (int x = 0; x < gridWidth; x++)
+                {
+                    int srcX = System.Math.Min(x * cellSize, width - 1), srcY = System.Math.Min(y * cellSize, height - 1);
+
+                    // minimum height of the cells that share this vertex
+                    float minHeight = float.MaxValue;
+                    int endX = System.Math.Min(srcX + cellSize, width - 1), endY = System.Math.Min(srcY + cellSize, height - 1);
+                    for (int sy = System.Math.Max(srcY - cellSize, 0); sy <= endY; sy++)
+                        for (int sx = System.Math.Max(srcX - cellSize, 0); sx <= endX; sx++)
+                            minHeight = System.Math.Min(minHeight, srcHeights[sx, sy]);
+
+                    grid[x, y].XZ = start2d + vspacing * new Float2(srcX, srcY);
+                    grid[x, y].Y = minHeight;
+                }
+            }
+
+            // triangles facing up
+            for (int y = 0; y < gridHeight - 1; y++)
+            {
+                for (int x = 0; x < gridWidth - 1; x++)
+                {
+                    AddTriangle(grid[x, y], grid[x, y + 1], grid[x + 1, y]);
+                    AddTriangle(grid[x + 1, y], grid[x, y + 1], grid[x + 1, y + 1]);
+                }
+            }
+        }
+
+        public void AddOccluders(OcclusionBuffer buffer, Int3 referenceTile)
+        {
+            Float4x4 worldMatrix = GetTransform().ToFloat4x4(referenceTile);
+            for (int i = 0; i < vertices.Count; i += 3)
+                buffer.AddTriangle(vertices[i] * worldMatrix, vertices[i + 1] * worldMatrix, vertices[i + 2] * worldMatrix);
+        }
+    }
+}
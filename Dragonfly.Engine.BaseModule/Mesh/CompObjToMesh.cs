@@ -1,25 +1,30 @@
 ﻿using Dragonfly.Engine.Core;
 using Dragonfly.Graphics;
+using Dragonfly.Graphics.Math;
 using Dragonfly.Utils;
 using System;
 using System.Collections.Concurrent;
 using System.Collections.Generic;
+using System.IO;
+using System.Threading;
 
 namespace Dragonfly.BaseModule
 {
-    internal class CompObjToMesh : Component, ICompUpdatable
+    internal class CompObjToMesh : Component, ICompDeclaredUpdatable
     {
         private ConcurrentDictionary<ObjFile, ObjParsingArgs> parsingQueue;
         private Queue<ObjMeshLoadingArgs> loadingQueue;
         private Dictionary<string, CompMeshGeometry> objGeometryCache;
         private CompTimer gcEvent;
-        private HashCode hashGen;
+        private int pendingCacheReads;
+        private int cacheSaveErrorLogged;
 
         // index arrays to decompose faces
         private int[/*ORIENTATION*/][/*POLYGON SIDE COUNT*/][/*INDICES*/] tessIndices;
 		private const int MAX_FACE_EDGES = 10;
 		private const int KEEP_ORIENTATION = 0;
 		private const int CHANGE_ORIENTATION = 1;
+        private const int MERGE_MAX_GROUP_VERTICES = 16384; // groups with more face vertices are never merged with others
 
         public UpdateType NeededUpdates
         {
@@ -32,9 +37,14 @@ namespace Dragonfly.BaseModule
             }
         }
 
+        public void GetUpdateAccess(UpdateType updateType, UpdateAccess access)
+        {
+            access.Write(typeof(object)); // creates and fills the meshes of the loaded objs
+        }
+
         public bool IsLoading
         {
-            get { return loadingQueue.Count > 0 || parsingQueue.Count > 0; }
+            get { return loadingQueue.Count > 0 || parsingQueue.Count > 0 || pendingCacheReads > 0; }
         }
 
         public int MeshPerFrameLimit { get; set; }
@@ -47,7 +57,6 @@ namespace Dragonfly.BaseModule
             MeshPerFrameLimit = 3;
             SetupTessellationIndices();
             gcEvent = new CompTimer(owner, 10.0f, DeleteUnusedGeometry);
-            hashGen = new HashCode();
         }
 		
 		private void SetupTessellationIndices()
@@ -114,13 +123,37 @@ namespace Dragonfly.BaseModule
             if (args.Material == null && args.MaterialFactory == null)
                 args.MaterialFactory = new CompMtlBasic.Factory { MaterialClass = Context.GetModule<BaseMod>().Settings.MaterialClasses.Solid };
 
-            // load obj file
             objPath = args.DestinationMesh.Context.GetResourcePath(objPath);
+            string cachePath = objPath + MeshCacheFile.Extension;
+            if (!args.DisableMeshCache && File.Exists(cachePath))
+            {
+                // load meshes from the cache, the obj file will be parsed only if the cache is not valid: its header is read first, so that the data of a stale cache is never loaded
+                Interlocked.Increment(ref pendingCacheReads);
+                IOScheduler.Default.RequestRange(0, cachePath, 0, MeshCacheFile.HeaderReadSize, new MeshCacheRequest() { Owner = this, ObjPath = objPath, Args = args }, IOPriority.Nearby);
+            }
+            else
+            {
+                LoadObj(objPath, args);
+            }
+        }
+
+        private void LoadObj(string objPath, ObjParsingArgs args)
+        {
             ObjFile objFile = new ObjFile();
             parsingQueue[objFile] = args;
             objFile.LoadFromFile(objPath, ObjFile_LoadingComplete);
         }
 
+        private ObjMeshLoadingArgs CreateLoadingArgs(ObjParsingArgs args, ObjMaterial objMaterial)
+        {
+            ObjMeshLoadingArgs loadingArgs = new ObjMeshLoadingArgs();
+            loadingArgs.ObjMaterial = objMaterial;
+            loadingArgs.MaterialFactory = args.MaterialFactory;
+            loadingArgs.DestinationMesh = args.DestinationMesh;
+            loadingArgs.OnMeshLoaded = args.OnMeshLoaded;
+            loadingArgs.Material = args.Material;
+            return loadingArgs;
+        }
 
         private void ObjFile_LoadingComplete(ObjFile obj)
         {
@@ -128,114 +161,274 @@ namespace Dragonfly.BaseModule
             if (!parsingQueue.TryRemove(obj, out args))
                 return; // should never reach this point
 
+            if (!obj.Loaded) return; // the obj file or its materials could not be loaded, see obj.Error
+
             if (args.DestinationMesh.Disposed || args.DestinationMesh.Context.Released) return;
 
-            // convert the loaded data to a mesh components
-            for (int gi = 0; gi < obj.Groups.Count; gi++)
+            // prepare a cache of the converted meshes, discarded if any of them was already loaded
+            MeshCacheFile cache = null;
+            List<VertexTexNorm> cacheVertices = null;
+            List<uint> cacheIndices = null;
+            if (!args.DisableMeshCache)
             {
-                int nextSplitIndex = -1;
-                ObjMeshLoadingArgs loadingArgs = new ObjMeshLoadingArgs();
-                loadingArgs.ObjMaterial = obj.Groups[gi].Material;
-                loadingArgs.MaterialFactory = args.MaterialFactory;
-                loadingArgs.DestinationMesh = args.DestinationMesh;
-                loadingArgs.OnMeshLoaded = args.OnMeshLoaded;
-                loadingArgs.Material = args.Material;
-
-
-                // prepare split data
-                List<VertexTexNorm> vertices = null;
-                List<ushort> indices = null;
-                Dictionary<int, ushort> uniqueVertexIndices = null;
-                
-                Action PrepareNextSplit = () =>
-                {
-                    nextSplitIndex++;
-                    loadingArgs.CacheGuid = string.Format("{0}-{1}-{2}", obj.FilePath, obj.Groups[gi].Name, nextSplitIndex);
-                    vertices = new List<VertexTexNorm>();
-                    indices = new List<ushort>();
-                    uniqueVertexIndices = new Dictionary<int, ushort>();
-                };
+                cache = new MeshCacheFile();
+                cache.Bounds = AABox.Empty;
+                cacheVertices = new List<VertexTexNorm>();
+                cacheIndices = new List<uint>();
+            }
 
-                PrepareNextSplit();
+            // convert the loaded data to a mesh components
+            foreach (ObjMeshPart part in GetMeshParts(obj, args.MergeGroupsByMaterial))
+            {
+                ObjMeshLoadingArgs loadingArgs = CreateLoadingArgs(args, part.Material);
+                loadingArgs.CacheGuid = string.Format("{0}-{1}", obj.FilePath, part.Name);
 
                 // check for cached or loading geometry
                 lock (loadingQueue)
                 {
-                    bool alreadyLoading = false;
-                    while (objGeometryCache.ContainsKey(loadingArgs.CacheGuid))
+                    if (objGeometryCache.ContainsKey(loadingArgs.CacheGuid))
                     {
                         // loaded or already loading, just ask for that instance
                         loadingQueue.Enqueue(loadingArgs);
-                        alreadyLoading = true;
-                        PrepareNextSplit();
-                    }
-
-                    if (alreadyLoading)
+                        cache = null;
                         continue;
+                    }
 
                     objGeometryCache[loadingArgs.CacheGuid] = null; // placeholder to flag as loading
                 }
 
                 int orientation = args.ChangeFaceOrientation != (loadingArgs.ObjMaterial.Cull == "invert") ? CHANGE_ORIENTATION : KEEP_ORIENTATION;
-                
-                IList<ObjFace> faces = obj.Groups[gi].Faces;
+                List<VertexTexNorm> vertices = new List<VertexTexNorm>();
+                List<uint> indices = new List<uint>();
+                Dictionary<ObjVertex, uint> uniqueVertexIndices = new Dictionary<ObjVertex, uint>();
 
-                // for each face
-                for (int fi = 0; fi < faces.Count; fi++)
+                foreach (ObjGroup group in part.Groups)
                 {
-                    ObjFace f = faces[fi];
-                    int[] faceIndices = tessIndices[orientation][f.Vertices.Length];
+                    IList<ObjFace> faces = group.Faces;
 
-                    // for each vertex
-                    for (int vi = 0; vi < faceIndices.Length; vi++)
+                    // for each face
+                    for (int fi = 0; fi < faces.Count; fi++)
                     {
-                        ObjVertex v = f.Vertices[faceIndices[vi]];
-                        hashGen.Reset();
-                        hashGen.Add(v.VertexIndex);
-                        hashGen.Add(v.TexCoordIndex);
-                        hashGen.Add(v.NormalIndex);
-                        // TODO: take smoothing group into account
-                        int vhash = hashGen.Resolve();
-
-                        if (!uniqueVertexIndices.ContainsKey(vhash))
+                        ObjFace f = faces[fi];
+                        int[] faceIndices = tessIndices[orientation][Math.Min(f.VertexCount, MAX_FACE_EDGES - 1)];
+
+                        // for each vertex
+                        for (int vi = 0; vi < faceIndices.Length; vi++)
                         {
-                            VertexTexNorm vertex = new VertexTexNorm();
+                            ObjVertex v = group.FaceVertices[f.FirstVertex + faceIndices[vi]];
+                            // TODO: take smoothing group into account
 
-                            // add position, normal tex coords
-                            vertex.Position = obj.Vertices[v.VertexIndex - 1];
-                            if (v.TexCoordIndex != 0)
+                            uint vertexIndex;
+                            if (!uniqueVertexIndices.TryGetValue(v, out vertexIndex))
                             {
-                                vertex.TexCoords = obj.TexCoords[v.TexCoordIndex - 1];
-                                vertex.TexCoords.Y = 1.0f - vertex.TexCoords.Y;
+                                VertexTexNorm vertex = new VertexTexNorm();
+
+                                // add position, normal tex coords
+                                vertex.Position = obj.Vertices[v.VertexIndex - 1];
+                                if (v.TexCoordIndex != 0)
+                                {
+                                    vertex.TexCoords = obj.TexCoords[v.TexCoordIndex - 1];
+                                    vertex.TexCoords.Y = 1.0f - vertex.TexCoords.Y;
+                                }
+                                if (v.NormalIndex != 0)
+                                    vertex.Normal = obj.Normals[v.NormalIndex - 1];
+
+                                // add the new vertex to the list
+                                vertexIndex = (uint)vertices.Count;
+                                vertices.Add(vertex);
+                                uniqueVertexIndices[v] = vertexIndex;
                             }
-                            vertex.Normal = obj.Normals[v.NormalIndex - 1];
-                            
-                            // add the new vertex to the list
-                            ushort vertexindex = (ushort)vertices.Count;
-                            vertices.Add(vertex);
-                            uniqueVertexIndices[vhash] = vertexindex;
-                        }
 
-                        indices.Add(uniqueVertexIndices[vhash]);
+                            indices.Add(vertexIndex);
+                        }
                     }
+                }
 
-                    if((vertices.Count + 4) > CompMeshGeomBuffers.MAX_VERTEX_COUNT || (indices.Count + 4) > CompMeshGeomBuffers.MAX_INDEX_COUNT || fi == (faces.Count - 1) && vertices.Count > 0)
+                if (vertices.Count == 0)
+                {
+                    // only unsupported faces, no mesh is created
+                    lock (loadingQueue)
                     {
-                        // queue mesh loading request
-                        ObjMeshLoadingArgs splitArgs = loadingArgs;
-                        splitArgs.Vertices = vertices;
-                        splitArgs.Indices = indices;
+                        objGeometryCache.Remove(loadingArgs.CacheGuid);
+                    }
+                    continue;
+                }
 
-                        // queue mesh loading request
-                        lock (loadingQueue)
-                        {
-                            loadingQueue.Enqueue(splitArgs);
-                        }
+                // optimize the mesh, so that the cache also stores the optimized data
+                if (!args.DisableMeshOptimization)
+                    loadingArgs.OptimizationStats = CompMeshGeometry.Optimize(vertices, indices);
 
-                        PrepareNextSplit();
-                    }
+                loadingArgs.Vertices = vertices;
+                loadingArgs.Indices = indices;
+
+                // add the mesh to the cache
+                if (cache != null)
+                {
+                    MeshCacheFile.MeshRange range = new MeshCacheFile.MeshRange();
+                    range.Name = part.Name;
+                    range.Material = part.Material;
+                    range.VertexStart = cacheVertices.Count;
+                    range.VertexCount = vertices.Count;
+                    range.IndexStart = cacheIndices.Count;
+                    range.IndexCount = indices.Count;
+                    range.Bounds = AABox.Bounding(vertices, vertex => vertex.Position);
+                    range.OptimizationStats = loadingArgs.OptimizationStats;
+                    cacheVertices.AddRange(vertices);
+                    cacheIndices.AddRange(indices);
+                    cache.Ranges.Add(range);
+                    cache.Bounds = cache.Bounds.Add(range.Bounds);
+                }
+
+                // queue mesh loading request
+                lock (loadingQueue)
+                {
+                    loadingQueue.Enqueue(loadingArgs);
+                }
+            }
+
+            if (cache != null && cache.Ranges.Count > 0)
+            {
+                cache.ChangeFaceOrientation = args.ChangeFaceOrientation;
+                cache.MergeGroupsByMaterial = args.MergeGroupsByMaterial;
+                cache.DisableMeshOptimization = args.DisableMeshOptimization;
+                cache.Vertices = cacheVertices.ToArray();
+                cache.Indices = cacheIndices.ToArray();
+                SaveMeshCache(cache, obj.FilePath, obj.SourceFiles);
+            }
+        }
+
+        /// <summary>
+        /// Returns the list of meshes that should be created from the obj groups.
+        /// If requested, small groups that share the same material are merged in a single mesh, so that they can be rendered with a single draw.
+        /// </summary>
+        private List<ObjMeshPart> GetMeshParts(ObjFile obj, bool mergeByMaterial)
+        {
+            List<ObjMeshPart> parts = new List<ObjMeshPart>();
+            Dictionary<ObjMaterial, ObjMeshPart> mergedParts = new Dictionary<ObjMaterial, ObjMeshPart>();
+
+            for (int gi = 0; gi < obj.Groups.Count; gi++)
+            {
+                ObjGroup group = obj.Groups[gi];
+                if (group.Faces.Count == 0)
+                    continue;
+
+                ObjMeshPart part;
+                bool mergeable = mergeByMaterial && group.Material != null && group.FaceVertices.Count <= MERGE_MAX_GROUP_VERTICES;
+                if (!mergeable || !mergedParts.TryGetValue(group.Material, out part))
+                {
+                    part = new ObjMeshPart();
+                    part.Name = mergeable ? string.Format("{0}-merged{1}", group.Material.Name, obj.Materials.IndexOf(group.Material)) : string.Format("{0}-{1}", group.Name, gi);
+                    part.Material = group.Material;
+                    part.Groups = new List<ObjGroup>();
+                    parts.Add(part);
+                    if (mergeable)
+                        mergedParts[group.Material] = part;
+                }
+
+                part.Groups.Add(group);
+            }
+
+            return parts;
+        }
+
+        private void SaveMeshCache(MeshCacheFile cache, string objPath, List<string> sourceFiles)
+        {
+            try
+            {
+                foreach (string srcPath in sourceFiles)
+                    cache.AddSource(srcPath);
+                cache.Save(objPath + MeshCacheFile.Extension);
+            }
+            catch (IOException e) { LogCacheSaveError(objPath, e); } // the cache is optional: the obj will be parsed again next time
+            catch (UnauthorizedAccessException e) { LogCacheSaveError(objPath, e); }
+        }
+
+        private void LogCacheSaveError(string objPath, Exception e)
+        {
+            // only reported once, since a read-only location would fail for every obj
+            if (Interlocked.Exchange(ref cacheSaveErrorLogged, 1) == 0)
+                System.Diagnostics.Debug.WriteLine("Mesh cache for {0} cannot be saved, the obj files will be parsed on each load: {1}", objPath, e.Message);
+        }
+
+        internal void OnMeshCacheHeaderLoaded(MeshCacheRequest request, ArrayRange<byte> headerBytes)
+        {
+            MeshCacheFile header;
+            if (MeshCacheFile.TryReadHeader(headerBytes, out header) && !IsCacheValid(header, request.Args))
+            {
+                // out of date or created with different settings
+                OnMeshCacheReadFailed(request);
+                return;
+            }
+
+            // valid cache, or header too long to be checked from the first range
+            IOScheduler.Default.RequestFile(0, request.ObjPath + MeshCacheFile.Extension, request, true, IOPriority.Nearby);
+        }
+
+        internal void OnMeshCacheLoaded(MeshCacheRequest request, byte[] cacheBytes)
+        {
+            try
+            {
+                QueueCachedMeshes(request.ObjPath, request.Args, cacheBytes);
+            }
+            finally
+            {
+                Interlocked.Decrement(ref pendingCacheReads);
+            }
+        }
+
+        internal void OnMeshCacheReadFailed(MeshCacheRequest request)
+        {
+            // the cache is optional, parse the obj file instead
+            LoadObj(request.ObjPath, request.Args);
+            Interlocked.Decrement(ref pendingCacheReads);
+        }
+
+        private static bool IsCacheValid(MeshCacheFile cache, ObjParsingArgs args)
+        {
+            return cache.IsUpToDate() && cache.MergeGroupsByMaterial == args.MergeGroupsByMaterial && cache.DisableMeshOptimization == args.DisableMeshOptimization;
+        }
+
+        private void QueueCachedMeshes(string objPath, ObjParsingArgs args, byte[] cacheBytes)
+        {
+            MeshCacheFile cache;
+            if (!MeshCacheFile.TryLoad(cacheBytes, out cache) || !IsCacheValid(cache, args))
+            {
+                // invalid or out of date cache
+                LoadObj(objPath, args);
+                return;
+            }
+
+            if (args.DestinationMesh.Disposed || args.DestinationMesh.Context.Released) return;
+
+            if (cache.ChangeFaceOrientation != args.ChangeFaceOrientation)
+                cache.FlipFaceOrientation();
+
+            foreach (MeshCacheFile.MeshRange range in cache.Ranges)
+            {
+                ObjMeshLoadingArgs loadingArgs = CreateLoadingArgs(args, range.Material);
+                loadingArgs.CacheGuid = string.Format("{0}-{1}", objPath, range.Name);
+                loadingArgs.OptimizationStats = range.OptimizationStats;
+
+                // check for cached or loading geometry
+                bool alreadyLoading;
+                lock (loadingQueue)
+                {
+                    alreadyLoading = objGeometryCache.ContainsKey(loadingArgs.CacheGuid);
+                    if (!alreadyLoading)
+                        objGeometryCache[loadingArgs.CacheGuid] = null; // placeholder to flag as loading
+                }
+
+                if (!alreadyLoading)
+                {
+                    loadingArgs.Vertices = new List<VertexTexNorm>(new ArraySegment<VertexTexNorm>(cache.Vertices, range.VertexStart, range.VertexCount));
+                    loadingArgs.Indices = new List<uint>(new ArraySegment<uint>(cache.Indices, range.IndexStart, range.IndexCount));
+                }
+
+                // queue mesh loading request
+                lock (loadingQueue)
+                {
+                    loadingQueue.Enqueue(loadingArgs);
                 }
-             
             }
         }
 
@@ -267,6 +460,7 @@ namespace Dragonfly.BaseModule
                         // create mesh geometry and add it to the cache
                         meshGeometry = new CompMeshGeometry(this, meshToLoad.Vertices, meshToLoad.Indices);
                         meshGeometry.Guid = meshToLoad.CacheGuid;
+                        meshGeometry.OptimizationStats = meshToLoad.OptimizationStats;
                         meshGeometry.Name = meshGeometry.Guid;
                         objGeometryCache[meshToLoad.CacheGuid] = meshGeometry;
                     }
@@ -298,6 +492,38 @@ namespace Dragonfly.BaseModule
         }
     }
 
+    /// <summary>
+    /// The read of a mesh cache: its header range is read first, then the whole file if the cache is valid.
+    /// </summary>
+    internal class MeshCacheRequest : ILoadedFileHandler, IRangeReadHandler
+    {
+        public CompObjToMesh Owner;
+        public string ObjPath;
+        public ObjParsingArgs Args;
+
+        public void OnRangeLoaded(int requestID, string filePath, long offset, ArrayRange<byte> data)
+        {
+            Owner.OnMeshCacheHeaderLoaded(this, data);
+        }
+
+        public void OnRangeLoadFailed(int requestID, string filePath, Exception error)
+        {
+            Owner.OnMeshCacheReadFailed(this);
+        }
+
+        public void OnFileLoaded(int requestID, string filePath, byte[] loadedBytes)
+        {
+            Owner.OnMeshCacheLoaded(this, loadedBytes);
+        }
+
+        public void OnFileLoaded(int requestID, string filePath, string loadedText) { }
+
+        public void OnFileLoadFailed(int requestID, string filePath, Exception error)
+        {
+            Owner.OnMeshCacheReadFailed(this);
+        }
+    }
+
     public struct ObjParsingArgs
     {
         /// <summary>
@@ -320,18 +546,42 @@ namespace Dragonfly.BaseModule
         /// A function that is called once the mesh has been completely loaded.
         /// </summary>
         public Action<CompMesh> OnMeshLoaded;
+        /// <summary>
+        /// If true, meshes are always converted from the obj file, without loading or saving a binary cache of them next to it.
+        /// </summary>
+        public bool DisableMeshCache;
+        /// <summary>
+        /// If true, small groups that share the same material are merged in a single mesh with 32-bit indices, reducing the number of draws for dense scenes.
+        /// Merged groups cannot be accessed as separate meshes.
+        /// </summary>
+        public bool MergeGroupsByMaterial;
+        /// <summary>
+        /// If true, the converted meshes are not optimized for rendering. See CompMeshGeometry.Optimize().
+        /// </summary>
+        public bool DisableMeshOptimization;
     }
 
     internal struct ObjMeshLoadingArgs
     {
         public List<VertexTexNorm> Vertices;
-        public List<ushort> Indices;
+        public List<uint> Indices;
         public ObjMaterial ObjMaterial;
         public MaterialFactory MaterialFactory;
         public CompMaterial Material; // used when factory is missing
         public CompMeshList DestinationMesh;
         public Action<CompMesh> OnMeshLoaded;
         public string CacheGuid;
+        public MeshOptimizationStats OptimizationStats;
+    }
+
+    /// <summary>
+    /// The obj groups converted to a single mesh.
+    /// </summary>
+    internal class ObjMeshPart
+    {
+        public string Name;
+        public ObjMaterial Material;
+        public List<ObjGroup> Groups;
     }
 
 }
\ No newline at end of file
@@ -22,6 +22,9 @@ using System.Runtime.InteropServices;
 // The following GUID is for the ID of the typelib if this project is exposed to COM
 [assembly: Guid("d42a036b-7bf4-44a0-b48a-7ccadc85116e")]
 
+// obj and mesh cache files are tested directly by the console tests
+[assembly: InternalsVisibleTo("Dragonfly.Graphics.Test")]
+
 // Version information for an assembly consists of the following four values:
 //
 //      Major Version
@@ -13,7 +13,7 @@ namespace Dragonfly.BaseModule
     {
         private const int PRESERVE_TEXTURE_FRAME_COUNT = 5; // wait in frames before releasing an unused texture, to allow for components to update 
 
-        private AsyncFileLoader fileLoader; // used to load texture files
+        private int pendingFileReads; // number of texture files requested to the I/O scheduler and still not loaded
         private object LOADING_QUEUE_LOCK; // lock to be taken before accessing any other loading queues
 
         // loading queues
@@ -32,7 +32,6 @@ namespace Dragonfly.BaseModule
 
         public CompTextureLoader(Component owner) : base(owner)
         {
-            fileLoader = new AsyncFileLoader();
             LOADING_QUEUE_LOCK = new object();
 
             needFileQueue = new BlockingQueue<CompTextureRef>();
@@ -55,13 +54,19 @@ namespace Dragonfly.BaseModule
         /// </summary>
         public float MegapixelsPerFrame { get; set; }
 
-        public bool LoadingRequired { get; internal set; }
+        private bool loadingRequired;
+
+        public bool LoadingRequired
+        {
+            get { return loadingRequired; }
+            internal set { SetLoadingRequired(ref loadingRequired, value); }
+        }
 
         public bool IsLoading
         {
             get
             {
-                return LoadingRequired || !fileLoader.Idle;
+                return LoadingRequired || Volatile.Read(ref pendingFileReads) > 0;
             }
         }
 
@@ -113,14 +118,53 @@ namespace Dragonfly.BaseModule
                 waitingAllocationQueue.Remove(textureRef);
                 priorityAllocationQueue.Remove(textureRef);
                 if (!keepPlaceholder) placeholderQueue.Remove(textureRef);
-                waitingFileQueue.Remove(textureRef);
+                if (waitingFileQueue.Remove(textureRef))
+                    CancelUnusedFileRead(textureRef.SrcPath);
             }
         }
 
-        public void LoadGraphicResources(EngineResourceAllocator g)
+        /// <summary>
+        /// Cancel the read of the specified file if no texture is waiting for it anymore.
+        /// </summary>
+        private void CancelUnusedFileRead(string filePath)
+        {
+            for (int i = 0; i < waitingFileQueue.Count; i++)
+                if (waitingFileQueue[i].SrcPath == filePath)
+                    return; // still needed
+
+            TextureFile texFile;
+            if (!diskTextureCache.TryGetValue(filePath, out texFile) || texFile.Loaded || texFile.ReadRequest == null)
+                return;
+
+            if (IOScheduler.Default.Cancel(texFile.ReadRequest))
+            {
+                diskTextureCache.Remove(filePath);
+                Interlocked.Decrement(ref pendingFileReads);
+            }
+        }
+
+        /// <summary>
+        /// Move the pending read of the file of the specified texture to the highest priority among the textures waiting for it.
+        /// </summary>
+        public void UpdateLoadingPriority(CompTextureRef textureRef)
         {
-            if (!fileLoader.IsRunning) fileLoader.Start();
+            lock (LOADING_QUEUE_LOCK)
+            {
+                TextureFile texFile;
+                if (textureRef.SrcPath == null || !diskTextureCache.TryGetValue(textureRef.SrcPath, out texFile) || texFile.ReadRequest == null)
+                    return; // no file read pending
+
+                IOPriority priority = textureRef.LoadingPriority;
+                for (int i = 0; i < waitingFileQueue.Count; i++)
+                    if (waitingFileQueue[i].SrcPath == textureRef.SrcPath && waitingFileQueue[i].LoadingPriority < priority)
+                        priority = waitingFileQueue[i].LoadingPriority;
 
+                IOScheduler.Default.SetPriority(texFile.ReadRequest, priority);
+            }
+        }
+
+        public void LoadGraphicResources(EngineResourceAllocator g)
+        {
             if (!Monitor.TryEnter(LOADING_QUEUE_LOCK))
                 return;
 
@@ -158,9 +202,12 @@ namespace Dragonfly.BaseModule
 
                         // request loading from disk
                         if (!tex.LoadNow)
-                            fileLoader.RequestFile(tex.ID, tex.SrcPath, this, true);
+                        {
+                            Interlocked.Increment(ref pendingFileReads);
+                            texFile.ReadRequest = IOScheduler.Default.RequestFile(tex.ID, tex.SrcPath, this, true, tex.LoadingPriority);
+                        }
                         else
-                            OnFileLoaded(tex.ID, tex.SrcPath, File.ReadAllBytes(tex.SrcPath));
+                            ProcessLoadedFile(tex.SrcPath, File.ReadAllBytes(tex.SrcPath));
                     }
                 }
 
@@ -220,6 +267,48 @@ namespace Dragonfly.BaseModule
 
         public void OnFileLoaded(int requestID, string filePath, byte[] loadedBytes)
         {
+            Interlocked.Decrement(ref pendingFileReads);
+            try
+            {
+                ProcessLoadedFile(filePath, loadedBytes);
+            }
+            catch
+            {
+                DiscardFile(filePath); // cannot be decoded
+                throw;
+            }
+        }
+
+        public void OnFileLoadFailed(int requestID, string filePath, Exception error)
+        {
+            Interlocked.Decrement(ref pendingFileReads);
+            DiscardFile(filePath);
+        }
+
+        /// <summary>
+        /// Remove a file that cannot be loaded from the cache, and stop loading the textures waiting for it, that will keep their placeholder.
+        /// </summary>
+        private void DiscardFile(string filePath)
+        {
+            lock (LOADING_QUEUE_LOCK)
+            {
+                TextureFile texFile;
+                if (diskTextureCache.TryGetValue(filePath, out texFile) && !texFile.Loaded)
+                    diskTextureCache.Remove(filePath);
+
+                waitingFileQueue.RemoveAll(tex => tex.SrcPath == filePath);
+            }
+        }
+
+        private void ProcessLoadedFile(string filePath, byte[] loadedBytes)
+        {
+            TextureFile texFile;
+            lock (LOADING_QUEUE_LOCK)
+            {
+                if (!diskTextureCache.TryGetValue(filePath, out texFile))
+                    return; // no more needed
+            }
+
             byte[] decodedPixBytes = null;
             int imgWidth = 0, imgHeight = 0;
 
@@ -228,7 +317,8 @@ namespace Dragonfly.BaseModule
             {
                 case HdrFile.Extension:
                     {
-                        HdrFile hdrImage = new HdrFile(filePath);
+                        // parse the bytes already loaded, scanlines are decoded in parallel
+                        HdrFile hdrImage = new HdrFile(loadedBytes);
                         imgWidth = hdrImage.Header.Width;
                         imgHeight = hdrImage.Header.Height;
                         decodedPixBytes = new byte[hdrImage.PixelCount * 4];
@@ -244,8 +334,8 @@ namespace Dragonfly.BaseModule
             lock (LOADING_QUEUE_LOCK)
             {
                 // fill this texture file istance (added when the file was requested)
-                TextureFile texFile = diskTextureCache[filePath];
-                texFile.SrcBytes = loadedBytes;
+                texFile.ReadRequest = null;
+                texFile.SrcBytes = decodedPixBytes == null ? loadedBytes : null; // file bytes are not needed once decoded
                 texFile.DecodedRGBA = decodedPixBytes;
                 texFile.SrcWidth = imgWidth;
                 texFile.SrcHeight = imgHeight;
@@ -408,9 +498,6 @@ namespace Dragonfly.BaseModule
 
         public void ReleaseGraphicResources()
         {
-            // stop file loading
-            fileLoader.Stop(true);
-
             // release textures and move them to the loading queue (so that when LoadResources() is called they're restored
             lock (LOADING_QUEUE_LOCK)
             {
@@ -459,6 +546,7 @@ namespace Dragonfly.BaseModule
         public byte[] DecodedRGBA; // cached decoded pixel bytes, used when the file cannot be loaded directly
         public int SrcWidth, SrcHeight;
         public bool Loaded; // set to true when this file is loaded from disk
+        public IORequest ReadRequest; // pending read of this file, null if loaded synchronously or completed
 
         public bool ContainsDecodedData
         {
@@ -20,6 +20,23 @@ namespace Dragonfly.BaseModule
 
         internal bool LoadNow { get; private set; }
 
+        private IOPriority loadingPriority;
+
+        /// <summary>
+        /// Priority of the file reads requested by this texture. If changed while the file is loading, the pending read is moved to the new priority.
+        /// </summary>
+        public IOPriority LoadingPriority
+        {
+            get { return loadingPriority; }
+            set
+            {
+                if (loadingPriority == value)
+                    return;
+                loadingPriority = value;
+                GetComponent<CompTextureLoader>().UpdateLoadingPriority(this);
+            }
+        }
+
         /// <summary>
         /// Type of source from which this texture is loading.
         /// </summary>
@@ -4,7 +4,7 @@ using System;
 
 namespace Dragonfly.BaseModule
 {
-    public class CompTimer : Component, ICompUpdatable
+    public class CompTimer : Component, ICompDeclaredUpdatable
     {
         private Action onTimerTick;
 
@@ -26,6 +26,11 @@ namespace Dragonfly.BaseModule
 
         public UpdateType NeededUpdates => UpdateType.FrameStart1;
 
+        public void GetUpdateAccess(UpdateType updateType, UpdateAccess access)
+        {
+            access.Write(typeof(object)); // the tick callback can modify any component
+        }
+
         public void Update(UpdateType updateType)
         {
             PreciseFloat curTime = Context.Time.SecondsFromStart;
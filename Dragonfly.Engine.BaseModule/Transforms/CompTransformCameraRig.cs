@@ -160,6 +160,8 @@ namespace Dragonfly.BaseModule
           
         }
 
+        public override bool IsLocalTransformDynamic => true; // follows paths over time
+
         public override TiledFloat4x4 GetLocalTransform()
         {
             Float3 dir = curDirectionIsTarget ? curDirection.GetValue() - curPosition.GetValue() : curDirection.GetValue();
@@ -19,6 +19,8 @@ namespace Dragonfly.BaseModule
             Movement.Direction.Set(Look.Direction);
         }
 
+        public override bool IsLocalTransformDynamic => true; // follows the smoothed position and direction of its children
+
         public override TiledFloat4x4 GetLocalTransform()
         {
             TiledFloat4x4 localTransform;
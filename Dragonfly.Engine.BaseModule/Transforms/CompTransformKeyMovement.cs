@@ -1,4 +1,4 @@
-using System;
+﻿using System;
 using Dragonfly.Engine.Core;
 using Dragonfly.Graphics.Math;
 using Dragonfly.Utils;
@@ -84,6 +84,8 @@ namespace Dragonfly.BaseModule
         }
 
 
+        public override bool IsLocalTransformDynamic => true; // smoothed over time
+
         public override TiledFloat4x4 GetLocalTransform()
         {
             return TiledFloat4x4.Translation(position.GetValue());
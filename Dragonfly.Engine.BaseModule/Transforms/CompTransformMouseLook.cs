@@ -1,4 +1,4 @@
-using Dragonfly.Engine.Core;
+﻿using Dragonfly.Engine.Core;
 using Dragonfly.Graphics.Math;
 using System;
 using System.Collections.Generic;
@@ -124,6 +124,8 @@ namespace Dragonfly.BaseModule
             return f2;
         }
 
+        public override bool IsLocalTransformDynamic => true; // smoothed over time, and driven by the up direction component
+
         public override TiledFloat4x4 GetLocalTransform()
         {        
             // when up dir changes: update lookat frames to the new up direction, converting angles from the previous frames
@@ -31,6 +31,7 @@ namespace Dragonfly.BaseModule
 
         private List<TransformRecord> trList;
         private Int3 worldTile;
+        private int dynamicRecordCount;
 
         public CompTransformStack(Component parent) : base(parent)
         {
@@ -67,7 +68,7 @@ namespace Dragonfly.BaseModule
             TransformRecord t = new TransformRecord();
             t.Type = TransformType.Translation;
             t.ParamCFloat3_1 = value;
-            trList.Add(t);
+            AddRecord(t);
         }
 
         public void PushRotationY(Component<float> value, float multiplier)
@@ -76,7 +77,7 @@ namespace Dragonfly.BaseModule
             t.Type = TransformType.RotationY;
             t.ParamCFloat_1 = value;
             t.ParamFloat_1 = multiplier;
-            trList.Add(t);
+            AddRecord(t);
         }
 
         public void PushDirectionalRotation(Float3 fromDirection, Component<Float3> toDirection, Float3 upDirection)
@@ -86,7 +87,7 @@ namespace Dragonfly.BaseModule
             t.ParamFloat3_1 = fromDirection;
             t.ParamCFloat3_1 = toDirection;
             t.ParamFloat3_2 = upDirection;
-            trList.Add(t);
+            AddRecord(t);
         }
 
         public void PushScale(Component<float> scale)
@@ -94,7 +95,7 @@ namespace Dragonfly.BaseModule
             TransformRecord t = new TransformRecord();
             t.Type = TransformType.Scale;
             t.ParamCFloat_1 = scale;
-            trList.Add(t);
+            AddRecord(t);
         }
 
         public void PushScale(Component<Float3> scale)
@@ -102,7 +103,7 @@ namespace Dragonfly.BaseModule
             TransformRecord t = new TransformRecord();
             t.Type = TransformType.Scale3D;
             t.ParamCFloat3_1 = scale;
-            trList.Add(t);
+            AddRecord(t);
         }
 
         public void Push(Float4x4 value)
@@ -110,7 +111,7 @@ namespace Dragonfly.BaseModule
             TransformRecord t = new TransformRecord();
             t.Type = TransformType.Static;
             t.ParamMatrix_1 = value;
-            trList.Add(t);
+            AddRecord(t);
         }
 
         public void Push(Component<Float4x4> value)
@@ -118,13 +119,15 @@ namespace Dragonfly.BaseModule
             TransformRecord t = new TransformRecord();
             t.Type = TransformType.Dynamic;
             t.ParamCMatrix_1 = value;
-            trList.Add(t);
+            AddRecord(t);
         }
 
         public void Clear()
         {
             trList.Clear();
             worldTile = Int3.Zero;
+            dynamicRecordCount = 0;
+            InvalidateLocalTransform();
         }
 
         public void Set(Float4x4 value)
@@ -140,6 +143,19 @@ namespace Dragonfly.BaseModule
             worldTile = value.Tile;
         }
 
+        private void AddRecord(TransformRecord t)
+        {
+            trList.Add(t);
+            if (t.Type != TransformType.Static)
+                dynamicRecordCount++;
+            InvalidateLocalTransform();
+        }
+
+        /// <summary>
+        /// True if any of the pushed transforms depends on another component value.
+        /// </summary>
+        public override bool IsLocalTransformDynamic => dynamicRecordCount > 0;
+
         public override TiledFloat4x4 GetLocalTransform()
         {
             Float4x4 m = Float4x4.Identity;
@@ -1,9 +1,10 @@
 ﻿using Dragonfly.Graphics;
 using Dragonfly.Graphics.Math;
+using System;
 
 namespace Dragonfly.BaseModule
 {
-    public struct VertexTexNorm
+    public struct VertexTexNorm : IEquatable<VertexTexNorm>
     {
         public Float3 Position;
         public Float2 TexCoords;
@@ -27,6 +28,27 @@ namespace Dragonfly.BaseModule
             return string.Format("POS:{0} COORDS:{1} NRM:{2}", Position.ToString(), TexCoords.ToString(), Normal.ToString());
         }
 
+        public bool Equals(VertexTexNorm other)
+        {
+            return Position == other.Position && TexCoords == other.TexCoords && Normal == other.Normal;
+        }
+
+        public override bool Equals(object obj)
+        {
+            return obj is VertexTexNorm other && Equals(other);
+        }
+
+        public override int GetHashCode()
+        {
+            unchecked
+            {
+                int hash = Position.GetHashCode();
+                hash = ((hash << 5) + hash + (hash >> 27)) ^ TexCoords.GetHashCode();
+                hash = ((hash << 5) + hash + (hash >> 27)) ^ Normal.GetHashCode();
+                return hash;
+            }
+        }
+
     }
 
     public struct VertexPosition
@@ -1,6 +1,7 @@
-using Dragonfly.Graphics.Math;
+﻿using Dragonfly.Graphics.Math;
 using System;
 using System.Collections.Generic;
+using System.Threading;
 
 namespace Dragonfly.Engine.Core
 {
@@ -12,6 +13,14 @@ namespace Dragonfly.Engine.Core
         private List<Component> children;
         private bool active;
 
+        // dense storage in the component manager
+        internal ComponentArchetype Archetype;
+        internal int ArchetypeSlot = -1;
+        internal int[] QuerySlots; // index of this component in the results of each query of its archetype
+        private CompTransform ancestorTransform; // cached result of GetAncestorTransform()
+        private int ancestorTransformVersion = -1;
+        internal int LoadingQueued; // 1 if this ICompAllocator is waiting in the component manager loading queue
+
         public Component(Component parent) : this(parent.Context, parent.ComManager)
         {
             Parent = parent;
@@ -64,6 +73,8 @@ namespace Dragonfly.Engine.Core
                 if (Context != value.Context)
                     throw new InvalidOperationException("A component cannot be moved to a parent from another engine instance!");
 
+                ComManager.CheckStructureChangesAllowed();
+
                 if(parent != null)
                     parent.children.Remove(this);
 
@@ -71,6 +82,10 @@ namespace Dragonfly.Engine.Core
                     value.children = new List<Component>();
                 value.children.Add(this);
                 parent = value;
+
+                // transforms of this subtree may have a different parent now
+                if (this is CompTransform || children != null)
+                    ComManager.OnHierarchyChanged();
             }
         }
 
@@ -110,14 +125,49 @@ namespace Dragonfly.Engine.Core
 
         public EngineContext Context { get; internal set; }
 
+        /// <summary>
+        /// Notify that this ICompAllocator requires LoadGraphicResources() to be called. Should be called each time LoadingRequired becomes true after construction, from any thread.
+        /// Allocators are only polled after being added, activated or notified, and then on each frame until LoadingRequired returns false.
+        /// </summary>
+        protected void RequestResourceLoading()
+        {
+            if (this is ICompAllocator)
+                ComManager.QueueResourceLoading(this);
+        }
+
+        /// <summary>
+        /// Store a new LoadingRequired value to the specified field of an ICompAllocator, requesting its resource loading if it is true.
+        /// To be called from the LoadingRequired setter, so that allocators never miss a notification.
+        /// </summary>
+        protected void SetLoadingRequired(ref bool loadingRequired, bool value)
+        {
+            loadingRequired = value;
+            if (value)
+                RequestResourceLoading();
+        }
+
         public TiledFloat4x4 GetTransform()
         {
-            CompTransform transform = GetFirstAncestor<CompTransform>();
+            CompTransform transform = GetAncestorTransform();
             if (transform != null)
                 return transform.GetValue();
 
             return TiledFloat4x4.Identity;
         }
+
+        /// <summary>
+        /// Returns the first transform component between the ancestors of this one. The result is cached until the hierarchy is modified.
+        /// </summary>
+        internal CompTransform GetAncestorTransform()
+        {
+            int hierarchyVersion = ComManager.HierarchyVersion;
+            if (Volatile.Read(ref ancestorTransformVersion) != hierarchyVersion)
+            {
+                ancestorTransform = GetFirstAncestor<CompTransform>();
+                Volatile.Write(ref ancestorTransformVersion, hierarchyVersion);
+            }
+            return ancestorTransform;
+        }
         
         public override string ToString()
         {
@@ -293,9 +343,10 @@ namespace Dragonfly.Engine.Core
 
     public abstract class Component<OutT> : Component, IComponent<OutT>
     {
-        private int lastUpdateID;
-        private OutT cachedValue, prevValue;
+        private int lastUpdateID, snapshotUpdateID;
+        private OutT cachedValue, prevValue, snapshotValue; // the snapshot keeps the value of the previous update, for threads that are still rendering it
         private object valueLock;
+        private int valueSeq; // odd while the cached values are being modified, read values are only valid if this did not change while reading them
         private readonly string EVENTNAME_GETVALUE;
 
         public Component(Component owner) : base(owner)
@@ -315,19 +366,106 @@ namespace Dragonfly.Engine.Core
         /// <returns></returns>
         public OutT GetValue()
         {
+            int readUpdateID = ComManager.ReadUpdateID;
+
+            // lock-free path: the value has already been evaluated for the requested frame
+            int seq = Volatile.Read(ref valueSeq);
+            if ((seq & 1) == 0)
+            {
+                OutT value;
+                bool cached = true;
+                if (lastUpdateID == readUpdateID)
+                    value = cachedValue;
+                else if (snapshotUpdateID == readUpdateID)
+                    value = snapshotValue;
+                else
+                {
+                    value = default(OutT);
+                    cached = false;
+                }
+
+                Interlocked.MemoryBarrier();
+                if (cached && valueSeq == seq)
+                    return value;
+            }
+
             lock (valueLock)
             {
-                if (lastUpdateID != ComManager.UpdateID)
+                if (lastUpdateID == readUpdateID)
+                    return cachedValue;
+
+                if (snapshotUpdateID == readUpdateID)
+                    return snapshotValue;
+
+                if (readUpdateID != ComManager.UpdateID)
+                {
+                    // a render thread is reading a value never evaluated for its frame, while the next one is being updated
+                    OutT renderValue = getValue();
+                    BeginValueChange();
+                    snapshotValue = renderValue;
+                    snapshotUpdateID = readUpdateID;
+                    EndValueChange();
+                    return renderValue;
+                }
+
+                StartTracedSection(Color.White, EVENTNAME_GETVALUE);
+                OutT newValue = getValue();
+                BeginValueChange();
+                if (lastUpdateID - snapshotUpdateID > 0)
+                {
+                    // keep the previous value available to render threads
+                    snapshotValue = cachedValue;
+                    snapshotUpdateID = lastUpdateID;
+                }
+                prevValue = cachedValue;
+                cachedValue = newValue;
+                lastUpdateID = readUpdateID;
+                EndValueChange();
+                EndTracedSection();
+                return newValue;
+            }
+        }
+
+        /// <summary>
+        /// Make the value cached in a previous update available to the current one, without evaluating it again.
+        /// Should only be called when the value is known to be unchanged since that update.
+        /// </summary>
+        /// <param name="cachedUpdateID">The update in which the value is expected to be cached.</param>
+        /// <returns>False if the cached value is not the one of the specified update, and should be evaluated again.</returns>
+        internal bool RenewCachedValue(int cachedUpdateID)
+        {
+            int updateID = ComManager.UpdateID;
+            if (Volatile.Read(ref lastUpdateID) == updateID)
+                return true; // already evaluated in this update
+
+            lock (valueLock)
+            {
+                if (lastUpdateID != cachedUpdateID)
+                    return lastUpdateID == updateID;
+
+                BeginValueChange();
+                if (lastUpdateID - snapshotUpdateID > 0)
                 {
-                    StartTracedSection(Color.White, EVENTNAME_GETVALUE);
-                    prevValue = cachedValue;
-                    cachedValue = getValue();
-                    lastUpdateID = ComManager.UpdateID; 
-                    EndTracedSection();
+                    // keep the previous value available to render threads
+                    snapshotValue = cachedValue;
+                    snapshotUpdateID = lastUpdateID;
                 }
+                prevValue = cachedValue;
+                lastUpdateID = updateID;
+                EndValueChange();
+                return true;
             }
-          
-            return cachedValue;
+        }
+
+        private void BeginValueChange()
+        {
+            Volatile.Write(ref valueSeq, valueSeq + 1);
+            Interlocked.MemoryBarrier(); // the odd sequence must be visible before the values are modified
+        }
+
+        private void EndValueChange()
+        {
+            Volatile.Write(ref valueSeq, valueSeq + 1);
         }
 
         /// <summary>
@@ -346,8 +484,14 @@ namespace Dragonfly.Engine.Core
 
         protected internal override void OnDispose()
         {
-            cachedValue = default(OutT);
-            prevValue = default(OutT);
+            lock (valueLock)
+            {
+                BeginValueChange();
+                cachedValue = default(OutT);
+                prevValue = default(OutT);
+                snapshotValue = default(OutT);
+                EndValueChange();
+            }
             base.OnDispose();
         }
     }
@@ -0,0 +1,90 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// Stores all the active components of the same concrete type in a dense array, together with the typed queries that they belong to.
+    /// Since the compatible queries are resolved once per type, adding or removing a component does not require any type check.
+    /// </summary>
+    internal class ComponentArchetype
+    {
+        private const int MIN_CAPACITY = 16;
+
+        private Component[] components;
+        private List<IComponentQuery> queries; // queries whose type is assignable from this archetype
+
+        public ComponentArchetype(Type type)
+        {
+            Type = type;
+            components = new Component[MIN_CAPACITY];
+            queries = new List<IComponentQuery>();
+        }
+
+        public Type Type { get; private set; }
+
+        public int Count { get; private set; }
+
+        public Component this[int index] => components[index];
+
+        public void Add(Component c)
+        {
+            if (Count == components.Length)
+                Array.Resize(ref components, 2 * components.Length);
+
+            c.Archetype = this;
+            c.ArchetypeSlot = Count;
+            components[Count++] = c;
+
+            if (c.QuerySlots == null || c.QuerySlots.Length < queries.Count)
+                c.QuerySlots = new int[queries.Count];
+            for (int i = 0; i < queries.Count; i++)
+                queries[i].Add(c, i);
+        }
+
+        public void Remove(Component c)
+        {
+            for (int i = 0; i < queries.Count; i++)
+                queries[i].Remove(c, i);
+
+            // move the last component to the removed slot
+            int slot = c.ArchetypeSlot;
+            Component last = components[--Count];
+            components[slot] = last;
+            last.ArchetypeSlot = slot;
+            components[Count] = null;
+
+            c.Archetype = null;
+            c.ArchetypeSlot = -1;
+        }
+
+        /// <summary>
+        /// Register a query compatible with this archetype, adding all the stored components to its results.
+        /// </summary>
+        public void AddQuery(IComponentQuery query)
+        {
+            int queryIndex = queries.Count;
+            queries.Add(query);
+
+            for (int i = 0; i < Count; i++)
+            {
+                Component c = components[i];
+                if (c.QuerySlots.Length <= queryIndex)
+                    Array.Resize(ref c.QuerySlots, queries.Count);
+                query.Add(c, queryIndex);
+            }
+        }
+
+        public void Clear()
+        {
+            for (int i = 0; i < Count; i++)
+            {
+                components[i].Archetype = null;
+                components[i].ArchetypeSlot = -1;
+                components[i] = null;
+            }
+            Count = 0;
+            queries.Clear();
+        }
+    }
+}
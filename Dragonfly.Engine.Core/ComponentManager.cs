@@ -4,6 +4,7 @@ using Dragonfly.Utils;
 using System;
 using System.Collections.Generic;
 using System.Runtime.CompilerServices;
+using System.Threading;
 
 namespace Dragonfly.Engine.Core
 {
@@ -11,7 +12,7 @@ namespace Dragonfly.Engine.Core
     {
         private class MatQueryCacheEntry
         {
-            public SortedLinkedList<CompMaterial> Result;
+            public SortedArrayList<CompMaterial> Result;
             public List<MaterialClassFilter> Filters;
             /// <summary>
             /// UpdateID of the last frame in which this cache entry was used.
@@ -20,7 +21,7 @@ namespace Dragonfly.Engine.Core
 
             public MatQueryCacheEntry(List<MaterialClassFilter> query)
             {
-                Result = new SortedLinkedList<CompMaterial>(Comparer<CompMaterial>.Create((m1, m2) => m1.RenderOrder.CompareTo(m2.RenderOrder)));
+                Result = new SortedArrayList<CompMaterial>(Comparer<CompMaterial>.Create((m1, m2) => m1.RenderOrder.CompareTo(m2.RenderOrder)));
                 Filters = query;
             }
         }
@@ -29,33 +30,55 @@ namespace Dragonfly.Engine.Core
         {
             public UpdateType Type;
             public Queue<ICompUpdatable> ToBeUpdated;
+            public Queue<ICompUpdatable> Deferred; // updates that touch graphic resources, postponed while rendering is in progress
         }
 
-        private Dictionary<int, Component> components; // all components, indexed by ID
-        private Dictionary<Type, IInvariantSet> byTypeCache; // all components, grouped by Type, only contains Types that have been recently searched for
+        [ThreadStatic]
+        private static bool readingRenderValues;
+
+        private Dictionary<Type, ComponentArchetype> archetypes; // all components, grouped by their concrete type
+        private List<ComponentArchetype> archetypeList;
+        private Dictionary<Type, IComponentQuery> byTypeCache; // all components, grouped by Type, only contains Types that have been searched for
         private object byTypeCacheLock; // lock for byTypeCache
-        private object allocationLock; // lock of ICompAllocator.LoadResources()
+        private int componentCount;
+        private int hierarchyVersion;
+        private List<ICompAllocator> loadingQueue, loadingQueueBack; // allocators that requested a resource loading, swapped while loading
+        private object loadingQueueLock;
         private Dictionary<int, MatQueryCacheEntry> matQueryCache; // material-specific cache: query ID -> query cache record
         private UpdatableQueryEntry[] updateQueryCache; // updatable-specific cache: update type -> list of updatable that requested that update on previous frame
         private int lastUpdateCacheID; // last update ID in which the updateQueryCache was updated
         private Dictionary<int, Component> waitingDisposal; // all component that should be disposed of next frame
-        private List<ICompAllocator> inactiveAllocators; // inactive ICompAllocator (that should still be polled for resource allocation
+        private List<InstanceList> changedInstances; // instance lists modified in this frame, that should be uploaded before rendering
+        private List<CompMaterial> changedMaterials; // materials whose queries should be refreshed once rendering is completed
+        private EvaluateRenderValuesBody evaluateRenderValuesBody;
+        private ParallelUpdateScheduler parallelUpdates;
+        private Action<ICompUpdatable, UpdateType> callUpdate; // cached CallUpdate() delegate
+        private IDFGraphics updatingGraphics; // graphics of the updates being called by RunUpdates()
 
         public ComponentManager()
         {
-            components = new Dictionary<int, Component>();
-            byTypeCache = new Dictionary<Type, IInvariantSet>();
+            archetypes = new Dictionary<Type, ComponentArchetype>();
+            archetypeList = new List<ComponentArchetype>();
+            byTypeCache = new Dictionary<Type, IComponentQuery>();
             byTypeCacheLock = new object();
             matQueryCache = new Dictionary<int, MatQueryCacheEntry>();
             updateQueryCache = new UpdatableQueryEntry[3];
-            updateQueryCache[0] = new UpdatableQueryEntry() { Type = UpdateType.FrameStart1, ToBeUpdated = new Queue<ICompUpdatable>() };
-            updateQueryCache[1] = new UpdatableQueryEntry() { Type = UpdateType.FrameStart2, ToBeUpdated = new Queue<ICompUpdatable>() };
-            updateQueryCache[2] = new UpdatableQueryEntry() { Type = UpdateType.ResourceLoaded, ToBeUpdated = new Queue<ICompUpdatable>() };
+            updateQueryCache[0] = new UpdatableQueryEntry() { Type = UpdateType.FrameStart1, ToBeUpdated = new Queue<ICompUpdatable>(), Deferred = new Queue<ICompUpdatable>() };
+            updateQueryCache[1] = new UpdatableQueryEntry() { Type = UpdateType.FrameStart2, ToBeUpdated = new Queue<ICompUpdatable>(), Deferred = new Queue<ICompUpdatable>() };
+            updateQueryCache[2] = new UpdatableQueryEntry() { Type = UpdateType.ResourceLoaded, ToBeUpdated = new Queue<ICompUpdatable>(), Deferred = new Queue<ICompUpdatable>() };
             UpdateID = 1;
-            allocationLock = new object();
             lastUpdateCacheID = 0;
             waitingDisposal = new Dictionary<int, Component>();
-            inactiveAllocators = new List<ICompAllocator>();
+            loadingQueue = new List<ICompAllocator>();
+            loadingQueueBack = new List<ICompAllocator>();
+            loadingQueueLock = new object();
+            changedInstances = new List<InstanceList>();
+            changedMaterials = new List<CompMaterial>();
+            evaluateRenderValuesBody = new EvaluateRenderValuesBody();
+            parallelUpdates = new ParallelUpdateScheduler();
+            callUpdate = CallUpdate;
+            Transforms = new TransformHierarchy(this);
+            SpatialIndex = new SceneSpatialIndex();
         }
 
         public void Add(Component c)
@@ -64,59 +87,125 @@ namespace Dragonfly.Engine.Core
             if (c.Context != null && c.Context.Scene != null)
                 c.Context.Scene.Log.WriteLine("Adding new component: {0}", c);
 #endif
-            this.components.Add(c.ID, c);
-     
-            //update by type query cache
-            foreach (Type queryType in byTypeCache.Keys)
-                byTypeCache[queryType].AddIfTypeIsCompatible(c);
+            CheckStructureChangesAllowed();
+            if (c.Archetype != null)
+                throw new ArgumentException("The specified component has already been added.");
+
+            // store the component with the others of the same type, which also updates all the compatible queries
+            GetArchetype(c.GetType()).Add(c);
+            componentCount++;
+            if (c is CompTransform)
+                OnHierarchyChanged();
+
+            // new and re-activated allocators are polled at least once
+            if (c is ICompAllocator)
+                QueueResourceLoading(c);
 
             // update drawable cache
             if (c is CompMaterial m)
-                AddMaterial(m);
+                RefreshMaterial(m);
         }
 
         public void QueueDisposal(Component component)
         {
+            CheckStructureChangesAllowed();
             waitingDisposal[component.ID] = component;
         }
 
         public void Remove(Component c)
         {
-            this.components.Remove(c.ID);
+            CheckStructureChangesAllowed();
+            if (c.Archetype == null)
+                return;
 
-            // search and remove from type cache
-            foreach (Type queryType in byTypeCache.Keys)
-                byTypeCache[queryType].Remove(c);
+            // remove from the archetype and its queries
+            c.Archetype.Remove(c);
+            componentCount--;
+            if (c is CompTransform)
+                OnHierarchyChanged();
 
             // update drawable cache
             if (c is CompMaterial m)
-                RemoveMaterial(m);
+                RefreshMaterial(m);
         }
 
-        public IReadOnlyList<T> Query<T>() where T : IComponent
+        /// <summary>
+        /// Component queries are read without locking by parallel updates, so the set of active components cannot change while they are running:
+        /// changes requested by the serial updates wait for the completion of the parallel updates started before them.
+        /// </summary>
+        internal void CheckStructureChangesAllowed()
         {
-            Type queryType = typeof(T);
-            IInvariantSet queryResult;
+            if (ParallelUpdateScheduler.IsUpdatingInParallel)
+                throw new InvalidOperationException("Components cannot be created, removed, moved or (de)activated from a parallel update.");
+            parallelUpdates.WaitForJobs();
+        }
+
+        private ComponentArchetype GetArchetype(Type type)
+        {
+            ComponentArchetype archetype;
+            if (archetypes.TryGetValue(type, out archetype))
+                return archetype;
 
-            if (!byTypeCache.TryGetValue(queryType, out queryResult))
+            lock (byTypeCacheLock)
             {
-                //query for type T
-                queryResult = new InvariantSet<T>();
-                foreach (object obj in components.Values)
-                    queryResult.AddIfTypeIsCompatible(obj);
+                // new concrete type: register all the compatible queries
+                archetype = new ComponentArchetype(type);
+                foreach (KeyValuePair<Type, IComponentQuery> query in byTypeCache)
+                {
+                    if (query.Key.IsAssignableFrom(type))
+                        archetype.AddQuery(query.Value);
+                }
+
+                archetypes[type] = archetype;
+                archetypeList.Add(archetype);
+            }
+
+            return archetype;
+        }
 
+        private ComponentQuery<T> GetQuery<T>() where T : IComponent
+        {
+            Type queryType = typeof(T);
+            IComponentQuery query;
+
+            if (!byTypeCache.TryGetValue(queryType, out query))
+            {
                 lock (byTypeCacheLock)
                 {
-                    byTypeCache[queryType] = queryResult;
+                    if (!byTypeCache.TryGetValue(queryType, out query))
+                    {
+                        // query for type T, only checking each archetype once
+                        query = new ComponentQuery<T>();
+                        foreach (ComponentArchetype archetype in archetypeList)
+                        {
+                            if (queryType.IsAssignableFrom(archetype.Type))
+                                archetype.AddQuery(query);
+                        }
+
+                        byTypeCache[queryType] = query;
+                    }
                 }
             }
 
-            return (queryResult as InvariantSet<T>).Values;
+            return (ComponentQuery<T>)query;
+        }
+
+        public IReadOnlyList<T> Query<T>() where T : IComponent
+        {
+            return GetQuery<T>().Values;
+        }
+
+        /// <summary>
+        /// Returns the components of type T as a range over a dense array. The returned range will not be modified by later changes.
+        /// </summary>
+        public ArrayRange<T> QueryRange<T>() where T : IComponent
+        {
+            return GetQuery<T>().Range;
         }
 
         public int GetCount<T>() where T: IComponent
         {
-            return Query<T>().Count;
+            return GetQuery<T>().Count;
         }
 
         public T QueryFirst<T>() where T : IComponent
@@ -129,22 +218,46 @@ namespace Dragonfly.Engine.Core
         public void Clear()
         {
             PerformWaitingDisposals();
-            components.Clear();
+            foreach (ComponentArchetype archetype in archetypeList)
+                archetype.Clear();
+            componentCount = 0;
             byTypeCache.Clear();
+            OnHierarchyChanged();
         }
 
         public int Count
         {
             get
             {
-                return components.Count;
+                return componentCount;
             }
         }
 
         public void OnNewFrameStart()
         {
             unchecked { UpdateID = UpdateID + 1; }
+            if (RenderingInProgress)
+                return; // changes that affect rendering are applied with ApplyDeferredChanges()
+
+            PerformWaitingDisposals();
+            CleanMaterialCache();
+        }
+
+        /// <summary>
+        /// Perform the disposals and material changes requested while rendering was in progress.
+        /// </summary>
+        public void ApplyDeferredChanges()
+        {
             PerformWaitingDisposals();
+
+            foreach (CompMaterial m in changedMaterials)
+            {
+                RemoveMaterial(m);
+                if (m.Archetype != null)
+                    AddMaterial(m);
+            }
+            changedMaterials.Clear();
+
             CleanMaterialCache();
         }
 
@@ -180,6 +293,55 @@ namespace Dragonfly.Engine.Core
             private set;
         }
 
+        /// <summary>
+        /// The UpdateID of the frame whose components are being rendered. 
+        /// Differs from UpdateID when the next frame is updated while the current one is being rendered.
+        /// </summary>
+        public int RenderUpdateID
+        {
+            get;
+            private set;
+        }
+
+        /// <summary>
+        /// True while render threads are recording the frame identified by RenderUpdateID, and updates for the next frame run concurrently.
+        /// While this is set, changes to the material queries and graphic updates are postponed.
+        /// </summary>
+        public bool RenderingInProgress { get; private set; }
+
+        /// <summary>
+        /// Set to true on the threads that record command lists: component values read from these threads will be the ones of the rendered frame.
+        /// </summary>
+        internal static bool ReadingRenderValues
+        {
+            get { return readingRenderValues; }
+            set { readingRenderValues = value; }
+        }
+
+        /// <summary>
+        /// The UpdateID of the component values that should be returned to the calling thread.
+        /// </summary>
+        internal int ReadUpdateID
+        {
+            get { return readingRenderValues ? RenderUpdateID : UpdateID; }
+        }
+
+        /// <summary>
+        /// Mark the start of the rendering of the current frame: values read from render threads will refer to this frame, even when updates for the next one are started.
+        /// </summary>
+        public void BeginRendering()
+        {
+            RenderUpdateID = UpdateID;
+        }
+
+        /// <summary>
+        /// Mark the start or the end of the period in which the next frame is updated while the current one is being rendered.
+        /// </summary>
+        public void SetRenderingInProgress(bool inProgress)
+        {
+            RenderingInProgress = inProgress;
+        }
+
         #region Material queries
 
         private void AddMaterial(CompMaterial m)
@@ -208,14 +370,28 @@ namespace Dragonfly.Engine.Core
         public void UpdateMaterialQueries(CompMaterial m)
         {
             if (m.Active)
+                RefreshMaterial(m);
+        }
+
+        /// <summary>
+        /// Update the cached queries that may contain the specified material. Postponed if the query results are being rendered.
+        /// </summary>
+        private void RefreshMaterial(CompMaterial m)
+        {
+            if (RenderingInProgress)
             {
-                // refresh by adding and removing
-                RemoveMaterial(m);
-                AddMaterial(m);
+                if (!changedMaterials.Contains(m))
+                    changedMaterials.Add(m);
+                return;
             }
+
+            // refresh by adding and removing
+            RemoveMaterial(m);
+            if (m.Archetype != null)
+                AddMaterial(m);
         }
 
-        public SortedLinkedList<CompMaterial> QueryMaterials(List<MaterialClassFilter> filterList)
+        public SortedArrayList<CompMaterial> QueryMaterials(List<MaterialClassFilter> filterList)
         {
             int queryId = MaterialClassFilter.GetQueryHash(filterList);
             MatQueryCacheEntry materialQuery;
@@ -238,6 +414,51 @@ namespace Dragonfly.Engine.Core
             return materialQuery.Result;
         }
 
+        /// <summary>
+        /// Called after the frame graph has been compiled again: the transient buffers may be bound to different render targets, so the shader params of the materials, 
+        /// that could reference them and were updated at the start of the frame, are refreshed before rendering.
+        /// </summary>
+        public void OnFrameGraphCompiled()
+        {
+            foreach (CompMaterial m in Query<CompMaterial>())
+                m.RefreshParams();
+        }
+
+        #endregion
+
+        #region Transforms
+
+        /// <summary>
+        /// The flattened hierarchy of the active transform components.
+        /// </summary>
+        public TransformHierarchy Transforms { get; private set; }
+
+        /// <summary>
+        /// Incremented each time a transform component is added or removed, or a component with transforms in its subtree is moved.
+        /// </summary>
+        public int HierarchyVersion
+        {
+            get { return Volatile.Read(ref hierarchyVersion); }
+        }
+
+        public void OnHierarchyChanged()
+        {
+            Interlocked.Increment(ref hierarchyVersion);
+        }
+
+        /// <summary>
+        /// Evaluate the world transforms modified in this update.
+        /// </summary>
+        public void EvaluateTransforms()
+        {
+            Transforms.Evaluate();
+        }
+
+        /// <summary>
+        /// The bounding volume hierarchy of the drawables, refreshed by EvaluateRenderValues().
+        /// </summary>
+        public SceneSpatialIndex SpatialIndex { get; private set; }
+
         #endregion
 
         #region Updatables
@@ -249,35 +470,34 @@ namespace Dragonfly.Engine.Core
                 return;
 
             // multithreaded search for components to be updated
-            queryUpdatesForBody.Updatables = Query<ICompUpdatable>();
-            queryUpdatesForBody.UpdateQueryCache = updateQueryCache;
-            SlimParallel.For(0, queryUpdatesForBody.Updatables.Count, 10, queryUpdatesForBody);
+            ArrayRange<ICompUpdatable> updatables = QueryRange<ICompUpdatable>();
+            if (queryUpdatesForBody.NeededUpdates.Length < updatables.Count)
+                queryUpdatesForBody.NeededUpdates = new UpdateType[updatables.Count * 2];
+            queryUpdatesForBody.Updatables = updatables;
+            SlimParallel.For(0, updatables.Count, 10, queryUpdatesForBody);
+
+            // enqueue in query order, so that updates run in the same order on each frame
+            for (int uTypeID = 0; uTypeID < updateQueryCache.Length; uTypeID++)
+            {
+                UpdatableQueryEntry query = updateQueryCache[uTypeID];
+                for (int i = 0; i < updatables.Count; i++)
+                {
+                    if ((queryUpdatesForBody.NeededUpdates[i] & query.Type) == query.Type)
+                        query.ToBeUpdated.Enqueue(updatables[i]);
+                }
+            }
 
             lastUpdateCacheID = UpdateID;
         }
 
         private class QueryUpdatablesForBody : SlimParallel.IForBody
         {
-            public IReadOnlyList<ICompUpdatable> Updatables;
-            public UpdatableQueryEntry[] UpdateQueryCache;
+            public ArrayRange<ICompUpdatable> Updatables;
+            public UpdateType[] NeededUpdates = new UpdateType[0];
 
             public void Execute(int i)
             {
-                ICompUpdatable u = Updatables[i];
-
-                UpdateType neededUpdates = u.NeededUpdates;
-
-                for (int uTypeID = 0; uTypeID < UpdateQueryCache.Length; uTypeID++)
-                {
-                    UpdatableQueryEntry query = UpdateQueryCache[uTypeID];
-                    if ((neededUpdates & query.Type) == query.Type)
-                    {
-                        lock (query.ToBeUpdated)
-                        {
-                            query.ToBeUpdated.Enqueue(u);
-                        }
-                    }
-                }
+                NeededUpdates[i] = Updatables[i].NeededUpdates;
             }
         }
 
@@ -298,88 +518,201 @@ namespace Dragonfly.Engine.Core
 
             UpdatableQueryEntry updateCache = GetUpdatablesQueryEntry(updateType);
 
-            while (updateCache.ToBeUpdated.Count > 0)
+            // components that allocate graphic resources are not updated while rendering
+            if (RenderingInProgress)
             {
-                ICompUpdatable u = updateCache.ToBeUpdated.Dequeue();
+                int updateCount = updateCache.ToBeUpdated.Count;
+                for (int i = 0; i < updateCount; i++)
+                {
+                    ICompUpdatable u = updateCache.ToBeUpdated.Dequeue();
+                    if (u is ICompAllocator)
+                        updateCache.Deferred.Enqueue(u);
+                    else
+                        updateCache.ToBeUpdated.Enqueue(u);
+                }
+            }
+
+            RunUpdates(g, updateType, updateCache.ToBeUpdated);
+        }
+
+        /// <summary>
+        /// Call the updates of the specified type that were postponed while rendering was in progress.
+        /// </summary>
+        public void UpdateDeferredComponents(IDFGraphics g, UpdateType updateType)
+        {
+            RunUpdates(g, updateType, GetUpdatablesQueryEntry(updateType).Deferred);
+        }
+
+        /// <summary>
+        /// Call all the queued updates on this thread. The parallel updates of ICompParallelUpdatable components run on the worker threads, concurrently with the following
+        /// updates that do not conflict with their declared accesses, so that conflicting updates still see each other's changes in queue order.
+        /// </summary>
+        private void RunUpdates(IDFGraphics g, UpdateType updateType, Queue<ICompUpdatable> toBeUpdated)
+        {
+            updatingGraphics = g;
+            parallelUpdates.Run(toBeUpdated, updateType, callUpdate);
+        }
+
+        private void CallUpdate(ICompUpdatable u, UpdateType updateType)
+        {
 #if TRACING
-                g.StartTracedSection(Color.TransparentWhite, u.GetType().Name);
+            updatingGraphics.StartTracedSection(Color.TransparentWhite, u.GetType().Name);
 #endif
-                u.Update(updateType);
+            u.Update(updateType);
 #if TRACING
-                g.EndTracedSection();
+            updatingGraphics.EndTracedSection();
 #endif
-            }            
+        }
+
+        /// <summary>
+        /// Evaluate the values read by render threads for the current frame in dependency order: transforms from the root down, then cameras and drawables.
+        /// Render threads will then read cached values without any evaluation or locking, and will not compute them while the next frame is being updated.
+        /// The world boxes of the drawables are also refreshed in the spatial index, and the occluders are rasterized for the cameras that use occlusion culling.
+        /// </summary>
+        public void EvaluateRenderValues(IReadOnlyList<CompRenderPass> passes)
+        {
+            Transforms.CacheValues();
+
+            Int3 viewTile = SpatialIndex.ReferenceTile;
+            ArrayRange<ICompOccluder> occluders = QueryRange<ICompOccluder>();
+            for (int i = 0; i < passes.Count; i++)
+            {
+                foreach (CompCamera camera in passes[i].CameraList)
+                {
+                    if (!camera.Active)
+                        continue;
+                    viewTile = camera.GetTransform().Tile; // the main pass is the last one
+                    camera.GetValue();
+                    _ = camera.Direction; // evaluate the camera cache
+                    camera.UpdateOcclusion(occluders, UpdateID);
+                }
+            }
+
+            // drawables whose transform is not in the flattened hierarchy, and their world boxes
+            SpatialIndex.BeginUpdate(viewTile);
+            evaluateRenderValuesBody.Drawables = QueryRange<CompDrawable>();
+            evaluateRenderValuesBody.SpatialIndex = SpatialIndex;
+            SlimParallel.For(0, evaluateRenderValuesBody.Drawables.Count, 64, evaluateRenderValuesBody);
+            SpatialIndex.EndUpdate(evaluateRenderValuesBody.Drawables);
+        }
+
+        private class EvaluateRenderValuesBody : SlimParallel.IForBody
+        {
+            public ArrayRange<CompDrawable> Drawables;
+            public SceneSpatialIndex SpatialIndex;
+
+            public void Execute(int i)
+            {
+                CompDrawable d = Drawables[i];
+                if (d.Active && d.Ready)
+                {
+                    // transforms in the flattened hierarchy have already been cached
+                    CompTransform t = d.GetAncestorTransform();
+                    if (t != null && t.HierarchyIndex < 0)
+                        t.GetValue();
+                }
+                SpatialIndex.RefreshBox(d);
+            }
         }
 
         #endregion
 
         #region Allocators
 
-        LoadResourcesArgs loadResForBody = new LoadResourcesArgs();
-        public void LoadComponentResources(IDFGraphics g, EngineResourceAllocator resAllocator)
+        internal void QueueInstanceUpload(InstanceList instances)
+        {
+            lock (changedInstances)
+            {
+                changedInstances.Add(instances);
+            }
+        }
+
+        /// <summary>
+        /// Upload all the instance lists modified since the last call.
+        /// </summary>
+        public void UploadChangedInstances(EngineResourceAllocator resAllocator)
         {
-            // trigger all resource allocator components that require to be invoked
-            IReadOnlyList<ICompAllocator> allocatorComponents = Query<ICompAllocator>();
-            loadResForBody.AllocatorComponents = allocatorComponents;
-            loadResForBody.Graphics = g;
-            loadResForBody.ResAllocator = resAllocator;
-            loadResForBody.AllocationLock = allocationLock;
-            SlimParallel.For(0, allocatorComponents.Count, 10, loadResForBody);
-            loadResForBody.AllocationLock = inactiveAllocators;
-            SlimParallel.For(0, allocatorComponents.Count, 10, loadResForBody);
+            lock (changedInstances)
+            {
+                foreach (InstanceList instances in changedInstances)
+                    instances.UploadChanges(resAllocator);
+                changedInstances.Clear();
+            }
         }
 
-        private class LoadResourcesArgs : SlimParallel.IForBody
+        /// <summary>
+        /// Queue an allocator to be polled by the next LoadComponentResources(). Can be called from any thread, and allocators already queued are ignored.
+        /// </summary>
+        public void QueueResourceLoading(Component allocator)
         {
-            internal IReadOnlyList<ICompAllocator> AllocatorComponents;
-            internal IDFGraphics Graphics;
-            internal EngineResourceAllocator ResAllocator;
-            internal object AllocationLock;
+            if (Interlocked.Exchange(ref allocator.LoadingQueued, 1) == 1)
+                return;
 
-            public void Execute(int i)
+            lock (loadingQueueLock)
+                loadingQueue.Add((ICompAllocator)allocator);
+        }
+
+        public void LoadComponentResources(IDFGraphics g, EngineResourceAllocator resAllocator)
+        {
+            // the second pass loads the allocators queued by the first one
+            for (int pass = 0; pass < 2; pass++)
             {
-                ICompAllocator allocator = AllocatorComponents[i];
+                // swap queues, so that allocators can be queued again while loading
+                List<ICompAllocator> toBeLoaded;
+                lock (loadingQueueLock)
+                {
+                    toBeLoaded = loadingQueue;
+                    loadingQueue = loadingQueueBack;
+                    loadingQueueBack = toBeLoaded;
+                }
+
+                for (int i = 0; i < toBeLoaded.Count; i++)
+                    LoadResources(g, resAllocator, toBeLoaded[i]);
+                toBeLoaded.Clear();
+            }
+        }
 
-                if (!allocator.LoadingRequired)
-                    return;
+        private void LoadResources(IDFGraphics g, EngineResourceAllocator resAllocator, ICompAllocator allocator)
+        {
+            Component c = (Component)allocator;
+            Volatile.Write(ref c.LoadingQueued, 0); // requests made from now on are queued again
+            if (c.Archetype == null)
+                return; // removed or inactive, will be queued again if activated
+
+            if (!allocator.LoadingRequired)
+                return;
 #if VERBOSE
-                Log.WriteLine("Loading Reosurces, component: " + allocator);
+            Log.WriteLine("Loading Reosurces, component: " + allocator);
 #endif
-                lock (AllocationLock)
-                {
 #if TRACING
-                    Graphics.StartTracedSection(Color.TransparentWhite, allocator.GetType().Name);
+            g.StartTracedSection(Color.TransparentWhite, allocator.GetType().Name);
 #endif
-                    allocator.LoadGraphicResources(ResAllocator);
+            allocator.LoadGraphicResources(resAllocator);
 #if TRACING
-                    Graphics.EndTracedSection();
+            g.EndTracedSection();
 #endif
-                }
-            }
+
+            // keep polling allocators that still need loading on the next frames
+            if (allocator.LoadingRequired)
+                QueueResourceLoading(c);
         }
 
         public void ReleaseComponentResources()
         {
-            IReadOnlyList<ICompAllocator> resAllocators = Query<ICompAllocator>();
+            ArrayRange<ICompAllocator> resAllocators = QueryRange<ICompAllocator>();
             for (int i = 0; i < resAllocators.Count; i++)
+            {
                 resAllocators[i].ReleaseGraphicResources();
+                QueueResourceLoading((Component)resAllocators[i]);
+            }
         }
 
         public void SetActive(Component c, bool active)
         {
-            ICompAllocator ca = c as ICompAllocator;
             if (active)
-            {
-                if (ca != null)
-                    inactiveAllocators.Remove(ca);
                 Add(c);
-            }
             else
-            {
-                if (ca != null)
-                    inactiveAllocators.Add(ca);
                 Remove(c);
-            }
         }
 
         #endregion
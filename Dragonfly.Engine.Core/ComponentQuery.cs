@@ -0,0 +1,138 @@
+﻿using Dragonfly.Utils;
+using System;
+using System.Collections;
+using System.Collections.Generic;
+
+namespace Dragonfly.Engine.Core
+{
+    internal interface IComponentQuery
+    {
+        /// <summary>
+        /// Add a component to this query results. The query index is the position of this query in the component archetype.
+        /// </summary>
+        void Add(Component c, int queryIndex);
+
+        void Remove(Component c, int queryIndex);
+    }
+
+    /// <summary>
+    /// The active components that can be assigned to a type, stored in a dense array. Each component keeps its index in the array, so removals take constant time.
+    /// The returned results are never modified: the array is copied on the first change after it has been read.
+    /// </summary>
+    internal class ComponentQuery<T> : IComponentQuery
+    {
+        private const int MIN_CAPACITY = 16;
+
+        private T[] values;
+        private Component[] owners; // the component stored at each index
+        private int[] ownerQueryIndices; // the index of this query in the archetype of each stored component
+        private int count;
+        private Results results; // the last returned results, which share the values array
+
+        public ComponentQuery()
+        {
+            values = new T[MIN_CAPACITY];
+            owners = new Component[MIN_CAPACITY];
+            ownerQueryIndices = new int[MIN_CAPACITY];
+        }
+
+        public int Count => count;
+
+        /// <summary>
+        /// Returns the current query results.
+        /// </summary>
+        public IReadOnlyList<T> Values
+        {
+            get
+            {
+                if (results == null)
+                    results = new Results(values, count);
+                return results;
+            }
+        }
+
+        /// <summary>
+        /// Returns the current query results as a range over the dense array, which can be iterated without any indirection.
+        /// </summary>
+        public ArrayRange<T> Range
+        {
+            get
+            {
+                if (results == null)
+                    results = new Results(values, count);
+                return new ArrayRange<T>() { Buffer = values, StartIndex = 0, Count = count };
+            }
+        }
+
+        public void Add(Component c, int queryIndex)
+        {
+            PrepareForChanges(count + 1);
+            values[count] = (T)(object)c;
+            owners[count] = c;
+            ownerQueryIndices[count] = queryIndex;
+            c.QuerySlots[queryIndex] = count;
+            count++;
+        }
+
+        public void Remove(Component c, int queryIndex)
+        {
+            PrepareForChanges(count);
+            int slot = c.QuerySlots[queryIndex];
+            int last = --count;
+
+            // move the last value to the removed slot
+            values[slot] = values[last];
+            owners[slot] = owners[last];
+            ownerQueryIndices[slot] = ownerQueryIndices[last];
+            owners[slot].QuerySlots[ownerQueryIndices[slot]] = slot;
+
+            values[last] = default(T);
+            owners[last] = null;
+            c.QuerySlots[queryIndex] = -1;
+        }
+
+        private void PrepareForChanges(int requiredCapacity)
+        {
+            if (results == null && requiredCapacity <= values.Length)
+                return;
+
+            // the values have been returned or are too small: continue on a new copy
+            int capacity = System.Math.Max(values.Length, requiredCapacity <= values.Length ? values.Length : 2 * requiredCapacity);
+            T[] newValues = new T[capacity];
+            Array.Copy(values, newValues, count);
+            values = newValues;
+            if (capacity > owners.Length)
+            {
+                Array.Resize(ref owners, capacity);
+                Array.Resize(ref ownerQueryIndices, capacity);
+            }
+            results = null;
+        }
+
+        private class Results : IReadOnlyList<T>
+        {
+            private T[] values;
+
+            public Results(T[] values, int count)
+            {
+                this.values = values;
+                Count = count;
+            }
+
+            public T this[int index] => values[index];
+
+            public int Count { get; private set; }
+
+            public IEnumerator<T> GetEnumerator()
+            {
+                for (int i = 0; i < Count; i++)
+                    yield return values[i];
+            }
+
+            IEnumerator IEnumerable.GetEnumerator()
+            {
+                return GetEnumerator();
+            }
+        }
+    }
+}
@@ -0,0 +1,15 @@
+﻿namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// An updatable that declares the objects read and written by its update, so that the parallel updates of other components can run while it is updated.
+    /// Updatables that do not declare their accesses are assumed to only modify their own component.
+    /// </summary>
+    public interface ICompDeclaredUpdatable : ICompUpdatable
+    {
+        /// <summary>
+        /// Declare all the components, component types or other objects that are read and written by the update of the specified type.
+        /// Declaring a write to typeof(object) makes the update wait for all the parallel updates queued before it.
+        /// </summary>
+        void GetUpdateAccess(UpdateType updateType, UpdateAccess access);
+    }
+}
@@ -0,0 +1,17 @@
+﻿using Dragonfly.Graphics.Math;
+
+namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// A component that can hide drawables from cameras with occlusion culling enabled.
+    /// Occluders are rasterized each frame, and should be simple shapes that lie inside the geometry they stand for, since everything behind them is considered hidden.
+    /// </summary>
+    public interface ICompOccluder : IComponent
+    {
+        /// <summary>
+        /// Add the occluder triangles to the specified buffer.
+        /// </summary>
+        /// <param name="referenceTile">The world tile to which the occluder coordinates should be relative.</param>
+        void AddOccluders(OcclusionBuffer buffer, Int3 referenceTile);
+    }
+}
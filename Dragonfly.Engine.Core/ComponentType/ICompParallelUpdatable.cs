@@ -0,0 +1,14 @@
+﻿namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// An updatable that splits its update in two parts: ParallelUpdate() is started on a worker thread when the component is reached in the update queue, and runs
+    /// concurrently with the following serial updates and the parallel updates of other components, as long as they do not conflict with the declared accesses.
+    /// Update() is then called on the main thread once ParallelUpdate() is completed, before the first following update that conflicts with it.
+    /// The declared accesses must cover both ParallelUpdate() and Update().
+    /// ParallelUpdate() should only prepare values for Update(): components cannot be created, removed, moved or (de)activated from it, and graphic resources should not be modified.
+    /// </summary>
+    public interface ICompParallelUpdatable : ICompDeclaredUpdatable
+    {
+        void ParallelUpdate(UpdateType updateType);
+    }
+}
@@ -1,4 +1,5 @@
 ﻿using Dragonfly.Graphics.Math;
+using Dragonfly.Utils;
 using System;
 using System.Runtime.CompilerServices;
 
@@ -6,6 +7,8 @@ namespace Dragonfly.Engine.Core
 {
     public abstract class CompCamera : Component<Float4x4>
     {
+        private const int OCCLUSION_BUFFER_WIDTH = 256, OCCLUSION_BUFFER_HEIGHT = 128;
+
         private struct CameraCache
         {
             public TiledFloat3 Position;
@@ -34,7 +37,7 @@ namespace Dragonfly.Engine.Core
             }
         }
 
-        private class DefaultVolume : IVolume
+        private class DefaultVolume : IVolume, IBatchVolume
         {
             public ViewFrustum ViewFrustum;
 
@@ -63,10 +66,24 @@ namespace Dragonfly.Engine.Core
             {
                 return ViewFrustum.Intersects(b);
             }
+
+            public void Intersects(AABoxArray boxes, ulong[] resultMask)
+            {
+                ViewFrustum.Intersects(boxes, resultMask);
+            }
+
+            public void Contains(AABoxArray boxes, ulong[] resultMask)
+            {
+                ViewFrustum.Contains(boxes, resultMask);
+            }
         }
 
         private CompCameraCache cameraCache;
         private DefaultVolume defaultVolume;
+        private OcclusionBuffer occlusionBuffer;
+        private int occlusionUpdateID;
+        private SceneSpatialIndex.VisibleSet visibleDrawables;
+        private int visibleDrawablesUpdateID;
 
         protected CompCamera(Component owner) : base(owner)
         {
@@ -75,6 +92,9 @@ namespace Dragonfly.Engine.Core
             defaultVolume = new DefaultVolume();
             StatsLock = new object();
             StatsFrameID = -1;
+            occlusionUpdateID = -1;
+            visibleDrawables = new SceneSpatialIndex.VisibleSet();
+            visibleDrawablesUpdateID = -1;
         }
 
         /// <summary>
@@ -111,6 +131,59 @@ namespace Dragonfly.Engine.Core
 
         internal int StatsFrameID;
 
+        /// <summary>
+        /// If true, the scene occluders are rasterized from this camera each frame, and drawables hidden behind them are not rendered.
+        /// </summary>
+        public bool OcclusionCulling { get; set; }
+
+        /// <summary>
+        /// The occluders rasterized from this camera for the frame being rendered, or null if occlusion culling is disabled.
+        /// </summary>
+        internal OcclusionBuffer Occlusion { get; private set; }
+
+        /// <summary>
+        /// Rasterize the specified occluders from this camera, if occlusion culling is enabled and this has not been already done in the current update.
+        /// </summary>
+        internal void UpdateOcclusion(ArrayRange<ICompOccluder> occluders, int updateID)
+        {
+            if (!OcclusionCulling)
+            {
+                Occlusion = null;
+                return;
+            }
+
+            if (occlusionUpdateID == updateID)
+                return; // already rasterized for another pass
+
+            if (occlusionBuffer == null)
+                occlusionBuffer = new OcclusionBuffer(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+
+            TiledFloat4x4 cameraTransform = GetTransform();
+            occlusionBuffer.Begin(cameraTransform.Value * GetValue(), LocalPosition);
+            for (int i = 0; i < occluders.Count; i++)
+                occluders[i].AddOccluders(occlusionBuffer, cameraTransform.Tile);
+            occlusionBuffer.BuildHiZ();
+            occlusionUpdateID = updateID;
+            Occlusion = occlusionBuffer;
+        }
+
+        /// <summary>
+        /// The indexed drawables visible from this camera in the frame being rendered. Only read by render threads, and shared by all the passes that use this camera.
+        /// </summary>
+        internal SceneSpatialIndex.VisibleSet VisibleDrawables => visibleDrawables;
+
+        /// <summary>
+        /// Find the indexed drawables visible from this camera, if this has not been already done in the current update.
+        /// </summary>
+        internal void UpdateVisibleDrawables(SceneSpatialIndex spatialIndex, int updateID)
+        {
+            if (visibleDrawablesUpdateID == updateID)
+                return; // already queried for another pass
+
+            spatialIndex.Query(Volume, GetTransform().Tile, visibleDrawables);
+            visibleDrawablesUpdateID = updateID;
+        }
+
         /// <summary>
         /// Returns the volume of this camera, based by default on this component view frustum.
         /// Used by the engine to test for visibility.
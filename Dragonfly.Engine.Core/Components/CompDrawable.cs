@@ -13,11 +13,12 @@ namespace Dragonfly.Engine.Core
         protected CompDrawable(Component parent) : base(parent)
         {
             materials = new ObservableList<CompMaterial>();
-            materials.ItemAdded += item => { item.UsedBy.Add(this); OnMaterialsChanged(); };
-            materials.ItemRemoved += item => { item.UsedBy.Remove(this); OnMaterialsChanged(); };
+            materials.ItemAdded += item => { item.AddUser(this); OnMaterialsChanged(); };
+            materials.ItemRemoved += item => { item.RemoveUser(this); OnMaterialsChanged(); };
 
             IsBounded = true;
-            Instances = new List<Float4x4>();
+            Instances = new InstanceList(ComManager);
+            SpatialEntry = new SceneSpatialIndex.Entry();
         }
 
         protected virtual void OnMaterialsChanged() { }
@@ -38,7 +39,15 @@ namespace Dragonfly.Engine.Core
 
         public abstract IndexBuffer GetIndexBuffer();
 
-        public List<Float4x4> Instances { get; protected set; }
+        public InstanceList Instances { get; protected set; }
+
+        internal SceneSpatialIndex.Entry SpatialEntry { get; private set; }
+
+        protected internal override void OnDispose()
+        {
+            Instances.ReleaseBuffer();
+            base.OnDispose();
+        }
 
     }
 
@@ -100,9 +100,24 @@ namespace Dragonfly.Engine.Core
         }
         /// <summary>
         /// List of drawables that use this material.
+        /// While rendering is in progress the list is replaced on each change, so that render threads can keep iterating it.
         /// </summary>
         internal List<CompDrawable> UsedBy { get; private set; }
 
+        internal void AddUser(CompDrawable drawable)
+        {
+            if (ComManager.RenderingInProgress)
+                UsedBy = new List<CompDrawable>(UsedBy);
+            UsedBy.Add(drawable);
+        }
+
+        internal void RemoveUser(CompDrawable drawable)
+        {
+            if (ComManager.RenderingInProgress)
+                UsedBy = new List<CompDrawable>(UsedBy);
+            UsedBy.Remove(drawable);
+        }
+
         /// <summary>
         /// Specify a list of tags exposed by this material, that are then used to decide in which pass is rendered.
         /// </summary>
@@ -186,6 +201,16 @@ namespace Dragonfly.Engine.Core
             paramsInvalidated = false;          
         }
 
+        /// <summary>
+        /// Update the shader params immediately, e.g. after the render targets they reference changed.
+        /// </summary>
+        internal void RefreshParams()
+        {
+            if (LoadingRequired)
+                return;
+            UpdateParamsInternal();
+        }
+
         private void UpdateParamsInternal()
         {
             if(Modules != null)
@@ -338,7 +363,13 @@ namespace Dragonfly.Engine.Core
         }
 
 
-        public bool LoadingRequired { get; protected set; }
+        private bool loadingRequired;
+
+        public bool LoadingRequired
+        {
+            get { return loadingRequired; }
+            protected set { SetLoadingRequired(ref loadingRequired, value); }
+        }
 
         public override bool Ready { get; protected set; }
 
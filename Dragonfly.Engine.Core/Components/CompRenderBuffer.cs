@@ -10,6 +10,8 @@ namespace Dragonfly.Engine.Core
         private SurfaceFormat[] formats;
         private RenderTarget[] renderTargets;
         private int preferredWidth, preferredHeight;
+        private bool transient;
+        private string targetsKey;
 
         public CompRenderBuffer(Component parent, SurfaceFormat[] formats, RenderBufferResizeStyle resizeStyle) : base(parent)
         {
@@ -82,14 +84,54 @@ namespace Dragonfly.Engine.Core
             }
         }
 
+        private bool loadingRequired;
+
         public bool LoadingRequired
         {
-            get; private set;
+            get { return loadingRequired; }
+            private set { SetLoadingRequired(ref loadingRequired, value); }
+        }
+
+        /// <summary>
+        /// If true, the content of this buffer is only valid during a frame, from the first pass that renders to it to the last pass that reads it.
+        /// Transient buffers do not own their render targets, which are assigned by the scene frame graph and shared with other transient buffers never used at the same time.
+        /// <para/> A transient buffer should only be read by passes that require the passes writing it or that list it in their InputBuffers, and through a RenderTargetRef since its targets can change.
+        /// </summary>
+        public bool Transient
+        {
+            get { return transient; }
+            set
+            {
+                if (transient == value)
+                    return;
+                ReleaseGraphicResources();
+                transient = value;
+            }
+        }
+
+        /// <summary>
+        /// The render targets currently assigned to this buffer by the frame graph, or null if not transient.
+        /// </summary>
+        internal RenderTarget[] TransientTargets
+        {
+            get { return transient ? renderTargets : null; }
         }
 
         public void LoadGraphicResources(EngineResourceAllocator g)
         {
-            renderTargets = new RenderTarget[formats.Length];
+            if (transient)
+                return; // targets will be bound by the frame graph
+
+            renderTargets = CreateTargets(g);
+            LoadingRequired = false;
+        }
+
+        /// <summary>
+        /// Create a new set of render targets that match the formats and size of this buffer.
+        /// </summary>
+        internal RenderTarget[] CreateTargets(EngineResourceAllocator g)
+        {
+            RenderTarget[] targets = new RenderTarget[formats.Length];
             float sizePercent = 1.0f;
             switch (ResizeStyle)
             {
@@ -100,15 +142,52 @@ namespace Dragonfly.Engine.Core
 
             for (int i = 0; i < formats.Length; i++)
             {
-                if (IsFixedSize) renderTargets[i] = g.CreateRenderTarget(preferredWidth, preferredHeight, formats[i], i == 0);
-                else renderTargets[i] = g.CreateRenderTarget(sizePercent, formats[i], i == 0);
-                if (i > 0) renderTargets[i].SetDepthWriteTarget(renderTargets[0]);
+                if (IsFixedSize) targets[i] = g.CreateRenderTarget(preferredWidth, preferredHeight, formats[i], i == 0);
+                else targets[i] = g.CreateRenderTarget(sizePercent, formats[i], i == 0);
+                if (i > 0) targets[i].SetDepthWriteTarget(targets[0]);
             }
+            return targets;
+        }
+
+        /// <summary>
+        /// Returns a key that is equal for all the buffers whose render targets can be exchanged.
+        /// </summary>
+        internal string GetTargetsKey()
+        {
+            if (targetsKey == null)
+            {
+                // formats and size cannot change, the key is only computed once
+                string key = IsFixedSize ? (preferredWidth + "x" + preferredHeight) : ResizeStyle.ToString();
+                for (int i = 0; i < formats.Length; i++)
+                    key += "|" + formats[i];
+                targetsKey = key;
+            }
+            return targetsKey;
+        }
+
+        internal void BindTransientTargets(RenderTarget[] targets)
+        {
+            renderTargets = targets;
             LoadingRequired = false;
         }
 
+        internal void UnbindTransientTargets()
+        {
+            if (!transient)
+                return;
+            renderTargets = null;
+            LoadingRequired = true;
+        }
+
         public void ReleaseGraphicResources()
         {
+            if (transient)
+            {
+                // targets are owned by the frame graph
+                UnbindTransientTargets();
+                return;
+            }
+
             if (renderTargets != null)
             {
                 for (int i = 0; i < renderTargets.Length; i++)
@@ -20,25 +20,57 @@ namespace Dragonfly.Engine.Core
         /// </summary>
         private const int MaxCmdListsPerPass = 3;
 
+        // handles to the parameters updated for each camera and drawable
+        private static readonly ShaderParam CameraMatrixParam = ShaderParam.Get("CAMERA_MATRIX");
+        private static readonly ShaderParam CameraInverseParam = ShaderParam.Get("CAMERA_INVERSE");
+        private static readonly ShaderParam CameraPosParam = ShaderParam.Get("CAMERA_POS");
+        private static readonly ShaderParam CameraDirParam = ShaderParam.Get("CAMERA_DIR");
+        private static readonly ShaderParam CameraUpParam = ShaderParam.Get("CAMERA_UP");
+        private static readonly ShaderParam PixSizeParam = ShaderParam.Get("PIX_SIZE");
+        private static readonly ShaderParam WorldMatrixParam = ShaderParam.Get("WORLD_MATRIX");
+        private static readonly ShaderParam NrmWorldMatrixParam = ShaderParam.Get("NRM_WORLD_MATRIX");
+
+        /// <summary>
+        /// Buffers used by a render thread to cull the draws of the cameras it records.
+        /// </summary>
+        internal class CullingBuffers
+        {
+            public ArrayRange<int> VisibleInstances = new ArrayRange<int>(1024); // indices of the visible instances of the drawable being processed
+            public AABoxArray InstanceBoxes = new AABoxArray(1024); // world boxes of the instances of the drawable being processed
+            public ulong[] InstanceMask = new ulong[16];
+        }
+
         class RenderThread : SlimParallel.ITaskBody
         {
             public CommandList CmdList;
-            public SortedLinkedList<CompMaterial> MaterialList;
             public int StartCamera;
             public int EndCamera;
             public CompRenderPass Pass;
-            internal int StartMaterial;
-            internal int EndMaterial;
+            internal int StartPacket;
+            internal int EndPacket;
+            internal CullingBuffers Culling = new CullingBuffers();
 
             public void Execute()
             {
-                Pass.FillCommandList(CmdList, MaterialList, StartCamera, EndCamera, StartMaterial, EndMaterial);
+                // read the component values of the rendered frame, even if the next one is being updated
+                bool wasReadingRenderValues = ComponentManager.ReadingRenderValues; // the task may run inline on a thread that is already rendering
+                ComponentManager.ReadingRenderValues = true;
+                try
+                {
+                    Pass.FillCommandList(CmdList, StartCamera, EndCamera, StartPacket, EndPacket, Culling);
+                }
+                finally
+                {
+                    ComponentManager.ReadingRenderValues = wasReadingRenderValues;
+                }
                 CmdList.QueueExecution();
             }
         }
 
-        private ArrayRange<Float4x4> instanceList;
         private List<RenderThread> renderThreads;
+        private ArrayRange<DrawPacket> drawPackets; // draws of the current frame, in recording order
+        private DrawKeyBuilder drawKeys;
+        private bool hasIndexedPackets; // true if some of the draw packets are tested against the spatial index
         private int statsFrameID;
         private object statsLock;
 
@@ -49,10 +81,13 @@ namespace Dragonfly.Engine.Core
             RenderToTexture = renderBuffer != null;
             ClearFlags = ClearFlags.ClearTargets | ClearFlags.ClearDepth;
             RequiredPasses = new List<CompRenderPass>();
+            InputBuffers = new List<CompRenderBuffer>();
+            AliasedPasses = new List<CompRenderPass>();
             CameraList = new List<CompCamera>();
             MaterialFilters = new List<MaterialClassFilter>();
-            instanceList = new ArrayRange<Float4x4>(8192);
             renderThreads = new List<RenderThread>();
+            drawPackets = new ArrayRange<DrawPacket>(64);
+            drawKeys = new DrawKeyBuilder();
             statsLock = new object();
             statsFrameID = -1;
             DebugColor = Color.LightBlue;
@@ -77,6 +112,13 @@ namespace Dragonfly.Engine.Core
                 if (RequiredPasses[i].CanBeRendered)
                     renderThreads[0].CmdList.RequiredLists.Add(RequiredPasses[i].renderThreads.Last().CmdList);
             }
+
+            // wait for the passes that used the same transient targets
+            for (int i = 0; i < AliasedPasses.Count; i++)
+            {
+                if (AliasedPasses[i].CanBeRendered)
+                    renderThreads[0].CmdList.RequiredLists.Add(AliasedPasses[i].renderThreads.Last().CmdList);
+            }
         }
 
         /// <summary>
@@ -182,6 +224,18 @@ namespace Dragonfly.Engine.Core
         /// </summary>
         public List<CompRenderPass> RequiredPasses { get; internal set; }
 
+        /// <summary>
+        /// Render buffers read by this pass, other than the ones rendered by its required passes.
+        /// <para/> These entries are only used to compute the lifetime of transient buffers, and do not affect pass sorting.
+        /// </summary>
+        public List<CompRenderBuffer> InputBuffers { get; private set; }
+
+        /// <summary>
+        /// Passes that used the transient targets assigned to the buffers of this pass before it, which should be completed before this pass is executed.
+        /// This list is filled by the frame graph.
+        /// </summary>
+        internal List<CompRenderPass> AliasedPasses { get; private set; }
+
         /// <summary>
         /// If set to a valid value, the specified template will be used to draw materials. 
         /// If a template is not available for a particular material, this will not be drawn.
@@ -244,9 +298,21 @@ namespace Dragonfly.Engine.Core
 
         public void Render()
         {
-            SortedLinkedList<CompMaterial> materialList = Context.Scene.Components.QueryMaterials(MaterialFilters);
+            SortedArrayList<CompMaterial> materialList = Context.Scene.Components.QueryMaterials(MaterialFilters);
+            PrepareDrawPackets(materialList);
             int activeCameraCount = ActiveCameraCount;
 
+            // query the spatial index once per camera and frame, the results are shared by render threads and by the other passes using the same cameras
+            if (hasIndexedPackets)
+            {
+                StartTracedSection(Color.Red, "Culling");
+                ComponentManager components = Context.Scene.Components;
+                for (int i = 0; i < CameraList.Count; i++)
+                    if (CameraList[i].Active)
+                        CameraList[i].UpdateVisibleDrawables(components.SpatialIndex, components.UpdateID);
+                EndTracedSection();
+            }
+
             if (activeCameraCount > 1)
             {
                 // split load on cameras
@@ -259,26 +325,24 @@ namespace Dragonfly.Engine.Core
                     rt.EndCamera = rt.StartCamera;
                     for (int rtCamCount = 0; rtCamCount < camPerList && rt.EndCamera < CameraList.Count; rt.EndCamera++)
                         rtCamCount += CameraList[rt.EndCamera].Active.ToInt();
-                    rt.MaterialList = materialList;
-                    rt.StartMaterial = 0;
-                    rt.EndMaterial = materialList.Count;
+                    rt.StartPacket = 0;
+                    rt.EndPacket = drawPackets.Count;
                     rt.CmdList.StartRecording();
                     SlimParallel.RunAsync(rt);
                 }
             }
             else
             {
-                // split load on materials
-                int materialsPerList = (materialList.Count + renderThreads.Count - 1) / renderThreads.Count;
+                // split load on draw packets
+                int packetsPerList = (drawPackets.Count + renderThreads.Count - 1) / renderThreads.Count;
 
                 for (int i = 0; i < renderThreads.Count; i++)
                 {
                     RenderThread rt = renderThreads[i];
                     rt.StartCamera = 0;
                     rt.EndCamera = CameraList.Count;
-                    rt.StartMaterial = i * materialsPerList;
-                    rt.EndMaterial = Math.Min(materialList.Count, rt.StartMaterial + materialsPerList);
-                    rt.MaterialList = materialList;
+                    rt.StartPacket = Math.Min(drawPackets.Count, i * packetsPerList);
+                    rt.EndPacket = Math.Min(drawPackets.Count, rt.StartPacket + packetsPerList);
                     rt.CmdList.StartRecording();
                     SlimParallel.RunAsync(rt);
                 }
@@ -287,13 +351,68 @@ namespace Dragonfly.Engine.Core
         }
 
         /// <summary>
-        /// Fill the command list with the draw call the render the specified materials.
+        /// Fill the draw packet list with a draw for each active drawable of the specified materials, sorted by their draw keys.
+        /// Materials and drawables that cannot be rendered are skipped, so that render threads can split the remaining packets evenly.
         /// </summary>
-        internal void FillCommandList(CommandList cmdList, SortedLinkedList<CompMaterial> materialList, int startCamera, int endCamera, int startMaterial, int endMaterial)
+        private void PrepareDrawPackets(SortedArrayList<CompMaterial> materialList)
         {
             bool templateOverrideEnabled = !string.IsNullOrEmpty(OverrideShaderTemplate);
             int templateOverrideHash = templateOverrideEnabled ? OverrideShaderTemplate.GetHashCode() : 0;
 
+            // draws are sorted front to back for the first camera
+            CompCamera depthCamera = CameraList.Find(c => c.Active);
+            TiledFloat3 depthCameraPos = depthCamera != null ? depthCamera.Position : new TiledFloat3();
+
+            drawPackets.Count = 0;
+            hasIndexedPackets = false;
+            int orderRank = -1;
+            for (int materialID = 0; materialID < materialList.Count; materialID++)
+            {
+                CompMaterial m = materialList[materialID];
+                if (materialID == 0 || m.RenderOrder != materialList[materialID - 1].RenderOrder)
+                    orderRank++; // materials with different render orders should not be mixed
+
+                if (!m.Ready // not ready, skip
+                    || (templateOverrideEnabled && !m.IsTemplateAvailable(templateOverrideHash)) // do not implement the template required by this pass
+                    )
+                    continue;
+
+                Shader shader = m.Shaders[templateOverrideEnabled ? templateOverrideHash : m.DefaultTemplateHash];
+                List<CompDrawable> usedBy = m.UsedBy;
+                for (int drawableID = 0; drawableID < usedBy.Count; drawableID++)
+                {
+                    CompDrawable d = usedBy[drawableID];
+                    if (!d.Active || !d.Ready)
+                        continue; // drawable not ready or active
+
+                    if (drawPackets.Count == drawPackets.Buffer.Length)
+                        Array.Resize(ref drawPackets.Buffer, 2 * drawPackets.Buffer.Length);
+
+                    float depth = depthCamera != null ? (d.GetTransform().Position - depthCameraPos).ToFloat3().Length : 0;
+
+                    DrawPacket packet;
+                    packet.SortKey = drawKeys.GetKey(orderRank, shader, materialID, depth);
+                    packet.Material = m;
+                    packet.Drawable = d;
+                    packet.Shader = shader;
+                    packet.Vertices = d.GetVertexBuffer();
+                    packet.Indices = d.GetIndexBuffer();
+                    drawPackets.Add(packet);
+                    hasIndexedPackets |= d.SpatialEntry.Proxy >= 0;
+                }
+            }
+
+            // group draws by pipeline and material
+            drawKeys.Sort(ref drawPackets);
+        }
+
+        /// <summary>
+        /// Fill the command list with the draw calls of the specified range of draw packets.
+        /// </summary>
+        internal void FillCommandList(CommandList cmdList, int startCamera, int endCamera, int startPacket, int endPacket, CullingBuffers culling)
+        {
+            SceneSpatialIndex spatialIndex = Context.Scene.Components.SpatialIndex;
+            ref ArrayRange<int> visibleInstances = ref culling.VisibleInstances;
             RenderStats partialPassStats = new RenderStats();
 #if VERBOSE
             Context.Scene.Log.WriteLine("Rendering pass: " + ToString());
@@ -330,136 +449,213 @@ namespace Dragonfly.Engine.Core
                 RenderStats cameraStats = new RenderStats();
 
                 cmdList.SetViewport(camera.Viewport);
-                if (startMaterial == 0 && ClearFlags != ClearFlags.None)
+                if (startPacket == 0 && ClearFlags != ClearFlags.None)
                     cmdList.ClearSurfaces(ClearValue, ClearFlags);
 
                 TiledFloat4x4 cameraTransform = camera.GetTransform();
                 Float4x4 cameraMatrix = cameraTransform.Value * camera.GetValue();
                 Float4x4 cameraInverse = cameraMatrix.Invert();
-                cmdList.SetParam("CAMERA_MATRIX", cameraMatrix);
-                cmdList.SetParam("CAMERA_INVERSE", cameraInverse);
-                cmdList.SetParam("CAMERA_POS", camera.LocalPosition);
-                cmdList.SetParam("CAMERA_DIR", camera.Direction);
-                cmdList.SetParam("CAMERA_UP",  camera.UpDirection);
-                cmdList.SetParam("PIX_SIZE", 1.0f / (Float2)Resolution / camera.Viewport.Size);
+                cmdList.SetParam(CameraMatrixParam, cameraMatrix);
+                cmdList.SetParam(CameraInverseParam, cameraInverse);
+                cmdList.SetParam(CameraPosParam, camera.LocalPosition);
+                cmdList.SetParam(CameraDirParam, camera.Direction);
+                cmdList.SetParam(CameraUpParam,  camera.UpDirection);
+                cmdList.SetParam(PixSizeParam, 1.0f / (Float2)Resolution / camera.Viewport.Size);
                 // DEPRECATED: avoiding using the world tile in shader is possible, making full world-coordinate CPU-only.
                 // This make it possible to change or updated them in the future.
                 //cmdList.SetParam("WORLD_TILE", cameraTransform.Tile);
 
                 IVolume cameraVolume = camera.Volume;
-
-                // process each material
-                int materialID = -1;
-                foreach(CompMaterial m in materialList)
+                IBatchVolume batchVolume = cameraVolume as IBatchVolume;
+                OcclusionBuffer occlusion = camera.Occlusion;
+                Float3 spatialIndexOffset = (cameraTransform.Tile - spatialIndex.ReferenceTile) * TiledFloat.TileSize;
+                SceneSpatialIndex.VisibleSet visibleDrawables = camera.VisibleDrawables; // queried by Render()
+
+                // process each draw packet
+                CompMaterial curMaterial = null;
+                VertexBuffer curVertices = null;
+                IndexBuffer curIndices = null;
+                bool materialVisible = false, materialUpdated = false;
+                if (startPacket == 0)
+                    cameraStats.AvoidedStateChangeCount = drawKeys.AvoidedStateChanges;
+                for (int packetID = startPacket; packetID < endPacket; packetID++)
                 {
-                    materialID++;
-                    cameraStats.ProcessedDrawableCount++; // pre-count as 1 drawable even if this material is skipped
-
-                    // limit the range of rendered materials
-                    if (materialID < startMaterial)
-                        continue; // skip materials up to the first one to be rendered
-                    else if (materialID >= endMaterial)
-                        break; // stop at the last material
-
-                    StartTracedSection(Color.Orange, m.Name);
+                    DrawPacket packet = drawPackets[packetID];
+                    cameraStats.ProcessedDrawableCount++;
 
-                    if (!m.Ready // not ready, skip
-                        || (templateOverrideEnabled && !m.IsTemplateAvailable(templateOverrideHash)) // do not implement the template required by this pass
-                        || (m.VisibleOnlyForCamera != null && m.VisibleOnlyForCamera.ID != camera.ID) // should not be rendered for this camera
-                        )
+                    if (packet.Material != curMaterial)
                     {
-                        EndTracedSection();
-                        continue;
+                        // first draw with a new material
+                        if (curMaterial != null)
+                            EndTracedSection();
+                        curMaterial = packet.Material;
+                        StartTracedSection(Color.Orange, curMaterial.Name);
+                        materialVisible = curMaterial.VisibleOnlyForCamera == null || curMaterial.VisibleOnlyForCamera.ID == camera.ID; // can be only rendered for a specific camera
+                        materialUpdated = false;
                     }
 
-                    bool materialUpdated = false;
-
-                    // draw each drawable using the current material
-                    int drawableCount = m.UsedBy.Count;
-                    cameraStats.ProcessedDrawableCount += drawableCount - 1;
-                    for (int drawableID = 0; drawableID < drawableCount; drawableID++)
-                    {
-                        CompDrawable d = m.UsedBy[drawableID];
-                        StartTracedSection(Color.Green, d.Name);
+                    if (!materialVisible)
+                        continue;
 
-                        if (!d.Active || !d.Ready)
-                        {
-                            EndTracedSection();
-                            continue; // drawable not ready or active
-                        }
+                    CompDrawable d = packet.Drawable;
+                    StartTracedSection(Color.Green, d.Name);
+                    StartTracedSection(Color.Red, "Visibility");
 
-                        StartTracedSection(Color.Red, "Visibility");
+                    // test for visibility (instances are read from the uploaded buffer, which is not modified by updates)
+                    InstanceBuffer instances = d.Instances.Buffer;
+                    int instanceCount = d.Instances.UploadedCount;
+                    bool isInstanced = instanceCount > 0;
+                    if (isInstanced)
+                    {
+                        if (visibleInstances.Buffer.Length < instanceCount)
+                            visibleInstances = new ArrayRange<int>(instanceCount);
+                        visibleInstances.Count = 0;
+                    }
 
-                        // test for visibility
-                        bool isInstanced = d.Instances.Count > 0;
-                        Float4x4 worldMatrix = d.GetTransform().ToFloat4x4(cameraTransform.Tile);
-                        if (d.IsBounded)
+                    Float4x4 worldMatrix = d.GetTransform().ToFloat4x4(cameraTransform.Tile);
+                    if (d.IsBounded)
+                    {
+                        // indexed drawables are tested with the query results, the others with their bounds
+                        SceneSpatialIndex.Entry spatialEntry = d.SpatialEntry;
+                        int proxy = spatialEntry.Proxy;
+                        bool contained = false;
+                        bool visible = proxy < 0 || visibleDrawables.Contains(proxy, out contained);
+                        bool instanceBoxesReady = false;
+
+                        if (visible && isInstanced)
                         {
-                            if (isInstanced)
+                            if (contained)
+                            {
+                                // all the instances are inside the camera volume
+                                for (int i = 0; i < instanceCount; i++)
+                                    visibleInstances.Add(i);
+                            }
+                            else if (batchVolume != null && proxy >= 0 && spatialEntry.InstanceBoxes.Count == instanceCount)
+                            {
+                                // transform the local instance boxes cached by the spatial index, and test them in batches
+                                spatialEntry.InstanceBoxes.Transform(worldMatrix, culling.InstanceBoxes);
+                                int maskLength = AABoxArray.GetMaskLength(instanceCount);
+                                if (culling.InstanceMask.Length < maskLength)
+                                    culling.InstanceMask = new ulong[maskLength];
+                                batchVolume.Intersects(culling.InstanceBoxes, culling.InstanceMask);
+                                instanceBoxesReady = true;
+
+                                for (int w = 0; w < maskLength; w++)
+                                {
+                                    ulong bits = culling.InstanceMask[w];
+                                    for (int i = w << 6; bits != 0; i++, bits >>= 1)
+                                        if ((bits & 1) != 0)
+                                            visibleInstances.Add(i);
+                                }
+                            }
+                            else
                             {
-                                instanceList.Count = 0;
                                 AABox bb = d.GetBoundingBox();
                                 Float4x4 instWorld;
-                                for (int i = 0; i < d.Instances.Count; i++)
+                                for (int i = 0; i < instanceCount; i++)
                                 {
-                                    instWorld = d.Instances[i] * worldMatrix;
+                                    instWorld = instances.GetInstance(i) * worldMatrix;
                                     if (cameraVolume.Intersects(bb * instWorld))
-                                        instanceList.Add(d.Instances[i]);
+                                        visibleInstances.Add(i);
                                 }
+                            }
+                            visible = visibleInstances.Count > 0;
+                        }
+                        else if (visible && proxy < 0)
+                        {
+                            visible = cameraVolume.Intersects(d.GetBoundingBox() * worldMatrix);
+                        }
 
-                                if (instanceList.Count == 0)
-                                {
-                                    EndTracedSection();
-                                    EndTracedSection();
-                                    continue; // drawable not visible
-                                }
+                        if (visible && occlusion != null)
+                        {
+                            // skip the drawable if hidden by the occluders
+                            if (proxy >= 0)
+                                visible = !occlusion.IsOccluded(new AABox(spatialEntry.WorldBox.Min - spatialIndexOffset, spatialEntry.WorldBox.Max - spatialIndexOffset));
+                            else if (!isInstanced)
+                                visible = !occlusion.IsOccluded(d.GetBoundingBox() * worldMatrix);
+
+                            if (!visible)
+                            {
+                                cameraStats.OcclusionCulledCount += isInstanced ? visibleInstances.Count : 1;
                             }
-                            else
+                            else if (isInstanced)
                             {
-                                if (!cameraVolume.Intersects(d.GetBoundingBox() * worldMatrix))
+                                // remove the hidden instances
+                                if (!instanceBoxesReady && proxy >= 0 && spatialEntry.InstanceBoxes.Count == instanceCount)
+                                {
+                                    spatialEntry.InstanceBoxes.Transform(worldMatrix, culling.InstanceBoxes);
+                                    instanceBoxesReady = true;
+                                }
+
+                                int unoccludedCount = 0;
+                                for (int i = 0; i < visibleInstances.Count; i++)
                                 {
-                                    EndTracedSection();
-                                    EndTracedSection();
-                                    continue; // drawable not visible
+                                    int instanceID = visibleInstances[i];
+                                    AABox instanceBox = instanceBoxesReady ? culling.InstanceBoxes[instanceID] : d.GetBoundingBox() * (instances.GetInstance(instanceID) * worldMatrix);
+                                    if (!occlusion.IsOccluded(instanceBox))
+                                        visibleInstances[unoccludedCount++] = instanceID;
                                 }
+                                cameraStats.OcclusionCulledCount += visibleInstances.Count - unoccludedCount;
+                                visibleInstances.Count = unoccludedCount;
+                                visible = unoccludedCount > 0;
                             }
                         }
 
-                        EndTracedSection();
-
-                        // update transform matrices                 
-                        cmdList.SetParam("WORLD_MATRIX", worldMatrix);
-                        Float3x3 nrmMatrix = ((Float3x3)worldMatrix).Invert().Transpose();
-                        cmdList.SetParam("NRM_WORLD_MATRIX", nrmMatrix);
-
-                        // update the parent material before the first drawable uses it
-                        if (!materialUpdated)
+                        if (!visible)
                         {
-                            cmdList.SetShader(m.Shaders[templateOverrideEnabled ? templateOverrideHash : m.DefaultTemplateHash]);
-                            materialUpdated = true;
+                            EndTracedSection();
+                            EndTracedSection();
+                            continue; // drawable not visible
                         }
+                    }
+
+                    else if (isInstanced)
+                    {
+                        // unbounded, all instances are visible
+                        for (int i = 0; i < instanceCount; i++)
+                            visibleInstances.Add(i);
+                    }
+
+                    EndTracedSection();
+
+                    // update transform matrices                 
+                    cmdList.SetParam(WorldMatrixParam, worldMatrix);
+                    Float3x3 nrmMatrix = ((Float3x3)worldMatrix).Invert().Transpose();
+                    cmdList.SetParam(NrmWorldMatrixParam, nrmMatrix);
+
+                    // update the parent material before the first drawable uses it
+                    if (!materialUpdated)
+                    {
+                        cmdList.SetShader(packet.Shader);
+                        materialUpdated = true;
+                        cameraStats.StateChangeCount++;
+                    }
+
+                    // setup geometry, if different from the previous draw
+                    if (packet.Vertices != curVertices || packet.Indices != curIndices)
+                    {
+                        cmdList.SetVertices(packet.Vertices);
+                        cmdList.SetIndices(packet.Indices);
+                        curVertices = packet.Vertices;
+                        curIndices = packet.Indices;
+                        cameraStats.StateChangeCount++;
+                    }
+
+                    // draw
+                    if (isInstanced)
+                        cmdList.DrawIndexedInstanced(instances, visibleInstances);
+                    else
+                        cmdList.DrawIndexed();
+
+                    // update stats
+                    cameraStats.PolygonCount += (isInstanced ? visibleInstances.Count : 1) * (packet.Indices == null ? packet.Vertices.VertexCount : packet.Indices.IndexCount) / 3;
+                    cameraStats.DrawCallCount++;
 
-                        // setup geometry
-                        VertexBuffer vb = d.GetVertexBuffer();
-                        cmdList.SetVertices(vb);
-                        IndexBuffer ib = d.GetIndexBuffer();
-                        cmdList.SetIndices(ib);
-
-                        // draw
-                        if (isInstanced)
-                            cmdList.DrawIndexedInstanced(instanceList);
-                        else
-                            cmdList.DrawIndexed();
-
-                        // update stats
-                        cameraStats.PolygonCount += (isInstanced ? instanceList.Count : 1) * (ib == null ? vb.VertexCount : ib.IndexCount) / 3;
-                        cameraStats.DrawCallCount++;
-
-                        EndTracedSection();
-                    } // foreach drawable
-           
                     EndTracedSection();
-                } // foreach material
+                } // foreach draw packet
+
+                if (curMaterial != null)
+                    EndTracedSection();
 
                 // merge and update camera stats
                 partialPassStats += cameraStats;
@@ -482,6 +678,10 @@ namespace Dragonfly.Engine.Core
                 statsFrameID = Context.Time.FrameIndex;
             }
 
+            // more command lists may be required for the processed draw count
+            if (LoadingRequired)
+                RequestResourceLoading();
+
 #if TRACING
             Context.Scene.Graphics.EndTracedSection(cmdList);
 #endif
@@ -14,6 +14,8 @@ namespace Dragonfly.Engine.Core
         }
 
 
+        internal int HierarchyIndex = -1; // index of this component in the flattened transform hierarchy
+
         public CompTransform(Component owner) : base(owner)
         {
 
@@ -21,8 +23,13 @@ namespace Dragonfly.Engine.Core
 
         protected sealed override TiledFloat4x4 getValue()
         {
+            // use the value evaluated by the transform hierarchy if up to date
+            TiledFloat4x4 world;
+            if (ComManager.Transforms.TryGetWorld(this, ComManager.ReadUpdateID, out world))
+                return world;
+
             TiledFloat4x4 transform = GetLocalTransform();
-            CompTransform parentTransformComp = GetFirstAncestor<CompTransform>();
+            CompTransform parentTransformComp = GetAncestorTransform();
             if (parentTransformComp != null)
                 transform *= parentTransformComp.GetValue();
             
@@ -35,6 +42,21 @@ namespace Dragonfly.Engine.Core
         /// </summary>
         public abstract TiledFloat4x4 GetLocalTransform();
 
+        /// <summary>
+        /// True if the local transform can change on any frame, without notifying it. 
+        /// By default transforms are static: they must call InvalidateLocalTransform() when modified, and their world transform will only be evaluated again after a change.
+        /// The value returned by this property is only read again after an invalidation.
+        /// </summary>
+        public virtual bool IsLocalTransformDynamic => false;
+
+        /// <summary>
+        /// Notify that the value returned by GetLocalTransform() changed.
+        /// </summary>
+        protected void InvalidateLocalTransform()
+        {
+            ComManager.Transforms.Invalidate(this);
+        }
+
     }
 }
 
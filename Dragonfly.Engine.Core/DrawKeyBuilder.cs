@@ -0,0 +1,148 @@
+﻿using Dragonfly.Graphics.Resources;
+using Dragonfly.Utils;
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+
+namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// Builds the 64-bit sort keys of the draw packets of a pass, and sorts them so that draws that share the same pipeline and material are recorded together.
+    /// From the most significant bits, a key contains: the material render order, the pipeline, the material and the view depth (front to back).
+    /// </summary>
+    internal class DrawKeyBuilder
+    {
+        private const int ORDER_BITS = 12, PIPELINE_BITS = 12, MATERIAL_BITS = 16, DEPTH_BITS = 24;
+        private const int MATERIAL_SHIFT = DEPTH_BITS;
+        private const int PIPELINE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+        private const int ORDER_SHIFT = PIPELINE_SHIFT + PIPELINE_BITS;
+        private const int MAX_PIPELINE_COUNT = 1 << PIPELINE_BITS;
+
+        [StructLayout(LayoutKind.Explicit)]
+        private struct FloatBits
+        {
+            [FieldOffset(0)] public float Float;
+            [FieldOffset(0)] public uint UInt;
+        }
+
+        private Dictionary<Shader, int> shaderPipelines; // pipeline ID of each shader
+        private Dictionary<string, int> pipelineIDs; // shaders with the same effect, variant, template and states share the same pipeline ID
+        private ulong[] keys;
+        private int[] order;
+        private DrawPacket[] sortedPackets;
+        private RadixSorter sorter;
+
+        public DrawKeyBuilder()
+        {
+            shaderPipelines = new Dictionary<Shader, int>();
+            pipelineIDs = new Dictionary<string, int>();
+            keys = new ulong[0];
+            order = new int[0];
+            sortedPackets = new DrawPacket[0];
+            sorter = new RadixSorter();
+        }
+
+        /// <summary>
+        /// State changes avoided by the last sort, compared to recording the packets in their original order.
+        /// </summary>
+        public int AvoidedStateChanges { get; private set; }
+
+        /// <summary>
+        /// Returns the sort key of a draw.
+        /// </summary>
+        /// <param name="orderRank">Rank of the material render order within the pass, materials with the same RenderOrder should have the same rank.</param>
+        /// <param name="shader">The shader used by the draw.</param>
+        /// <param name="materialIndex">Index of the material in the pass.</param>
+        /// <param name="viewDepth">Distance from the camera, only used to sort draws of the same material.</param>
+        public ulong GetKey(int orderRank, Shader shader, int materialIndex, float viewDepth)
+        {
+            FloatBits depthBits = new FloatBits() { Float = System.Math.Max(0, viewDepth) }; // the bits of a positive float grow with its value
+
+            ulong key = (ulong)System.Math.Min(orderRank, (1 << ORDER_BITS) - 1) << ORDER_SHIFT;
+            key |= (ulong)GetPipelineID(shader) << PIPELINE_SHIFT;
+            key |= (ulong)(materialIndex & ((1 << MATERIAL_BITS) - 1)) << MATERIAL_SHIFT;
+            key |= depthBits.UInt >> (32 - DEPTH_BITS);
+            return key;
+        }
+
+        private int GetPipelineID(Shader shader)
+        {
+            int id;
+            if (shaderPipelines.TryGetValue(shader, out id))
+                return id;
+
+            if (pipelineIDs.Count == MAX_PIPELINE_COUNT || shaderPipelines.Count >= 4 * MAX_PIPELINE_COUNT)
+            {
+                // out of IDs or too many released shaders, start over
+                pipelineIDs.Clear();
+                shaderPipelines.Clear();
+            }
+
+            string pipelineKey = string.Format("{0}|{1}|{2}|{3}", shader.EffectName, shader.VariantID, shader.TemplateName, shader.States.GetHashCode());
+            if (!pipelineIDs.TryGetValue(pipelineKey, out id))
+            {
+                id = pipelineIDs.Count;
+                pipelineIDs[pipelineKey] = id;
+            }
+
+            shaderPipelines[shader] = id;
+            return id;
+        }
+
+        private static int GetPipelineID(ulong key)
+        {
+            return (int)(key >> PIPELINE_SHIFT) & (MAX_PIPELINE_COUNT - 1);
+        }
+
+        /// <summary>
+        /// Sort the specified packets by their keys.
+        /// </summary>
+        public void Sort(ref ArrayRange<DrawPacket> packets)
+        {
+            int count = packets.Count;
+            if (keys.Length < count)
+            {
+                keys = new ulong[packets.Buffer.Length];
+                order = new int[packets.Buffer.Length];
+            }
+            if (sortedPackets.Length < packets.Buffer.Length)
+                sortedPackets = new DrawPacket[packets.Buffer.Length];
+
+            for (int i = 0; i < count; i++)
+            {
+                keys[i] = packets[i].SortKey;
+                order[i] = i;
+            }
+
+            int unsortedChanges = CountStateChanges(packets.Buffer, count);
+            sorter.Sort(keys, order, count);
+            for (int i = 0; i < count; i++)
+                sortedPackets[i] = packets[order[i]];
+            AvoidedStateChanges = unsortedChanges - CountStateChanges(sortedPackets, count);
+
+            // swap the packet buffers
+            DrawPacket[] unsorted = packets.Buffer;
+            Array.Clear(unsorted, 0, count);
+            packets.Buffer = sortedPackets;
+            sortedPackets = unsorted;
+        }
+
+        /// <summary>
+        /// Count the pipeline, material and geometry changes between consecutive packets.
+        /// </summary>
+        private static int CountStateChanges(DrawPacket[] packets, int count)
+        {
+            int changes = 0;
+            for (int i = 1; i < count; i++)
+            {
+                if (GetPipelineID(packets[i].SortKey) != GetPipelineID(packets[i - 1].SortKey))
+                    changes++;
+                if (packets[i].Material != packets[i - 1].Material)
+                    changes++;
+                if (packets[i].Vertices != packets[i - 1].Vertices || packets[i].Indices != packets[i - 1].Indices)
+                    changes++;
+            }
+            return changes;
+        }
+    }
+}
@@ -0,0 +1,20 @@
+﻿using Dragonfly.Graphics.Resources;
+
+namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// A single draw of a drawable with one of its materials, prepared before recording so that render threads can split a pass by packet index.
+    /// </summary>
+    internal struct DrawPacket
+    {
+        /// <summary>
+        /// Packets are recorded in ascending key order.
+        /// </summary>
+        public ulong SortKey;
+        public CompMaterial Material;
+        public CompDrawable Drawable;
+        public Shader Shader;
+        public VertexBuffer Vertices;
+        public IndexBuffer Indices;
+    }
+}
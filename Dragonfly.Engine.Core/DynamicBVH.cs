@@ -0,0 +1,433 @@
+﻿using Dragonfly.Graphics.Math;
+using System;
+
+namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// Receives the leaves found by a DynamicBVH query.
+    /// </summary>
+    public interface IBVHVisitor
+    {
+        /// <param name="proxy">The proxy of a leaf whose box intersects the query volume.</param>
+        /// <param name="contained">True if the leaf box is fully inside the query volume.</param>
+        void Visit(int proxy, bool contained);
+    }
+
+    /// <summary>
+    /// A dynamic bounding volume hierarchy of axis-aligned boxes, that finds the items intersecting a volume in O(log n + k).
+    /// Leaves are stored with an enlarged box, so that items moving by a small amount are updated without changing the tree.
+    /// New leaves are paired with the sibling that adds the least surface area, and the tree is kept balanced with rotations.
+    /// </summary>
+    public class DynamicBVH<T>
+    {
+        private const int NONE = -1;
+        private const float MIN_MARGIN = 0.05f;
+
+        private struct Node
+        {
+            public AABox Box; // enlarged box for leaves, union of the children boxes otherwise
+            public AABox Tight; // the box of the item, for leaves
+            public int Parent; // next free node if unused
+            public int Child1, Child2;
+            public int Height; // 0 for leaves, -1 for unused nodes
+            public T Item;
+
+            public bool IsLeaf => Child1 == NONE;
+        }
+
+        [ThreadStatic]
+        private static int[] queryStack;
+
+        private Node[] nodes;
+        private int root, freeList;
+        private int leafCount;
+        private float marginRatio;
+
+        /// <param name="marginRatio">The margin added to leaf boxes, relative to their size.</param>
+        public DynamicBVH(float marginRatio = 0.1f)
+        {
+            this.marginRatio = marginRatio;
+            nodes = new Node[16];
+            Clear();
+        }
+
+        /// <summary>
+        /// Number of items stored in the tree.
+        /// </summary>
+        public int Count => leafCount;
+
+        /// <summary>
+        /// An upper bound to the proxy values returned by this tree.
+        /// </summary>
+        public int ProxyCapacity => nodes.Length;
+
+        public int Height => root == NONE ? 0 : nodes[root].Height;
+
+        public T GetItem(int proxy)
+        {
+            return nodes[proxy].Item;
+        }
+
+        public AABox GetBox(int proxy)
+        {
+            return nodes[proxy].Tight;
+        }
+
+        /// <summary>
+        /// Add an item to the tree, returning its proxy. The box must be finite.
+        /// </summary>
+        public int Add(AABox box, T item)
+        {
+            int proxy = AllocateNode();
+            nodes[proxy].Tight = box;
+            nodes[proxy].Box = Enlarge(box, 1.0f);
+            nodes[proxy].Item = item;
+            InsertLeaf(proxy);
+            leafCount++;
+            return proxy;
+        }
+
+        public void Remove(int proxy)
+        {
+            RemoveLeaf(proxy);
+            FreeNode(proxy);
+            leafCount--;
+        }
+
+        /// <summary>
+        /// Update the box of an item. The tree is only modified if the new box exits the enlarged one, or is much smaller than it.
+        /// </summary>
+        /// <returns>True if the item has been re-inserted.</returns>
+        public bool Move(int proxy, AABox box)
+        {
+            nodes[proxy].Tight = box;
+            AABox fatBox = nodes[proxy].Box;
+            if (Contains(fatBox, box) && Contains(Enlarge(box, 4.0f), fatBox))
+                return false;
+
+            RemoveLeaf(proxy);
+            nodes[proxy].Box = Enlarge(box, 1.0f);
+            InsertLeaf(proxy);
+            return true;
+        }
+
+        public void Clear()
+        {
+            root = NONE;
+            leafCount = 0;
+            InitFreeList(0);
+        }
+
+        /// <summary>
+        /// Call the visitor for each item whose box intersects the specified volume.
+        /// Subtrees fully contained in the volume are visited without further tests. Can be called concurrently from multiple threads.
+        /// </summary>
+        /// <param name="volumeOrigin">The position of the volume coordinates origin in the tree coordinates.</param>
+        public void Query(IVolume volume, Float3 volumeOrigin, IBVHVisitor visitor)
+        {
+            if (root == NONE)
+                return;
+
+            int stackSize = 2 * nodes[root].Height + 4;
+            if (queryStack == null || queryStack.Length < stackSize)
+                queryStack = new int[System.Math.Max(64, stackSize)];
+            int[] stack = queryStack;
+
+            int top = 0;
+            stack[top++] = root;
+            while (top > 0)
+            {
+                int i = stack[--top];
+                bool isLeaf = nodes[i].IsLeaf;
+                AABox box = isLeaf ? nodes[i].Tight : nodes[i].Box;
+                box.Min -= volumeOrigin;
+                box.Max -= volumeOrigin;
+
+                if (!volume.Intersects(box))
+                    continue;
+
+                bool contained = volume.Contains(box);
+                if (isLeaf)
+                {
+                    visitor.Visit(i, contained);
+                }
+                else if (contained)
+                {
+                    // visit all the leaves of this subtree, above the pending nodes in the stack
+                    int subtreeBase = top;
+                    stack[top++] = i;
+                    while (top > subtreeBase)
+                    {
+                        int j = stack[--top];
+                        if (nodes[j].IsLeaf)
+                        {
+                            visitor.Visit(j, true);
+                            continue;
+                        }
+                        stack[top++] = nodes[j].Child1;
+                        stack[top++] = nodes[j].Child2;
+                    }
+                }
+                else
+                {
+                    stack[top++] = nodes[i].Child1;
+                    stack[top++] = nodes[i].Child2;
+                }
+            }
+        }
+
+        #region Tree updates
+
+        private void InsertLeaf(int leaf)
+        {
+            if (root == NONE)
+            {
+                root = leaf;
+                nodes[leaf].Parent = NONE;
+                return;
+            }
+
+            // search the sibling that minimizes the area added to the tree
+            AABox leafBox = nodes[leaf].Box;
+            int index = root;
+            while (!nodes[index].IsLeaf)
+            {
+                float area = Area(nodes[index].Box);
+                float combinedArea = Area(Union(nodes[index].Box, leafBox));
+                float cost = 2.0f * combinedArea; // cost of pairing the leaf with this node
+                float inheritanceCost = 2.0f * (combinedArea - area); // minimum cost of moving the leaf further down
+                float cost1 = GetDescentCost(nodes[index].Child1, leafBox) + inheritanceCost;
+                float cost2 = GetDescentCost(nodes[index].Child2, leafBox) + inheritanceCost;
+
+                if (cost < cost1 && cost < cost2)
+                    break;
+
+                index = cost1 < cost2 ? nodes[index].Child1 : nodes[index].Child2;
+            }
+            int sibling = index;
+
+            // create a new parent for the leaf and its sibling
+            int oldParent = nodes[sibling].Parent;
+            int newParent = AllocateNode();
+            nodes[newParent].Parent = oldParent;
+            nodes[newParent].Child1 = sibling;
+            nodes[newParent].Child2 = leaf;
+            nodes[sibling].Parent = newParent;
+            nodes[leaf].Parent = newParent;
+            if (oldParent == NONE)
+                root = newParent;
+            else if (nodes[oldParent].Child1 == sibling)
+                nodes[oldParent].Child1 = newParent;
+            else
+                nodes[oldParent].Child2 = newParent;
+
+            RefitAncestors(newParent);
+        }
+
+        private float GetDescentCost(int child, AABox leafBox)
+        {
+            float combinedArea = Area(Union(leafBox, nodes[child].Box));
+            return nodes[child].IsLeaf ? combinedArea : combinedArea - Area(nodes[child].Box);
+        }
+
+        private void RemoveLeaf(int leaf)
+        {
+            if (leaf == root)
+            {
+                root = NONE;
+                return;
+            }
+
+            int parent = nodes[leaf].Parent;
+            int grandParent = nodes[parent].Parent;
+            int sibling = nodes[parent].Child1 == leaf ? nodes[parent].Child2 : nodes[parent].Child1;
+
+            // replace the parent with the sibling
+            nodes[sibling].Parent = grandParent;
+            FreeNode(parent);
+            if (grandParent == NONE)
+            {
+                root = sibling;
+                return;
+            }
+
+            if (nodes[grandParent].Child1 == parent)
+                nodes[grandParent].Child1 = sibling;
+            else
+                nodes[grandParent].Child2 = sibling;
+            RefitAncestors(grandParent);
+        }
+
+        /// <summary>
+        /// Walk up from the specified node, balancing the tree and updating boxes and heights.
+        /// </summary>
+        private void RefitAncestors(int index)
+        {
+            while (index != NONE)
+            {
+                index = Balance(index);
+                int child1 = nodes[index].Child1, child2 = nodes[index].Child2;
+                nodes[index].Height = 1 + System.Math.Max(nodes[child1].Height, nodes[child2].Height);
+                nodes[index].Box = Union(nodes[child1].Box, nodes[child2].Box);
+                index = nodes[index].Parent;
+            }
+        }
+
+        /// <summary>
+        /// If the subtrees of the specified node are unbalanced, rotate the highest one up. Returns the node that replaced the specified one.
+        /// </summary>
+        private int Balance(int iA)
+        {
+            ref Node a = ref nodes[iA];
+            if (a.IsLeaf || a.Height < 2)
+                return iA;
+
+            int iB = a.Child1, iC = a.Child2;
+            ref Node b = ref nodes[iB];
+            ref Node c = ref nodes[iC];
+            int balance = c.Height - b.Height;
+
+            if (balance > 1)
+            {
+                // rotate C up
+                int iF = c.Child1, iG = c.Child2;
+                ref Node f = ref nodes[iF];
+                ref Node g = ref nodes[iG];
+                c.Child1 = iA;
+                c.Parent = a.Parent;
+                a.Parent = iC;
+                ReplaceChild(c.Parent, iA, iC);
+
+                if (f.Height > g.Height)
+                {
+                    c.Child2 = iF;
+                    a.Child2 = iG;
+                    g.Parent = iA;
+                    a.Box = Union(b.Box, g.Box);
+                    c.Box = Union(a.Box, f.Box);
+                    a.Height = 1 + System.Math.Max(b.Height, g.Height);
+                    c.Height = 1 + System.Math.Max(a.Height, f.Height);
+                }
+                else
+                {
+                    c.Child2 = iG;
+                    a.Child2 = iF;
+                    f.Parent = iA;
+                    a.Box = Union(b.Box, f.Box);
+                    c.Box = Union(a.Box, g.Box);
+                    a.Height = 1 + System.Math.Max(b.Height, f.Height);
+                    c.Height = 1 + System.Math.Max(a.Height, g.Height);
+                }
+                return iC;
+            }
+
+            if (balance < -1)
+            {
+                // rotate B up
+                int iD = b.Child1, iE = b.Child2;
+                ref Node d = ref nodes[iD];
+                ref Node e = ref nodes[iE];
+                b.Child1 = iA;
+                b.Parent = a.Parent;
+                a.Parent = iB;
+                ReplaceChild(b.Parent, iA, iB);
+
+                if (d.Height > e.Height)
+                {
+                    b.Child2 = iD;
+                    a.Child1 = iE;
+                    e.Parent = iA;
+                    a.Box = Union(c.Box, e.Box);
+                    b.Box = Union(a.Box, d.Box);
+                    a.Height = 1 + System.Math.Max(c.Height, e.Height);
+                    b.Height = 1 + System.Math.Max(a.Height, d.Height);
+                }
+                else
+                {
+                    b.Child2 = iE;
+                    a.Child1 = iD;
+                    d.Parent = iA;
+                    a.Box = Union(c.Box, d.Box);
+                    b.Box = Union(a.Box, e.Box);
+                    a.Height = 1 + System.Math.Max(c.Height, d.Height);
+                    b.Height = 1 + System.Math.Max(a.Height, e.Height);
+                }
+                return iB;
+            }
+
+            return iA;
+        }
+
+        private void ReplaceChild(int parent, int oldChild, int newChild)
+        {
+            if (parent == NONE)
+                root = newChild;
+            else if (nodes[parent].Child1 == oldChild)
+                nodes[parent].Child1 = newChild;
+            else
+                nodes[parent].Child2 = newChild;
+        }
+
+        #endregion
+
+        #region Nodes
+
+        private int AllocateNode()
+        {
+            if (freeList == NONE)
+            {
+                int oldLength = nodes.Length;
+                Array.Resize(ref nodes, oldLength * 2);
+                InitFreeList(oldLength);
+            }
+
+            int id = freeList;
+            freeList = nodes[id].Parent;
+            nodes[id] = new Node() { Parent = NONE, Child1 = NONE, Child2 = NONE };
+            return id;
+        }
+
+        private void FreeNode(int id)
+        {
+            nodes[id] = new Node() { Parent = freeList, Child1 = NONE, Child2 = NONE, Height = -1 };
+            freeList = id;
+        }
+
+        private void InitFreeList(int start)
+        {
+            for (int i = start; i < nodes.Length; i++)
+                nodes[i] = new Node() { Parent = i + 1, Child1 = NONE, Child2 = NONE, Height = -1 };
+            nodes[nodes.Length - 1].Parent = NONE;
+            freeList = start;
+        }
+
+        #endregion
+
+        #region Box utils
+
+        private AABox Enlarge(AABox box, float marginScale)
+        {
+            Float3 margin = ((box.Max - box.Min) * marginRatio).Max((Float3)MIN_MARGIN) * marginScale;
+            return new AABox(box.Min - margin, box.Max + margin);
+        }
+
+        private static AABox Union(AABox b1, AABox b2)
+        {
+            return new AABox(Float3.Min(b1.Min, b2.Min), Float3.Max(b1.Max, b2.Max));
+        }
+
+        private static bool Contains(AABox container, AABox b)
+        {
+            return container.Min.X <= b.Min.X && container.Min.Y <= b.Min.Y && container.Min.Z <= b.Min.Z
+                && container.Max.X >= b.Max.X && container.Max.Y >= b.Max.Y && container.Max.Z >= b.Max.Z;
+        }
+
+        private static float Area(AABox b)
+        {
+            Float3 size = b.Max - b.Min;
+            return size.X * size.Y + size.Y * size.Z + size.Z * size.X;
+        }
+
+        #endregion
+    }
+}
@@ -21,6 +21,7 @@ namespace Dragonfly.Engine.Core
             ResourceFolder = ep.ResourceFolder;
             Scene = new Scene(this, ep.Target);
             Scene.Settings.HardwareAntiAliasing = ep.AntiAliasing;
+            Scene.PipelinedRendering = ep.PipelinedRendering;
             Time = new Timeline(ep.StartTime);
             Input = new InputDeviceList();
             TargetWindow = ep.Target;
@@ -132,6 +133,10 @@ namespace Dragonfly.Engine.Core
 		public DateTime StartTime;
         public string ResourceFolder;
         public bool AntiAliasing;
+        /// <summary>
+        /// Update the next frame while the current one is being rendered, see Scene.PipelinedRendering.
+        /// </summary>
+        public bool PipelinedRendering;
 	}
 
     public class UnsupportedComponentException<T> : Exception    {  }
@@ -1,99 +1,173 @@
 ﻿using Dragonfly.Graphics.Math;
 using Dragonfly.Graphics.Resources;
+using System;
+using System.Collections.Generic;
 
 namespace Dragonfly.Engine.Core
 {
     /// <summary>
     /// Manage a command list used to set globals with frame visibility.
+    /// Params set while the command list is not recording (e.g. from updates running during rendering) are applied on the next frame.
     /// </summary>
     public class EngineGlobals
     {
         private CommandList cmdList;
+        private List<Action<CommandList>> deferredParams;
 
         internal EngineGlobals(CommandList cmdList)
         {
             this.cmdList = cmdList;
             cmdList.FlushRequired = true;
+            deferredParams = new List<Action<CommandList>>();
+        }
+
+        private void Defer<T>(string name, T value, Action<CommandList, string, T> setParam)
+        {
+            lock (deferredParams)
+            {
+                deferredParams.Add(c => setParam(c, name, value));
+            }
+        }
+
+        /// <summary>
+        /// Set the params that have been deferred since the command list was last recording. Must be called after the command list started recording.
+        /// </summary>
+        internal void ApplyDeferredParams()
+        {
+            lock (deferredParams)
+            {
+                foreach (Action<CommandList> setParam in deferredParams)
+                    setParam(cmdList);
+                deferredParams.Clear();
+            }
         }
 
         public void SetParam(string name, bool value)
         {
-            cmdList.SetParam(name, value);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, value);
+            else
+                Defer(name, value, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, int value)
         {
-            cmdList.SetParam(name, value);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, value);
+            else
+                Defer(name, value, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, float value)
         {
-            cmdList.SetParam(name, value);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, value);
+            else
+                Defer(name, value, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, Float2 value)
         {
-            cmdList.SetParam(name, value);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, value);
+            else
+                Defer(name, value, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, Float3 values)
         {
-            cmdList.SetParam(name, values);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, values);
+            else
+                Defer(name, values, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, Float4 values)
         {
-            cmdList.SetParam(name, values);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, values);
+            else
+                Defer(name, values, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, Float4x4 value)
         {
-            cmdList.SetParam(name, value);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, value);
+            else
+                Defer(name, value, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, Float3x3 value)
         {
-            cmdList.SetParam(name, value);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, value);
+            else
+                Defer(name, value, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, int[] values)
         {
-            cmdList.SetParam(name, values);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, values);
+            else
+                Defer(name, values, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, float[] values)
         {
-            cmdList.SetParam(name, values);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, values);
+            else
+                Defer(name, values, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, Texture value)
         {
-            cmdList.SetParam(name, value);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, value);
+            else
+                Defer(name, value, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, RenderTarget value)
         {
-            cmdList.SetParam(name, value);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, value);
+            else
+                Defer(name, value, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, Float2[] values)
         {
-            cmdList.SetParam(name, values);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, values);
+            else
+                Defer(name, values, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, Float3[] values)
         {
-            cmdList.SetParam(name, values);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, values);
+            else
+                Defer(name, values, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, Float4[] value)
         {
-            cmdList.SetParam(name, value);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, value);
+            else
+                Defer(name, value, (c, n, v) => c.SetParam(n, v));
         }
 
         public void SetParam(string name, Float4x4[] value)
         {
-            cmdList.SetParam(name, value);
+            if (cmdList.IsRecording)
+                cmdList.SetParam(name, value);
+            else
+                Defer(name, value, (c, n, v) => c.SetParam(n, v));
         }
 
         public void Release()
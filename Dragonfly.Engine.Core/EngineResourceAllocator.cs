@@ -28,6 +28,16 @@ namespace Dragonfly.Engine.Core
             return g.CreateIndexBuffer(indexCount);
         }
 
+        public IndexBuffer CreateIndexBuffer(int indexCount, IndexFormat format)
+        {
+            return g.CreateIndexBuffer(indexCount, format);
+        }
+
+        public InstanceBuffer CreateInstanceBuffer(int capacity)
+        {
+            return g.CreateInstanceBuffer(capacity);
+        }
+
         public Texture CreateTexture(int width, int height, SurfaceFormat format)
         {
             return g.CreateTexture(width, height, format);
@@ -0,0 +1,325 @@
+﻿using Dragonfly.Graphics.Math;
+using Dragonfly.Graphics.Resources;
+using Dragonfly.Utils;
+using System;
+using System.Collections.Generic;
+
+namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// A compiled version of the render pass tree, that lists the passes needed for a frame in execution order together with the lifetime of the buffers they use.
+    /// Transient render buffers that are never used at the same time are aliased to the same render targets.
+    /// The graph is only compiled again when the pass tree or its buffers change, or when a transient buffer lost its targets.
+    /// </summary>
+    internal class FrameGraph
+    {
+        private const int MAX_PASS_COUNT = 1024;
+
+        /// <summary>
+        /// The range of compiled passes that use a buffer.
+        /// </summary>
+        private class BufferUsage
+        {
+            public CompRenderBuffer Buffer;
+            public int FirstPass, LastPass;
+            public List<CompRenderPass> Users = new List<CompRenderPass>();
+        }
+
+        /// <summary>
+        /// A set of render targets shared by transient buffers with the same formats and size.
+        /// </summary>
+        private class AliasedTargets
+        {
+            public string Key;
+            public RenderTarget[] Targets;
+            public BufferUsage Occupant; // the last buffer that use these targets in the compiled pass order
+        }
+
+        private EngineResourceAllocator resAllocator;
+        private List<CompRenderPass> passes; // passes in execution order, required passes come first
+        private Dictionary<CompRenderPass, bool> visitedPasses; // true if the pass has been already added, false if it's being visited
+        private Dictionary<CompRenderBuffer, BufferUsage> bufferUsages;
+        private List<AliasedTargets> targetPool;
+        private List<CompRenderBuffer> boundBuffers;
+        private CompRenderPass compiledMainPass;
+        private Digest128 compiledTopology;
+
+        public FrameGraph(EngineResourceAllocator resAllocator)
+        {
+            this.resAllocator = resAllocator;
+            passes = new List<CompRenderPass>();
+            visitedPasses = new Dictionary<CompRenderPass, bool>();
+            bufferUsages = new Dictionary<CompRenderBuffer, BufferUsage>();
+            targetPool = new List<AliasedTargets>();
+            boundBuffers = new List<CompRenderBuffer>();
+        }
+
+        /// <summary>
+        /// The compiled passes, in the order they should be rendered.
+        /// </summary>
+        public IReadOnlyList<CompRenderPass> Passes
+        {
+            get { return passes; }
+        }
+
+        /// <summary>
+        /// Number of render targets sets currently allocated for transient buffers.
+        /// </summary>
+        public int TransientTargetCount
+        {
+            get { return targetPool.Count; }
+        }
+
+        /// <summary>
+        /// Number of transient buffers bound to the pooled render targets.
+        /// </summary>
+        public int TransientBufferCount
+        {
+            get { return boundBuffers.Count; }
+        }
+
+        /// <summary>
+        /// Compile the graph again if the pass tree starting from the specified pass changed since the last call. Must be called on the main rendering thread.
+        /// </summary>
+        /// <returns>True if the graph has been compiled again, in which case transient buffers may be bound to different render targets.</returns>
+        public bool Update(CompRenderPass mainPass)
+        {
+            if (mainPass == compiledMainPass && ComputeTopologyDigest() == compiledTopology && AllTransientBuffersBound())
+                return false;
+
+            Compile(mainPass);
+            compiledMainPass = mainPass;
+            compiledTopology = ComputeTopologyDigest();
+            return true;
+        }
+
+        /// <summary>
+        /// Returns a digest of the compiled passes and of all the state that affects the compilation.
+        /// </summary>
+        private Digest128 ComputeTopologyDigest()
+        {
+            Digest128 digest = Digest128.Seed;
+            for (int i = 0; i < passes.Count; i++)
+            {
+                CompRenderPass pass = passes[i];
+                digest.Add(pass.ID);
+                digest.Add(pass.Disposed);
+                digest.Add(pass.RenderToTexture && pass.CanRenderToTexture);
+                if (pass.RenderBuffer != null)
+                    AddBufferDigest(ref digest, pass.RenderBuffer);
+
+                digest.Add(pass.RequiredPasses.Count);
+                for (int r = 0; r < pass.RequiredPasses.Count; r++)
+                {
+                    digest.Add(pass.RequiredPasses[r].ID);
+                    digest.Add(pass.RequiredPasses[r].CanBeRendered);
+                }
+
+                digest.Add(pass.InputBuffers.Count);
+                for (int b = 0; b < pass.InputBuffers.Count; b++)
+                    AddBufferDigest(ref digest, pass.InputBuffers[b]);
+            }
+            return digest;
+        }
+
+        private void AddBufferDigest(ref Digest128 digest, CompRenderBuffer buffer)
+        {
+            digest.Add(buffer.ID);
+            digest.Add(buffer.Disposed);
+            digest.Add(buffer.Transient);
+            digest.Add(buffer.GetTargetsKey()); // formats and size
+            Int2 resolution = buffer.Resolution;
+            digest.Add(resolution.X);
+            digest.Add(resolution.Y);
+        }
+
+        /// <summary>
+        /// Returns false if a transient buffer bound by the last compilation released its targets, and should be bound again.
+        /// </summary>
+        private bool AllTransientBuffersBound()
+        {
+            for (int i = 0; i < boundBuffers.Count; i++)
+                if (boundBuffers[i].TransientTargets == null && !boundBuffers[i].Disposed)
+                    return false;
+            return true;
+        }
+
+        private void Compile(CompRenderPass mainPass)
+        {
+            // clear the previous compilation
+            for (int i = 0; i < passes.Count; i++)
+                passes[i].AliasedPasses.Clear();
+            passes.Clear();
+            visitedPasses.Clear();
+            bufferUsages.Clear();
+
+            // sort passes so that each one comes after all its required passes
+            if (mainPass != null && !mainPass.Disposed)
+                AddPassTree(mainPass);
+
+            // compute the lifetime of each buffer
+            for (int i = 0; i < passes.Count; i++)
+            {
+                CompRenderPass pass = passes[i];
+                if (pass.RenderToTexture && pass.CanRenderToTexture)
+                    AddBufferUsage(pass.RenderBuffer, pass, i);
+
+                for (int r = 0; r < pass.RequiredPasses.Count; r++)
+                {
+                    CompRenderPass requiredPass = pass.RequiredPasses[r];
+                    if (requiredPass.CanBeRendered && requiredPass.RenderToTexture && requiredPass.CanRenderToTexture)
+                        AddBufferUsage(requiredPass.RenderBuffer, pass, i);
+                }
+
+                for (int b = 0; b < pass.InputBuffers.Count; b++)
+                    AddBufferUsage(pass.InputBuffers[b], pass, i);
+            }
+
+            AliasTransientBuffers();
+        }
+
+        /// <summary>
+        /// Add the specified pass to the compiled list, after all the passes it requires.
+        /// </summary>
+        private void AddPassTree(CompRenderPass pass)
+        {
+            bool added;
+            if (visitedPasses.TryGetValue(pass, out added))
+            {
+                if (!added)
+                    throw new Exception("Circular dependency found on the render pass " + pass.Name + "!");
+                return;
+            }
+
+            if (visitedPasses.Count >= MAX_PASS_COUNT)
+                throw new Exception("View-stack overflow, too many rendered in this frame! This can be caused by too many queued views or by a circular dependency on the active views.");
+
+            visitedPasses[pass] = false;
+            for (int i = 0; i < pass.RequiredPasses.Count; i++)
+            {
+                CompRenderPass requiredPass = pass.RequiredPasses[i];
+
+                // remove disposed passes, that are still listed as required
+                // (this allow user to not worry about dangling required views references)
+                if (requiredPass.Disposed)
+                {
+                    pass.RequiredPasses.RemoveAt(i--);
+                    continue;
+                }
+
+                if (requiredPass.CanBeRendered)
+                    AddPassTree(requiredPass);
+            }
+            visitedPasses[pass] = true;
+            passes.Add(pass);
+        }
+
+        private void AddBufferUsage(CompRenderBuffer buffer, CompRenderPass pass, int passIndex)
+        {
+            if (buffer == null || buffer.Disposed)
+                return;
+
+            BufferUsage usage;
+            if (!bufferUsages.TryGetValue(buffer, out usage))
+            {
+                usage = new BufferUsage() { Buffer = buffer, FirstPass = passIndex };
+                bufferUsages[buffer] = usage;
+            }
+
+            usage.LastPass = passIndex;
+            if (!usage.Users.Contains(pass))
+                usage.Users.Add(pass);
+        }
+
+        /// <summary>
+        /// Bind each transient buffer to a set of pooled render targets, sharing them between buffers whose lifetimes do not overlap.
+        /// </summary>
+        private void AliasTransientBuffers()
+        {
+            List<BufferUsage> transientUsages = new List<BufferUsage>();
+            foreach (BufferUsage usage in bufferUsages.Values)
+                if (usage.Buffer.Transient)
+                    transientUsages.Add(usage);
+            transientUsages.Sort((u1, u2) => u1.FirstPass.CompareTo(u2.FirstPass));
+
+            for (int i = 0; i < targetPool.Count; i++)
+                targetPool[i].Occupant = null;
+
+            List<CompRenderBuffer> prevBoundBuffers = boundBuffers;
+            boundBuffers = new List<CompRenderBuffer>();
+            foreach (BufferUsage usage in transientUsages)
+            {
+                string key = usage.Buffer.GetTargetsKey();
+
+                // search targets that are not in use during this buffer lifetime, preferring the ones already bound to it
+                AliasedTargets aliased = null;
+                for (int i = 0; i < targetPool.Count; i++)
+                {
+                    AliasedTargets candidate = targetPool[i];
+                    if (candidate.Key != key || (candidate.Occupant != null && candidate.Occupant.LastPass >= usage.FirstPass))
+                        continue;
+
+                    if (aliased == null || candidate.Targets == usage.Buffer.TransientTargets)
+                        aliased = candidate;
+                }
+
+                if (aliased == null)
+                {
+                    // no compatible targets available, allocate a new set
+                    aliased = new AliasedTargets() { Key = key, Targets = usage.Buffer.CreateTargets(resAllocator) };
+                    targetPool.Add(aliased);
+                }
+                else if (aliased.Occupant != null)
+                {
+                    // targets are re-used: the passes that use this buffer should wait for the passes that used the previous one
+                    foreach (CompRenderPass user in usage.Users)
+                        user.AliasedPasses.AddRange(aliased.Occupant.Users);
+                }
+
+                aliased.Occupant = usage;
+                usage.Buffer.BindTransientTargets(aliased.Targets);
+                boundBuffers.Add(usage.Buffer);
+            }
+
+            // unbind buffers that are no longer used
+            foreach (CompRenderBuffer buffer in prevBoundBuffers)
+                if (!boundBuffers.Contains(buffer))
+                    buffer.UnbindTransientTargets();
+
+            // release unused targets
+            for (int i = targetPool.Count - 1; i >= 0; i--)
+            {
+                if (targetPool[i].Occupant != null)
+                    continue;
+
+                ReleaseTargets(targetPool[i].Targets);
+                targetPool.RemoveAt(i);
+            }
+        }
+
+        private void ReleaseTargets(RenderTarget[] targets)
+        {
+            for (int i = 0; i < targets.Length; i++)
+                targets[i].Release();
+        }
+
+        /// <summary>
+        /// Release all the pooled render targets, unbinding them from transient buffers.
+        /// </summary>
+        public void Release()
+        {
+            foreach (CompRenderBuffer buffer in boundBuffers)
+                buffer.UnbindTransientTargets();
+            boundBuffers.Clear();
+
+            foreach (AliasedTargets aliased in targetPool)
+                ReleaseTargets(aliased.Targets);
+            targetPool.Clear();
+
+            for (int i = 0; i < passes.Count; i++)
+                passes[i].AliasedPasses.Clear();
+            passes.Clear();
+            compiledMainPass = null;
+        }
+    }
+}
@@ -0,0 +1,208 @@
+﻿using Dragonfly.Graphics.Math;
+using Dragonfly.Graphics.Resources;
+using System;
+using System.Collections;
+using System.Collections.Generic;
+
+namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// The list of instance transforms of a drawable. Instances are stored in a persistent instance buffer,
+    /// and only the range modified since the last frame is uploaded before rendering.
+    /// </summary>
+    public class InstanceList : IList<Float4x4>
+    {
+        private const int MIN_CAPACITY = 16;
+
+        private ComponentManager compManager;
+        private Float4x4[] values;
+        private int count;
+        private int changedStart, changedEnd; // range of instances modified since the last upload
+        private bool uploadQueued, released;
+
+        internal InstanceList(ComponentManager compManager)
+        {
+            this.compManager = compManager;
+            values = new Float4x4[0];
+            changedStart = int.MaxValue;
+        }
+
+        /// <summary>
+        /// The buffer that stores the instances on the GPU. Can be null if no instances have been uploaded yet.
+        /// </summary>
+        public InstanceBuffer Buffer { get; private set; }
+
+        /// <summary>
+        /// Number of instances stored in the buffer by the last upload. 
+        /// Render threads should use this count together with the buffer values, which are not modified by the updates of the next frame.
+        /// </summary>
+        public int UploadedCount { get; private set; }
+
+        /// <summary>
+        /// Incremented each time instances are uploaded.
+        /// </summary>
+        public int UploadVersion { get; private set; }
+
+        public Float4x4 this[int index]
+        {
+            get
+            {
+                return values[index];
+            }
+            set
+            {
+                values[index] = value;
+                MarkChanged(index, index + 1);
+            }
+        }
+
+        public int Count
+        {
+            get { return count; }
+        }
+
+        public bool IsReadOnly
+        {
+            get { return false; }
+        }
+
+        public void Add(Float4x4 item)
+        {
+            Reserve(count + 1);
+            values[count++] = item;
+            MarkChanged(count - 1, count);
+        }
+
+        public void AddRange(IEnumerable<Float4x4> items)
+        {
+            int startCount = count;
+            foreach (Float4x4 item in items)
+            {
+                Reserve(count + 1);
+                values[count++] = item;
+            }
+            MarkChanged(startCount, count);
+        }
+
+        public void Clear()
+        {
+            count = 0;
+        }
+
+        public bool Contains(Float4x4 item)
+        {
+            return IndexOf(item) >= 0;
+        }
+
+        public void CopyTo(Float4x4[] array, int arrayIndex)
+        {
+            Array.Copy(values, 0, array, arrayIndex, count);
+        }
+
+        public int IndexOf(Float4x4 item)
+        {
+            return Array.IndexOf(values, item, 0, count);
+        }
+
+        public void Insert(int index, Float4x4 item)
+        {
+            Reserve(count + 1);
+            Array.Copy(values, index, values, index + 1, count - index);
+            values[index] = item;
+            count++;
+            MarkChanged(index, count);
+        }
+
+        public bool Remove(Float4x4 item)
+        {
+            int index = IndexOf(item);
+            if (index < 0)
+                return false;
+
+            RemoveAt(index);
+            return true;
+        }
+
+        public void RemoveAt(int index)
+        {
+            count--;
+            Array.Copy(values, index + 1, values, index, count - index);
+            MarkChanged(index, count);
+        }
+
+        public IEnumerator<Float4x4> GetEnumerator()
+        {
+            for (int i = 0; i < count; i++)
+                yield return values[i];
+        }
+
+        IEnumerator IEnumerable.GetEnumerator()
+        {
+            return GetEnumerator();
+        }
+
+        private void Reserve(int capacity)
+        {
+            if (values.Length >= capacity)
+                return;
+
+            Float4x4[] newValues = new Float4x4[System.Math.Max(MIN_CAPACITY, 2 * capacity)];
+            Array.Copy(values, newValues, count);
+            values = newValues;
+        }
+
+        private void MarkChanged(int start, int end)
+        {
+            changedStart = System.Math.Min(changedStart, start);
+            changedEnd = System.Math.Max(changedEnd, end);
+
+            if (!uploadQueued)
+            {
+                uploadQueued = true;
+                compManager.QueueInstanceUpload(this);
+            }
+        }
+
+        /// <summary>
+        /// Upload the modified instances to the instance buffer, re-creating it if too small. Must be called on the main rendering thread.
+        /// </summary>
+        internal void UploadChanges(EngineResourceAllocator resAllocator)
+        {
+            uploadQueued = false;
+            if (released)
+                return;
+
+            int uploadEnd = System.Math.Min(changedEnd, count);
+
+            if (count > 0 && (Buffer == null || Buffer.Capacity < count))
+            {
+                // buffer is too small: replace it and upload all the instances
+                if (Buffer != null)
+                    Buffer.Release();
+                Buffer = resAllocator.CreateInstanceBuffer(values.Length);
+                changedStart = 0;
+                uploadEnd = count;
+            }
+
+            if (uploadEnd > changedStart)
+                Buffer.SetInstances(values, changedStart, uploadEnd - changedStart);
+
+            changedStart = int.MaxValue;
+            changedEnd = 0;
+            UploadedCount = count;
+            UploadVersion++;
+        }
+
+        internal void ReleaseBuffer()
+        {
+            released = true;
+            UploadedCount = 0;
+            UploadVersion++;
+            if (Buffer != null)
+            {
+                Buffer.Release();
+                Buffer = null;
+            }
+        }
+    }
+}
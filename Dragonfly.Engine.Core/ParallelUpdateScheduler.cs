@@ -0,0 +1,169 @@
+﻿using Dragonfly.Utils;
+using System;
+using System.Collections.Generic;
+using System.Runtime.ExceptionServices;
+
+namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// Calls a queue of updates on the calling thread, starting the ParallelUpdate() of each ICompParallelUpdatable component on the worker threads as soon as it is reached.
+    /// Each update, serial or parallel, first completes the pending parallel updates that conflict with its declared accesses, calling their Update() in queue order,
+    /// so that updates that do not conflict run concurrently while the result is the same as calling all the updates in queue order.
+    /// </summary>
+    internal class ParallelUpdateScheduler
+    {
+        [ThreadStatic]
+        private static bool updatingInParallel;
+
+        private class UpdateJob : SlimParallel.ITaskBody
+        {
+            public ICompParallelUpdatable Updatable;
+            public UpdateType Type;
+            public UpdateAccess Access = new UpdateAccess();
+            public SlimParallel.JobHandle Handle;
+            public Exception Error;
+
+            public void Execute()
+            {
+                bool prevUpdating = updatingInParallel;
+                updatingInParallel = true;
+                try
+                {
+                    Updatable.ParallelUpdate(Type);
+                }
+                catch (Exception e)
+                {
+                    Error = e; // re-thrown on the calling thread
+                }
+                finally
+                {
+                    updatingInParallel = prevUpdating;
+                }
+            }
+        }
+
+        private List<UpdateJob> jobs; // re-used between runs, the jobs in [firstPending, jobCount) are started and their Update() has not been called yet
+        private int firstPending, jobCount;
+        private UpdateAccess serialAccess; // accesses of the serial update being called
+
+        public ParallelUpdateScheduler()
+        {
+            jobs = new List<UpdateJob>();
+            serialAccess = new UpdateAccess();
+        }
+
+        /// <summary>
+        /// True if the calling thread is executing a parallel update.
+        /// </summary>
+        public static bool IsUpdatingInParallel => updatingInParallel;
+
+        /// <summary>
+        /// The number of parallel updates started whose Update() has not been called yet.
+        /// </summary>
+        public int PendingCount => jobCount - firstPending;
+
+        /// <summary>
+        /// Dequeue and call all the specified updates, waiting for the completion of all the parallel ones. The calling thread also executes jobs while waiting.
+        /// </summary>
+        /// <param name="callUpdate">Called on the calling thread for each Update(), in queue order with respect to the conflicting updates.</param>
+        public void Run(Queue<ICompUpdatable> toBeUpdated, UpdateType updateType, Action<ICompUpdatable, UpdateType> callUpdate)
+        {
+            try
+            {
+                while (toBeUpdated.Count > 0)
+                {
+                    ICompUpdatable u = toBeUpdated.Dequeue();
+                    ICompParallelUpdatable pu = u as ICompParallelUpdatable;
+                    if (pu != null)
+                    {
+                        // start the parallel update once the pending ones that conflict with it are completed
+                        if (jobCount == jobs.Count)
+                            jobs.Add(new UpdateJob());
+                        UpdateJob job = jobs[jobCount];
+                        job.Updatable = pu;
+                        job.Type = updateType;
+                        job.Access.Clear();
+                        pu.GetUpdateAccess(updateType, job.Access);
+                        CompleteConflicting(job.Access, updateType, callUpdate);
+                        jobCount++;
+                        job.Handle = SlimParallel.Schedule(job);
+                    }
+                    else
+                    {
+                        serialAccess.Clear();
+                        GetUpdateAccess(u, updateType, serialAccess);
+                        CompleteConflicting(serialAccess, updateType, callUpdate);
+                        callUpdate(u, updateType);
+                    }
+                }
+
+                while (PendingCount > 0)
+                    CompleteNext(updateType, callUpdate);
+            }
+            catch
+            {
+                // the remaining updates are skipped, but the running ones must not outlive this call
+                WaitForJobs();
+                for (int i = firstPending; i < jobCount; i++)
+                {
+                    jobs[i].Updatable = null;
+                    jobs[i].Error = null;
+                }
+                firstPending = jobCount = 0;
+                throw;
+            }
+
+            firstPending = jobCount = 0;
+        }
+
+        /// <summary>
+        /// Wait for the completion of all the started parallel updates, without calling their Update().
+        /// </summary>
+        public void WaitForJobs()
+        {
+            for (int i = firstPending; i < jobCount; i++)
+                SlimParallel.Wait(jobs[i].Handle);
+        }
+
+        /// <summary>
+        /// Complete the pending parallel updates in queue order, up to the last one that conflicts with the specified access.
+        /// </summary>
+        private void CompleteConflicting(UpdateAccess access, UpdateType updateType, Action<ICompUpdatable, UpdateType> callUpdate)
+        {
+            int completedCount = 0;
+            for (int i = firstPending; i < jobCount; i++)
+            {
+                if (access.ConflictsWith(jobs[i].Access))
+                    completedCount = i + 1 - firstPending;
+            }
+
+            for (int i = 0; i < completedCount; i++)
+                CompleteNext(updateType, callUpdate);
+        }
+
+        private void CompleteNext(UpdateType updateType, Action<ICompUpdatable, UpdateType> callUpdate)
+        {
+            UpdateJob job = jobs[firstPending];
+            SlimParallel.Wait(job.Handle);
+            if (job.Error != null)
+                ExceptionDispatchInfo.Capture(job.Error).Throw();
+
+            ICompUpdatable u = job.Updatable;
+            job.Updatable = null;
+            firstPending++;
+            callUpdate(u, updateType);
+        }
+
+        /// <summary>
+        /// Collect the accesses declared by the specified update. Updates that do not declare them are assumed to only modify their own component.
+        /// </summary>
+        private static void GetUpdateAccess(ICompUpdatable updatable, UpdateType updateType, UpdateAccess access)
+        {
+            ICompDeclaredUpdatable declared = updatable as ICompDeclaredUpdatable;
+            if (declared != null)
+                declared.GetUpdateAccess(updateType, access);
+            else
+                access.Write(updatable);
+        }
+    }
+}
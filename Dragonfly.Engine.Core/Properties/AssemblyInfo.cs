@@ -22,6 +22,9 @@ using System.Runtime.InteropServices;
 // The following GUID is for the ID of the typelib if this project is exposed to COM
 [assembly: Guid("38986ff5-b666-4862-9205-0be3b631c261")]
 
+// the update scheduling is tested directly by the console tests
+[assembly: InternalsVisibleTo("Dragonfly.Graphics.Test")]
+
 // Version information for an assembly consists of the following four values:
 //
 //      Major Version
@@ -14,12 +14,27 @@
         /// Number of processed drawables.
         /// </summary>
         public int ProcessedDrawableCount;
+        /// <summary>
+        /// Number of shader, material or geometry changes between consecutive draws.
+        /// </summary>
+        public int StateChangeCount;
+        /// <summary>
+        /// Number of state changes avoided by sorting the draws, compared to recording them in material order.
+        /// </summary>
+        public int AvoidedStateChangeCount;
+        /// <summary>
+        /// Number of drawables and instances inside the camera volume, that have not been rendered since hidden by occluders.
+        /// </summary>
+        public int OcclusionCulledCount;
 
         public static RenderStats operator +(RenderStats s1, RenderStats s2)
         {
             s1.DrawCallCount += s2.DrawCallCount;
             s1.PolygonCount += s2.PolygonCount;
             s1.ProcessedDrawableCount += s2.ProcessedDrawableCount;
+            s1.StateChangeCount += s2.StateChangeCount;
+            s1.AvoidedStateChangeCount += s2.AvoidedStateChangeCount;
+            s1.OcclusionCulledCount += s2.OcclusionCulledCount;
             return s1;
         }
     }
@@ -10,17 +10,16 @@ namespace Dragonfly.Engine.Core
 {
     public class Scene
     {
-        private const int MAX_VIEW_COUNT = 1024;
-
         private IDFGraphics graphics;
         private EngineTarget target;
         private EngineContext context;
         private bool resolutionUpdateRequested, targetChangedResolution;
-        private HashSet<CompRenderPass> renderedViews;
-        private Stack<CompRenderPass> passStack;
+        private FrameGraph frameGraph;
         private object renderLock;
         private bool sceneRenderedToScreen; // true if at least one pass has rendered to screen in the current frame
         private EngineResourceAllocator resAllocator;
+        private bool nextFrameUpdated; // true if the components have been already updated for the next frame while rendering the previous one
+        private PreciseFloat updateSeconds; // time at which components have been updated for the frame being rendered
 
 #if VERBOSE
         internal SceneLog Log;
@@ -34,8 +33,6 @@ namespace Dragonfly.Engine.Core
             Root = new Component(context, Components);
             Root.IsRoot = true;
             Root.Name = "ROOT";
-            renderedViews = new HashSet<CompRenderPass>();
-            passStack = new Stack<CompRenderPass>();
             renderLock = new object();
             RenderingEnabled = true;
 
@@ -84,6 +81,13 @@ namespace Dragonfly.Engine.Core
         /// </summary>
         public bool RenderingEnabled { get; set; }
 
+        /// <summary>
+        /// If enabled, the components of the next frame are updated while the command lists of the current one are being recorded, adding a frame of latency.
+        /// <para/> Render threads read the component values of the frame they are rendering. Updates of components that allocate graphic resources, disposals
+        /// and material changes are deferred until rendering completes. Other updates should not modify the graphic resources used by the rendered frame.
+        /// </summary>
+        public bool PipelinedRendering { get; set; }
+
         /// <summary>
         /// List the graphics settings currently used by this scene instance.
         /// </summary>
@@ -123,6 +127,7 @@ namespace Dragonfly.Engine.Core
             Settings.TargetControl = target.IsNativeWindow ? target.NativeHandle : IntPtr.Zero;
             graphics = GraphicsAPIs.GetDefault().CreateGraphics(Settings);
             resAllocator = new EngineResourceAllocator(graphics);
+            frameGraph = new FrameGraph(resAllocator);
             MainCommandList = resAllocator.CreateCommandList();
             Globals = new EngineGlobals(MainCommandList);
             return Initialized;
@@ -155,50 +160,23 @@ namespace Dragonfly.Engine.Core
 
             // start tracking constants updates
             MainCommandList.StartRecording();
+            Globals.ApplyDeferredParams();
 
 #if TRACING
             Graphics.StartTracedSection(Color.Cyan, "PrepareFrame");
 #endif
 
-            // update component values
-            Components.OnNewFrameStart();
-
-#if TRACING
-            Graphics.StartTracedSection(Color.Cyan, "UpdateType.FrameStart1");
-#endif
-            // call updatable components
-            Components.UpdateComponents(Graphics, UpdateType.FrameStart1);
-
-#if TRACING
-            Graphics.EndTracedSection();
-            Graphics.StartTracedSection(Color.Cyan, "UpdateType.FrameStart2");
-#endif
-
-            // call updatable components
-            Components.UpdateComponents(Graphics, UpdateType.FrameStart2);
-
-#if TRACING
-            Graphics.EndTracedSection();
-            Graphics.StartTracedSection(Color.Cyan, "LoadGraphicResources");
-#endif
-
-            // load needed resources
-            Components.LoadComponentResources(Graphics, resAllocator);
+            // update component values, if not already done while the previous frame was rendering
+            bool updateOverlapped = nextFrameUpdated;
+            if (!nextFrameUpdated)
+                UpdateComponents();
+            nextFrameUpdated = false;
 
-#if TRACING
-            Graphics.EndTracedSection();
-            Graphics.StartTracedSection(Color.Cyan, "UpdateType.ResourceLoaded");
-#endif
-
-            // call updatable components after resources have been loaded
-            Components.UpdateComponents(Graphics, UpdateType.ResourceLoaded);
-
-#if TRACING
-            Graphics.EndTracedSection();
-#endif
+            // complete the updates that require graphic resources
+            PrepareGraphicResources(updateOverlapped);
 
             //  update scene shader globals
-            Globals.SetParam("preciseSeconds", context.Time.SecondsFromStart.ToFloat2());
+            Globals.SetParam("preciseSeconds", updateSeconds.ToFloat2());
 
 #if TRACING
             Graphics.EndTracedSection();
@@ -217,6 +195,27 @@ namespace Dragonfly.Engine.Core
                     // render all passes
                     RenderAllPasses();
 
+                    // update the next frame while the render threads are recording this one
+                    if (PipelinedRendering)
+                    {
+#if TRACING
+                        Graphics.StartTracedSection(Color.Cyan, "UpdateNextFrame");
+#endif
+                        Components.SetRenderingInProgress(true);
+                        try
+                        {
+                            UpdateComponents();
+                        }
+                        finally
+                        {
+                            Components.SetRenderingInProgress(false);
+                        }
+                        nextFrameUpdated = true;
+#if TRACING
+                        Graphics.EndTracedSection();
+#endif
+                    }
+
                     // signal end of frame
                     graphics.StartRender();
 
@@ -237,67 +236,121 @@ namespace Dragonfly.Engine.Core
 		}
 
         /// <summary>
-        /// render all the passes needed for the current frame
+        /// Start a new update and call the updatable components that run at the start of the frame.
+        /// <para/> If the previous frame is being rendered, the updates of components that allocate graphic resources are deferred to PrepareGraphicResources().
         /// </summary>
-        private void RenderAllPasses()
+        private void UpdateComponents()
         {
-            sceneRenderedToScreen = false;
-            renderedViews.Clear();
-            RenderPassTree(MainRenderPass);
-        }
+            updateSeconds = context.Time.SecondsFromStart;
 
-        private void UpdateFrameStats()
-        {
-            RenderStats curFrameStats = new RenderStats();
-            foreach (CompRenderPass pass in renderedViews)
-                curFrameStats += pass.Stats;
-            LastFrameStats = curFrameStats;
+            // update component values
+            Components.OnNewFrameStart();
+
+#if TRACING
+            Graphics.StartTracedSection(Color.Cyan, "UpdateType.FrameStart1");
+#endif
+            // call updatable components
+            Components.UpdateComponents(Graphics, UpdateType.FrameStart1);
+
+#if TRACING
+            Graphics.EndTracedSection();
+            Graphics.StartTracedSection(Color.Cyan, "UpdateType.FrameStart2");
+#endif
+
+            // call updatable components
+            Components.UpdateComponents(Graphics, UpdateType.FrameStart2);
+
+#if TRACING
+            Graphics.EndTracedSection();
+#endif
         }
 
         /// <summary>
-        /// Render the specified pass and all the required passes recursively.
+        /// Load the resources needed for the current update, and prepare the frame graph for rendering.
         /// </summary>
-        private void RenderPassTree(CompRenderPass presentationPass)
+        /// <param name="updateOverlapped">True if the current update has been performed while the previous frame was rendering.</param>
+        private void PrepareGraphicResources(bool updateOverlapped)
         {
-            passStack.Push(presentationPass);
-
-            while(passStack.Count > 0)
+            if (updateOverlapped)
             {
-                if (renderedViews.Count > MAX_VIEW_COUNT)
-                    throw new Exception("View-stack overflow, too many rendered in this frame! This can be caused by too many queued views or by a circular dependency on the active views.");
+                // apply changes and updates that have been deferred during rendering
+                Components.ApplyDeferredChanges();
+                Components.UpdateDeferredComponents(Graphics, UpdateType.FrameStart1);
+                Components.UpdateDeferredComponents(Graphics, UpdateType.FrameStart2);
+            }
 
-                CompRenderPass currentPass = passStack.Pop();
-                if (currentPass.RequiredPasses.Count > 0)
-                {
-                    // queue views required by the current one
-                    for (int i = currentPass.RequiredPasses.Count - 1; i >= 0 ; --i)
-                    {
-                        CompRenderPass requiredPass = currentPass.RequiredPasses[i];
+#if TRACING
+            Graphics.StartTracedSection(Color.Cyan, "LoadGraphicResources");
+#endif
 
-                        // remove disposed passes, that are still listed as required
-                        // (this allow user to not worry about dangling required views references)
-                        if(requiredPass.Disposed)
-                        {
-                            currentPass.RequiredPasses.RemoveAt(i);
-                            continue;
-                        }
+            // load needed resources
+            Components.LoadComponentResources(Graphics, resAllocator);
 
-                        // if the required can be rendered, add to the pass stack 
-                        if (requiredPass.CanBeRendered && !renderedViews.Contains(requiredPass))
-                            passStack.Push(requiredPass);
-                    }
-                }
+#if TRACING
+            Graphics.EndTracedSection();
+            Graphics.StartTracedSection(Color.Cyan, "FrameGraph");
+#endif
+
+            // compile the pass tree again if changed, binding transient buffers before they are used
+            if (MainRenderPass != null && frameGraph.Update(MainRenderPass))
+                Components.OnFrameGraphCompiled();
+
+#if TRACING
+            Graphics.EndTracedSection();
+            Graphics.StartTracedSection(Color.Cyan, "UpdateType.ResourceLoaded");
+#endif
+
+            // call updatable components after resources have been loaded
+            Components.UpdateComponents(Graphics, UpdateType.ResourceLoaded);
+
+            // upload modified instances
+            Components.UploadChangedInstances(resAllocator);
+
+            // evaluate the world transforms changed in this frame
+            Components.EvaluateTransforms();
+
+            // evaluate the values read by render threads before recording starts
+            Components.EvaluateRenderValues(frameGraph.Passes);
+
+#if TRACING
+            Graphics.EndTracedSection();
+#endif
+        }
+
+        /// <summary>
+        /// render all the passes needed for the current frame
+        /// </summary>
+        private void RenderAllPasses()
+        {
+            sceneRenderedToScreen = false;
+            Components.BeginRendering();
+            IReadOnlyList<CompRenderPass> passes = frameGraph.Passes;
+            for (int i = 0; i < passes.Count; i++)
+            {
+                CompRenderPass pass = passes[i];
+
+                // skip required passes disabled after the graph update, the graph will be compiled again on the next frame
+                // (the main pass is always the last one, and is rendered anyway)
+                if (pass.Disposed || (i < passes.Count - 1 && !pass.CanBeRendered))
+                    continue;
 
                 // save if at least one pass has rendered to screen
-                if (!currentPass.RenderToTexture || !currentPass.CanRenderToTexture)
-                    sceneRenderedToScreen = true; 
+                if (!pass.RenderToTexture || !pass.CanRenderToTexture)
+                    sceneRenderedToScreen = true;
 
-                // render the current view     
-                currentPass.Render();
-                renderedViews.Add(currentPass);            
+                pass.Render();
             }
         }
 
+        private void UpdateFrameStats()
+        {
+            RenderStats curFrameStats = new RenderStats();
+            IReadOnlyList<CompRenderPass> passes = frameGraph.Passes;
+            for (int i = 0; i < passes.Count; i++)
+                curFrameStats += passes[i].Stats;
+            LastFrameStats = curFrameStats;
+        }
+
         /// <summary>
         /// Release all graphics resources loaded for this scene.
         /// </summary>
@@ -305,6 +358,7 @@ namespace Dragonfly.Engine.Core
 		{
             Globals.Release();
             Globals = null;
+            frameGraph.Release();
             Components.ReleaseComponentResources();
         }
 
@@ -0,0 +1,253 @@
+﻿using Dragonfly.Graphics.Math;
+using Dragonfly.Utils;
+using System.Collections.Generic;
+
+namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// A scene-wide bounding volume hierarchy of the bounded drawables, used to find the ones visible from a camera without testing all of them.
+    /// World boxes are refreshed once per frame, and the tree is only modified for the drawables that moved out of their enlarged box.
+    /// Boxes are stored relative to a reference tile, which follows the view when it moves too far from it.
+    /// </summary>
+    internal class SceneSpatialIndex
+    {
+        private const int REBASE_TILE_DISTANCE = 4;
+        private const float MAX_BOX_COORD = 1e30f; // bigger boxes are considered unbounded, and are not indexed
+
+        /// <summary>
+        /// The indexing state of a drawable.
+        /// </summary>
+        internal class Entry
+        {
+            public int Proxy = -1; // leaf of the drawable in the tree, or -1 if not indexed
+            public int TrackedIndex = -1;
+            public bool Indexable;
+            public AABox WorldBox; // relative to the reference tile
+            public AABox LocalBox, InstanceBox; // the box of the drawable, and the union of its instances
+            public AABoxArray InstanceBoxes = new AABoxArray(0); // the box of each instance, relative to the drawable
+            public int InstanceVersion = -1;
+        }
+
+        /// <summary>
+        /// The set of drawables found by a query, that can be tested in constant time.
+        /// </summary>
+        public class VisibleSet : IBVHVisitor
+        {
+            private int[] marks; // (query stamp << 1) | contained, for each proxy
+            private int stamp;
+
+            public VisibleSet()
+            {
+                marks = new int[0];
+            }
+
+            internal void Reset(int proxyCapacity)
+            {
+                if (marks.Length < proxyCapacity)
+                {
+                    marks = new int[proxyCapacity];
+                    stamp = 0;
+                }
+
+                stamp++;
+                if (stamp >= int.MaxValue >> 1)
+                {
+                    System.Array.Clear(marks, 0, marks.Length);
+                    stamp = 1;
+                }
+            }
+
+            public void Visit(int proxy, bool contained)
+            {
+                marks[proxy] = (stamp << 1) | (contained ? 1 : 0);
+            }
+
+            /// <summary>
+            /// Returns true if the specified proxy has been found by the last query.
+            /// </summary>
+            /// <param name="contained">True if the drawable is fully inside the query volume.</param>
+            public bool Contains(int proxy, out bool contained)
+            {
+                int mark = marks[proxy];
+                contained = (mark & 1) != 0;
+                return (mark >> 1) == stamp;
+            }
+        }
+
+        private DynamicBVH<CompDrawable> tree;
+        private List<CompDrawable> tracked; // indexed drawables
+        private bool rebased;
+
+        public SceneSpatialIndex()
+        {
+            tree = new DynamicBVH<CompDrawable>();
+            tracked = new List<CompDrawable>();
+        }
+
+        /// <summary>
+        /// The tile to which the indexed boxes are relative.
+        /// </summary>
+        public Int3 ReferenceTile { get; private set; }
+
+        /// <summary>
+        /// Number of indexed drawables.
+        /// </summary>
+        public int Count => tree.Count;
+
+        /// <summary>
+        /// Number of drawables re-inserted in the tree during the last update.
+        /// </summary>
+        public int ReinsertedCount { get; private set; }
+
+        /// <summary>
+        /// Returns the drawable associated to a proxy found by a query.
+        /// </summary>
+        public CompDrawable GetDrawable(int proxy)
+        {
+            return tree.GetItem(proxy);
+        }
+
+        /// <summary>
+        /// Find the indexed drawables that intersect the specified volume.
+        /// </summary>
+        /// <param name="volumeTile">The tile to which the volume coordinates are relative.</param>
+        public void Query(IVolume volume, Int3 volumeTile, VisibleSet result)
+        {
+            result.Reset(tree.ProxyCapacity);
+            tree.Query(volume, (volumeTile - ReferenceTile) * TiledFloat.TileSize, result);
+        }
+
+        /// <summary>
+        /// Find the indexed drawables that intersect the specified volume.
+        /// </summary>
+        public void Query(IVolume volume, Int3 volumeTile, IBVHVisitor visitor)
+        {
+            tree.Query(volume, (volumeTile - ReferenceTile) * TiledFloat.TileSize, visitor);
+        }
+
+        /// <summary>
+        /// Start a new update, moving the reference tile if the view is too far from it.
+        /// </summary>
+        internal void BeginUpdate(Int3 viewTile)
+        {
+            Int3 tileDist = viewTile - ReferenceTile;
+            rebased = System.Math.Max(System.Math.Abs(tileDist.X), System.Math.Max(System.Math.Abs(tileDist.Y), System.Math.Abs(tileDist.Z))) > REBASE_TILE_DISTANCE;
+            if (rebased)
+                ReferenceTile = viewTile;
+        }
+
+        /// <summary>
+        /// Compute the world box of the specified drawable. Can be called concurrently for different drawables.
+        /// </summary>
+        internal void RefreshBox(CompDrawable d)
+        {
+            Entry e = d.SpatialEntry;
+            e.Indexable = false;
+            if (!d.Active || !d.Ready || !d.IsBounded)
+                return;
+
+            AABox localBox = d.GetBoundingBox();
+            if (!IsFinite(localBox))
+                return;
+
+            // union of the instance boxes, recomputed when instances or the drawable box change
+            InstanceList instances = d.Instances;
+            int instanceCount = instances.UploadedCount;
+            if (instanceCount > 0 && (instances.UploadVersion != e.InstanceVersion || !localBox.Min.Equals(e.LocalBox.Min) || !localBox.Max.Equals(e.LocalBox.Max)))
+            {
+                AABox instanceBox = AABox.Empty;
+                e.InstanceBoxes.Clear();
+                e.InstanceBoxes.Reserve(instanceCount);
+                for (int i = 0; i < instanceCount; i++)
+                {
+                    e.InstanceBoxes.AddTransformed(localBox, instances.Buffer.GetInstance(i));
+                    instanceBox = instanceBox.Add(e.InstanceBoxes[i]);
+                }
+                e.InstanceBox = instanceBox;
+                e.InstanceVersion = instances.UploadVersion;
+            }
+            e.LocalBox = localBox;
+
+            AABox worldBox = (instanceCount > 0 ? e.InstanceBox : localBox) * d.GetTransform().ToFloat4x4(ReferenceTile);
+            if (!IsFinite(worldBox))
+                return;
+
+            e.WorldBox = worldBox;
+            e.Indexable = true;
+        }
+
+        /// <summary>
+        /// Update the tree with the boxes computed for the specified drawables, removing the drawables that are no longer available.
+        /// </summary>
+        internal void EndUpdate(ArrayRange<CompDrawable> drawables)
+        {
+            if (rebased)
+            {
+                // all the boxes moved
+                tree.Clear();
+                foreach (CompDrawable d in tracked)
+                    d.SpatialEntry.Proxy = -1;
+            }
+
+            ReinsertedCount = 0;
+            for (int i = 0; i < drawables.Count; i++)
+            {
+                CompDrawable d = drawables[i];
+                Entry e = d.SpatialEntry;
+                if (!e.Indexable)
+                {
+                    if (e.TrackedIndex >= 0)
+                        Untrack(d);
+                    continue;
+                }
+
+                if (e.TrackedIndex < 0)
+                {
+                    e.TrackedIndex = tracked.Count;
+                    tracked.Add(d);
+                }
+
+                if (e.Proxy < 0)
+                {
+                    e.Proxy = tree.Add(e.WorldBox, d);
+                    ReinsertedCount++;
+                }
+                else if (tree.Move(e.Proxy, e.WorldBox))
+                {
+                    ReinsertedCount++;
+                }
+            }
+
+            // remove disposed drawables
+            for (int i = tracked.Count - 1; i >= 0; i--)
+            {
+                CompDrawable d = tracked[i];
+                if (d.Archetype == null)
+                    Untrack(d);
+            }
+        }
+
+        private void Untrack(CompDrawable d)
+        {
+            Entry e = d.SpatialEntry;
+            if (e.Proxy >= 0)
+                tree.Remove(e.Proxy);
+            e.Proxy = -1;
+
+            // swap-remove from the tracked list
+            CompDrawable last = tracked[tracked.Count - 1];
+            tracked[e.TrackedIndex] = last;
+            last.SpatialEntry.TrackedIndex = e.TrackedIndex;
+            tracked.RemoveAt(tracked.Count - 1);
+            e.TrackedIndex = -1;
+        }
+
+        private static bool IsFinite(AABox b)
+        {
+            // also false for NaN coordinates
+            return b.Min.X > -MAX_BOX_COORD && b.Min.Y > -MAX_BOX_COORD && b.Min.Z > -MAX_BOX_COORD
+                && b.Max.X < MAX_BOX_COORD && b.Max.Y < MAX_BOX_COORD && b.Max.Z < MAX_BOX_COORD
+                && b.Min.X <= b.Max.X && b.Min.Y <= b.Max.Y && b.Min.Z <= b.Max.Z;
+        }
+    }
+}
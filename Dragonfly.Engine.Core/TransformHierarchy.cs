@@ -0,0 +1,286 @@
+﻿using Dragonfly.Graphics.Math;
+using Dragonfly.Utils;
+using System.Collections.Generic;
+using System.Threading;
+
+namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// A flattened view of the active transform components, sorted by depth so that each parent comes before its children.
+    /// World transforms are evaluated one depth level at a time, and only for the subtrees whose local transform is dynamic or has been invalidated.
+    /// CompTransform.GetValue() reads the evaluated values, falling back to the recursive evaluation for transforms that are not up to date.
+    /// </summary>
+    internal class TransformHierarchy
+    {
+        private const int MIN_CHUNK_SIZE = 64;
+
+        private ComponentManager compManager;
+        private int builtVersion; // the hierarchy version of the component manager when this was last flattened
+        private bool rebuilt, invalidated;
+        private int nodeCount;
+        private CompTransform[] nodes;
+        private int[] parents; // index of the parent of each node, or -1 for root transforms
+        private int[] levelStarts; // index of the first node of each depth level, plus the node count
+        private int levelCount;
+        private TiledFloat4x4[] worlds;
+        private int[] evaluatedIDs; // UpdateID in which each world transform was last evaluated
+        private int[] cachedIDs; // UpdateID in which each world transform was last stored in its component value cache
+        private bool[] dynamic, dynamicPath; // true if the local transform of the node (or of any of its ancestors) changes each frame
+        private bool[] localDirty, changed;
+        private int dynamicCount;
+        private EvaluateLevelBody evaluateBody;
+        private CacheLevelBody cacheBody;
+        private List<int> depthPath;
+
+        public TransformHierarchy(ComponentManager compManager)
+        {
+            this.compManager = compManager;
+            builtVersion = -1;
+            nodes = new CompTransform[0];
+            levelStarts = new int[1];
+            evaluateBody = new EvaluateLevelBody() { Hierarchy = this };
+            cacheBody = new CacheLevelBody() { Hierarchy = this };
+            depthPath = new List<int>();
+        }
+
+        /// <summary>
+        /// Mark the local transform of the specified component as changed.
+        /// </summary>
+        public void Invalidate(CompTransform t)
+        {
+            lock (this)
+            {
+                int i = t.HierarchyIndex;
+                if (i >= 0 && i < nodeCount && nodes[i] == t)
+                    localDirty[i] = true;
+                invalidated = true;
+            }
+        }
+
+        /// <summary>
+        /// Returns the world transform of the specified component if it is up to date for the specified update.
+        /// </summary>
+        public bool TryGetWorld(CompTransform t, int readUpdateID, out TiledFloat4x4 world)
+        {
+            world = TiledFloat4x4.Identity;
+            int i = t.HierarchyIndex;
+            if (builtVersion != compManager.HierarchyVersion || i < 0 || i >= nodeCount || nodes[i] != t)
+                return false;
+
+            int evaluatedID = Volatile.Read(ref evaluatedIDs[i]);
+            if (evaluatedID == 0)
+                return false; // never evaluated, or being evaluated
+
+            if (evaluatedID != readUpdateID)
+            {
+                // values evaluated in previous frames are still valid if nothing changed since then
+                if (dynamicPath[i] || invalidated || evaluatedID - readUpdateID > 0)
+                    return false;
+            }
+
+            world = worlds[i];
+            return true;
+        }
+
+        /// <summary>
+        /// Evaluate the world transforms that changed in the current update.
+        /// </summary>
+        public void Evaluate()
+        {
+            if (builtVersion != compManager.HierarchyVersion)
+                Flatten();
+
+            if (!rebuilt && !invalidated && dynamicCount == 0)
+                return; // nothing changed
+
+            evaluateBody.UpdateID = compManager.UpdateID;
+            evaluateBody.Rebuilt = rebuilt;
+            for (int l = 0; l < levelCount; l++)
+                SlimParallel.For(levelStarts[l], levelStarts[l + 1], MIN_CHUNK_SIZE, evaluateBody);
+
+            dynamicCount = 0;
+            for (int i = 0; i < nodeCount; i++)
+                dynamicCount += dynamic[i] ? 1 : 0;
+            rebuilt = false;
+            invalidated = false;
+        }
+
+        private void EvaluateNode(int i, int updateID, bool rebuilt)
+        {
+            int p = parents[i];
+            bool dirty = rebuilt || localDirty[i] || (p >= 0 && changed[p]);
+            if (localDirty[i] || rebuilt)
+            {
+                localDirty[i] = false;
+                dynamic[i] = nodes[i].IsLocalTransformDynamic;
+            }
+            dirty |= dynamic[i];
+            dynamicPath[i] = dynamic[i] || (p >= 0 && dynamicPath[p]);
+            changed[i] = dirty;
+            if (!dirty)
+                return;
+
+            Volatile.Write(ref evaluatedIDs[i], 0);
+            TiledFloat4x4 world = nodes[i].GetLocalTransform();
+            if (p >= 0)
+                world *= worlds[p];
+            worlds[i] = world;
+            Volatile.Write(ref evaluatedIDs[i], updateID);
+        }
+
+        private class EvaluateLevelBody : SlimParallel.IForBody
+        {
+            public TransformHierarchy Hierarchy;
+            public int UpdateID;
+            public bool Rebuilt;
+
+            public void Execute(int i)
+            {
+                Hierarchy.EvaluateNode(i, UpdateID, Rebuilt);
+            }
+        }
+
+        /// <summary>
+        /// Store the world transform of each node in its component value cache, parents first, so that reading them later does not require any evaluation.
+        /// Nodes whose world transform has not been evaluated again since they were last cached keep their cached value.
+        /// </summary>
+        public void CacheValues()
+        {
+            cacheBody.UpdateID = compManager.UpdateID;
+            for (int l = 0; l < levelCount; l++)
+                SlimParallel.For(levelStarts[l], levelStarts[l + 1], MIN_CHUNK_SIZE, cacheBody);
+        }
+
+        private void CacheNode(int i, int updateID)
+        {
+            int cachedID = cachedIDs[i];
+            if (cachedID == updateID)
+                return;
+
+            int evaluatedID = evaluatedIDs[i];
+            bool unchanged = cachedID != 0 && evaluatedID != 0 && evaluatedID - cachedID <= 0 && !dynamicPath[i] && !invalidated;
+            if (!unchanged || !nodes[i].RenewCachedValue(cachedID))
+                nodes[i].GetValue();
+            cachedIDs[i] = updateID;
+        }
+
+        private class CacheLevelBody : SlimParallel.IForBody
+        {
+            public TransformHierarchy Hierarchy;
+            public int UpdateID;
+
+            public void Execute(int i)
+            {
+                Hierarchy.CacheNode(i, UpdateID);
+            }
+        }
+
+        /// <summary>
+        /// Sort the active transforms by depth, and resolve the index of their parents.
+        /// </summary>
+        private void Flatten()
+        {
+            int version = compManager.HierarchyVersion;
+            ArrayRange<CompTransform> transforms = compManager.QueryRange<CompTransform>();
+            int count = transforms.Count;
+
+            // index the transforms in query order
+            int[] queryParents = new int[count];
+            int[] depths = new int[count];
+            for (int i = 0; i < count; i++)
+                transforms[i].HierarchyIndex = i;
+            for (int i = 0; i < count; i++)
+            {
+                CompTransform parent = transforms[i].GetAncestorTransform();
+                if (parent == null)
+                    queryParents[i] = -1;
+                else if (parent.HierarchyIndex >= 0 && parent.HierarchyIndex < count && transforms[parent.HierarchyIndex] == parent)
+                    queryParents[i] = parent.HierarchyIndex;
+                else
+                    queryParents[i] = -2; // the parent is not active, evaluated recursively
+                depths[i] = -1;
+            }
+
+            // compute depths, excluding the subtrees of inactive transforms
+            int maxDepth = -1;
+            for (int i = 0; i < count; i++)
+                maxDepth = System.Math.Max(maxDepth, GetDepth(i, queryParents, depths));
+
+            // sort by depth
+            levelCount = maxDepth + 1;
+            levelStarts = new int[levelCount + 1];
+            for (int i = 0; i < count; i++)
+                if (depths[i] >= 0)
+                    levelStarts[depths[i] + 1]++;
+            for (int l = 0; l < levelCount; l++)
+                levelStarts[l + 1] += levelStarts[l];
+
+            nodeCount = levelStarts[levelCount];
+            nodes = new CompTransform[nodeCount];
+            parents = new int[nodeCount];
+            int[] nodeIndices = new int[count];
+            int[] levelFill = new int[levelCount];
+            for (int i = 0; i < count; i++)
+            {
+                nodeIndices[i] = -1;
+                if (depths[i] < 0)
+                    continue;
+                nodeIndices[i] = levelStarts[depths[i]] + levelFill[depths[i]]++;
+                nodes[nodeIndices[i]] = transforms[i];
+            }
+            for (int i = 0; i < count; i++)
+            {
+                transforms[i].HierarchyIndex = nodeIndices[i];
+                if (nodeIndices[i] >= 0)
+                    parents[nodeIndices[i]] = queryParents[i] >= 0 ? nodeIndices[queryParents[i]] : -1;
+            }
+
+            worlds = new TiledFloat4x4[nodeCount];
+            evaluatedIDs = new int[nodeCount];
+            cachedIDs = new int[nodeCount];
+            dynamic = new bool[nodeCount];
+            dynamicPath = new bool[nodeCount];
+            localDirty = new bool[nodeCount];
+            changed = new bool[nodeCount];
+            rebuilt = true;
+            builtVersion = version;
+        }
+
+        /// <summary>
+        /// Returns the depth of the specified node, or -2 if it is a descendant of an inactive transform. Depths are cached in the specified array, where -1 means unknown.
+        /// </summary>
+        private int GetDepth(int i, int[] queryParents, int[] depths)
+        {
+            // walk up to the first node with a known depth, or to the root
+            depthPath.Clear();
+            int n = i;
+            while (depths[n] == -1)
+            {
+                depthPath.Add(n);
+                if (queryParents[n] < 0)
+                    break;
+                n = queryParents[n];
+            }
+
+            if (depthPath.Count == 0)
+                return depths[i];
+
+            // depth of the top-most node of the path
+            int top = depthPath[depthPath.Count - 1], depth;
+            if (n != top)
+                depth = depths[n] == -2 ? -2 : depths[n] + 1;
+            else
+                depth = queryParents[top] == -1 ? 0 : -2;
+
+            // assign depths down the path
+            for (int k = depthPath.Count - 1; k >= 0; k--)
+            {
+                depths[depthPath[k]] = depth;
+                if (depth >= 0)
+                    depth++;
+            }
+
+            return depths[i];
+        }
+    }
+}
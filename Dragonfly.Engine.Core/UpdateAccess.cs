@@ -0,0 +1,73 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace Dragonfly.Engine.Core
+{
+    /// <summary>
+    /// The set of objects read and written by an update. Two updates conflict if one of them writes an object that the other reads or writes, and conflicting updates 
+    /// are executed in the order in which they are queued. A Type can be used to declare the access to all the components of that type, and overlaps with its instances and compatible types.
+    /// </summary>
+    public class UpdateAccess
+    {
+        private List<object> reads, writes;
+
+        internal UpdateAccess()
+        {
+            reads = new List<object>();
+            writes = new List<object>();
+        }
+
+        public void Read(object resource)
+        {
+            if (resource == null)
+                throw new ArgumentNullException();
+            reads.Add(resource);
+        }
+
+        public void Write(object resource)
+        {
+            if (resource == null)
+                throw new ArgumentNullException();
+            writes.Add(resource);
+        }
+
+        internal void Clear()
+        {
+            reads.Clear();
+            writes.Clear();
+        }
+
+        /// <summary>
+        /// Returns true if the updates that declared this and the specified access cannot run concurrently.
+        /// </summary>
+        internal bool ConflictsWith(UpdateAccess other)
+        {
+            return AnyOverlap(writes, other.writes) || AnyOverlap(writes, other.reads) || AnyOverlap(reads, other.writes);
+        }
+
+        private static bool AnyOverlap(List<object> a, List<object> b)
+        {
+            for (int i = 0; i < a.Count; i++)
+                for (int j = 0; j < b.Count; j++)
+                    if (Overlaps(a[i], b[j]))
+                        return true;
+            return false;
+        }
+
+        private static bool Overlaps(object a, object b)
+        {
+            if (ReferenceEquals(a, b))
+                return true;
+
+            Type typeA = a as Type, typeB = b as Type;
+            if (typeA != null && typeB != null)
+                return typeA.IsAssignableFrom(typeB) || typeB.IsAssignableFrom(typeA);
+            if (typeA != null)
+                return typeA.IsInstanceOfType(b);
+            if (typeB != null)
+                return typeB.IsInstanceOfType(a);
+
+            return false;
+        }
+    }
+}
@@ -47,6 +47,10 @@ namespace Dragonfly.Engine.Procedural
 
             // start generation from the main branch (which is actually the trunk)
             GenerateBranch(trunk.AsObject3D(), outFoliages, tp);
+
+            // optimize the generated meshes for rendering
+            foreach (CompMesh mesh in treeMesh.MeshList)
+                mesh.OptimizeGeometry();
             
             return treeMesh;
         }
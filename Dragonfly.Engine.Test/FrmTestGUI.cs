@@ -57,6 +57,9 @@ namespace Dragonfly.Engine.Test
             AddTest(new NoiseTest());
             AddTest(new HeighmapVisualizerTest());
             AddTest(new PlanetTest());
+            AddTest(new TransientBufferTest());
+            AddTest(new MeshMergeTest());
+            AddTest(new OcclusionCullingTest());
             InitLog();
 
 #if TRACING
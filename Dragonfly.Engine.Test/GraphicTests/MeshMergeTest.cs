@@ -0,0 +1,114 @@
+﻿using Dragonfly.BaseModule;
+using Dragonfly.Engine.Core;
+using Dragonfly.Graphics;
+using Dragonfly.Graphics.Math;
+using Dragonfly.Graphics.Resources;
+using System.Collections.Generic;
+
+namespace Dragonfly.Engine.Test.GraphicTests
+{
+    /// <summary>
+    /// Merge a grid of static spheres that share the same material, and check that the merged mesh, with more than 65536 vertices, is uploaded with 32-bit indices
+    /// and that the source geometries are released.
+    /// </summary>
+    public class MeshMergeTest : GraphicsTest
+    {
+        public MeshMergeTest()
+        {
+            Name = "Basic Tests: Static mesh merge";
+            EngineUsage = BaseMod.Usage.Generic3D;
+        }
+
+        public override void CreateScene()
+        {
+            AddDebugInfoWindow();
+
+            BaseMod baseMod = Context.GetModule<BaseMod>();
+            Component root = Context.Scene.Root;
+            baseMod.MainPass.ClearValue = new Float4("#e3f3f9");
+            baseMod.MainPass.Camera = new CompCamPerspective(new CompTransformEditorMovement(root, new Float3(0, 6.0f, -8.0f), Float3.Zero));
+            new CompLightAmbient(root, new Float3(0.3f, 0.3f, 0.3f));
+            new CompLightDirectional(root, Float3.One, 1.0f);
+
+            // a grid of spheres with about 10k vertices each, that exceed the 16-bit index range once merged
+            MeshMergeCheck check = new MeshMergeCheck(root);
+            CompMaterial material = new CompMtlPhong(root, new Float3("#c0a060")).DisplayIn(baseMod.MainPass);
+            for (int x = 0; x < 3; x++)
+                for (int z = 0; z < 3; z++)
+                {
+                    CompMeshGeometry geom = new CompMeshGeometry(check.Spheres);
+                    Primitives.Spheroid(geom, new Float3(x - 1, 0, z - 1) * 1.5f, Float3.One, 10000);
+                    geom.UpdateGeometry();
+                    check.Spheres.AddMesh(geom, material);
+                    check.SourceGeometries.Add(geom);
+                }
+
+            // a sphere with its own instances, that should not be merged
+            CompMeshGeometry instancedGeom = new CompMeshGeometry(check.Spheres);
+            Primitives.Spheroid(instancedGeom, Float3.Zero, Float3.One * 0.5f, 1000);
+            instancedGeom.UpdateGeometry();
+            CompMesh instancedMesh = check.Spheres.AddMesh(instancedGeom, material);
+            instancedMesh.Instances.Add(Float4x4.Translation(-3.0f, 0, 0));
+            instancedMesh.Instances.Add(Float4x4.Translation(3.0f, 0, 0));
+
+            // display results
+            check.ResultsWindow = new CompUiWindow(baseMod.UiContainer, "25em 10em", UiPositioning.Below(TestResults.Window, "0.5em"));
+            check.ResultsWindow.Title = Name;
+        }
+
+        private class MeshMergeCheck : Component, ICompUpdatable
+        {
+            private const int MERGE_FRAME = 10; // frames rendered before merging, so that all the geometries are uploaded
+            private const int CHECK_FRAME = 12; // frame in which the merged mesh is checked
+
+            private int startFrame;
+            private int step;
+            private CompUiCtrlLabel lastResult;
+
+            public MeshMergeCheck(Component parent) : base(parent)
+            {
+                Spheres = new CompMeshList(parent);
+                startFrame = -1;
+                SourceGeometries = new List<CompMeshGeometry>();
+            }
+
+            public CompMeshList Spheres { get; private set; }
+
+            public List<CompMeshGeometry> SourceGeometries { get; private set; }
+
+            public CompUiWindow ResultsWindow { get; set; }
+
+            public UpdateType NeededUpdates => step < 2 ? UpdateType.FrameStart1 : UpdateType.None;
+
+            public void Update(UpdateType updateType)
+            {
+                if (startFrame < 0)
+                    startFrame = Context.Time.FrameIndex;
+                int frame = Context.Time.FrameIndex - startFrame;
+
+                if (step == 0 && frame >= MERGE_FRAME)
+                {
+                    int removedCount = Spheres.MergeStaticMeshes();
+                    AddResult("Same-material meshes merged: " + (removedCount == 8 && Spheres.MeshCount == 2 ? "OK" : "FAILED"));
+                    step++;
+                }
+                else if (step == 1 && frame >= CHECK_FRAME)
+                {
+                    CompMesh merged = Spheres[Spheres.MeshCount - 1];
+                    CompMeshGeometry mergedGeom = (CompMeshGeometry)merged.Geometry;
+                    IndexBuffer indices = merged.GetIndexBuffer();
+                    bool index32 = mergedGeom.VertexCount > 65536 && indices != null && indices.Format == IndexFormat.Index32;
+                    AddResult(string.Format("{0} vertices merged with 32-bit indices: {1}", mergedGeom.VertexCount, index32 ? "OK" : "FAILED"));
+                    AddResult("Instanced mesh kept: " + (Spheres[0].Instances.Count == 2 ? "OK" : "FAILED"));
+                    AddResult("Source geometries released: " + (SourceGeometries.TrueForAll(g => g.Disposed) ? "OK" : "FAILED"));
+                    step++;
+                }
+            }
+
+            private void AddResult(string text)
+            {
+                lastResult = new CompUiCtrlLabel(ResultsWindow, text, lastResult == null ? UiPositioning.Inside(ResultsWindow, "0 0") : UiPositioning.Below(lastResult));
+            }
+        }
+    }
+}
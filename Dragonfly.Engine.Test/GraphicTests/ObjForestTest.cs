@@ -55,6 +55,10 @@ namespace Dragonfly.Engine.Test.GraphicTests
             terrainHmap.Dispose();
             Primitives.Terrain(ground.AsObject3D(), Float3.Zero, heights, TERRAIN_SIZE, TERRAIN_SIZE, 16.0f);
 
+            // a coarse version of the terrain, that hides the trees behind the hills
+            CompMeshOccluder groundOccluder = new CompMeshOccluder(root);
+            groundOccluder.AddTerrain(Float3.Zero, heights, TERRAIN_SIZE, TERRAIN_SIZE, 8);
+
             // create camera
             Component cameraController = null;
             if (TestMode)
@@ -82,7 +86,9 @@ namespace Dragonfly.Engine.Test.GraphicTests
                 cameraTarget.Y += HeightAt(cameraPos.XZ);
                 cameraController = new CompTransformEditorMovement(root, cameraPos, cameraTarget);
             }
-            baseModule.MainPass.Camera = new CompCamPerspective(cameraController);
+            CompCamPerspective camera = new CompCamPerspective(cameraController);
+            camera.OcclusionCulling = true;
+            baseModule.MainPass.Camera = camera;
 
             // create trees  
             CompMtlPhong.Factory mf = new CompMtlPhong.Factory { MaterialClass = baseModule.MainPass.MainClass };
@@ -124,6 +130,18 @@ namespace Dragonfly.Engine.Test.GraphicTests
             windBg.Effects.Add(new CompAudioFxVolumeRnd(windBg, 0.4f, -12.0f, 0.0f));
             
 
+            // occlusion culling toggle, the occluded draws are reported in the debug window
+            if (!TestMode)
+            {
+                CompUiWindow settingsWindow = new CompUiWindow(baseModule.UiContainer, "25em 5em", UiPositioning.Below(TestResults.Window, "0.5em"));
+                settingsWindow.Title = "Occlusion culling";
+                CompUiCtrlLabel lblOcclusion = new CompUiCtrlLabel(settingsWindow, "Occlusion culling: ", UiPositioning.Inside(settingsWindow, "0em 1em"));
+                CompUiCtrlCheckbox occlusionCheck = new CompUiCtrlCheckbox(settingsWindow, UiPositioning.RightOf(lblOcclusion), camera.OcclusionCulling);
+                UiPositioning.AlignCenterVertically(lblOcclusion, occlusionCheck);
+                new CompActionOnEvent(occlusionCheck.CheckedChanged, () => camera.OcclusionCulling = occlusionCheck.Checked);
+                settingsWindow.Show();
+            }
+
             if (TestMode)
             {
                 ambientMusic = new CompAudio(house1, "audio/ambient_loop_1.wav");
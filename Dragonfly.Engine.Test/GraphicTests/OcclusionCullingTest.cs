@@ -0,0 +1,81 @@
+﻿using Dragonfly.BaseModule;
+using Dragonfly.Engine.Core;
+using Dragonfly.Graphics.Math;
+
+namespace Dragonfly.Engine.Test.GraphicTests
+{
+    /// <summary>
+    /// A field of instanced spheres behind rows of walls, that are also occluders. Occlusion culling can be toggled at runtime, and the culled draws are reported in the debug window.
+    /// </summary>
+    public class OcclusionCullingTest : GraphicsTest
+    {
+        private const int WALL_ROWS = 4;
+        private const float WALL_WIDTH = 16.0f, WALL_HEIGHT = 6.0f, WALL_THICKNESS = 1.0f;
+        private const float ROW_SPACING = 20.0f;
+
+        public OcclusionCullingTest()
+        {
+            Name = "Component test: Occlusion culling";
+            EngineUsage = BaseMod.Usage.Generic3D;
+        }
+
+        public override void CreateScene()
+        {
+            AddDebugInfoWindow();
+
+            BaseMod baseMod = Context.GetModule<BaseMod>();
+            Component root = Context.Scene.Root;
+            baseMod.MainPass.ClearValue = new Float4("#e3f3f9");
+            CompCamPerspective camera = new CompCamPerspective(new CompTransformEditorMovement(root, new Float3(0, 3.0f, -30.0f), new Float3(0, 3.0f, 0)));
+            camera.OcclusionCulling = true;
+            baseMod.MainPass.Camera = camera;
+
+            // lights
+            new CompLightAmbient(root, new Float3(0.2f, 0.2f, 0.25f));
+            new CompLightDirectional(CompTransformStack.FromDirection(root, new Float3(1.0f, -1.5f, 1.0f)), new Float3("#f9f6e0"), 3.0f);
+
+            // ground
+            CompMesh ground = new CompMesh(root, new CompMtlPhong(root, new Float3("#8c9a7a")).DisplayIn(baseMod.MainPass));
+            Primitives.Quad(ground.AsObject3D(), new Float3(-100.0f, 0, -100.0f), new Float3(-100.0f, 0, 100.0f), new Float3(100.0f, 0, 100.0f));
+
+            // rows of walls with gaps between them, each with an occluder quad on its middle plane facing both sides
+            CompMeshList walls = new CompMeshList(root);
+            CompMeshOccluder wallOccluders = new CompMeshOccluder(root);
+            for (int row = 0; row < WALL_ROWS; row++)
+            {
+                float z = row * ROW_SPACING - 10.0f;
+                float rowOffset = (row % 2) * WALL_WIDTH * 0.5f;
+                for (int i = -2; i <= 2; i++)
+                {
+                    float x = i * (WALL_WIDTH + 6.0f) + rowOffset;
+                    Primitives.Cuboid(walls.AddMesh().AsObject3D(), new Float3(x, WALL_HEIGHT * 0.5f, z), new Float3(WALL_WIDTH, WALL_HEIGHT, WALL_THICKNESS));
+
+                    Float3 bottomLeft = new Float3(x - WALL_WIDTH * 0.5f + 0.1f, 0, z), topRight = new Float3(x + WALL_WIDTH * 0.5f - 0.1f, WALL_HEIGHT - 0.1f, z);
+                    Float3 topLeft = new Float3(bottomLeft.X, topRight.Y, z), bottomRight = new Float3(topRight.X, 0, z);
+                    wallOccluders.AddQuad(bottomLeft, topLeft, topRight, bottomRight);
+                    wallOccluders.AddQuad(bottomRight, topRight, topLeft, bottomLeft);
+                }
+            }
+            walls.SetMainMaterial(new CompMtlPhong(root, new Float3("#b0a898")));
+
+            // instanced spheres, most of them hidden by the walls
+            CompMeshList spheres = new CompMeshList(root);
+            Primitives.Spheroid(spheres.AddMesh().AsObject3D(), Float3.Zero, Float3.One, 500);
+            spheres.SetMainMaterial(new CompMtlPhong(root, new Float3("#c05030")));
+            for (int x = -20; x <= 20; x++)
+                for (int z = 0; z < 30; z++)
+                    spheres.AddInstance(Float4x4.Translation(x * 3.0f, 1.0f, z * 3.0f - 5.0f));
+
+            // runtime toggle
+            CompUiWindow settingsWindow = new CompUiWindow(baseMod.UiContainer, "25em 5em", UiPositioning.Below(TestResults.Window, "0.5em"));
+            settingsWindow.Title = Name;
+            {
+                CompUiCtrlLabel lblOcclusion = new CompUiCtrlLabel(settingsWindow, "Occlusion culling: ", UiPositioning.Inside(settingsWindow, "0em 1em"));
+                CompUiCtrlCheckbox occlusionCheck = new CompUiCtrlCheckbox(settingsWindow, UiPositioning.RightOf(lblOcclusion), camera.OcclusionCulling);
+                UiPositioning.AlignCenterVertically(lblOcclusion, occlusionCheck);
+                new CompActionOnEvent(occlusionCheck.CheckedChanged, () => camera.OcclusionCulling = occlusionCheck.Checked);
+            }
+            settingsWindow.Show();
+        }
+    }
+}
@@ -0,0 +1,128 @@
+﻿using Dragonfly.BaseModule;
+using Dragonfly.Engine.Core;
+using Dragonfly.Graphics;
+using Dragonfly.Graphics.Math;
+using Dragonfly.Graphics.Resources;
+
+namespace Dragonfly.Engine.Test.GraphicTests
+{
+    /// <summary>
+    /// Render a chain of passes whose transient buffers are used in sequence, and a chain of composition passes of the base pipeline, 
+    /// and check that the frame graph aliases the buffers whose lifetimes do not overlap.
+    /// </summary>
+    public class TransientBufferTest : GraphicsTest
+    {
+        public TransientBufferTest()
+        {
+            Name = "Basic Tests: Transient buffer aliasing";
+            EngineUsage = BaseMod.Usage.Generic3D;
+        }
+
+        public override void CreateScene()
+        {
+            AddDebugInfoWindow();
+
+            BaseMod baseMod = Context.GetModule<BaseMod>();
+            Component root = Context.Scene.Root;
+            baseMod.MainPass.ClearValue = new Float4("#e3f3f9");
+            baseMod.MainPass.Camera = new CompCamPerspective(new CompTransformEditorMovement(root, new Float3(0, 3.0f, -3.0f), Float3.Zero));
+
+            // pass1 -> pass2 -> pass3 -> pass4 -> main pass, each pass reads the buffer of the previous one:
+            // buffer1 is used by pass1 and pass2, buffer3 by pass3 and pass4, so they can share the same targets (same for buffer2 and buffer4)
+            TransientAliasingCheck check = new TransientAliasingCheck(root);
+            CompRenderPass prevPass = null;
+            for (int i = 0; i < check.Buffers.Length; i++)
+            {
+                Int2 resolution = (i % 2 == 0) ? new Int2(256, 256) : new Int2(128, 128);
+                check.Buffers[i] = new CompRenderBuffer(root, SurfaceFormat.Color, resolution.X, resolution.Y);
+                check.Buffers[i].Transient = true;
+
+                CompRenderPass pass = new CompRenderPass(root, "TransientPass" + (i + 1), check.Buffers[i]);
+                pass.Camera = new CompCamIdentity(pass);
+                pass.ClearValue = Color.Red.ToFloat4();
+                pass.ClearFlags = ClearFlags.ClearTargets;
+                if (prevPass != null)
+                {
+                    pass.RequiredPasses.Add(prevPass);
+                    pass.InputBuffers.Add(prevPass.RenderBuffer);
+                }
+                prevPass = pass;
+            }
+            baseMod.MainPass.RequiredPasses.Add(prevPass);
+
+            // three composition passes that copy the previous image, the first and the last one can share the same targets
+            for (int i = 0; i < check.CompositionBuffers.Length; i++)
+            {
+                check.CompositionBuffers[i] = baseMod.CreateCompositionBuffer(root);
+                CompScreenPass copyPass = new CompScreenPass(root, "CompositionCopy" + (i + 1), check.CompositionBuffers[i]);
+                CompMtlImgCopy copyMaterial = new CompMtlImgCopy(copyPass);
+                copyMaterial.Image.SetSource(new RenderTargetRef(baseMod.LastCompositionPass.RenderBuffer));
+                copyPass.Material = copyMaterial;
+                baseMod.PushCompositionPass(copyPass.Pass);
+            }
+
+            // display results
+            check.ResultsWindow = new CompUiWindow(baseMod.UiContainer, "25em 10em", UiPositioning.Below(TestResults.Window, "0.5em"));
+            check.ResultsWindow.Title = Name;
+        }
+
+        private class TransientAliasingCheck : Component, ICompUpdatable
+        {
+            private const int CHECK_FRAME = 10; // frames rendered before checking the bindings
+            private const int RELEASE_FRAME = 20; // frame in which a buffer is released, to check that it's bound again
+
+            private int startFrame;
+            private int step;
+            private CompUiCtrlLabel lastResult;
+
+            public TransientAliasingCheck(Component parent) : base(parent)
+            {
+                Buffers = new CompRenderBuffer[4];
+                CompositionBuffers = new CompRenderBuffer[3];
+                startFrame = -1;
+            }
+
+            public CompRenderBuffer[] Buffers { get; private set; }
+
+            public CompRenderBuffer[] CompositionBuffers { get; private set; }
+
+            public CompUiWindow ResultsWindow { get; set; }
+
+            public UpdateType NeededUpdates => step < 3 ? UpdateType.FrameStart1 : UpdateType.None;
+
+            public void Update(UpdateType updateType)
+            {
+                if (startFrame < 0)
+                    startFrame = Context.Time.FrameIndex;
+                int frame = Context.Time.FrameIndex - startFrame;
+
+                if (step == 0 && frame >= CHECK_FRAME)
+                {
+                    bool aliased = Buffers[0][0] != null && Buffers[0][0] == Buffers[2][0] && Buffers[1][0] != null && Buffers[1][0] == Buffers[3][0];
+                    bool separated = Buffers[0][0] != Buffers[1][0];
+                    AddResult("Non-overlapping buffers aliased: " + (aliased ? "OK" : "FAILED"));
+                    AddResult("Overlapping buffers separated: " + (separated ? "OK" : "FAILED"));
+                    bool compositionAliased = CompositionBuffers[0][0] != null && CompositionBuffers[0][0] == CompositionBuffers[2][0] && CompositionBuffers[1][0] != CompositionBuffers[0][0];
+                    AddResult("Composition buffers aliased: " + (compositionAliased ? "OK" : "FAILED"));
+                    step++;
+                }
+                else if (step == 1 && frame >= RELEASE_FRAME)
+                {
+                    Buffers[2].ReleaseGraphicResources();
+                    step++;
+                }
+                else if (step == 2 && frame >= RELEASE_FRAME + 2)
+                {
+                    bool rebound = Buffers[2][0] != null && Buffers[2][0] == Buffers[0][0];
+                    AddResult("Released buffer bound again: " + (rebound ? "OK" : "FAILED"));
+                    step++;
+                }
+            }
+
+            private void AddResult(string text)
+            {
+                lastResult = new CompUiCtrlLabel(ResultsWindow, text, lastResult == null ? UiPositioning.Inside(ResultsWindow, "0 0") : UiPositioning.Below(lastResult));
+            }
+        }
+    }
+}
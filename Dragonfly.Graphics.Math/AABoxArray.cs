@@ -0,0 +1,167 @@
+﻿using System;
+using System.Numerics;
+using System.Runtime.CompilerServices;
+
+namespace Dragonfly.Graphics.Math
+{
+    /// <summary>
+    /// A list of bounding boxes stored as separate arrays of coordinates, that can be transformed and tested in batches using SIMD instructions.
+    /// Batch tests return their results as bitmasks, where bit (i &amp; 63) of the element (i &gt;&gt; 6) is set for each passing box i.
+    /// </summary>
+    public class AABoxArray
+    {
+        public float[] MinX, MinY, MinZ, MaxX, MaxY, MaxZ;
+
+        public AABoxArray(int capacity)
+        {
+            Count = 0;
+            Resize(System.Math.Max(capacity, Vector<float>.Count));
+        }
+
+        public int Count { get; private set; }
+
+        public int Capacity => MinX.Length;
+
+        public AABox this[int index]
+        {
+            get
+            {
+                return new AABox(new Float3(MinX[index], MinY[index], MinZ[index]), new Float3(MaxX[index], MaxY[index], MaxZ[index]));
+            }
+            set
+            {
+                MinX[index] = value.Min.X;
+                MinY[index] = value.Min.Y;
+                MinZ[index] = value.Min.Z;
+                MaxX[index] = value.Max.X;
+                MaxY[index] = value.Max.Y;
+                MaxZ[index] = value.Max.Z;
+            }
+        }
+
+        public void Clear()
+        {
+            Count = 0;
+        }
+
+        /// <summary>
+        /// Make sure that the specified number of boxes can be stored without allocations.
+        /// </summary>
+        public void Reserve(int capacity)
+        {
+            if (capacity > Capacity)
+                Resize(System.Math.Max(capacity, 2 * Capacity));
+        }
+
+        public void Add(AABox box)
+        {
+            Reserve(Count + 1);
+            this[Count++] = box;
+        }
+
+        /// <summary>
+        /// Add the bounding box of the specified box transformed by an affine matrix.
+        /// </summary>
+        public void AddTransformed(AABox box, Float4x4 transform)
+        {
+            if (!IsAffine(transform))
+            {
+                Add(box * transform);
+                return;
+            }
+
+            Reserve(Count + 1);
+            Float3 c = (box.Min + box.Max) * 0.5f, e = (box.Max - box.Min) * 0.5f;
+            float cx = c.X * transform.A11 + c.Y * transform.A21 + c.Z * transform.A31 + transform.A41;
+            float cy = c.X * transform.A12 + c.Y * transform.A22 + c.Z * transform.A32 + transform.A42;
+            float cz = c.X * transform.A13 + c.Y * transform.A23 + c.Z * transform.A33 + transform.A43;
+            float ex = e.X * System.Math.Abs(transform.A11) + e.Y * System.Math.Abs(transform.A21) + e.Z * System.Math.Abs(transform.A31);
+            float ey = e.X * System.Math.Abs(transform.A12) + e.Y * System.Math.Abs(transform.A22) + e.Z * System.Math.Abs(transform.A32);
+            float ez = e.X * System.Math.Abs(transform.A13) + e.Y * System.Math.Abs(transform.A23) + e.Z * System.Math.Abs(transform.A33);
+            MinX[Count] = cx - ex;
+            MinY[Count] = cy - ey;
+            MinZ[Count] = cz - ez;
+            MaxX[Count] = cx + ex;
+            MaxY[Count] = cy + ey;
+            MaxZ[Count] = cz + ez;
+            Count++;
+        }
+
+        /// <summary>
+        /// Store in the destination array the bounding boxes of all these boxes, transformed by the specified matrix.
+        /// </summary>
+        public void Transform(Float4x4 transform, AABoxArray dest)
+        {
+            dest.Count = 0;
+            dest.Reserve(Count);
+
+            if (!IsAffine(transform))
+            {
+                // projective transform, that should be applied to each corner
+                for (int i = 0; i < Count; i++)
+                    dest.Add(this[i] * transform);
+                return;
+            }
+
+            int width = Vector<float>.Count;
+            int vecEnd = Vector.IsHardwareAccelerated ? Count - Count % width : 0;
+            Vector<float> half = new Vector<float>(0.5f);
+            for (int i = 0; i < vecEnd; i += width)
+            {
+                Vector<float> minX = new Vector<float>(MinX, i), minY = new Vector<float>(MinY, i), minZ = new Vector<float>(MinZ, i);
+                Vector<float> maxX = new Vector<float>(MaxX, i), maxY = new Vector<float>(MaxY, i), maxZ = new Vector<float>(MaxZ, i);
+                Vector<float> cx = (minX + maxX) * half, cy = (minY + maxY) * half, cz = (minZ + maxZ) * half;
+                Vector<float> ex = (maxX - minX) * half, ey = (maxY - minY) * half, ez = (maxZ - minZ) * half;
+
+                // transform the center, and project the extents on each axis
+                Vector<float> tc = cx * transform.A11 + cy * transform.A21 + cz * transform.A31 + new Vector<float>(transform.A41);
+                Vector<float> te = ex * System.Math.Abs(transform.A11) + ey * System.Math.Abs(transform.A21) + ez * System.Math.Abs(transform.A31);
+                (tc - te).CopyTo(dest.MinX, i);
+                (tc + te).CopyTo(dest.MaxX, i);
+
+                tc = cx * transform.A12 + cy * transform.A22 + cz * transform.A32 + new Vector<float>(transform.A42);
+                te = ex * System.Math.Abs(transform.A12) + ey * System.Math.Abs(transform.A22) + ez * System.Math.Abs(transform.A32);
+                (tc - te).CopyTo(dest.MinY, i);
+                (tc + te).CopyTo(dest.MaxY, i);
+
+                tc = cx * transform.A13 + cy * transform.A23 + cz * transform.A33 + new Vector<float>(transform.A43);
+                te = ex * System.Math.Abs(transform.A13) + ey * System.Math.Abs(transform.A23) + ez * System.Math.Abs(transform.A33);
+                (tc - te).CopyTo(dest.MinZ, i);
+                (tc + te).CopyTo(dest.MaxZ, i);
+            }
+
+            dest.Count = vecEnd;
+            for (int i = vecEnd; i < Count; i++)
+                dest.AddTransformed(this[i], transform);
+        }
+
+        /// <summary>
+        /// Returns the number of ulong elements needed to store a bitmask of the specified number of boxes.
+        /// </summary>
+        public static int GetMaskLength(int boxCount)
+        {
+            return (boxCount + 63) >> 6;
+        }
+
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        public static bool IsMaskSet(ulong[] mask, int index)
+        {
+            return (mask[index >> 6] & (1UL << (index & 63))) != 0;
+        }
+
+        private static bool IsAffine(Float4x4 m)
+        {
+            return m.A14 == 0 && m.A24 == 0 && m.A34 == 0 && m.A44 == 1.0f;
+        }
+
+        private void Resize(int capacity)
+        {
+            Array.Resize(ref MinX, capacity);
+            Array.Resize(ref MinY, capacity);
+            Array.Resize(ref MinZ, capacity);
+            Array.Resize(ref MaxX, capacity);
+            Array.Resize(ref MaxY, capacity);
+            Array.Resize(ref MaxZ, capacity);
+        }
+    }
+}
@@ -0,0 +1,13 @@
+﻿
+namespace Dragonfly.Graphics.Math
+{
+    /// <summary>
+    /// A volume that can test a list of boxes at once, returning the results as bitmasks (see AABoxArray).
+    /// </summary>
+    public interface IBatchVolume
+    {
+        void Intersects(AABoxArray boxes, ulong[] resultMask);
+
+        void Contains(AABoxArray boxes, ulong[] resultMask);
+    }
+}
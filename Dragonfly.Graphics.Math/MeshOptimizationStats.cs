@@ -0,0 +1,25 @@
+﻿namespace Dragonfly.Graphics.Math
+{
+    /// <summary>
+    /// Vertex processing statistics of a mesh, measured before and after its optimization.
+    /// </summary>
+    public struct MeshOptimizationStats
+    {
+        public int TriangleCount;
+        public int VertexCountBefore, VertexCountAfter;
+        /// <summary>
+        /// Average cache miss ratio: the number of transformed vertices per triangle, from 3 (no reuse) down to about 0.5.
+        /// </summary>
+        public float ACMRBefore, ACMRAfter;
+        /// <summary>
+        /// Average transform to vertex ratio: how many times each vertex is transformed, 1 is optimal.
+        /// </summary>
+        public float ATVRBefore, ATVRAfter;
+
+        public override string ToString()
+        {
+            return string.Format("{0} triangles, {1} -> {2} vertices, ACMR {3:F3} -> {4:F3}, ATVR {5:F3} -> {6:F3}",
+                TriangleCount, VertexCountBefore, VertexCountAfter, ACMRBefore, ACMRAfter, ATVRBefore, ATVRAfter);
+        }
+    }
+}
@@ -0,0 +1,416 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace Dragonfly.Graphics.Math
+{
+    /// <summary>
+    /// CPU optimizations of indexed triangle lists, that reduce vertex shader invocations, overdraw and vertex fetches when a mesh is drawn.
+    /// Triangles are reordered with Tipsify (Sander, Nehab, Barczak 2007), whose clusters are then sorted to draw the outer surfaces first.
+    /// </summary>
+    public static class MeshOptimizer
+    {
+        /// <summary>
+        /// The post-transform cache size assumed by the optimizations, a conservative value for most GPUs.
+        /// </summary>
+        public const int DEFAULT_CACHE_SIZE = 16;
+        /// <summary>
+        /// The maximum ACMR increase accepted to reduce overdraw, relative to the vertex cache optimized order.
+        /// </summary>
+        public const float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+        /// <summary>
+        /// Run the full optimization pipeline on a mesh: duplicated vertices are welded, triangles are reordered for the vertex cache and to reduce overdraw,
+        /// and vertices are remapped in fetch order. Returns the vertex processing statistics before and after the optimization.
+        /// </summary>
+        public static MeshOptimizationStats Optimize<T>(ref T[] vertices, ref uint[] indices, Func<T, Float3> getPosition, Func<T, Float3> getNormal, int cacheSize = DEFAULT_CACHE_SIZE) where T : IEquatable<T>
+        {
+            MeshOptimizationStats stats = new MeshOptimizationStats();
+            stats.TriangleCount = indices.Length / 3;
+            stats.VertexCountBefore = vertices.Length;
+            stats.ACMRBefore = ComputeACMR(indices, vertices.Length, cacheSize);
+            stats.ATVRBefore = ComputeATVR(indices, vertices.Length, cacheSize);
+
+            WeldVertices(vertices, indices);
+            indices = OptimizeOverdraw(indices, vertices, getPosition, getNormal, cacheSize, DEFAULT_OVERDRAW_THRESHOLD);
+            vertices = OptimizeVertexFetch(vertices, indices);
+
+            stats.VertexCountAfter = vertices.Length;
+            stats.ACMRAfter = ComputeACMR(indices, vertices.Length, cacheSize);
+            stats.ATVRAfter = ComputeATVR(indices, vertices.Length, cacheSize);
+            return stats;
+        }
+
+        #region Statistics
+
+        /// <summary>
+        /// Returns the average cache miss ratio of a triangle list, i.e. the number of vertices transformed per triangle with a FIFO cache of the specified size.
+        /// </summary>
+        public static float ComputeACMR(uint[] indices, int vertexCount, int cacheSize = DEFAULT_CACHE_SIZE)
+        {
+            int triangleCount = indices.Length / 3;
+            return triangleCount == 0 ? 0 : (float)CountCacheMisses(indices, vertexCount, cacheSize) / triangleCount;
+        }
+
+        /// <summary>
+        /// Returns the average transform to vertex ratio of a triangle list, i.e. how many times each referenced vertex is transformed with a FIFO cache of the specified size.
+        /// </summary>
+        public static float ComputeATVR(uint[] indices, int vertexCount, int cacheSize = DEFAULT_CACHE_SIZE)
+        {
+            bool[] used = new bool[vertexCount];
+            int usedCount = 0;
+            for (int i = 0; i < indices.Length; i++)
+            {
+                if (!used[indices[i]])
+                {
+                    used[indices[i]] = true;
+                    usedCount++;
+                }
+            }
+
+            return usedCount == 0 ? 0 : (float)CountCacheMisses(indices, vertexCount, cacheSize) / usedCount;
+        }
+
+        private static int CountCacheMisses(uint[] indices, int vertexCount, int cacheSize)
+        {
+            VertexCacheSimulation cache = new VertexCacheSimulation(vertexCount, cacheSize);
+            int missCount = 0;
+            for (int i = 0; i < indices.Length / 3 * 3; i++)
+                missCount += cache.Access(indices[i]).ToInt();
+            return missCount;
+        }
+
+        /// <summary>
+        /// A FIFO post-transform cache, that tracks when each vertex has been inserted.
+        /// </summary>
+        private class VertexCacheSimulation
+        {
+            private int[] timestamps;
+            private int cacheSize;
+            private int clock, clearClock;
+
+            public VertexCacheSimulation(int vertexCount, int cacheSize)
+            {
+                this.timestamps = new int[vertexCount];
+                this.cacheSize = cacheSize;
+                clock = clearClock = 1; // all timestamps start before the last clear
+            }
+
+            public void Clear()
+            {
+                clearClock = clock;
+            }
+
+            /// <summary>
+            /// Access the specified vertex, returning true if it was not in the cache and has been transformed.
+            /// </summary>
+            public bool Access(uint vertex)
+            {
+                int timestamp = timestamps[vertex];
+                if (timestamp >= clearClock && clock - timestamp <= cacheSize)
+                    return false;
+
+                timestamps[vertex] = clock++;
+                return true;
+            }
+        }
+
+        #endregion
+
+        #region Vertex cache
+
+        /// <summary>
+        /// Reorder the triangles of a list to improve the reuse of the post-transform vertex cache. Returns the reordered indices.
+        /// </summary>
+        public static uint[] OptimizeVertexCache(uint[] indices, int vertexCount, int cacheSize = DEFAULT_CACHE_SIZE)
+        {
+            return Tipsify(indices, vertexCount, cacheSize, null);
+        }
+
+        /// <summary>
+        /// Reorder the first indexCount 16-bit indices of a triangle list in place, to improve the reuse of the post-transform vertex cache.
+        /// </summary>
+        public static void OptimizeVertexCache(ushort[] indices, int indexCount, int vertexCount, int cacheSize = DEFAULT_CACHE_SIZE)
+        {
+            uint[] indices32 = new uint[indexCount];
+            for (int i = 0; i < indexCount; i++)
+                indices32[i] = indices[i];
+
+            indices32 = Tipsify(indices32, vertexCount, cacheSize, null);
+            for (int i = 0; i < indices32.Length; i++)
+                indices[i] = (ushort)indices32[i];
+        }
+
+        /// <param name="clusterStarts">If not null, filled with the first triangle of each cluster of the output, that starts where the cache had to be flushed.</param>
+        private static uint[] Tipsify(uint[] indices, int vertexCount, int cacheSize, List<int> clusterStarts)
+        {
+            int indexCount = indices.Length / 3 * 3;
+            uint[] result = new uint[indexCount];
+            if (indexCount == 0)
+                return result;
+
+            // build the list of triangles adjacent to each vertex
+            int[] liveTriangles = new int[vertexCount];
+            for (int i = 0; i < indexCount; i++)
+                liveTriangles[indices[i]]++;
+            int[] adjacencyStart = new int[vertexCount + 1];
+            for (int v = 0; v < vertexCount; v++)
+                adjacencyStart[v + 1] = adjacencyStart[v] + liveTriangles[v];
+            int[] adjacency = new int[indexCount];
+            int[] adjacencyEnd = (int[])adjacencyStart.Clone();
+            for (int i = 0; i < indexCount; i++)
+                adjacency[adjacencyEnd[indices[i]]++] = i / 3;
+
+            int[] cacheTimestamps = new int[vertexCount];
+            bool[] emitted = new bool[indexCount / 3];
+            uint[] deadEndStack = new uint[indexCount];
+            List<uint> candidates = new List<uint>();
+            int time = cacheSize + 1, deadEndCount = 0, cursor = 0, outCount = 0;
+            int fanningVertex = (int)indices[0];
+            bool cacheFlushed = true;
+
+            while (fanningVertex >= 0)
+            {
+                if (cacheFlushed && clusterStarts != null)
+                    clusterStarts.Add(outCount / 3);
+
+                // emit all the remaining triangles around the fanning vertex
+                candidates.Clear();
+                for (int a = adjacencyStart[fanningVertex]; a < adjacencyStart[fanningVertex + 1]; a++)
+                {
+                    int t = adjacency[a];
+                    if (emitted[t])
+                        continue;
+
+                    for (int k = 0; k < 3; k++)
+                    {
+                        uint v = indices[3 * t + k];
+                        result[outCount++] = v;
+                        deadEndStack[deadEndCount++] = v;
+                        candidates.Add(v);
+                        liveTriangles[v]--;
+                        if (time - cacheTimestamps[v] > cacheSize)
+                            cacheTimestamps[v] = time++;
+                    }
+                    emitted[t] = true;
+                }
+
+                // select the next fanning vertex, preferring the ones that will still be in cache
+                fanningVertex = -1;
+                int bestPriority = -1;
+                foreach (uint v in candidates)
+                {
+                    if (liveTriangles[v] <= 0)
+                        continue;
+
+                    int priority = 0;
+                    if (time - cacheTimestamps[v] + 2 * liveTriangles[v] <= cacheSize)
+                        priority = time - cacheTimestamps[v];
+                    if (priority > bestPriority)
+                    {
+                        bestPriority = priority;
+                        fanningVertex = (int)v;
+                    }
+                }
+
+                cacheFlushed = fanningVertex < 0;
+                if (cacheFlushed)
+                    fanningVertex = SkipDeadEnd(liveTriangles, deadEndStack, ref deadEndCount, ref cursor);
+            }
+
+            return result;
+        }
+
+        /// <summary>
+        /// Returns the last used vertex with remaining triangles, or the next one in index order. Returns -1 if all the triangles have been emitted.
+        /// </summary>
+        private static int SkipDeadEnd(int[] liveTriangles, uint[] deadEndStack, ref int deadEndCount, ref int cursor)
+        {
+            while (deadEndCount > 0)
+            {
+                uint v = deadEndStack[--deadEndCount];
+                if (liveTriangles[v] > 0)
+                    return (int)v;
+            }
+
+            for (; cursor < liveTriangles.Length; cursor++)
+            {
+                if (liveTriangles[cursor] > 0)
+                    return cursor;
+            }
+
+            return -1;
+        }
+
+        #endregion
+
+        #region Overdraw
+
+        /// <summary>
+        /// Reorder the triangles of a list for the vertex cache, then sort the resulting clusters of triangles so that those on the outside of the mesh, facing away from its center, are drawn first.
+        /// Clusters are further split as long as the ACMR stays within the specified threshold of the vertex cache optimized one. Returns the reordered indices.
+        /// </summary>
+        public static uint[] OptimizeOverdraw<T>(uint[] indices, T[] vertices, Func<T, Float3> getPosition, Func<T, Float3> getNormal, int cacheSize = DEFAULT_CACHE_SIZE, float threshold = DEFAULT_OVERDRAW_THRESHOLD)
+        {
+            List<int> clusterStarts = new List<int>();
+            uint[] cacheOptimized = Tipsify(indices, vertices.Length, cacheSize, clusterStarts);
+            if (clusterStarts.Count == 0)
+                return cacheOptimized;
+
+            float maxClusterACMR = threshold * ComputeACMR(cacheOptimized, vertices.Length, cacheSize);
+            clusterStarts = SplitClusters(cacheOptimized, vertices.Length, cacheSize, maxClusterACMR, clusterStarts);
+            return SortClusters(cacheOptimized, vertices, getPosition, getNormal, clusterStarts);
+        }
+
+        /// <summary>
+        /// Split the specified clusters each time the ACMR of the current one, starting with an empty cache, drops below the specified value.
+        /// </summary>
+        private static List<int> SplitClusters(uint[] indices, int vertexCount, int cacheSize, float maxClusterACMR, List<int> clusterStarts)
+        {
+            List<int> splitStarts = new List<int>();
+            VertexCacheSimulation cache = new VertexCacheSimulation(vertexCount, cacheSize);
+            int triangleCount = indices.Length / 3;
+
+            for (int c = 0; c < clusterStarts.Count; c++)
+            {
+                int clusterEnd = c + 1 < clusterStarts.Count ? clusterStarts[c + 1] : triangleCount;
+                int splitStart = clusterStarts[c], missCount = 0;
+                splitStarts.Add(splitStart);
+                cache.Clear();
+
+                for (int t = splitStart; t < clusterEnd - 1; t++)
+                {
+                    for (int k = 0; k < 3; k++)
+                        missCount += cache.Access(indices[3 * t + k]).ToInt();
+
+                    if (missCount <= maxClusterACMR * (t + 1 - splitStart))
+                    {
+                        // the cluster reuses the cache well enough, start a new one
+                        splitStart = t + 1;
+                        splitStarts.Add(splitStart);
+                        missCount = 0;
+                        cache.Clear();
+                    }
+                }
+            }
+
+            return splitStarts;
+        }
+
+        private static uint[] SortClusters<T>(uint[] indices, T[] vertices, Func<T, Float3> getPosition, Func<T, Float3> getNormal, List<int> clusterStarts)
+        {
+            int triangleCount = indices.Length / 3, clusterCount = clusterStarts.Count;
+            Float3[] clusterCenters = new Float3[clusterCount];
+            Float3[] clusterNormals = new Float3[clusterCount];
+            Float3 meshCenter = Float3.Zero;
+            float meshArea = 0;
+
+            // compute the area-weighted center and the average normal of each cluster
+            for (int c = 0; c < clusterCount; c++)
+            {
+                int clusterEnd = c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount;
+                Float3 center = Float3.Zero, normal = Float3.Zero;
+                float area = 0;
+
+                for (int t = clusterStarts[c]; t < clusterEnd; t++)
+                {
+                    T v0 = vertices[indices[3 * t]], v1 = vertices[indices[3 * t + 1]], v2 = vertices[indices[3 * t + 2]];
+                    Float3 p0 = getPosition(v0), p1 = getPosition(v1), p2 = getPosition(v2);
+                    float triangleArea = 0.5f * (p1 - p0).Cross(p2 - p0).Length;
+                    center += (p0 + p1 + p2) * (triangleArea / 3.0f);
+                    normal += getNormal(v0) + getNormal(v1) + getNormal(v2);
+                    area += triangleArea;
+                }
+
+                meshCenter += center;
+                meshArea += area;
+                clusterCenters[c] = area > 0 ? center / area : getPosition(vertices[indices[3 * clusterStarts[c]]]);
+                clusterNormals[c] = normal.LengthSquared > 0 ? normal.Normal() : Float3.Zero;
+            }
+
+            if (meshArea > 0)
+                meshCenter /= meshArea;
+
+            // sort clusters from the most exposed, drawn first
+            float[] sortKeys = new float[clusterCount];
+            int[] sortedClusters = new int[clusterCount];
+            for (int c = 0; c < clusterCount; c++)
+            {
+                sortKeys[c] = -(clusterCenters[c] - meshCenter).Dot(clusterNormals[c]);
+                sortedClusters[c] = c;
+            }
+            Array.Sort(sortKeys, sortedClusters);
+
+            uint[] result = new uint[indices.Length];
+            int outCount = 0;
+            foreach (int c in sortedClusters)
+            {
+                int clusterStartIndex = 3 * clusterStarts[c];
+                int clusterIndexCount = 3 * (c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount) - clusterStartIndex;
+                Array.Copy(indices, clusterStartIndex, result, outCount, clusterIndexCount);
+                outCount += clusterIndexCount;
+            }
+
+            return result;
+        }
+
+        #endregion
+
+        #region Vertices
+
+        /// <summary>
+        /// Change all the indices that reference identical vertices to reference the first of them.
+        /// Duplicated vertices are left unreferenced, and can be removed with OptimizeVertexFetch(). Returns the number of unique vertices.
+        /// </summary>
+        public static int WeldVertices<T>(T[] vertices, uint[] indices) where T : IEquatable<T>
+        {
+            Dictionary<T, uint> uniqueVertices = new Dictionary<T, uint>(vertices.Length);
+            uint[] remap = new uint[vertices.Length];
+            for (uint v = 0; v < vertices.Length; v++)
+            {
+                uint firstVertex;
+                if (!uniqueVertices.TryGetValue(vertices[v], out firstVertex))
+                {
+                    firstVertex = v;
+                    uniqueVertices.Add(vertices[v], v);
+                }
+                remap[v] = firstVertex;
+            }
+
+            for (int i = 0; i < indices.Length; i++)
+                indices[i] = remap[indices[i]];
+
+            return uniqueVertices.Count;
+        }
+
+        /// <summary>
+        /// Reorder the vertices as they are first referenced by the indices, so that vertex fetches are as sequential as possible.
+        /// Unreferenced vertices are removed. Indices are updated in place, and the reordered vertices are returned.
+        /// </summary>
+        public static T[] OptimizeVertexFetch<T>(T[] vertices, uint[] indices)
+        {
+            uint[] remap = new uint[vertices.Length];
+            for (int v = 0; v < remap.Length; v++)
+                remap[v] = uint.MaxValue;
+
+            uint nextVertex = 0;
+            for (int i = 0; i < indices.Length; i++)
+            {
+                uint v = indices[i];
+                if (remap[v] == uint.MaxValue)
+                    remap[v] = nextVertex++;
+                indices[i] = remap[v];
+            }
+
+            T[] result = new T[nextVertex];
+            for (int v = 0; v < vertices.Length; v++)
+            {
+                if (remap[v] != uint.MaxValue)
+                    result[remap[v]] = vertices[v];
+            }
+
+            return result;
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,341 @@
+﻿using System;
+using System.Numerics;
+
+namespace Dragonfly.Graphics.Math
+{
+    /// <summary>
+    /// A low resolution depth buffer where occluder triangles are rasterized on the CPU, used to test whether bounding boxes are hidden behind them.
+    /// Occluder triangles cover the pixels whose center is inside them, so that the triangles of a mesh leave no gaps, and store the farthest depth that they can have inside each pixel.
+    /// Boxes are then tested against a hierarchical pyramid of the farthest depths, reading only a few texels for each box.
+    /// Since pixels on the edges of an occluder may be only partially covered, box tests also require the pixels around the box to be covered.
+    /// Depth is reversed as in the camera matrices: 1 on the near plane, and 0 on the far plane and where no occluders have been rasterized.
+    /// </summary>
+    public class OcclusionBuffer
+    {
+        private const float GUARD_BAND = 2.0f; // clipping distance from the screen center in ndc units, which keeps the screen coordinates small
+        private const int MAX_TEST_TEXELS = 4; // maximum number of texels read on each axis for a box test
+        private const int WIDTH_ALIGNMENT = 16; // rows can be processed with any vector size
+        private const float EDGE_TOLERANCE = 1e-3f; // in pixels, avoids gaps between triangles due to rounding
+
+        private static readonly Float4[] clipPlanes = new Float4[]
+        {
+            new Float4(0, 0, -1.0f, 1.0f), // near
+            new Float4(1.0f, 0, 0, GUARD_BAND), // left
+            new Float4(-1.0f, 0, 0, GUARD_BAND), // right
+            new Float4(0, 1.0f, 0, GUARD_BAND), // bottom
+            new Float4(0, -1.0f, 0, GUARD_BAND) // top
+        };
+
+        private float[][] mips; // the rasterized depth, followed by its farthest-depth pyramid
+        private int[] mipWidths, mipHeights;
+        private Float4x4 cameraMatrix;
+        private Float3 cameraPos;
+        private float[] laneOffsets;
+        private Float4[] clipVerts, clipTemp;
+        private Float3[] screenVerts;
+
+        /// <param name="width">Horizontal resolution, rounded up to a multiple of 16.</param>
+        /// <param name="height">Vertical resolution.</param>
+        public OcclusionBuffer(int width, int height)
+        {
+            if (width <= 0 || height <= 0)
+                throw new ArgumentException("The occlusion buffer size must be positive.");
+
+            Width = (width + WIDTH_ALIGNMENT - 1) / WIDTH_ALIGNMENT * WIDTH_ALIGNMENT;
+            Height = height;
+
+            // allocate the pyramid down to a single texel
+            int levelCount = 1;
+            for (int size = System.Math.Max(Width, Height); size > 1; size = (size + 1) / 2)
+                levelCount++;
+            mips = new float[levelCount][];
+            mipWidths = new int[levelCount];
+            mipHeights = new int[levelCount];
+            for (int i = 0, w = Width, h = Height; i < levelCount; i++, w = (w + 1) / 2, h = (h + 1) / 2)
+            {
+                mipWidths[i] = w;
+                mipHeights[i] = h;
+                mips[i] = new float[w * h];
+            }
+
+            laneOffsets = new float[Vector<float>.Count];
+            for (int i = 0; i < laneOffsets.Length; i++)
+                laneOffsets[i] = i;
+            clipVerts = new Float4[16];
+            clipTemp = new Float4[16];
+            screenVerts = new Float3[16];
+        }
+
+        public int Width { get; private set; }
+
+        public int Height { get; private set; }
+
+        /// <summary>
+        /// Number of levels of the depth pyramid, including the full resolution one.
+        /// </summary>
+        public int LevelCount => mips.Length;
+
+        /// <summary>
+        /// Number of triangles rasterized since the last call to Begin(), after clipping.
+        /// </summary>
+        public int RasterizedCount { get; private set; }
+
+        /// <summary>
+        /// Clear the buffer, and start adding the occluders seen from the specified camera.
+        /// </summary>
+        /// <param name="cameraMatrix">The view-projection matrix of the camera.</param>
+        /// <param name="cameraPos">The camera position, in the same coordinates of the occluders and boxes.</param>
+        public void Begin(Float4x4 cameraMatrix, Float3 cameraPos)
+        {
+            this.cameraMatrix = cameraMatrix;
+            this.cameraPos = cameraPos;
+            Array.Clear(mips[0], 0, mips[0].Length);
+            RasterizedCount = 0;
+        }
+
+        /// <summary>
+        /// Rasterize an occluder triangle. Only the front face is rasterized, which is the one pointed by the normal cross(v1 - v0, v2 - v0).
+        /// </summary>
+        public void AddTriangle(Float3 v0, Float3 v1, Float3 v2)
+        {
+            // back-face culling
+            if ((v1 - v0).Cross(v2 - v0).Dot(cameraPos - v0) <= 0)
+                return;
+
+            clipVerts[0] = v0.ToFloat4(1.0f) * cameraMatrix;
+            clipVerts[1] = v1.ToFloat4(1.0f) * cameraMatrix;
+            clipVerts[2] = v2.ToFloat4(1.0f) * cameraMatrix;
+
+            // skip triangles fully outside the screen
+            if ((GetOutCode(clipVerts[0]) & GetOutCode(clipVerts[1]) & GetOutCode(clipVerts[2])) != 0)
+                return;
+
+            // clip to the near plane and to the guard band
+            int count = 3;
+            for (int i = 0; i < clipPlanes.Length && count >= 3; i++)
+            {
+                count = ClipPolygon(clipVerts, count, clipPlanes[i], clipTemp);
+                Float4[] swap = clipVerts;
+                clipVerts = clipTemp;
+                clipTemp = swap;
+            }
+            if (count < 3)
+                return;
+
+            // map to screen coordinates and depth
+            for (int i = 0; i < count; i++)
+            {
+                Float4 p = clipVerts[i];
+                float invW = 1.0f / p.W;
+                screenVerts[i] = new Float3((p.X * invW * 0.5f + 0.5f) * Width, (0.5f - p.Y * invW * 0.5f) * Height, p.Z * invW);
+            }
+
+            // rasterize the clipped polygon as a triangle fan
+            for (int i = 1; i < count - 1; i++)
+                RasterizeTriangle(screenVerts[0], screenVerts[i], screenVerts[i + 1]);
+        }
+
+        /// <summary>
+        /// Rasterize a planar occluder quad, whose front face is the one pointed by the normal cross(v1 - v0, v2 - v0).
+        /// </summary>
+        public void AddQuad(Float3 v0, Float3 v1, Float3 v2, Float3 v3)
+        {
+            AddTriangle(v0, v1, v2);
+            AddTriangle(v0, v2, v3);
+        }
+
+        /// <summary>
+        /// Build the depth pyramid, must be called after all the occluders have been added and before testing any box.
+        /// Each texel stores the farthest depth of the texels that it covers in the previous level.
+        /// </summary>
+        public void BuildHiZ()
+        {
+            for (int level = 1; level < mips.Length; level++)
+            {
+                float[] src = mips[level - 1], dest = mips[level];
+                int srcWidth = mipWidths[level - 1], srcHeight = mipHeights[level - 1], destWidth = mipWidths[level];
+                for (int y = 0; y < mipHeights[level]; y++)
+                {
+                    int row0 = 2 * y * srcWidth, row1 = System.Math.Min(2 * y + 1, srcHeight - 1) * srcWidth;
+                    for (int x = 0; x < destWidth; x++)
+                    {
+                        int x0 = 2 * x, x1 = System.Math.Min(2 * x + 1, srcWidth - 1);
+                        float d = System.Math.Min(System.Math.Min(src[row0 + x0], src[row0 + x1]), System.Math.Min(src[row1 + x0], src[row1 + x1]));
+                        dest[y * destWidth + x] = d;
+                    }
+                }
+            }
+        }
+
+        /// <summary>
+        /// Returns true if the specified box is completely hidden by the rasterized occluders, which must cover both its screen rect and the pixels around it.
+        /// Boxes that cross the near plane or lie outside the screen are never occluded. Can be called concurrently once the pyramid has been built.
+        /// </summary>
+        public bool IsOccluded(AABox box)
+        {
+            // project the box corners, and find their screen rect and nearest depth
+            float minX = float.MaxValue, minY = float.MaxValue, maxX = float.MinValue, maxY = float.MinValue, nearestDepth = 0;
+            for (int i = 0; i < 8; i++)
+            {
+                Float3 corner = new Float3((i & 1) == 0 ? box.Min.X : box.Max.X, (i & 2) == 0 ? box.Min.Y : box.Max.Y, (i & 4) == 0 ? box.Min.Z : box.Max.Z);
+                Float4 p = corner.ToFloat4(1.0f) * cameraMatrix;
+                if (p.W <= 0 || p.Z > p.W)
+                    return false; // crossing the near plane
+
+                float invW = 1.0f / p.W;
+                float sx = p.X * invW, sy = p.Y * invW;
+                minX = System.Math.Min(minX, sx);
+                maxX = System.Math.Max(maxX, sx);
+                minY = System.Math.Min(minY, sy);
+                maxY = System.Math.Max(maxY, sy);
+                nearestDepth = System.Math.Max(nearestDepth, p.Z * invW);
+            }
+
+            // touched pixels, extended by one pixel on each side
+            if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f)
+                return false;
+            int x0 = System.Math.Max(0, (int)System.Math.Floor((minX * 0.5f + 0.5f) * Width) - 1);
+            int x1 = System.Math.Min(Width - 1, (int)((maxX * 0.5f + 0.5f) * Width) + 1);
+            int y0 = System.Math.Max(0, (int)System.Math.Floor((0.5f - maxY * 0.5f) * Height) - 1);
+            int y1 = System.Math.Min(Height - 1, (int)((0.5f - minY * 0.5f) * Height) + 1);
+
+            // select the level where the rect covers a few texels
+            int level = 0;
+            while (level < mips.Length - 1 && ((x1 >> level) - (x0 >> level) >= MAX_TEST_TEXELS || (y1 >> level) - (y0 >> level) >= MAX_TEST_TEXELS))
+                level++;
+
+            // the box is hidden only if all the occluders in its rect are nearer
+            float[] depth = mips[level];
+            int levelWidth = mipWidths[level];
+            for (int y = y0 >> level; y <= (y1 >> level); y++)
+            {
+                for (int x = x0 >> level; x <= (x1 >> level); x++)
+                {
+                    if (depth[y * levelWidth + x] <= nearestDepth)
+                        return false;
+                }
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Returns the depth stored in a texel of the specified level of the pyramid.
+        /// </summary>
+        public float GetDepth(int x, int y, int level = 0)
+        {
+            return mips[level][y * mipWidths[level] + x];
+        }
+
+        private static int GetOutCode(Float4 p)
+        {
+            int code = 0;
+            if (p.X < -p.W) code |= 1;
+            if (p.X > p.W) code |= 2;
+            if (p.Y < -p.W) code |= 4;
+            if (p.Y > p.W) code |= 8;
+            if (p.Z > p.W) code |= 16;
+            if (p.Z < 0) code |= 32;
+            return code;
+        }
+
+        /// <summary>
+        /// Clip a convex polygon to the positive side of a plane, returning the number of vertices written to the destination array.
+        /// </summary>
+        private static int ClipPolygon(Float4[] src, int count, Float4 plane, Float4[] dest)
+        {
+            int destCount = 0;
+            Float4 prev = src[count - 1];
+            float prevDist = prev.Dot(plane);
+            for (int i = 0; i < count; i++)
+            {
+                Float4 cur = src[i];
+                float curDist = cur.Dot(plane);
+                if ((curDist >= 0) != (prevDist >= 0))
+                    dest[destCount++] = prev.Lerp(cur, prevDist / (prevDist - curDist)); // edge crossing the plane
+                if (curDist >= 0)
+                    dest[destCount++] = cur;
+                prev = cur;
+                prevDist = curDist;
+            }
+            return destCount;
+        }
+
+        private void RasterizeTriangle(Float3 a, Float3 b, Float3 c)
+        {
+            double area = ((double)b.X - a.X) * ((double)c.Y - a.Y) - ((double)c.X - a.X) * ((double)b.Y - a.Y);
+            if (area < 0)
+            {
+                // make the winding counter-clockwise on screen
+                Float3 swap = b;
+                b = c;
+                c = swap;
+                area = -area;
+            }
+            if (area <= 0)
+                return; // degenerate
+
+            // bounding rect of the pixel centers
+            int minX = System.Math.Max(0, (int)System.Math.Ceiling(System.Math.Min(a.X, System.Math.Min(b.X, c.X)) - 0.5f));
+            int maxX = System.Math.Min(Width - 1, (int)System.Math.Floor(System.Math.Max(a.X, System.Math.Max(b.X, c.X)) - 0.5f));
+            int minY = System.Math.Max(0, (int)System.Math.Ceiling(System.Math.Min(a.Y, System.Math.Min(b.Y, c.Y)) - 0.5f));
+            int maxY = System.Math.Min(Height - 1, (int)System.Math.Floor(System.Math.Max(a.Y, System.Math.Max(b.Y, c.Y)) - 0.5f));
+            if (minX > maxX || minY > maxY)
+                return;
+            RasterizedCount++;
+
+            // edge functions, positive inside, evaluated relative to the first pixel center
+            double originX = minX + 0.5, originY = minY + 0.5;
+            float e0A, e0B, e0C, e1A, e1B, e1C, e2A, e2B, e2C;
+            GetEdgeFunction(a, b, originX, originY, out e0A, out e0B, out e0C);
+            GetEdgeFunction(b, c, originX, originY, out e1A, out e1B, out e1C);
+            GetEdgeFunction(c, a, originX, originY, out e2A, out e2B, out e2C);
+
+            // depth plane, offset to the farthest depth inside each pixel
+            double dzdx = (((double)b.Z - a.Z) * ((double)c.Y - a.Y) - ((double)c.Z - a.Z) * ((double)b.Y - a.Y)) / area;
+            double dzdy = (((double)c.Z - a.Z) * ((double)b.X - a.X) - ((double)b.Z - a.Z) * ((double)c.X - a.X)) / area;
+            float zOrigin = (float)(a.Z + dzdx * (originX - a.X) + dzdy * (originY - a.Y) - 0.5 * (System.Math.Abs(dzdx) + System.Math.Abs(dzdy)));
+            float zMin = System.Math.Min(a.Z, System.Math.Min(b.Z, c.Z));
+            float zdx = (float)dzdx, zdy = (float)dzdy;
+
+            // process each row in vectors of pixels
+            float[] depth = mips[0];
+            int vecWidth = Vector<float>.Count;
+            int startX = minX - minX % vecWidth;
+            Vector<float> lanes = new Vector<float>(laneOffsets), zero = Vector<float>.Zero, zMinVec = new Vector<float>(zMin);
+            Vector<float> e0AVec = new Vector<float>(e0A), e1AVec = new Vector<float>(e1A), e2AVec = new Vector<float>(e2A), zdxVec = new Vector<float>(zdx);
+            for (int y = minY; y <= maxY; y++)
+            {
+                float dy = y - minY;
+                Vector<float> e0Row = new Vector<float>(e0C + e0B * dy), e1Row = new Vector<float>(e1C + e1B * dy), e2Row = new Vector<float>(e2C + e2B * dy);
+                Vector<float> zRow = new Vector<float>(zOrigin + zdy * dy);
+                int rowStart = y * Width;
+                for (int x = startX; x <= maxX; x += vecWidth)
+                {
+                    Vector<float> dx = lanes + new Vector<float>(x - minX);
+                    Vector<int> covered = Vector.GreaterThanOrEqual(dx * e0AVec + e0Row, zero)
+                        & Vector.GreaterThanOrEqual(dx * e1AVec + e1Row, zero)
+                        & Vector.GreaterThanOrEqual(dx * e2AVec + e2Row, zero);
+                    if (Vector.EqualsAll(covered, Vector<int>.Zero))
+                        continue;
+
+                    Vector<float> z = Vector.Max(dx * zdxVec + zRow, zMinVec);
+                    Vector<float> prevZ = new Vector<float>(depth, rowStart + x);
+                    Vector.ConditionalSelect(covered, Vector.Max(prevZ, z), prevZ).CopyTo(depth, rowStart + x);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Returns the coefficients of the edge function from p0 to p1, relative to the specified origin.
+        /// </summary>
+        private static void GetEdgeFunction(Float3 p0, Float3 p1, double originX, double originY, out float a, out float b, out float c)
+        {
+            double ea = (double)p0.Y - p1.Y, eb = (double)p1.X - p0.X;
+            double ec = ea * (originX - p0.X) + eb * (originY - p0.Y);
+            a = (float)ea;
+            b = (float)eb;
+            c = (float)(ec + EDGE_TOLERANCE * (System.Math.Abs(ea) + System.Math.Abs(eb)));
+        }
+    }
+}
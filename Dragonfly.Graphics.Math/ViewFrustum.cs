@@ -1,61 +1,67 @@
 ﻿using System;
+using System.Numerics;
+using System.Runtime.CompilerServices;
 
 namespace Dragonfly.Graphics.Math
 {
-    public struct ViewFrustum : IVolume
+    public struct ViewFrustum : IVolume, IBatchVolume
     {
-        private Float4x4 cameraMatrix;
+        // planes are extracted once from the camera matrix columns
+        private Float4 leftPlane, rightPlane, topPlane, bottomPlane, nearPlane, farPlane;
 
         public ViewFrustum(Float4x4 cameraMatrix)
         {
-            this.cameraMatrix = cameraMatrix;
+            Float4 c0 = cameraMatrix.GetColumn(0), c1 = cameraMatrix.GetColumn(1), c2 = cameraMatrix.GetColumn(2), c3 = cameraMatrix.GetColumn(3);
+            leftPlane = c3 + c0;
+            rightPlane = c3 - c0;
+            topPlane = c3 - c1;
+            bottomPlane = c3 + c1;
+            nearPlane = c3 - c2;
+            farPlane = c2;
         }
 
         public Float4 LeftPlane
         {
-            get { return cameraMatrix.GetColumn(3) + cameraMatrix.GetColumn(0); }
+            get { return leftPlane; }
         }
 
         public Float4 RightPlane
         {
-            get { return cameraMatrix.GetColumn(3) - cameraMatrix.GetColumn(0); }
+            get { return rightPlane; }
         }
 
         public Float4 TopPlane
         {
-            get { return cameraMatrix.GetColumn(3) - cameraMatrix.GetColumn(1); }
+            get { return topPlane; }
         }
 
         public Float4 BottomPlane
         {
-            get { return cameraMatrix.GetColumn(3) + cameraMatrix.GetColumn(1); }
+            get { return bottomPlane; }
         }
         public Float4 NearPlane
         {
-            get { return cameraMatrix.GetColumn(3) - cameraMatrix.GetColumn(2); }
+            get { return nearPlane; }
         }
 
         public Float4 FarPlane
         {
-            get { return cameraMatrix.GetColumn(2); }
+            get { return farPlane; }
         }
 
         public void GetPlanes(out Float4 leftPlane, out Float4 rightPlane, out Float4 topPlane, out Float4 bottomPlane, out Float4 nearPlane, out Float4 farPlane)
         {
-            Float4 c0 = cameraMatrix.GetColumn(0), c1 = cameraMatrix.GetColumn(1), c2 = cameraMatrix.GetColumn(2), c3 = cameraMatrix.GetColumn(3);
-            leftPlane = c3 + c0;
-            rightPlane = c3 - c0;
-            topPlane = c3 - c1;
-            bottomPlane = c3 + c1;
-            nearPlane = c3 - c2;
-            farPlane = c2;
+            leftPlane = this.leftPlane;
+            rightPlane = this.rightPlane;
+            topPlane = this.topPlane;
+            bottomPlane = this.bottomPlane;
+            nearPlane = this.nearPlane;
+            farPlane = this.farPlane;
         }
 
         public bool Contains(Float3 point)
         {
             Float4 hPoint = point.ToFloat4(1.0f);
-            Float4 leftPlane, rightPlane, topPlane, bottomPlane, nearPlane, farPlane;
-            GetPlanes(out leftPlane, out rightPlane, out topPlane, out bottomPlane, out nearPlane, out farPlane);
 
             if (leftPlane.Dot(hPoint) < 0) return false;
             if (rightPlane.Dot(hPoint) < 0) return false;
@@ -69,8 +75,6 @@ namespace Dragonfly.Graphics.Math
         public bool Contains(Sphere s)
         {
             Float4 hCenter = s.Center.ToFloat4(1.0f);
-            Float4 leftPlane, rightPlane, topPlane, bottomPlane, nearPlane, farPlane;
-            GetPlanes(out leftPlane, out rightPlane, out topPlane, out bottomPlane, out nearPlane, out farPlane);
 
             if (leftPlane.Dot(hCenter) < s.Radius) return false;
             if (rightPlane.Dot(hCenter) < s.Radius) return false;
@@ -94,9 +98,6 @@ namespace Dragonfly.Graphics.Math
 
         public bool Contains(AABox b)
         {
-            Float4 leftPlane, rightPlane, topPlane, bottomPlane, nearPlane, farPlane;
-            GetPlanes(out leftPlane, out rightPlane, out topPlane, out bottomPlane, out nearPlane, out farPlane);
-
             if (!IsBoxInsidePlane(b, leftPlane)) return false;
             if (!IsBoxInsidePlane(b, rightPlane)) return false;
             if (!IsBoxInsidePlane(b, topPlane)) return false;
@@ -110,8 +111,6 @@ namespace Dragonfly.Graphics.Math
         public bool Intersects(Sphere s)
         {
             Float4 hCenter = s.Center.ToFloat4(1.0f);
-            Float4 leftPlane, rightPlane, topPlane, bottomPlane, nearPlane, farPlane;
-            GetPlanes(out leftPlane, out rightPlane, out topPlane, out bottomPlane, out nearPlane, out farPlane);
 
             if (leftPlane.Dot(hCenter) < -s.Radius) return false;
             if (rightPlane.Dot(hCenter) < -s.Radius) return false;
@@ -135,9 +134,6 @@ namespace Dragonfly.Graphics.Math
 
         public bool Intersects(AABox b)
         {
-            Float4 leftPlane, rightPlane, topPlane, bottomPlane, nearPlane, farPlane;
-            GetPlanes(out leftPlane, out rightPlane, out topPlane, out bottomPlane, out nearPlane, out farPlane);
-
             if (IsBoxOutsidePlane(b, leftPlane)) return false;
             if (IsBoxOutsidePlane(b, rightPlane)) return false;
             if (IsBoxOutsidePlane(b, topPlane)) return false;
@@ -148,6 +144,75 @@ namespace Dragonfly.Graphics.Math
             return true;
         }
 
+        #region Batch tests
+
+        /// <summary>
+        /// Test all the specified boxes for intersection with this frustum, setting the bits of the visible ones in the result mask.
+        /// </summary>
+        public void Intersects(AABoxArray boxes, ulong[] resultMask)
+        {
+            TestBoxes(boxes, resultMask, false);
+        }
+
+        /// <summary>
+        /// Test if each of the specified boxes is fully inside this frustum, setting the bits of the contained ones in the result mask.
+        /// </summary>
+        public void Contains(AABoxArray boxes, ulong[] resultMask)
+        {
+            TestBoxes(boxes, resultMask, true);
+        }
+
+        private void TestBoxes(AABoxArray boxes, ulong[] resultMask, bool containment)
+        {
+            int count = boxes.Count;
+            Array.Clear(resultMask, 0, AABoxArray.GetMaskLength(count));
+
+            // test a vector of boxes against each plane, using the corner that is closest (intersection) or farthest (containment) along the plane normal
+            int width = Vector<float>.Count;
+            int vecEnd = Vector.IsHardwareAccelerated ? count - count % width : 0;
+            for (int i = 0; i < vecEnd; i += width)
+            {
+                Vector<int> failed = Vector<int>.Zero;
+                failed |= TestPlane(leftPlane, boxes, i, containment);
+                failed |= TestPlane(rightPlane, boxes, i, containment);
+                failed |= TestPlane(topPlane, boxes, i, containment);
+                failed |= TestPlane(bottomPlane, boxes, i, containment);
+                failed |= TestPlane(nearPlane, boxes, i, containment);
+                failed |= TestPlane(farPlane, boxes, i, containment);
+
+                if (Vector.EqualsAll(failed, Vector<int>.Zero))
+                {
+                    // all passed (the vector width divides 64, so its bits are in the same element)
+                    resultMask[i >> 6] |= ((1UL << width) - 1) << (i & 63);
+                    continue;
+                }
+
+                for (int k = 0; k < width; k++)
+                    if (failed[k] == 0)
+                        resultMask[(i + k) >> 6] |= 1UL << ((i + k) & 63);
+            }
+
+            for (int i = vecEnd; i < count; i++)
+            {
+                if (containment ? Contains(boxes[i]) : Intersects(boxes[i]))
+                    resultMask[i >> 6] |= 1UL << (i & 63);
+            }
+        }
+
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        private static Vector<int> TestPlane(Float4 plane, AABoxArray boxes, int i, bool farthestCorner)
+        {
+            // the corner coordinates are selected once for all the boxes, based on the plane normal signs
+            bool useMaxX = (plane.X > 0) != farthestCorner, useMaxY = (plane.Y > 0) != farthestCorner, useMaxZ = (plane.Z > 0) != farthestCorner;
+            Vector<float> x = new Vector<float>(useMaxX ? boxes.MaxX : boxes.MinX, i);
+            Vector<float> y = new Vector<float>(useMaxY ? boxes.MaxY : boxes.MinY, i);
+            Vector<float> z = new Vector<float>(useMaxZ ? boxes.MaxZ : boxes.MinZ, i);
+            Vector<float> dist = x * plane.X + y * plane.Y + z * plane.Z + new Vector<float>(plane.W);
+            return Vector.LessThan(dist, Vector<float>.Zero);
+        }
+
+        #endregion
+
         public float Depth
         {
             get
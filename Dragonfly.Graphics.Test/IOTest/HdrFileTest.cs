@@ -0,0 +1,96 @@
+﻿using Dragonfly.BaseModule;
+using Dragonfly.Utils;
+using System;
+using System.IO;
+using System.Text;
+
+namespace Dragonfly.Graphics.Test
+{
+    /// <summary>
+    /// Decode an uncompressed hdr image from memory, save it with the parallel run-length encoder and decode it again,
+    /// checking that the pixels are preserved and that the runs and dumps of each scanline have been compressed.
+    /// </summary>
+    public class HdrFileTest : IConsoleProgram
+    {
+        private const int WIDTH = 300, HEIGHT = 70; // the last scanline block is only partially filled
+        private const int SEGMENT_WIDTH = 32; // pixels of each alternating run or noise segment
+
+        private bool failed;
+
+        public string ProgramName => "Hdr file round-trip test.";
+
+        public void RunProgram()
+        {
+            failed = false;
+
+            // uncompressed file, whose scanlines alternate constant segments (encoded as runs) and noise (encoded as dumps)
+            byte[] header = Encoding.ASCII.GetBytes(string.Format("#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y {0} +X {1}\n", HEIGHT, WIDTH));
+            byte[] rgbe = new byte[WIDTH * HEIGHT * 4];
+            Random rnd = new Random(1);
+            for (int y = 0; y < HEIGHT; y++)
+                for (int x = 0; x < WIDTH; x++)
+                    for (int c = 0; c < 4; c++)
+                    {
+                        bool noise = (x / SEGMENT_WIDTH) % 2 == 1;
+                        rgbe[(y * WIDTH + x) * 4 + c] = noise ? (byte)rnd.Next(256) : (byte)((y * 7 + c * 31 + x / SEGMENT_WIDTH) % 250 + 5); // never starts with a run-length marker
+                    }
+            byte[] fileBytes = new byte[header.Length + rgbe.Length];
+            header.CopyTo(fileBytes, 0);
+            rgbe.CopyTo(fileBytes, header.Length);
+
+            HdrFile source = new HdrFile(fileBytes);
+            if (source.IsCompressed || source.Header.Width != WIDTH || source.Header.Height != HEIGHT)
+                Fail("wrong uncompressed image header");
+            float[] sourceHdr = new float[WIDTH * HEIGHT * 3];
+            source.CopyHdrDataTo(sourceHdr);
+
+            string filePath = Path.GetTempFileName();
+            try
+            {
+                source.Save(filePath);
+                byte[] encodedBytes = File.ReadAllBytes(filePath);
+                Console.WriteLine("Encoded {0} KB to {1} KB.", fileBytes.Length / 1024, encodedBytes.Length / 1024);
+                if (encodedBytes.Length >= fileBytes.Length)
+                    Fail("the image has not been compressed");
+
+                HdrFile decoded = new HdrFile(encodedBytes);
+                if (!decoded.IsCompressed || decoded.Header.Width != WIDTH || decoded.Header.Height != HEIGHT)
+                {
+                    Fail("wrong compressed image header");
+                    return;
+                }
+
+                byte[] decodedRgbe = new byte[rgbe.Length];
+                decoded.CopyRGBEDataTo(decodedRgbe);
+                for (int i = 0; i < rgbe.Length; i++)
+                    if (decodedRgbe[i] != rgbe[i])
+                    {
+                        Fail(string.Format("wrong RGBE value at pixel {0}, {1}", i / 4 % WIDTH, i / 4 / WIDTH));
+                        break;
+                    }
+
+                float[] decodedHdr = new float[sourceHdr.Length];
+                decoded.CopyHdrDataTo(decodedHdr);
+                for (int i = 0; i < sourceHdr.Length; i++)
+                    if (decodedHdr[i] != sourceHdr[i])
+                    {
+                        Fail("wrong hdr value " + i);
+                        break;
+                    }
+            }
+            finally
+            {
+                File.Delete(filePath);
+            }
+
+            if (!failed)
+                Console.WriteLine("Test passed.");
+        }
+
+        private void Fail(string message)
+        {
+            failed = true;
+            Console.WriteLine("Test failed: " + message);
+        }
+    }
+}
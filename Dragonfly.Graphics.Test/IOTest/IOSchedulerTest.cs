@@ -0,0 +1,195 @@
+﻿using Dragonfly.Utils;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Threading;
+
+namespace Dragonfly.Graphics.Test
+{
+    /// <summary>
+    /// Queue reads to a single-threaded I/O scheduler while its thread is busy, checking that they are served by priority, that cancelled reads are never delivered, and that failures are reported.
+    /// Ranged reads of the same file are also checked to be batched in offset order, truncated at the end of the file and stored to pooled buffers.
+    /// </summary>
+    public class IOSchedulerTest : IConsoleProgram, ILoadedFileHandler, IRangeReadHandler
+    {
+        private const int REQUEST_COUNT = 12;
+        private const int THROWING_REQUEST_ID = 100;
+        private const int RANGE_FILE_SIZE = 10000;
+        private const int RANGE_LENGTH = 1000;
+
+        private ManualResetEvent blockingReadStarted, releaseBlockingRead;
+        private List<int> completionOrder;
+        private List<int> failedRequests;
+        private List<byte[]> rangeBuffers;
+        private byte[] rangeFileContent;
+        private bool failed;
+
+        public string ProgramName => "I/O scheduler test.";
+
+        public void RunProgram()
+        {
+            blockingReadStarted = new ManualResetEvent(false);
+            releaseBlockingRead = new ManualResetEvent(false);
+            completionOrder = new List<int>();
+            failedRequests = new List<int>();
+            rangeBuffers = new List<byte[]>();
+            failed = false;
+
+            TestFileReads();
+            TestRangeReads();
+
+            if (!failed)
+                Console.WriteLine("Test passed.");
+        }
+
+        private void TestFileReads()
+        {
+            string filePath = Path.GetTempFileName();
+            File.WriteAllBytes(filePath, new byte[] { 1, 2, 3, 4 });
+
+            try
+            {
+                IOScheduler scheduler = new IOScheduler(1);
+
+                // keep the only I/O thread busy while the other requests are queued
+                scheduler.RequestFile(-1, filePath, this, true, IOPriority.Visible);
+                blockingReadStarted.WaitOne();
+
+                IORequest[] requests = new IORequest[REQUEST_COUNT];
+                for (int i = 0; i < REQUEST_COUNT; i++)
+                    requests[i] = scheduler.RequestFile(i, filePath, this, true, (IOPriority)(i % 3));
+                IORequest missingFile = scheduler.RequestFile(REQUEST_COUNT, filePath + ".missing", this, true, IOPriority.Visible);
+                IORequest throwingHandler = scheduler.RequestFile(THROWING_REQUEST_ID, filePath, this, true, IOPriority.Visible);
+
+                // 4 should be read with the visible requests, 2 and 7 never
+                scheduler.SetPriority(requests[4], IOPriority.Visible);
+                if (!scheduler.Cancel(requests[2]) || !scheduler.Cancel(requests[7]))
+                    Fail("queued requests cannot be cancelled");
+
+                releaseBlockingRead.Set();
+                while (!scheduler.Idle)
+                    Thread.Sleep(1);
+
+                int[] expectedOrder = new int[] { 0, 3, 6, 9, 4, 1, 10, 5, 8, 11 };
+                Console.WriteLine("Completion order: " + string.Join(", ", completionOrder));
+                if (string.Join(",", completionOrder) != string.Join(",", expectedOrder))
+                    Fail("requests have not been served by priority");
+                if (requests[2].State != IORequestState.Cancelled || requests[7].State != IORequestState.Cancelled)
+                    Fail("cancelled requests have been read");
+                if (missingFile.State != IORequestState.Failed || missingFile.Error == null || failedRequests.Count != 1 || failedRequests[0] != REQUEST_COUNT)
+                    Fail("the failed read has not been reported to the handler");
+                if (throwingHandler.State != IORequestState.Failed || !(throwingHandler.Error is InvalidOperationException))
+                    Fail("the exception thrown by the handler has not been stored to the request");
+                if (scheduler.Cancel(requests[0]))
+                    Fail("a completed request has been cancelled");
+            }
+            finally
+            {
+                File.Delete(filePath);
+            }
+        }
+
+        private void TestRangeReads()
+        {
+            blockingReadStarted.Reset();
+            releaseBlockingRead.Reset();
+            completionOrder.Clear();
+            failedRequests.Clear();
+
+            string filePath = Path.GetTempFileName();
+            rangeFileContent = new byte[RANGE_FILE_SIZE];
+            for (int i = 0; i < rangeFileContent.Length; i++)
+                rangeFileContent[i] = (byte)(i % 251);
+            File.WriteAllBytes(filePath, rangeFileContent);
+
+            try
+            {
+                IOScheduler scheduler = new IOScheduler(1);
+                scheduler.RequestFile(-1, filePath, this, true, IOPriority.Visible);
+                blockingReadStarted.WaitOne();
+
+                // ranges queued out of order with different priorities, the last one exceeds the end of the file
+                long[] offsets = new long[] { 5000, 100, 9500, 2000 };
+                for (int i = 0; i < offsets.Length; i++)
+                    scheduler.RequestRange(i, filePath, offsets[i], RANGE_LENGTH, this, (IOPriority)(i % 3));
+                IORequest cancelledRange = scheduler.RequestRange(offsets.Length, filePath, 0, RANGE_LENGTH, this, IOPriority.Prefetch);
+                IORequest missingRange = scheduler.RequestRange(THROWING_REQUEST_ID, filePath + ".missing", 0, RANGE_LENGTH, this, IOPriority.Visible);
+                scheduler.Cancel(cancelledRange);
+
+                releaseBlockingRead.Set();
+                while (!scheduler.Idle)
+                    Thread.Sleep(1);
+
+                Console.WriteLine("Range completion order: " + string.Join(", ", completionOrder));
+                if (string.Join(",", completionOrder) != "1,3,0,2")
+                    Fail("the ranges of the same file have not been read together in offset order");
+                if (rangeBuffers.Count != offsets.Length || rangeBuffers.Exists(b => b != rangeBuffers[0]))
+                    Fail("the ranges have not been stored to a pooled buffer");
+                if (cancelledRange.State != IORequestState.Cancelled)
+                    Fail("a cancelled range has been read");
+                if (missingRange.State != IORequestState.Failed || failedRequests.Count != 1 || failedRequests[0] != THROWING_REQUEST_ID)
+                    Fail("the failed range read has not been reported to the handler");
+            }
+            finally
+            {
+                File.Delete(filePath);
+            }
+        }
+
+        public void OnFileLoaded(int requestID, string filePath, byte[] loadedBytes)
+        {
+            if (requestID < 0)
+            {
+                blockingReadStarted.Set();
+                releaseBlockingRead.WaitOne();
+                return;
+            }
+
+            if (requestID == THROWING_REQUEST_ID)
+                throw new InvalidOperationException("Handler failure.");
+
+            if (loadedBytes.Length != 4)
+                Fail("wrong file content for request " + requestID);
+            lock (completionOrder)
+                completionOrder.Add(requestID);
+        }
+
+        public void OnFileLoaded(int requestID, string filePath, string loadedText) { }
+
+        public void OnFileLoadFailed(int requestID, string filePath, Exception error)
+        {
+            lock (failedRequests)
+                failedRequests.Add(requestID);
+        }
+
+        public void OnRangeLoaded(int requestID, string filePath, long offset, ArrayRange<byte> data)
+        {
+            int expectedCount = (int)System.Math.Min(RANGE_LENGTH, RANGE_FILE_SIZE - offset);
+            if (data.Count != expectedCount)
+                Fail("wrong length for range " + requestID);
+            for (int i = 0; i < data.Count; i++)
+                if (data[i] != rangeFileContent[offset + i])
+                {
+                    Fail("wrong content for range " + requestID);
+                    break;
+                }
+
+            lock (completionOrder)
+            {
+                completionOrder.Add(requestID);
+                rangeBuffers.Add(data.Buffer);
+            }
+        }
+
+        public void OnRangeLoadFailed(int requestID, string filePath, Exception error)
+        {
+            OnFileLoadFailed(requestID, filePath, error);
+        }
+
+        private void Fail(string message)
+        {
+            failed = true;
+            Console.WriteLine("Test failed: " + message);
+        }
+    }
+}
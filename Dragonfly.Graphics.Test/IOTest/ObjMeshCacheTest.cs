@@ -0,0 +1,223 @@
+﻿using Dragonfly.BaseModule;
+using Dragonfly.Graphics.Math;
+using Dragonfly.Utils;
+using System;
+using System.Globalization;
+using System.IO;
+using System.Text;
+
+namespace Dragonfly.Graphics.Test
+{
+    /// <summary>
+    /// Parse a generated obj large enough to be split in several chunks, checking the resolved indices and the UTF-8 group names, then save and reload a mesh cache,
+    /// checking that the cached content and header are preserved and that truncated or corrupted files are rejected without exceptions.
+    /// </summary>
+    public class ObjMeshCacheTest : IConsoleProgram
+    {
+        private const int QUAD_COUNT = 40000;
+        private const int QUADS_PER_GROUP = 1000;
+        private const string GROUP_NAME = "grüppe_";
+
+        private bool failed;
+
+        public string ProgramName => "Obj parser and mesh cache test.";
+
+        public void RunProgram()
+        {
+            failed = false;
+            TestObjParsing();
+            TestCacheRoundTrip();
+            if (!failed)
+                Console.WriteLine("Test passed.");
+        }
+
+        private void TestObjParsing()
+        {
+            // quads with 4 vertices and a normal each, where odd quads use negative (relative) indices, starting with a byte order mark
+            StringBuilder objText = new StringBuilder();
+            for (int q = 0; q < QUAD_COUNT; q++)
+            {
+                if (q % QUADS_PER_GROUP == 0)
+                    objText.Append("g ").Append(GROUP_NAME).Append(q / QUADS_PER_GROUP).Append("\r\n");
+                for (int k = 0; k < 4; k++)
+                    objText.AppendFormat(CultureInfo.InvariantCulture, "v {0} {1} -1.5\n", q, k * 0.25f);
+                objText.Append("vn 0 0 1\n");
+                if (q % 2 == 0)
+                    objText.AppendFormat("f {0}//{4} {1}//{4} {2}//{4} {3}//{4}\n", 4 * q + 1, 4 * q + 2, 4 * q + 3, 4 * q + 4, q + 1);
+                else
+                    objText.Append("f -4//-1 -3//-1 -2//-1 -1//-1\n");
+            }
+            byte[] bom = Encoding.UTF8.GetPreamble(), textBytes = Encoding.UTF8.GetBytes(objText.ToString());
+            byte[] objBytes = new byte[bom.Length + textBytes.Length];
+            bom.CopyTo(objBytes, 0);
+            textBytes.CopyTo(objBytes, bom.Length);
+
+            ObjFile obj = new ObjFile();
+            obj.OnFileLoaded(0, "generated.obj", objBytes);
+            if (!obj.Loaded)
+            {
+                Fail("the obj has not been loaded");
+                return;
+            }
+            Console.WriteLine("Parsed {0} KB: {1} vertices, {2} groups.", objBytes.Length / 1024, obj.Vertices.Count, obj.Groups.Count);
+
+            if (obj.Vertices.Count != 4 * QUAD_COUNT || obj.Normals.Count != QUAD_COUNT)
+                Fail("wrong number of vertex attributes");
+            for (int i = 0; i < obj.Vertices.Count; i++)
+                if (obj.Vertices[i] != new Float3(i / 4, (i % 4) * 0.25f, -1.5f))
+                {
+                    Fail("wrong position for vertex " + i);
+                    break;
+                }
+
+            if (obj.Groups.Count != QUAD_COUNT / QUADS_PER_GROUP)
+                Fail("wrong number of groups");
+            int quadID = 0;
+            for (int g = 0; g < obj.Groups.Count; g++)
+            {
+                ObjGroup group = obj.Groups[g];
+                if (group.Name != GROUP_NAME + g)
+                    Fail("wrong group name: " + group.Name);
+                foreach (ObjFace face in group.Faces)
+                {
+                    for (int k = 0; k < face.VertexCount; k++)
+                    {
+                        ObjVertex v = group.FaceVertices[face.FirstVertex + k];
+                        if (face.VertexCount != 4 || v.VertexIndex != 4 * quadID + k + 1 || v.NormalIndex != quadID + 1)
+                        {
+                            Fail("wrong indices for quad " + quadID);
+                            return;
+                        }
+                    }
+                    quadID++;
+                }
+            }
+            if (quadID != QUAD_COUNT)
+                Fail("wrong number of faces");
+        }
+
+        private void TestCacheRoundTrip()
+        {
+            string sourcePath = Path.GetTempFileName();
+            string cachePath = sourcePath + MeshCacheFile.Extension;
+            File.WriteAllText(sourcePath, "v 0 0 0\n");
+
+            try
+            {
+                MeshCacheFile cache = new MeshCacheFile();
+                cache.AddSource(sourcePath);
+                cache.ChangeFaceOrientation = true;
+                cache.MergeGroupsByMaterial = true;
+                cache.DisableMeshOptimization = true;
+                cache.Vertices = new VertexTexNorm[70000];
+                for (int i = 0; i < cache.Vertices.Length; i++)
+                    cache.Vertices[i] = new VertexTexNorm(new Float3(i, -i, 0.5f), new Float2(i * 0.5f, 1.0f), Float3.UnitY);
+                cache.Indices = new uint[3 * (cache.Vertices.Length - 2)];
+                for (int i = 0; i < cache.Indices.Length; i++)
+                    cache.Indices[i] = (uint)((i / 3 + i % 3) % (i < 6 ? 4 : cache.Vertices.Length - 4)); // relative to the vertices of each range
+                cache.Bounds = new AABox(new Float3(0, -70000, 0.5f), new Float3(70000, 0, 0.5f));
+                ObjMaterial material = new ObjMaterial("matériau");
+                material.DiffuseColor = new Float3(0.5f, 0.25f, 1.0f);
+                material.DiffuseTextureMap = "textures/albedo.dds";
+                cache.Ranges.Add(new MeshCacheFile.MeshRange() { Name = "default0", Material = material, VertexStart = 0, VertexCount = 4, IndexStart = 0, IndexCount = 6, Bounds = cache.Bounds });
+                cache.Ranges.Add(new MeshCacheFile.MeshRange() { Name = "big", VertexStart = 4, VertexCount = cache.Vertices.Length - 4, IndexStart = 6, IndexCount = cache.Indices.Length - 6, Bounds = cache.Bounds });
+                cache.Ranges[1].OptimizationStats = new MeshOptimizationStats() { TriangleCount = cache.Indices.Length / 3 - 2, VertexCountBefore = 90000, VertexCountAfter = cache.Vertices.Length - 4, ACMRBefore = 1.5f, ACMRAfter = 0.75f, ATVRBefore = 2.0f, ATVRAfter = 1.25f };
+                cache.Save(cachePath);
+
+                byte[] cacheBytes = File.ReadAllBytes(cachePath);
+                MeshCacheFile loaded;
+                if (!MeshCacheFile.TryLoad(cacheBytes, out loaded))
+                {
+                    Fail("the saved cache cannot be loaded");
+                    return;
+                }
+                Console.WriteLine("Cache of {0} KB reloaded.", cacheBytes.Length / 1024);
+
+                if (!loaded.ChangeFaceOrientation || !loaded.MergeGroupsByMaterial || !loaded.DisableMeshOptimization || loaded.Sources.Count != 1 || loaded.Ranges.Count != 2)
+                    Fail("wrong cache settings");
+                if (loaded.Vertices.Length != cache.Vertices.Length || loaded.Indices.Length != cache.Indices.Length)
+                    Fail("wrong vertex or index count");
+                else
+                {
+                    for (int i = 0; i < cache.Vertices.Length; i++)
+                        if (!loaded.Vertices[i].Equals(cache.Vertices[i]))
+                        {
+                            Fail("wrong vertex " + i);
+                            break;
+                        }
+                    for (int i = 0; i < cache.Indices.Length; i++)
+                        if (loaded.Indices[i] != cache.Indices[i])
+                        {
+                            Fail("wrong index " + i);
+                            break;
+                        }
+                }
+                if (loaded.Ranges.Count == 2)
+                {
+                    ObjMaterial loadedMaterial = loaded.Ranges[0].Material;
+                    if (loadedMaterial == null || loadedMaterial.Name != material.Name || loadedMaterial.DiffuseColor != material.DiffuseColor || loadedMaterial.DiffuseTextureMap != material.DiffuseTextureMap || loadedMaterial.NormalMap != null)
+                        Fail("wrong cached material");
+                    if (loaded.Ranges[1].Material != null || loaded.Ranges[1].IndexCount != cache.Ranges[1].IndexCount)
+                        Fail("wrong cached mesh range");
+                    if (!loaded.Ranges[1].OptimizationStats.Equals(cache.Ranges[1].OptimizationStats) || loaded.Ranges[0].OptimizationStats.TriangleCount != 0)
+                        Fail("wrong cached optimization stats");
+                }
+
+                // header read alone, as done to validate a cache before loading its data
+                MeshCacheFile header;
+                if (!MeshCacheFile.TryReadHeader(new ArrayRange<byte>() { Buffer = cacheBytes, Count = System.Math.Min(cacheBytes.Length, MeshCacheFile.HeaderReadSize) }, out header))
+                    Fail("the cache header cannot be read");
+                else if (!header.ChangeFaceOrientation || !header.MergeGroupsByMaterial || !header.DisableMeshOptimization || header.Sources.Count != 1 || header.Sources[0].Path != sourcePath)
+                    Fail("wrong cache header");
+                if (MeshCacheFile.TryReadHeader(new ArrayRange<byte>() { Buffer = cacheBytes, Count = 10 }, out header))
+                    Fail("a truncated cache header has been read");
+
+                // modified sources
+                if (!loaded.IsUpToDate())
+                    Fail("the cache is not up to date");
+                File.AppendAllText(sourcePath, "v 1 1 1\n");
+                if (loaded.IsUpToDate())
+                    Fail("a modified source has not been detected");
+
+                // truncated and corrupted files
+                byte[] corrupted = new byte[cacheBytes.Length / 2];
+                Array.Copy(cacheBytes, corrupted, corrupted.Length);
+                if (MeshCacheFile.TryLoad(corrupted, out loaded))
+                    Fail("a truncated cache has been loaded");
+                corrupted = (byte[])cacheBytes.Clone();
+                BitConverter.GetBytes((uint)4).CopyTo(corrupted, corrupted.Length - cache.Indices.Length * sizeof(uint) + 5 * sizeof(uint)); // past the 4 vertices of the first range
+                if (MeshCacheFile.TryLoad(corrupted, out loaded))
+                    Fail("a cache with out of range indices has been loaded");
+                corrupted = new byte[cacheBytes.Length];
+                Random rnd = new Random(1);
+                for (int i = 0; i < 100; i++)
+                {
+                    Array.Copy(cacheBytes, corrupted, cacheBytes.Length);
+                    int from = rnd.Next(12, 400); // after the header, in the sources and ranges description
+                    for (int b = from; b < from + 8; b++)
+                        corrupted[b] = (byte)rnd.Next(256);
+                    try
+                    {
+                        MeshCacheFile.TryLoad(corrupted, out loaded); // either rejected or loaded with altered values, but never thrown
+                    }
+                    catch (Exception e)
+                    {
+                        Fail("loading a corrupted cache threw " + e.GetType().Name);
+                        break;
+                    }
+                }
+            }
+            finally
+            {
+                File.Delete(sourcePath);
+                File.Delete(cachePath);
+            }
+        }
+
+        private void Fail(string message)
+        {
+            failed = true;
+            Console.WriteLine("Test failed: " + message);
+        }
+    }
+}
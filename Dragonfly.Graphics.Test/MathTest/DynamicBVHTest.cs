@@ -0,0 +1,166 @@
+﻿using Dragonfly.Engine.Core;
+using Dragonfly.Graphics.Math;
+using Dragonfly.Utils;
+using System;
+using System.Collections.Generic;
+
+namespace Dragonfly.Graphics.Test
+{
+    /// <summary>
+    /// Insert, move and remove random boxes in a dynamic bounding volume hierarchy, checking after each step that queries return the same items found by a brute-force search.
+    /// </summary>
+    public class DynamicBVHTest : IConsoleProgram, IBVHVisitor
+    {
+        private const int BOX_COUNT = 2000;
+        private const int QUERY_COUNT = 200;
+        private const float WORLD_SIZE = 1000.0f;
+
+        private Random rnd;
+        private HashSet<int> found;
+        private int errors;
+
+        public string ProgramName => "Dynamic BVH test.";
+
+        public void RunProgram()
+        {
+            rnd = new Random(1);
+            found = new HashSet<int>();
+            errors = 0;
+
+            DynamicBVH<int> tree = new DynamicBVH<int>();
+            Dictionary<int, AABox> boxes = new Dictionary<int, AABox>(); // proxy -> box
+            List<int> proxies = new List<int>();
+
+            // insert
+            for (int i = 0; i < BOX_COUNT; i++)
+            {
+                AABox box = RandomBox();
+                int proxy = tree.Add(box, i);
+                if (boxes.ContainsKey(proxy))
+                    Fail("proxy " + proxy + " returned twice");
+                boxes[proxy] = box;
+                proxies.Add(proxy);
+            }
+            CheckTree("Insert", tree, boxes);
+
+            // move: half of the boxes by a small amount, that should not modify the tree, the others to a random position
+            int reinsertedCount = 0;
+            for (int i = 0; i < proxies.Count; i++)
+            {
+                int proxy = proxies[i];
+                AABox box = boxes[proxy];
+                if (i % 2 == 0)
+                {
+                    Float3 offset = (box.Max - box.Min) * 0.01f;
+                    box = new AABox(box.Min + offset, box.Max + offset);
+                }
+                else
+                {
+                    box = RandomBox();
+                }
+                reinsertedCount += tree.Move(proxy, box) ? 1 : 0;
+                boxes[proxy] = box;
+            }
+            Console.WriteLine("Moved {0} boxes, {1} re-inserted in the tree.", proxies.Count, reinsertedCount);
+            if (reinsertedCount > proxies.Count / 2)
+                Fail("small moves have re-inserted boxes");
+            CheckTree("Move", tree, boxes);
+
+            // remove half of the boxes
+            for (int i = 0; i < proxies.Count; i += 2)
+            {
+                tree.Remove(proxies[i]);
+                boxes.Remove(proxies[i]);
+            }
+            CheckTree("Remove", tree, boxes);
+
+            // removed proxies are reused by new items
+            for (int i = 0; i < BOX_COUNT / 2; i++)
+            {
+                AABox box = RandomBox();
+                int proxy = tree.Add(box, BOX_COUNT + i);
+                if (boxes.ContainsKey(proxy))
+                    Fail("proxy " + proxy + " is still in use");
+                boxes[proxy] = box;
+            }
+            CheckTree("Insert after remove", tree, boxes);
+
+            // empty tree
+            tree.Clear();
+            boxes.Clear();
+            CheckTree("Clear", tree, boxes);
+
+            Console.WriteLine(errors == 0 ? "Test passed." : "Test failed: " + errors + " errors.");
+        }
+
+        public void Visit(int proxy, bool contained)
+        {
+            if (!found.Add(proxy))
+                Fail("proxy " + proxy + " visited twice");
+        }
+
+        private void CheckTree(string stepName, DynamicBVH<int> tree, Dictionary<int, AABox> boxes)
+        {
+            int errorsBefore = errors;
+            if (tree.Count != boxes.Count)
+                Fail(string.Format("{0} items in the tree, {1} expected", tree.Count, boxes.Count));
+            foreach (KeyValuePair<int, AABox> entry in boxes)
+            {
+                AABox box = tree.GetBox(entry.Key);
+                if (!box.Min.Equals(entry.Value.Min) || !box.Max.Equals(entry.Value.Max))
+                    Fail("wrong box stored for proxy " + entry.Key);
+            }
+
+            int foundCount = 0;
+            for (int q = 0; q < QUERY_COUNT; q++)
+            {
+                // queries of random boxes and spheres, with a random origin
+                Float3 origin = RandomPoint() * 0.1f;
+                IVolume volume;
+                if (q % 2 == 0)
+                {
+                    Float3 center = RandomPoint();
+                    Float3 extents = new Float3((float)rnd.NextDouble(), (float)rnd.NextDouble(), (float)rnd.NextDouble()) * WORLD_SIZE * 0.2f;
+                    volume = new AABox(center - extents, center + extents);
+                }
+                else
+                {
+                    volume = new Sphere(RandomPoint(), (float)rnd.NextDouble() * WORLD_SIZE * 0.2f);
+                }
+
+                found.Clear();
+                tree.Query(volume, origin, this);
+                foundCount += found.Count;
+
+                foreach (KeyValuePair<int, AABox> entry in boxes)
+                {
+                    AABox localBox = new AABox(entry.Value.Min - origin, entry.Value.Max - origin);
+                    if (volume.Intersects(localBox) && !found.Contains(entry.Key))
+                        Fail("proxy " + entry.Key + " not found by a query");
+                }
+            }
+
+            Console.WriteLine("{0}: {1} items, height {2}, {3:0.0} items found per query{4}", stepName, tree.Count, tree.Height, foundCount / (float)QUERY_COUNT, errors == errorsBefore ? "" : " - FAILED");
+        }
+
+        private Float3 RandomPoint()
+        {
+            return new Float3((float)rnd.NextDouble(), (float)rnd.NextDouble(), (float)rnd.NextDouble()) * WORLD_SIZE;
+        }
+
+        private AABox RandomBox()
+        {
+            Float3 center = RandomPoint();
+            Float3 extents = new Float3((float)rnd.NextDouble(), (float)rnd.NextDouble(), (float)rnd.NextDouble()) * 10.0f + 0.1f;
+            return new AABox(center - extents, center + extents);
+        }
+
+        private void Fail(string message)
+        {
+            errors++;
+            if (errors <= 10)
+                Console.WriteLine("Error: " + message);
+        }
+    }
+
+}
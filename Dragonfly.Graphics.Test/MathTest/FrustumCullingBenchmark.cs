@@ -0,0 +1,93 @@
+﻿using Dragonfly.Graphics.Math;
+using Dragonfly.Utils;
+using System;
+using System.Diagnostics;
+using System.Numerics;
+
+namespace Dragonfly.Graphics.Test
+{
+    /// <summary>
+    /// Compare the batch frustum culling and box transform kernels with the per-box versions, checking that results match and measuring boxes per second on a single core.
+    /// </summary>
+    public class FrustumCullingBenchmark : IConsoleProgram
+    {
+        private const int BOX_COUNT = 1 << 20;
+        private const int REPETITIONS = 10;
+
+        public string ProgramName => "Frustum culling benchmark.";
+
+        public void RunProgram()
+        {
+            Random rnd = new Random(1);
+            AABoxArray boxes = new AABoxArray(BOX_COUNT);
+            for (int i = 0; i < BOX_COUNT; i++)
+            {
+                Float3 center = new Float3((float)rnd.NextDouble(), (float)rnd.NextDouble(), (float)rnd.NextDouble()) * 2000.0f - (Float3)1000.0f;
+                Float3 extents = new Float3((float)rnd.NextDouble(), (float)rnd.NextDouble(), (float)rnd.NextDouble()) * 10.0f;
+                boxes.Add(new AABox(center - extents, center + extents));
+            }
+
+            Float4x4 view = Float4x4.LookAt(new Float3(10, 20, 30), new Float3(100, 0, 200), Float3.UnitY);
+            ViewFrustum frustum = new ViewFrustum(view * Float4x4.Perspective(FMath.PI_OVER_2, 1.5f, 1, 1000));
+            Float4x4 transform = Float4x4.RotationY(0.3f) * Float4x4.Translation(5, -3, 2);
+            ulong[] intersected = new ulong[AABoxArray.GetMaskLength(BOX_COUNT)];
+            ulong[] contained = new ulong[intersected.Length];
+            AABoxArray transformed = new AABoxArray(BOX_COUNT);
+            Console.WriteLine("SIMD width: {0} floats, hardware accelerated: {1}", Vector<float>.Count, Vector.IsHardwareAccelerated);
+
+            // per-box tests
+            int visibleCount = 0;
+            Stopwatch timer = Stopwatch.StartNew();
+            for (int r = 0; r < REPETITIONS; r++)
+            {
+                visibleCount = 0;
+                for (int i = 0; i < BOX_COUNT; i++)
+                    if (frustum.Intersects(boxes[i]))
+                        visibleCount++;
+            }
+            PrintRate("Per-box intersection", timer);
+
+            timer.Restart();
+            for (int r = 0; r < REPETITIONS; r++)
+                frustum.Intersects(boxes, intersected);
+            PrintRate("Batch intersection", timer);
+
+            timer.Restart();
+            for (int r = 0; r < REPETITIONS; r++)
+                for (int i = 0; i < BOX_COUNT; i++)
+                    transformed[i] = boxes[i] * transform;
+            PrintRate("Per-box transform", timer);
+
+            timer.Restart();
+            for (int r = 0; r < REPETITIONS; r++)
+                boxes.Transform(transform, transformed);
+            PrintRate("Batch transform", timer);
+
+            // check results
+            frustum.Contains(boxes, contained);
+            int errors = 0, batchVisibleCount = 0;
+            for (int i = 0; i < BOX_COUNT; i++)
+            {
+                AABox b = boxes[i];
+                bool isVisible = AABoxArray.IsMaskSet(intersected, i);
+                batchVisibleCount += isVisible ? 1 : 0;
+                if (isVisible != frustum.Intersects(b) || AABoxArray.IsMaskSet(contained, i) != frustum.Contains(b))
+                    errors++;
+
+                AABox expected = b * transform, result = transformed[i];
+                if ((expected.Min - result.Min).Abs().CMax() > 1e-3f || (expected.Max - result.Max).Abs().CMax() > 1e-3f)
+                    errors++;
+            }
+
+            Console.WriteLine("Visible boxes: {0} / {1} (batch: {2})", visibleCount, BOX_COUNT, batchVisibleCount);
+            Console.WriteLine(errors == 0 ? "Test passed." : "Test failed: " + errors + " results differ from the per-box versions.");
+        }
+
+        private void PrintRate(string name, Stopwatch timer)
+        {
+            double seconds = timer.Elapsed.TotalSeconds;
+            Console.WriteLine("{0}: {1:0.0} M boxes/s per core", name, REPETITIONS * (double)BOX_COUNT / seconds / 1e6);
+        }
+    }
+
+}
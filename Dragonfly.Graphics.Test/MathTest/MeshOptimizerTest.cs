@@ -0,0 +1,90 @@
+﻿using Dragonfly.Graphics.Math;
+using Dragonfly.Utils;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+
+namespace Dragonfly.Graphics.Test
+{
+    /// <summary>
+    /// Optimize an unindexed torus with shuffled triangles, checking that the same triangles are preserved and reporting ACMR / ATVR before and after.
+    /// </summary>
+    public class MeshOptimizerTest : IConsoleProgram
+    {
+        private const int RING_COUNT = 256, SIDE_COUNT = 128;
+        private const float MAJOR_RADIUS = 2.0f, MINOR_RADIUS = 0.5f;
+
+        public string ProgramName => "Mesh optimizer test.";
+
+        public void RunProgram()
+        {
+            // generate a torus with a vertex for each triangle corner, and triangles in random order
+            List<Float3[]> triangles = new List<Float3[]>();
+            for (int r = 0; r < RING_COUNT; r++)
+            {
+                for (int s = 0; s < SIDE_COUNT; s++)
+                {
+                    triangles.Add(new Float3[] { TorusPoint(r, s), TorusPoint(r + 1, s), TorusPoint(r + 1, s + 1) });
+                    triangles.Add(new Float3[] { TorusPoint(r, s), TorusPoint(r + 1, s + 1), TorusPoint(r, s + 1) });
+                }
+            }
+            Random rnd = new Random(1);
+            for (int i = triangles.Count - 1; i > 0; i--)
+            {
+                int j = rnd.Next(i + 1);
+                Float3[] tmp = triangles[i];
+                triangles[i] = triangles[j];
+                triangles[j] = tmp;
+            }
+
+            Float3[] vertices = new Float3[triangles.Count * 3];
+            uint[] indices = new uint[triangles.Count * 3];
+            for (int i = 0; i < vertices.Length; i++)
+            {
+                vertices[i] = triangles[i / 3][i % 3];
+                indices[i] = (uint)i;
+            }
+
+            // optimize, using the direction from the torus ring as normal
+            Stopwatch timer = Stopwatch.StartNew();
+            MeshOptimizationStats stats = MeshOptimizer.Optimize(ref vertices, ref indices, p => p, p => p - new Float3(p.X, 0, p.Z).Normal() * MAJOR_RADIUS);
+            timer.Stop();
+            Console.WriteLine(stats);
+            Console.WriteLine("Optimized in {0} ms.", timer.ElapsedMilliseconds);
+
+            // check that all the triangles are still there, with the same winding
+            HashSet<string> srcTriangles = new HashSet<string>();
+            foreach (Float3[] t in triangles)
+                srcTriangles.Add(TriangleKey(t[0], t[1], t[2]));
+            for (int i = 0; i < indices.Length; i += 3)
+            {
+                if (!srcTriangles.Remove(TriangleKey(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]])))
+                {
+                    Console.WriteLine("Test failed: triangle {0} is not part of the source mesh or is duplicated.", i / 3);
+                    return;
+                }
+            }
+
+            if (srcTriangles.Count > 0)
+                Console.WriteLine("Test failed: {0} triangles are missing.", srcTriangles.Count);
+            else if (stats.VertexCountAfter != RING_COUNT * SIDE_COUNT)
+                Console.WriteLine("Test failed: duplicated vertices have not been welded.");
+            else if (stats.ACMRAfter > 1.0f)
+                Console.WriteLine("Test failed: the vertex cache has not been optimized.");
+            else
+                Console.WriteLine("Test passed.");
+        }
+
+        private static Float3 TorusPoint(int ring, int side)
+        {
+            float ringAngle = FMath.TWO_PI * (ring % RING_COUNT) / RING_COUNT, sideAngle = FMath.TWO_PI * (side % SIDE_COUNT) / SIDE_COUNT;
+            float radius = MAJOR_RADIUS + MINOR_RADIUS * FMath.Cos(sideAngle);
+            return new Float3(radius * FMath.Cos(ringAngle), MINOR_RADIUS * FMath.Sin(sideAngle), radius * FMath.Sin(ringAngle));
+        }
+
+        private static string TriangleKey(Float3 p0, Float3 p1, Float3 p2)
+        {
+            return string.Format("{0}{1}{2}", p0, p1, p2);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+﻿using Dragonfly.Graphics.Math;
+using Dragonfly.Utils;
+using System;
+using System.Diagnostics;
+
+namespace Dragonfly.Graphics.Test
+{
+    /// <summary>
+    /// Test the occlusion buffer with a wall in front of the camera, checking that no visible box is reported as occluded, and measuring rasterization and test rates.
+    /// </summary>
+    public class OcclusionBufferTest : IConsoleProgram
+    {
+        private const int WIDTH = 256, HEIGHT = 128;
+        private const int BOX_COUNT = 100000;
+        private const int GRID_SIZE = 64;
+        private const int REPETITIONS = 10;
+
+        public string ProgramName => "Occlusion buffer test.";
+
+        public void RunProgram()
+        {
+            OcclusionBuffer buffer = new OcclusionBuffer(WIDTH, HEIGHT);
+            Float4x4 projection = Float4x4.Perspective(FMath.PI_OVER_2, 2.0f, 0.1f, float.PositiveInfinity);
+            Float3 cameraPos = Float3.Zero;
+            Float4x4 cameraMatrix = Float4x4.LookAt(cameraPos, Float3.UnitZ, Float3.UnitY) * projection;
+
+            // a wall facing the camera at z = 50, covering x / z in [-0.4, 0.4] and y / z in [-0.2, 0.2]
+            Float3 w0 = new Float3(-20, -10, 50), w1 = new Float3(-20, 10, 50), w2 = new Float3(20, 10, 50), w3 = new Float3(20, -10, 50);
+            buffer.Begin(cameraMatrix, cameraPos);
+            buffer.AddQuad(w0, w1, w2, w3);
+            buffer.BuildHiZ();
+
+            int errors = 0;
+            errors += Check("Box behind the wall", buffer.IsOccluded(new AABox(new Float3(-2, -2, 80), new Float3(2, 2, 82))), true);
+            errors += Check("Box in front of the wall", buffer.IsOccluded(new AABox(new Float3(-2, -2, 30), new Float3(2, 2, 32))), false);
+            errors += Check("Box beside the wall", buffer.IsOccluded(new AABox(new Float3(30, -2, 60), new Float3(40, 2, 62))), false);
+            errors += Check("Box partially behind the wall", buffer.IsOccluded(new AABox(new Float3(10, -2, 60), new Float3(40, 2, 62))), false);
+            errors += Check("Box crossing the wall", buffer.IsOccluded(new AABox(new Float3(-2, -2, 45), new Float3(2, 2, 55))), false);
+
+            // random boxes: occluded ones must be fully behind the wall and inside its projection
+            Random rnd = new Random(1);
+            AABox[] boxes = new AABox[BOX_COUNT];
+            for (int i = 0; i < BOX_COUNT; i++)
+            {
+                Float3 center = new Float3((float)rnd.NextDouble() * 120.0f - 60.0f, (float)rnd.NextDouble() * 60.0f - 30.0f, (float)rnd.NextDouble() * 150.0f + 5.0f);
+                Float3 extents = new Float3((float)rnd.NextDouble(), (float)rnd.NextDouble(), (float)rnd.NextDouble()) * 5.0f;
+                boxes[i] = new AABox(center - extents, center + extents);
+            }
+
+            int occludedCount = 0, hiddenCount = 0;
+            for (int i = 0; i < BOX_COUNT; i++)
+            {
+                AABox b = boxes[i];
+                bool hidden = b.Min.Z > 50.0f && b.Min.X / b.Min.Z >= -0.4f && b.Max.X / b.Min.Z <= 0.4f && b.Min.Y / b.Min.Z >= -0.2f && b.Max.Y / b.Min.Z <= 0.2f;
+                bool occluded = buffer.IsOccluded(b);
+                hiddenCount += hidden ? 1 : 0;
+                occludedCount += occluded ? 1 : 0;
+                if (occluded && !hidden)
+                    errors++;
+            }
+            Console.WriteLine("Random boxes hidden by the wall: {0}, found occluded: {1}", hiddenCount, occludedCount);
+
+            // the wall is not rasterized from behind
+            buffer.Begin(Float4x4.LookAt(new Float3(0, 0, 100), -Float3.UnitZ, Float3.UnitY) * projection, new Float3(0, 0, 100));
+            buffer.AddQuad(w0, w1, w2, w3);
+            buffer.BuildHiZ();
+            errors += Check("Box behind a back-facing wall", buffer.IsOccluded(new AABox(new Float3(-2, -2, 20), new Float3(2, 2, 22))), false);
+
+            // rasterization rate, with a terrain-like grid in front of the camera
+            Stopwatch timer = Stopwatch.StartNew();
+            Float4x4 groundCamera = Float4x4.LookAt(new Float3(0, 10, 0), new Float3(0, -0.2f, 1), Float3.UnitY) * projection;
+            for (int r = 0; r < REPETITIONS; r++)
+            {
+                buffer.Begin(groundCamera, new Float3(0, 10, 0));
+                for (int z = 0; z < GRID_SIZE; z++)
+                {
+                    for (int x = 0; x < GRID_SIZE; x++)
+                    {
+                        Float3 p00 = new Float3(x - GRID_SIZE / 2, (float)System.Math.Sin(x * 0.3f) * 2.0f, z) * 4.0f;
+                        Float3 p01 = new Float3(x - GRID_SIZE / 2, (float)System.Math.Sin(x * 0.3f) * 2.0f, z + 1) * 4.0f;
+                        Float3 p10 = new Float3(x + 1 - GRID_SIZE / 2, (float)System.Math.Sin((x + 1) * 0.3f) * 2.0f, z) * 4.0f;
+                        Float3 p11 = new Float3(x + 1 - GRID_SIZE / 2, (float)System.Math.Sin((x + 1) * 0.3f) * 2.0f, z + 1) * 4.0f;
+                        buffer.AddTriangle(p00, p01, p10);
+                        buffer.AddTriangle(p10, p01, p11);
+                    }
+                }
+                buffer.BuildHiZ();
+            }
+            double rasterMs = timer.Elapsed.TotalMilliseconds / REPETITIONS;
+            Console.WriteLine("Grid of {0} triangles: {1} rasterized, {2:0.00} ms per frame", 2 * GRID_SIZE * GRID_SIZE, buffer.RasterizedCount, rasterMs);
+
+            timer.Restart();
+            int groundOccluded = 0;
+            for (int r = 0; r < REPETITIONS; r++)
+            {
+                groundOccluded = 0;
+                for (int i = 0; i < BOX_COUNT; i++)
+                    groundOccluded += buffer.IsOccluded(boxes[i] * Float4x4.Translation(0, -40, 0)) ? 1 : 0;
+            }
+            double seconds = timer.Elapsed.TotalSeconds;
+            Console.WriteLine("Boxes below the ground: {0} / {1} occluded, {2:0.0} M boxes/s per core", groundOccluded, BOX_COUNT, REPETITIONS * (double)BOX_COUNT / seconds / 1e6);
+
+            Console.WriteLine(errors == 0 ? "Test passed." : "Test failed: " + errors + " boxes have been wrongly classified.");
+        }
+
+        private int Check(string name, bool occluded, bool expected)
+        {
+            Console.WriteLine("{0}: {1}", name, occluded ? "occluded" : "visible");
+            return occluded == expected ? 0 : 1;
+        }
+    }
+
+}
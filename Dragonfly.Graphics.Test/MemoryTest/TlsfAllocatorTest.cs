@@ -0,0 +1,88 @@
+﻿using Dragonfly.Utils;
+using System;
+using System.Collections.Generic;
+
+namespace Dragonfly.Graphics.Test
+{
+    /// <summary>
+    /// Stress the TLSF allocator used for GPU heaps with random allocations and frees, checking that ranges never overlap and are always merged back.
+    /// </summary>
+    public class TlsfAllocatorTest : IConsoleProgram
+    {
+        private const long HEAP_SIZE = 64 * 1024 * 1024;
+        private const long MIN_BLOCK_SIZE = 256;
+        private const int ITERATIONS = 200000;
+
+        private bool failed;
+
+        public string ProgramName => "TLSF allocator test.";
+
+        public void RunProgram()
+        {
+            failed = false;
+            Random rnd = new Random(1);
+            TlsfAllocator allocator = new TlsfAllocator(HEAP_SIZE, MIN_BLOCK_SIZE);
+            List<TlsfAllocator.Allocation> allocations = new List<TlsfAllocator.Allocation>();
+            int failedAllocations = 0;
+
+            for (int i = 0; i < ITERATIONS; i++)
+            {
+                if (allocations.Count > 0 && rnd.NextDouble() < 0.5)
+                {
+                    // free a random allocation
+                    int index = rnd.Next(allocations.Count);
+                    allocator.Free(allocations[index]);
+                    allocations[index] = allocations[allocations.Count - 1];
+                    allocations.RemoveAt(allocations.Count - 1);
+                }
+                else
+                {
+                    // allocate a random size with a random alignment
+                    long size = rnd.Next(1, 1 << rnd.Next(4, 21));
+                    long alignment = 1L << rnd.Next(0, 17);
+                    TlsfAllocator.Allocation a;
+                    if (!allocator.TryAllocate(size, alignment, out a))
+                        failedAllocations++;
+                    else if (a.Offset % System.Math.Max(alignment, MIN_BLOCK_SIZE) != 0)
+                        Fail(string.Format("allocation at {0} is not aligned to {1}", a.Offset, alignment));
+                    else
+                        allocations.Add(a);
+                }
+
+                if (i % (ITERATIONS / 10) == 0)
+                {
+                    CheckOverlaps(allocations);
+                    Console.WriteLine(allocator.GetStats());
+                }
+            }
+
+            foreach (TlsfAllocator.Allocation a in allocations)
+                allocator.Free(a);
+
+            AllocatorStats stats = allocator.GetStats();
+            Console.WriteLine(stats);
+            Console.WriteLine("Failed allocations: " + failedAllocations);
+            if (stats.FreeBlockCount != 1 || stats.LargestFreeBlock != HEAP_SIZE)
+                Fail("free blocks have not been merged back");
+
+            if (!failed)
+                Console.WriteLine("Test passed.");
+        }
+
+        private void CheckOverlaps(List<TlsfAllocator.Allocation> allocations)
+        {
+            List<TlsfAllocator.Allocation> sorted = new List<TlsfAllocator.Allocation>(allocations);
+            sorted.Sort((a1, a2) => a1.Offset.CompareTo(a2.Offset));
+            for (int i = 1; i < sorted.Count; i++)
+                if (sorted[i - 1].Offset + sorted[i - 1].Size > sorted[i].Offset)
+                    Fail(string.Format("allocations at {0} and {1} overlap", sorted[i - 1].Offset, sorted[i].Offset));
+        }
+
+        private void Fail(string message)
+        {
+            failed = true;
+            Console.WriteLine("Test failed: " + message);
+        }
+    }
+
+}
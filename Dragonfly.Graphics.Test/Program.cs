@@ -15,6 +15,15 @@ namespace Dragonfly.Graphics.Test
             selectionLoop.AddProgram(new FrmAllocationTest());
             selectionLoop.AddProgram(new FrmInstancingTest());
             selectionLoop.AddProgram(new MatricesAndVectorTest());
+            selectionLoop.AddProgram(new FrustumCullingBenchmark());
+            selectionLoop.AddProgram(new OcclusionBufferTest());
+            selectionLoop.AddProgram(new DynamicBVHTest());
+            selectionLoop.AddProgram(new MeshOptimizerTest());
+            selectionLoop.AddProgram(new TlsfAllocatorTest());
+            selectionLoop.AddProgram(new IOSchedulerTest());
+            selectionLoop.AddProgram(new ObjMeshCacheTest());
+            selectionLoop.AddProgram(new HdrFileTest());
+            selectionLoop.AddProgram(new ParallelUpdateTest());
 
             selectionLoop.Start();
         }
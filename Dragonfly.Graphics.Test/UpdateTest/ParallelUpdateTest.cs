@@ -0,0 +1,193 @@
+﻿using Dragonfly.Engine.Core;
+using Dragonfly.Graphics.Math;
+using Dragonfly.Utils;
+using System;
+using System.Collections.Generic;
+using System.Threading;
+
+namespace Dragonfly.Graphics.Test
+{
+    /// <summary>
+    /// Run queues of fake component updates through the parallel update scheduler, checking that parallel updates with disjoint accesses overlap with each other and with the serial 
+    /// updates queued between them, while conflicting updates, serial or parallel, still see each other's changes in queue order.
+    /// </summary>
+    public class ParallelUpdateTest : IConsoleProgram
+    {
+        private const int OVERLAP_TIMEOUT_MS = 5000;
+
+        private List<string> log;
+        private bool failed;
+
+        public string ProgramName => "Parallel update scheduling test.";
+
+        public void RunProgram()
+        {
+            log = new List<string>();
+            failed = false;
+            ParallelUpdateScheduler scheduler = new ParallelUpdateScheduler();
+
+            TestOverlap(scheduler);
+            TestConflicts(scheduler);
+            TestErrors(scheduler);
+
+            if (!failed)
+                Console.WriteLine("Test passed.");
+        }
+
+        private void TestOverlap(ParallelUpdateScheduler scheduler)
+        {
+            // two parallel updates with disjoint accesses, that can only complete if they run at the same time, with a serial update between them
+            ManualResetEvent aStarted = new ManualResetEvent(false), bStarted = new ManualResetEvent(false);
+            bool aOverlapped = false, bOverlapped = false, serialOverlapped = false;
+            TestParallelUpdate a = new TestParallelUpdate(this, "A", new object[0], new object[] { "a" });
+            a.OnParallelUpdate = () => { aStarted.Set(); aOverlapped = bStarted.WaitOne(OVERLAP_TIMEOUT_MS); };
+            TestParallelUpdate b = new TestParallelUpdate(this, "B", new object[0], new object[] { "b" });
+            b.OnParallelUpdate = () => { bStarted.Set(); bOverlapped = aStarted.WaitOne(OVERLAP_TIMEOUT_MS); };
+            TestUpdate serial = new TestUpdate(this, "S");
+            serial.OnUpdate = () => serialOverlapped = scheduler.PendingCount == 1;
+
+            Run(scheduler, a, serial, b);
+            Console.WriteLine("Disjoint updates: {0}", string.Join(", ", log));
+            if (!aOverlapped || !bOverlapped)
+                Fail("parallel updates with disjoint accesses did not overlap");
+            if (!serialOverlapped)
+                Fail("an undeclared serial update waited for a parallel update");
+            if (log.IndexOf("A.Update") < log.IndexOf("A.ParallelUpdate") || log.IndexOf("B.Update") < log.IndexOf("B.ParallelUpdate"))
+                Fail("Update() called before ParallelUpdate()");
+        }
+
+        private void TestConflicts(ParallelUpdateScheduler scheduler)
+        {
+            // a parallel reader after a parallel writer, then a serial writer after a slow parallel reader
+            object shared = new object();
+            TestParallelUpdate writer = new TestParallelUpdate(this, "W", new object[0], new object[] { shared });
+            TestParallelUpdate reader = new TestParallelUpdate(this, "R", new object[] { shared }, new object[0]);
+            TestParallelUpdate slowReader = new TestParallelUpdate(this, "SR", new object[] { typeof(string) }, new object[0]);
+            slowReader.OnParallelUpdate = () => Thread.Sleep(100);
+            TestDeclaredUpdate serialWriter = new TestDeclaredUpdate(this, "SW", new object[0], new object[] { "text" });
+
+            Run(scheduler, writer, reader, slowReader, serialWriter);
+            Console.WriteLine("Conflicting updates: {0}", string.Join(", ", log));
+            if (log.IndexOf("W.Update") > log.IndexOf("R.ParallelUpdate"))
+                Fail("a parallel update started before the Update() of a conflicting one");
+            if (log.IndexOf("SR.Update") > log.IndexOf("SW.Update"))
+                Fail("a serial update did not wait for a conflicting parallel update");
+        }
+
+        private void TestErrors(ParallelUpdateScheduler scheduler)
+        {
+            // an exception thrown by a parallel update is reported to the caller, after the other running updates are completed
+            TestParallelUpdate throwing = new TestParallelUpdate(this, "T", new object[0], new object[] { "t" });
+            throwing.OnParallelUpdate = () => throw new InvalidOperationException("expected");
+            TestParallelUpdate slow = new TestParallelUpdate(this, "L", new object[0], new object[] { "l" });
+            bool slowCompleted = false;
+            slow.OnParallelUpdate = () => { Thread.Sleep(100); slowCompleted = true; };
+
+            try
+            {
+                Run(scheduler, throwing, slow);
+                Fail("the parallel update exception has not been reported");
+            }
+            catch (InvalidOperationException)
+            {
+                if (!slowCompleted)
+                    Fail("a parallel update is still running after an exception");
+            }
+
+            if (scheduler.PendingCount != 0)
+                Fail("pending updates left after an exception");
+        }
+
+        private void Run(ParallelUpdateScheduler scheduler, params ICompUpdatable[] updates)
+        {
+            log.Clear();
+            scheduler.Run(new Queue<ICompUpdatable>(updates), UpdateType.FrameStart1, (u, updateType) => u.Update(updateType));
+        }
+
+        private void Log(string entry)
+        {
+            lock (log)
+                log.Add(entry);
+        }
+
+        private void Fail(string message)
+        {
+            failed = true;
+            Console.WriteLine("Test failed: " + message);
+        }
+
+        /// <summary>
+        /// A serial update without declared accesses.
+        /// </summary>
+        private class TestUpdate : ICompUpdatable
+        {
+            protected ParallelUpdateTest test;
+
+            public TestUpdate(ParallelUpdateTest test, string name)
+            {
+                this.test = test;
+                Name = name;
+                Active = true;
+            }
+
+            public Action OnUpdate { get; set; }
+
+            public UpdateType NeededUpdates => UpdateType.FrameStart1;
+
+            public void Update(UpdateType updateType)
+            {
+                test.Log(Name + ".Update");
+                OnUpdate?.Invoke();
+            }
+
+            public Component Parent => null;
+
+            public bool Ready => true;
+
+            public bool Active { get; set; }
+
+            public string Name { get; set; }
+
+            public bool Disposed => false;
+
+            public TiledFloat4x4 GetTransform()
+            {
+                return new TiledFloat4x4();
+            }
+
+            public void Dispose() { }
+        }
+
+        private class TestDeclaredUpdate : TestUpdate, ICompDeclaredUpdatable
+        {
+            private object[] reads, writes;
+
+            public TestDeclaredUpdate(ParallelUpdateTest test, string name, object[] reads, object[] writes) : base(test, name)
+            {
+                this.reads = reads;
+                this.writes = writes;
+            }
+
+            public void GetUpdateAccess(UpdateType updateType, UpdateAccess access)
+            {
+                foreach (object r in reads)
+                    access.Read(r);
+                foreach (object w in writes)
+                    access.Write(w);
+            }
+        }
+
+        private class TestParallelUpdate : TestDeclaredUpdate, ICompParallelUpdatable
+        {
+            public TestParallelUpdate(ParallelUpdateTest test, string name, object[] reads, object[] writes) : base(test, name, reads, writes) { }
+
+            public Action OnParallelUpdate { get; set; }
+
+            public void ParallelUpdate(UpdateType updateType)
+            {
+                test.Log(Name + ".ParallelUpdate");
+                OnParallelUpdate?.Invoke();
+            }
+        }
+    }
+}
@@ -470,9 +470,14 @@ namespace DragonflyGraphicsWrappers {
 			}
 
 			void SetIndexBuffer(DF_Buffer11^ indexBuffer)
+			{
+				SetIndexBuffer(indexBuffer, false);
+			}
+
+			void SetIndexBuffer(DF_Buffer11^ indexBuffer, bool use32BitIndices)
 			{
 				ID3D11Buffer* ib = indexBuffer == nullptr ? NULL : static_cast<ID3D11Buffer*>(indexBuffer->Get());
-				GetContext()->IASetIndexBuffer(ib, DXGI_FORMAT_R16_UINT, 0);
+				GetContext()->IASetIndexBuffer(ib, use32BitIndices ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
 			}
 
 			void SetVertexBuffer(UINT slot, DF_Buffer11^ vertexBuffer, UINT byteOffset, UINT vertexSize)
@@ -155,6 +155,15 @@ namespace DragonflyGraphicsWrappers {
 				memcpy(indexBufferData, pinPtrIndices, count * sizeof(USHORT));
 				DF_D3DErrors::Throw(GetNativePointer()->Unlock());
 			}
+
+			void SetIndices(UINT startIndex, UINT count, cli::array<UINT> ^ indices)
+			{
+				void * indexBufferData;
+				pin_ptr<UINT> pinPtrIndices = &(indices[0]);
+				DF_D3DErrors::Throw(GetNativePointer()->Lock(startIndex * sizeof(UINT), count * sizeof(UINT), &indexBufferData, 0));
+				memcpy(indexBufferData, pinPtrIndices, count * sizeof(UINT));
+				DF_D3DErrors::Throw(GetNativePointer()->Unlock());
+			}
 		};
 
 
@@ -654,9 +663,15 @@ namespace DragonflyGraphicsWrappers {
 			}
 
 			DF_IndexBuffer ^ CreateIndexBuffer(UINT byteLength)
+			{
+				return CreateIndexBuffer(byteLength, false);
+			}
+
+			DF_IndexBuffer ^ CreateIndexBuffer(UINT byteLength, bool use32BitIndices)
 			{
 				IDirect3DIndexBuffer9 * indexBuffer;
-				DF_D3DErrors::Throw(dx_device->CreateIndexBuffer(byteLength, D3DUSAGE_WRITEONLY, D3DFMT_INDEX16, D3DPOOL_MANAGED, &indexBuffer, NULL));
+				D3DFORMAT indexFormat = use32BitIndices ? D3DFMT_INDEX32 : D3DFMT_INDEX16;
+				DF_D3DErrors::Throw(dx_device->CreateIndexBuffer(byteLength, D3DUSAGE_WRITEONLY, indexFormat, D3DPOOL_MANAGED, &indexBuffer, NULL));
 				return gcnew DF_IndexBuffer(indexBuffer);
 			}
 
@@ -53,6 +53,16 @@ namespace DragonflyGraphicsWrappers {
 			frameToAllocatorOffset[bbFrame] = (frameToAllocatorOffset[bbFrame] + DF_12_FRAME_COUNT) % allocatorCount;
 		}
 
+		/// <summary>
+		/// Returns the state of a render target while is not bound to a command list.
+		/// </summary>
+		static D3D12_RESOURCE_STATES GetUnboundRenderTargetState(DF_Resource12^ renderTarget)
+		{
+			if ((renderTarget->Flags & DF_Resource12Flags::FrameBuffer) == DF_Resource12Flags::FrameBuffer)
+				return D3D12_RESOURCE_STATE_PRESENT;
+			return D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		}
+
 		void DF_CommandList12::TransitionOutRenderTargets()
 		{
 			if (!curRenderTargetCount)
@@ -60,15 +70,7 @@ namespace DragonflyGraphicsWrappers {
 
 			BarrierGroup barriers(GetList());
 			for (UINT i = 0; i < curRenderTargetCount; i++)
-			{
-				D3D12_RESOURCE_STATES nextRtState;
-				if ((curRenderTargets[i]->Flags & DF_Resource12Flags::FrameBuffer) == DF_Resource12Flags::FrameBuffer)
-					nextRtState = D3D12_RESOURCE_STATE_PRESENT;
-				else
-					nextRtState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-
-				curRenderTargets[i]->AddTransition(D3D12_RESOURCE_STATE_RENDER_TARGET, nextRtState, barriers);
-			}
+				curRenderTargets[i]->AddTransition(D3D12_RESOURCE_STATE_RENDER_TARGET, GetUnboundRenderTargetState(curRenderTargets[i]), barriers);
 			barriers.Commit();
 			curRenderTargetCount = 0;
 		}
@@ -92,6 +94,12 @@ namespace DragonflyGraphicsWrappers {
 			cmdListPtr[0]->SetGraphicsRoot32BitConstants(RS_PARAMID_CONSTANTS, data->Length / 4, pinnedData, 0);
 		}
 
+		void DF_CommandList12::SetRootConstants(cli::array<System::Byte>^ data, int byteOffset, int byteCount)
+		{
+			pin_ptr<System::Byte> pinnedData = &data[byteOffset];
+			cmdListPtr[0]->SetGraphicsRoot32BitConstants(RS_PARAMID_CONSTANTS, byteCount / 4, pinnedData, byteOffset / 4);
+		}
+
 		void DF_CommandList12::SetGlobalConstantBuffer(DF_Resource12^ cbuffer, int byteOffset)
 		{
 			cmdListPtr[0]->SetGraphicsRootConstantBufferView(RS_PARAMID_CBV_GLOBALS, cbuffer->GetResource()->GetGPUVirtualAddress() + byteOffset);
@@ -104,28 +112,32 @@ namespace DragonflyGraphicsWrappers {
 
 		void DF_CommandList12::SetRenderTargets(cli::array<DF_Resource12^>^ renderTargets, DF_Resource12^ depthStencil)
 		{
-			TransitionOutRenderTargets();
+			UINT newRenderTargetCount = 0;
+			while (newRenderTargetCount < (UINT)renderTargets->Length && renderTargets[newRenderTargetCount])
+				newRenderTargetCount++;
 
-			// prepare descriptors and barrirers for render targets
-			D3D12_CPU_DESCRIPTOR_HANDLE rtDescrList[8];
+			// transition out the previous render targets in the same barrier group of the new ones,
+			// skipping the targets that stay bound
 			BarrierGroup barriers(GetList());
-			for (int i = 0; i < renderTargets->Length; i++)
+			for (UINT i = 0; i < curRenderTargetCount; i++)
 			{
-				if (!renderTargets[i])
-				{
-					curRenderTargetCount = i;
-					break;
-				}
+				if (System::Array::IndexOf(renderTargets, curRenderTargets[i], 0, newRenderTargetCount) < 0)
+					curRenderTargets[i]->AddTransition(D3D12_RESOURCE_STATE_RENDER_TARGET, GetUnboundRenderTargetState(curRenderTargets[i]), barriers);
+			}
 
-				curRenderTargets[i] = renderTargets[i];
+			// prepare descriptors and barriers for the new render targets
+			D3D12_CPU_DESCRIPTOR_HANDLE rtDescrList[8];
+			for (UINT i = 0; i < newRenderTargetCount; i++)
+			{
 				rtDescrList[i] = renderTargets[i]->GetRTV();
-
-				D3D12_RESOURCE_STATES prevState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-				if ((curRenderTargets[i]->Flags & DF_Resource12Flags::FrameBuffer) == DF_Resource12Flags::FrameBuffer)
-					prevState = D3D12_RESOURCE_STATE_PRESENT;
-				renderTargets[i]->AddTransition(prevState, D3D12_RESOURCE_STATE_RENDER_TARGET, barriers);
+				if (System::Array::IndexOf(curRenderTargets, renderTargets[i], 0, curRenderTargetCount) < 0)
+					renderTargets[i]->AddTransition(GetUnboundRenderTargetState(renderTargets[i]), D3D12_RESOURCE_STATE_RENDER_TARGET, barriers);
 			}
 
+			for (UINT i = 0; i < newRenderTargetCount; i++)
+				curRenderTargets[i] = renderTargets[i];
+			curRenderTargetCount = newRenderTargetCount;
+
 			// prepare depth stencil descriptor
 			D3D12_CPU_DESCRIPTOR_HANDLE dsDescr;
 			if (depthStencil)
@@ -50,6 +50,11 @@ namespace DragonflyGraphicsWrappers {
 
 			void SetRootConstants(cli::array<System::Byte>^ data);
 
+			/// <summary>
+			/// Update only a range of the root constants. Offset and size must be multiple of 4 bytes.
+			/// </summary>
+			void SetRootConstants(cli::array<System::Byte>^ data, int byteOffset, int byteCount);
+
 			void SetGlobalConstantBuffer(DF_Resource12^ cbuffer, int byteOffset);
 
 			void SetLocalConstantBuffer(DF_Resource12^ cbuffer, int byteOffset);
@@ -4,6 +4,8 @@
 #include "DF_Directx3D12.h"
 #include "DF_DescriptorHeap12.h"
 #include "DF_PipelineState12.h"
+#include "DF_Heap12.h"
+#include "DF_PipelineLibrary12.h"
 #include "DF_D3D12Device.h"
 #include "WICTextureLoader12.h"
 #include "DDSTextureLoader12.h"
@@ -91,7 +93,7 @@ namespace DragonflyGraphicsWrappers {
 			D3D12_CLEAR_VALUE clearValue = {};
 			clearValue.Format = renderTargetDesc.Format;
 
-			return CreateCommittedRes(renderTargetDesc, &clearValue, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_HEAP_TYPE_DEFAULT, ResourceViews::RTV | ResourceViews::SRV);
+			return CreateRes(renderTargetDesc, &clearValue, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_HEAP_TYPE_DEFAULT, ResourceViews::RTV | ResourceViews::SRV);
 		}
 
 		DF_Resource12^ DF_D3D12Device::CreateDepthBuffer(UINT width, UINT height)
@@ -113,7 +115,7 @@ namespace DragonflyGraphicsWrappers {
 			clearValue.DepthStencil.Depth = 0.0f;
 			clearValue.DepthStencil.Stencil = 0;
 			
-			return CreateCommittedRes(depthStencilDesc, &clearValue, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_HEAP_TYPE_DEFAULT, ResourceViews::DSV);
+			return CreateRes(depthStencilDesc, &clearValue, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_HEAP_TYPE_DEFAULT, ResourceViews::DSV);
 		}
 
 		DF_Resource12^ DF_D3D12Device::CreateBuffer(int byteSize, DF_CPUAccess cpuAccess)
@@ -131,7 +133,7 @@ namespace DragonflyGraphicsWrappers {
 			cbufferDesc.SampleDesc.Quality = 0;
 			cbufferDesc.Width = byteSize;
 
-			return CreateCommittedRes(
+			return CreateRes(
 				cbufferDesc, nullptr, 
 				cpuAccess == DF_CPUAccess::Write ? D3D12_RESOURCE_STATE_GENERIC_READ : (cpuAccess == DF_CPUAccess::Read ? D3D12_RESOURCE_STATE_COPY_DEST : D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
 				cpuAccess == DF_CPUAccess::Write ? D3D12_HEAP_TYPE_UPLOAD : (cpuAccess == DF_CPUAccess::Read ? D3D12_HEAP_TYPE_READBACK : D3D12_HEAP_TYPE_DEFAULT),
@@ -149,13 +151,23 @@ namespace DragonflyGraphicsWrappers {
 
 		DF_Resource12^ DF_D3D12Device::CreateIndexBuffer(int indexCount, DF_CPUAccess cpuAccess)
 		{
-			int byteSize = sizeof(WORD) * indexCount;
+			return CreateIndexBuffer(indexCount, cpuAccess, false);
+		}
+
+		DF_Resource12^ DF_D3D12Device::CreateIndexBuffer(int indexCount, DF_CPUAccess cpuAccess, bool use32BitIndices)
+		{
+			int byteSize = (use32BitIndices ? sizeof(DWORD) : sizeof(WORD)) * indexCount;
 			DF_Resource12^ ibResource = CreateBuffer(byteSize, cpuAccess);
-			ibResource->PrepareIBV(byteSize);
+			ibResource->PrepareIBV(byteSize, use32BitIndices);
 			return ibResource;
 		}
 
 		DF_PipelineState12^ DF_D3D12Device::CreatePSO(DF_PSODesc12 psoDesc)
+		{
+			return CreatePSO(psoDesc, nullptr, nullptr);
+		}
+
+		DF_PipelineState12^ DF_D3D12Device::CreatePSO(DF_PSODesc12 psoDesc, DF_PipelineLibrary12^ library, System::String^ name)
 		{
 			pin_ptr<System::Byte> pinPtrVS = &psoDesc.CompiledVS[psoDesc.CompiledVSFirstByteIndex];
 			pin_ptr<System::Byte> pinPtrPS = &psoDesc.CompiledPS[psoDesc.CompiledPSFirstByteIndex];
@@ -206,15 +218,78 @@ namespace DragonflyGraphicsWrappers {
 				dx12PsoDesc.RTVFormats[i] = DX12Conv::SurfaceToDXGIFORMAT(psoDesc.RenderTargetFormats[i]);
 			dx12PsoDesc.SampleDesc.Count = 1;
 
-			// Create the pipeline state
-			ID3D12PipelineState* psoResource;
-			DF_D3DErrors::Throw(devicePtr[0]->CreateGraphicsPipelineState(&dx12PsoDesc, IID_PPV_ARGS(&psoResource)));
+			// try loading the pipeline state from the library
+			ID3D12PipelineState* psoResource = NULL;
+			marshal_context marshalCtx;
+			const wchar_t* psoName = library ? marshalCtx.marshal_as<const wchar_t*>(name) : NULL;
+			if (library && FAILED(library->GetLibrary()->LoadGraphicsPipeline(psoName, &dx12PsoDesc, IID_PPV_ARGS(&psoResource))))
+				psoResource = NULL; // not stored yet, or stored with a different description
+
+			if (!psoResource)
+			{
+				// Create the pipeline state
+				HRESULT hr = devicePtr[0]->CreateGraphicsPipelineState(&dx12PsoDesc, IID_PPV_ARGS(&psoResource));
+				if (FAILED(hr))
+				{
+					delete[] dx12InputElems;
+					DF_D3DErrors::Throw(hr);
+				}
+
+				// store it for the next runs, failures are ignored since a pipeline with the same name could be already stored
+				if (library)
+					library->GetLibrary()->StorePipeline(psoName, psoResource);
+			}
 
 			delete[] dx12InputElems;
 
 			return gcnew DF_PipelineState12(psoResource);
 		}
 
+		DF_PipelineLibrary12^ DF_D3D12Device::CreatePipelineLibrary(cli::array<System::Byte>^ serialized)
+		{
+			CComPtr<ID3D12Device1> device1;
+			if (FAILED(devicePtr[0]->QueryInterface(IID_PPV_ARGS(&device1))))
+				return nullptr;
+
+			// the serialized data must be kept alive with the library, copy it to native memory
+			SIZE_T blobSize = serialized != nullptr ? serialized->Length : 0;
+			BYTE* blob = NULL;
+			if (blobSize > 0)
+			{
+				blob = new BYTE[blobSize];
+				Marshal::Copy(serialized, 0, System::IntPtr(blob), (int)blobSize);
+			}
+
+			ID3D12PipelineLibrary* library = NULL;
+			HRESULT hr = device1->CreatePipelineLibrary(blob, blobSize, IID_PPV_ARGS(&library));
+			if (FAILED(hr) && blob)
+			{
+				// the data is corrupted or has been serialized by a different adapter or driver: start from an empty library
+				delete[] blob;
+				blob = NULL;
+				hr = device1->CreatePipelineLibrary(NULL, 0, IID_PPV_ARGS(&library));
+			}
+
+			if (FAILED(hr))
+				return nullptr; // not supported
+			return gcnew DF_PipelineLibrary12(library, blob);
+		}
+
+		DF_Heap12^ DF_D3D12Device::CreateHeap(UINT64 byteSize, DF_HeapKind12 kind)
+		{
+			return gcnew DF_Heap12(devicePtr[0], byteSize, kind);
+		}
+
+		void DF_D3D12Device::SetHeapAllocator(DF_IHeapAllocator12^ allocator)
+		{
+			heapAllocator = allocator;
+		}
+
+		void DF_D3D12Device::SetUploadAllocator(DF_IUploadAllocator12^ allocator)
+		{
+			uploadAllocator = allocator;
+		}
+
 		DF_Resource12^ DF_D3D12Device::CreateTexture(cli::array<System::Byte>^ fileBytes, bool isDDS, DF_CommandList12^ copyCommandList, DF_Resource12^% uploadResource, int% width, int% height)
 		{
 			pin_ptr<System::Byte> fileBytesPtr = &fileBytes[0];
@@ -234,12 +309,14 @@ namespace DragonflyGraphicsWrappers {
 				DF_D3DErrors::Throw(DirectX::LoadWICTextureFromMemoryEx(GetDevice(), fileBytesPtr, fileBytes->Length, 0Ui64, D3D12_RESOURCE_FLAG_NONE, DirectX::WIC_LOADER_IGNORE_SRGB, managedTex->GetResourcePtr(), wicData, subresources[0]));
 			}
 
-			// create an updload resource to copy the texture data to the default resource
+			// allocate an updload range to copy the texture data to the default resource
 			const UINT64 uploadBufferSize = GetRequiredIntermediateSize(managedTex->GetResource(), 0, static_cast<UINT>(subresources.size()));
-			uploadResource = CreateCommittedRes(CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize), nullptr, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_HEAP_TYPE_UPLOAD, ResourceViews::None);
+			UINT64 uploadOffset;
+			DF_Resource12^ stagingResource = AllocateStaging(uploadBufferSize, uploadOffset);
+			uploadResource = IsStagingPooled() ? nullptr : stagingResource;
 
 			// use the specified command list to update the texture data
-			UpdateSubresources(copyCommandList->GetList(), managedTex->GetResource(), uploadResource->GetResource(), 0, 0, static_cast<UINT>(subresources.size()), subresources.data());
+			UpdateSubresources(copyCommandList->GetList(), managedTex->GetResource(), stagingResource->GetResource(), uploadOffset, 0, static_cast<UINT>(subresources.size()), subresources.data());
 
 			// sync for update completion before usage
 			BarrierGroup barriers(copyCommandList->GetList());
@@ -260,7 +337,7 @@ namespace DragonflyGraphicsWrappers {
 		DF_Resource12^ DF_D3D12Device::CreateTexture(UINT width, UINT height, DF_SurfaceFormat format)
 		{
 			// create texture on the default heap
-			DF_Resource12^ managedTex = CreateCommittedRes(
+			DF_Resource12^ managedTex = CreateRes(
 				CD3DX12_RESOURCE_DESC::Tex2D(DX12Conv::SurfaceToDXGIFORMAT(format), width, height, 1U, 1U), 
 				nullptr, 
 				D3D12_RESOURCE_STATE_COPY_DEST, 
@@ -336,18 +413,31 @@ namespace DragonflyGraphicsWrappers {
 			WaitForGPU();
 		}
 
-		DF_Resource12^ DF_D3D12Device::CreateCommittedRes(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue, D3D12_RESOURCE_STATES initialState, D3D12_HEAP_TYPE heapType, ResourceViews requiredViews)
+		DF_Resource12^ DF_D3D12Device::CreateRes(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue, D3D12_RESOURCE_STATES initialState, D3D12_HEAP_TYPE heapType, ResourceViews requiredViews)
 		{
-			// create as a committed resource
-			ID3D12Resource* committedRes;
-			DF_D3DErrors::Throw(devicePtr[0]->CreateCommittedResource(
-				&CD3DX12_HEAP_PROPERTIES(heapType),
-				D3D12_HEAP_FLAG_NONE,
-				&desc,
-				initialState,
-				clearValue,
-				IID_PPV_ARGS(&committedRes)));
-			DF_Resource12^ managedRes = gcnew DF_Resource12(committedRes, initialState);
+			DF_Resource12^ managedRes;
+
+			// try to place the resource on a heap
+			int allocationID;
+			ID3D12Resource* placedRes = CreatePlacedRes(desc, clearValue, initialState, heapType, allocationID);
+			if (placedRes)
+			{
+				managedRes = gcnew DF_Resource12(placedRes, initialState);
+				managedRes->SetHeapAllocation(heapAllocator, allocationID);
+			}
+			else
+			{
+				// create as a committed resource
+				ID3D12Resource* committedRes;
+				DF_D3DErrors::Throw(devicePtr[0]->CreateCommittedResource(
+					&CD3DX12_HEAP_PROPERTIES(heapType),
+					D3D12_HEAP_FLAG_NONE,
+					&desc,
+					initialState,
+					clearValue,
+					IID_PPV_ARGS(&committedRes)));
+				managedRes = gcnew DF_Resource12(committedRes, initialState);
+			}
 
 			// prepare views
 			if (HAS_FLAG(requiredViews, ResourceViews::RTV))
@@ -362,6 +452,72 @@ namespace DragonflyGraphicsWrappers {
 			return managedRes;
 		}
 
+		ID3D12Resource* DF_D3D12Device::CreatePlacedRes(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue, D3D12_RESOURCE_STATES initialState, D3D12_HEAP_TYPE heapType, int% allocationID)
+		{
+			if (heapAllocator == nullptr)
+				return NULL;
+
+			// select the heap kind, render targets and depth buffers are kept committed since placed ones require an explicit initialization
+			DF_HeapKind12 heapKind;
+			if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER && heapType == D3D12_HEAP_TYPE_DEFAULT)
+				heapKind = DF_HeapKind12::Buffers;
+			else if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER && heapType == D3D12_HEAP_TYPE_UPLOAD)
+				heapKind = DF_HeapKind12::UploadBuffers;
+			else if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER && heapType == D3D12_HEAP_TYPE_DEFAULT && !(desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)))
+				heapKind = DF_HeapKind12::Textures;
+			else
+				return NULL;
+
+			// query size and alignment, small textures can use a 4KB alignment instead of 64KB
+			D3D12_RESOURCE_DESC placedDesc = desc;
+			D3D12_RESOURCE_ALLOCATION_INFO allocInfo;
+			if (heapKind == DF_HeapKind12::Textures)
+			{
+				placedDesc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+				allocInfo = devicePtr[0]->GetResourceAllocationInfo(0, 1, &placedDesc);
+				if (allocInfo.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+				{
+					placedDesc.Alignment = 0;
+					allocInfo = devicePtr[0]->GetResourceAllocationInfo(0, 1, &placedDesc);
+				}
+			}
+			else
+			{
+				allocInfo = devicePtr[0]->GetResourceAllocationInfo(0, 1, &placedDesc);
+			}
+
+			// reserve a heap range
+			UINT64 heapOffset;
+			DF_Heap12^ heap = heapAllocator->Allocate(heapKind, allocInfo.SizeInBytes, allocInfo.Alignment, heapOffset, allocationID);
+			if (heap == nullptr)
+				return NULL;
+
+			// create the resource
+			ID3D12Resource* placedRes;
+			HRESULT hr = devicePtr[0]->CreatePlacedResource(heap->GetHeap(), heapOffset, &placedDesc, initialState, clearValue, IID_PPV_ARGS(&placedRes));
+			if (FAILED(hr))
+			{
+				heapAllocator->Free(allocationID);
+				DF_D3DErrors::Throw(hr);
+			}
+
+			return placedRes;
+		}
+
+		DF_Resource12^ DF_D3D12Device::AllocateStaging(UINT64 byteSize, UINT64% byteOffset)
+		{
+			if (uploadAllocator != nullptr)
+				return uploadAllocator->Allocate(byteSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, byteOffset);
+
+			byteOffset = 0;
+			return CreateRes(CD3DX12_RESOURCE_DESC::Buffer(byteSize), nullptr, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_HEAP_TYPE_UPLOAD, ResourceViews::None);
+		}
+
+		bool DF_D3D12Device::IsStagingPooled()
+		{
+			return uploadAllocator != nullptr;
+		}
+
 		void DF_D3D12Device::WaitForGPU()
 		{
 			if (!frameBufferFence->IsReleased())
@@ -12,6 +12,8 @@ namespace DragonflyGraphicsWrappers {
 		ref class DF_Resource12;
 		ref class DF_CommandList12;
 		ref class DF_PipelineState12;
+		ref class DF_Heap12;
+		ref class DF_PipelineLibrary12;
 
 		/// <summary>
 		/// The main directx11 device context. 
@@ -32,6 +34,8 @@ namespace DragonflyGraphicsWrappers {
 			DF_DescriptorHeap12^ srvHeap; // descriptor heap that stores SRVs
 			cli::array<DF_Resource12^>^ frameBuffers; // frame buffer resources
 			DF_Resource12^ defaultDepth; // default depth buffer 
+			DF_IHeapAllocator12^ heapAllocator; // allocator used to place resources on heaps, if null all resources are committed
+			DF_IUploadAllocator12^ uploadAllocator; // allocator used for staging memory, if null a new upload buffer is created for each copy
 
 		internal:
 			ID3D12Device* GetDevice();
@@ -62,15 +66,44 @@ namespace DragonflyGraphicsWrappers {
 
 			DF_Resource12^ CreateIndexBuffer(int indexCount, DF_CPUAccess cpuAccess);
 
+			DF_Resource12^ CreateIndexBuffer(int indexCount, DF_CPUAccess cpuAccess, bool use32BitIndices);
+
 			DF_PipelineState12^ CreatePSO(DF_PSODesc12 psoDesc);
 
+			/// <summary>
+			/// Load the pipeline state with the specified name from a pipeline library, or create it and store it in the library if not available.
+			/// Can be called from multiple threads.
+			/// </summary>
+			DF_PipelineState12^ CreatePSO(DF_PSODesc12 psoDesc, DF_PipelineLibrary12^ library, System::String^ name);
+
+			/// <summary>
+			/// Create a pipeline library from previously serialized data, or an empty one if the data is null or was serialized by a different device or driver.
+			/// Returns null if pipeline libraries are not supported.
+			/// </summary>
+			DF_PipelineLibrary12^ CreatePipelineLibrary(cli::array<System::Byte>^ serialized);
+
+			/// <summary>
+			/// Create a heap of the specified size, on which resources of the specified kind can be placed.
+			/// </summary>
+			DF_Heap12^ CreateHeap(UINT64 byteSize, DF_HeapKind12 kind);
+
+			/// <summary>
+			/// Set the allocator used to place buffers and textures on heaps. Resources that cannot be placed are created as committed resources.
+			/// </summary>
+			void SetHeapAllocator(DF_IHeapAllocator12^ allocator);
+
+			/// <summary>
+			/// Set the allocator used for the staging memory of texture uploads. When set, texture creation and uploads do not return upload resources to be released.
+			/// </summary>
+			void SetUploadAllocator(DF_IUploadAllocator12^ allocator);
+
 			/// <summary>
 			/// Create a texture on a default heap, from the bytes loaded from a DDS or other image file.
 			/// </summary>
 			/// <param name="fileBytes">The file bytes.</param>
 			/// <param name="isDDS">True if the specified bytes are from a dds file. Only DDS can load mipmaps.</param>
 			/// <param name="copyCommandList">The command list used to upload the texture to gpu.</param>
-			/// <param name="uploadResource">The resource created by this call to upload texture data, the called can then release it when the copy added to the command list is completed.</param>
+			/// <param name="uploadResource">The resource created by this call to upload texture data, the called can then release it when the copy added to the command list is completed. Null if an upload allocator is set.</param>
 			/// <param name="width">The width of the created texture.</param>
 			/// <param name="height">The height if the created texture.</param>
 			/// <returns>The default heap resource of the created texture.</returns>
@@ -133,7 +166,20 @@ namespace DragonflyGraphicsWrappers {
 
 		internal:
 
-			DF_Resource12^ CreateCommittedRes(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue, D3D12_RESOURCE_STATES initialState, D3D12_HEAP_TYPE heapType, ResourceViews requiredViews);
+			/// <summary>
+			/// Create a resource, placed on a heap if an heap allocator is available and the resource type is supported, or as a committed resource otherwise.
+			/// </summary>
+			DF_Resource12^ CreateRes(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue, D3D12_RESOURCE_STATES initialState, D3D12_HEAP_TYPE heapType, ResourceViews requiredViews);
+
+			/// <summary>
+			/// Returns an upload buffer range to be used as a copy source, from the upload allocator if available.
+			/// </summary>
+			DF_Resource12^ AllocateStaging(UINT64 byteSize, UINT64% byteOffset);
+
+			/// <summary>
+			/// Returns true if the staging memory is managed by an upload allocator, so resources returned by AllocateStaging() should not be released.
+			/// </summary>
+			bool IsStagingPooled();
 
 		private:
 
@@ -147,6 +193,8 @@ namespace DragonflyGraphicsWrappers {
 
 			void CreateDefaultHeaps();
 
+			ID3D12Resource* CreatePlacedRes(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue, D3D12_RESOURCE_STATES initialState, D3D12_HEAP_TYPE heapType, int% allocationID);
+
 			void CreateRootSignature(UINT rootConstantsByteSize, cli::array<DF_SamplerDesc12>^ samplerDescList);
 
 			void ReleaseSwapChain();
@@ -0,0 +1,49 @@
+#include "DF_Heap12.h"
+
+namespace DragonflyGraphicsWrappers {
+	namespace DX12 {
+
+		DF_Heap12::DF_Heap12(ID3D12Device* device, UINT64 byteSize, DF_HeapKind12 kind)
+		{
+			D3D12_HEAP_DESC heapDesc = {};
+			heapDesc.SizeInBytes = byteSize;
+			heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			switch (kind)
+			{
+			case DF_HeapKind12::Buffers:
+				heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+				heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+				break;
+			case DF_HeapKind12::UploadBuffers:
+				heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+				heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+				break;
+			case DF_HeapKind12::Textures:
+				heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+				heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+				break;
+			}
+
+			heapPtr = MakeComPtr(ID3D12Heap);
+			DF_D3DErrors::Throw(device->CreateHeap(&heapDesc, IID_PPV_ARGS(heapPtr)));
+			this->byteSize = byteSize;
+			this->kind = kind;
+		}
+
+		UINT64 DF_Heap12::GetSizeInBytes()
+		{
+			return byteSize;
+		}
+
+		DF_HeapKind12 DF_Heap12::GetKind()
+		{
+			return kind;
+		}
+
+		ID3D12Heap* DF_Heap12::GetHeap()
+		{
+			return heapPtr[0];
+		}
+
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "DX12.h"
+
+namespace DragonflyGraphicsWrappers {
+	namespace DX12 {
+
+		/// <summary>
+		/// A directx 12 memory heap, on which resources can be placed at a given offset.
+		/// </summary>
+		public ref class DF_Heap12 : DF_Resource
+		{
+		private:
+			ID3D12Heap** heapPtr;
+			UINT64 byteSize;
+			DF_HeapKind12 kind;
+
+		public:
+			UINT64 GetSizeInBytes();
+
+			DF_HeapKind12 GetKind();
+
+		internal:
+			DF_Heap12(ID3D12Device* device, UINT64 byteSize, DF_HeapKind12 kind);
+
+			ID3D12Heap* GetHeap();
+
+		};
+
+	}
+}
@@ -0,0 +1,40 @@
+#include "DF_PipelineLibrary12.h"
+
+namespace DragonflyGraphicsWrappers {
+	namespace DX12 {
+
+		DF_PipelineLibrary12::DF_PipelineLibrary12(ID3D12PipelineLibrary* library, BYTE* libraryBlob)
+		{
+			this->libraryPtr = TrackComPtr(ID3D12PipelineLibrary, library);
+			this->libraryBlob = libraryBlob;
+		}
+
+		cli::array<System::Byte>^ DF_PipelineLibrary12::Serialize()
+		{
+			SIZE_T byteSize = libraryPtr[0]->GetSerializedSize();
+			cli::array<System::Byte>^ serialized = gcnew cli::array<System::Byte>((int)byteSize);
+			if (byteSize > 0)
+			{
+				pin_ptr<System::Byte> serializedPtr = &serialized[0];
+				DF_D3DErrors::Throw(libraryPtr[0]->Serialize(serializedPtr, byteSize));
+			}
+			return serialized;
+		}
+
+		void DF_PipelineLibrary12::Release()
+		{
+			DF_Resource::Release();
+			if (libraryBlob)
+			{
+				delete[] libraryBlob;
+				libraryBlob = NULL;
+			}
+		}
+
+		ID3D12PipelineLibrary* DF_PipelineLibrary12::GetLibrary()
+		{
+			return libraryPtr[0];
+		}
+
+	}
+}
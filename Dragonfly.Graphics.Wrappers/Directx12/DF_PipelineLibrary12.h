@@ -0,0 +1,33 @@
+#pragma once
+
+#include "DX12.h"
+
+namespace DragonflyGraphicsWrappers {
+	namespace DX12 {
+
+		/// <summary>
+		/// A directx 12 pipeline library, that stores compiled pipeline states by name and can be serialized to skip their compilation on later runs.
+		/// </summary>
+		public ref class DF_PipelineLibrary12 : DF_Resource
+		{
+		private:
+			ID3D12PipelineLibrary** libraryPtr;
+			BYTE* libraryBlob; // serialized data the library was created from, that must be kept alive with it
+
+		public:
+			/// <summary>
+			/// Serialize all the pipeline states stored in this library. Should not be called while pipelines are being stored.
+			/// </summary>
+			cli::array<System::Byte>^ Serialize();
+
+			virtual void Release() override;
+
+		internal:
+			DF_PipelineLibrary12(ID3D12PipelineLibrary* library, BYTE* libraryBlob);
+
+			ID3D12PipelineLibrary* GetLibrary();
+
+		};
+
+	}
+}
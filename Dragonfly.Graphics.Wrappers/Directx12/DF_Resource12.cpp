@@ -71,8 +71,10 @@ namespace DragonflyGraphicsWrappers {
 
 			// create an updload resource to copy the texture data to the default resource
 			const UINT64 uploadBufferSize = GetSizeInBytes();
-			if (uploadResource == nullptr)
-				uploadResource = device->CreateCommittedRes(CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize), nullptr, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_HEAP_TYPE_UPLOAD, ResourceViews::None);
+			DF_Resource12^ stagingResource = uploadResource;
+			UINT64 stagingOffset = 0;
+			if (stagingResource == nullptr)
+				stagingResource = device->AllocateStaging(uploadBufferSize, stagingOffset);
 
 			// use the specified command list to update the texture data
 			D3D12_SUBRESOURCE_DATA textureData = {};
@@ -85,7 +87,9 @@ namespace DragonflyGraphicsWrappers {
 				textureData.RowPitch = static_cast<LONG_PTR>(rowSizeInBytes);
 				textureData.SlicePitch = static_cast<LONG_PTR>(textureData.RowPitch * numRows);
 			}
-			UpdateSubresources(copyCommandList->GetList(), GetResource(), uploadResource->GetResource(), 0, 0, 1U, &textureData);
+			UpdateSubresources(copyCommandList->GetList(), GetResource(), stagingResource->GetResource(), stagingOffset, 0, 1U, &textureData);
+			if (!device->IsStagingPooled())
+				uploadResource = stagingResource; // not pooled, the caller is responsible of its release
 
 			// sync for update completion before usage
 			AddTransitionIfNeeded(D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, barriers);
@@ -120,7 +124,7 @@ namespace DragonflyGraphicsWrappers {
 						if (downloadResource == nullptr)
 						{
 							UINT64 downloadBuffSize = destLocation.PlacedFootprint.Footprint.RowPitch * destLocation.PlacedFootprint.Footprint.Height;
-							downloadResource = device->CreateCommittedRes(CD3DX12_RESOURCE_DESC::Buffer(downloadBuffSize), nullptr, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_HEAP_TYPE_READBACK, ResourceViews::None);
+							downloadResource = device->CreateRes(CD3DX12_RESOURCE_DESC::Buffer(downloadBuffSize), nullptr, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_HEAP_TYPE_READBACK, ResourceViews::None);
 						}
 						destLocation.pResource = downloadResource->GetResource();
 					}
@@ -177,6 +181,8 @@ namespace DragonflyGraphicsWrappers {
 			mappedData[0] = NULL;
 			vbv = NULL;
 			ibv = NULL;
+			heapAllocator = nullptr;
+			heapAllocationID = -1;
 		}
 
 		ID3D12Resource* DF_Resource12::GetResource()
@@ -229,12 +235,12 @@ namespace DragonflyGraphicsWrappers {
 			vbv->SizeInBytes = bufferByteSize;
 		}
 
-		void DF_Resource12::PrepareIBV(UINT bufferByteSize)
+		void DF_Resource12::PrepareIBV(UINT bufferByteSize, bool use32BitIndices)
 		{
 			ibv = new D3D12_INDEX_BUFFER_VIEW();
 			ibv->BufferLocation = resourcePtr[0]->GetGPUVirtualAddress();
 			ibv->SizeInBytes = bufferByteSize;
-			ibv->Format = DXGI_FORMAT_R16_UINT;
+			ibv->Format = use32BitIndices ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
 		}
 
 		D3D12_CPU_DESCRIPTOR_HANDLE DF_Resource12::GetRTV()
@@ -262,6 +268,12 @@ namespace DragonflyGraphicsWrappers {
 			return state;
 		}
 
+		void DF_Resource12::SetHeapAllocation(DF_IHeapAllocator12^ allocator, int allocationID)
+		{
+			heapAllocator = allocator;
+			heapAllocationID = allocationID;
+		}
+
 		BOOL DF_Resource12::AddTransitionIfNeeded(D3D12_RESOURCE_STATES afterState, BarrierGroup& barriers)
 		{
 			if (state & afterState)
@@ -279,6 +291,8 @@ namespace DragonflyGraphicsWrappers {
 
 		void DF_Resource12::Release()
 		{
+			bool placedResource = !IsReleased() && heapAllocator != nullptr;
+
 			if (!IsReleased())
 			{
 				Unmap();
@@ -299,6 +313,13 @@ namespace DragonflyGraphicsWrappers {
 					dsvHeap->FreeSlot(dsvID);
 			}
 			DF_Resource::Release();
+
+			// the heap range can be reused once the resource placed on it is released
+			if (placedResource)
+			{
+				heapAllocator->Free(heapAllocationID);
+				heapAllocator = nullptr;
+			}
 		}
 
 	}
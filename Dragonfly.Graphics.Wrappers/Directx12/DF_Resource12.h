@@ -30,6 +30,8 @@ namespace DragonflyGraphicsWrappers {
 			UINT8** mappedData;
 			D3D12_VERTEX_BUFFER_VIEW *vbv;
 			D3D12_INDEX_BUFFER_VIEW* ibv;
+			DF_IHeapAllocator12^ heapAllocator; // allocator of the heap range this resource is placed on, null for committed resources
+			int heapAllocationID;
 
 		public:
 
@@ -54,7 +56,7 @@ namespace DragonflyGraphicsWrappers {
 			/// <typeparam name="T"></typeparam>
 			/// <param name="data"></param>
 			/// <param name="copyCommandList"></param>
-			/// <param name="uploadResource">An upload resource to upload the specified data to the GPU. If none is specified, a new one will be created.</param>
+			/// <param name="uploadResource">An upload resource to upload the specified data to the GPU. If none is specified, the device upload allocator is used if available, otherwise a new one will be created.</param>
 			generic <typename T> void UploadData(DF_D3D12Device^ device, cli::array<T>^ data, DF_CommandList12^ copyCommandList, DF_Resource12^% uploadResource);
 
 			/// <summary>
@@ -89,7 +91,7 @@ namespace DragonflyGraphicsWrappers {
 
 			void PrepareVBV(UINT vertexByteSize, UINT bufferByteSize);
 
-			void PrepareIBV(UINT bufferByteSize);
+			void PrepareIBV(UINT bufferByteSize, bool use32BitIndices);
 
 			D3D12_CPU_DESCRIPTOR_HANDLE GetRTV();
 
@@ -101,6 +103,11 @@ namespace DragonflyGraphicsWrappers {
 
 			D3D12_RESOURCE_STATES GetState();
 
+			/// <summary>
+			/// Set the heap range this resource is placed on, which is freed when this resource is released.
+			/// </summary>
+			void SetHeapAllocation(DF_IHeapAllocator12^ allocator, int allocationID);
+
 			/// <summary>
 			/// Add a transition to the current resource if needed, and update its current state.
 			/// </summary>
@@ -70,6 +70,16 @@ namespace DragonflyGraphicsWrappers {
 			Write
 		};
 
+		/// <summary>
+		/// The type of resources that can be placed on a DF_Heap12.
+		/// </summary>
+		public enum class DF_HeapKind12
+		{
+			Buffers, // gpu only buffers
+			UploadBuffers, // cpu writable buffers
+			Textures // textures that are not render targets or depth buffers
+		};
+
 		public enum class DF_ResourceState
 		{
 			Common  = D3D12_RESOURCE_STATE_COMMON,
@@ -120,6 +130,44 @@ namespace DragonflyGraphicsWrappers {
 #pragma endregion
 
 
+#pragma region INTERFACES
+
+		ref class DF_Heap12;
+		ref class DF_Resource12;
+
+		/// <summary>
+		/// Sub-allocates heap memory for placed resources. When set to a device, resources that do not fit any heap are created as committed resources.
+		/// </summary>
+		public interface class DF_IHeapAllocator12
+		{
+			/// <summary>
+			/// Reserve a range of a heap of the specified kind.
+			/// </summary>
+			/// <param name="heapOffset">The offset of the reserved range in the returned heap.</param>
+			/// <param name="allocationID">An id that is later used to free the range.</param>
+			/// <returns>The heap that contains the range, or null if the request cannot be satisfied.</returns>
+			DF_Heap12^ Allocate(DF_HeapKind12 kind, UINT64 byteSize, UINT64 alignment, [System::Runtime::InteropServices::Out] UINT64% heapOffset, [System::Runtime::InteropServices::Out] int% allocationID);
+
+			/// <summary>
+			/// Free a range once the resource placed on it has been released.
+			/// </summary>
+			void Free(int allocationID);
+		};
+
+		/// <summary>
+		/// Sub-allocates short-lived upload memory, used as staging to copy data to gpu resources.
+		/// </summary>
+		public interface class DF_IUploadAllocator12
+		{
+			/// <summary>
+			/// Reserve a range of an upload buffer that stays valid until the copies recorded in the current frame are executed.
+			/// </summary>
+			/// <param name="byteOffset">The offset of the reserved range in the returned buffer.</param>
+			DF_Resource12^ Allocate(UINT64 byteSize, UINT64 alignment, [System::Runtime::InteropServices::Out] UINT64% byteOffset);
+		};
+
+#pragma endregion
+
 #pragma region Utils
 
 		public ref class DX12Conv abstract sealed
@@ -1,10 +1,12 @@
-﻿using System;
+﻿using Dragonfly.Graphics.Resources;
+using System;
 
 namespace Dragonfly.Graphics.API
 {
     internal class CBuffer
     {
         private byte[] buffer;
+        private int changedStart, changedEnd; // range of bytes modified since the last upload
 
         public CBufferBinding Bindings { get; private set; }
 
@@ -17,26 +19,30 @@ namespace Dragonfly.Graphics.API
 
         public void SetValue(string name, int[] value)
         {
-            Buffer.BlockCopy(value, 0, buffer, Bindings.GetByteAddress(name), value.Length * 4);
-            Changed = true;
+            int byteAddress = Bindings.GetByteAddress(name);
+            Buffer.BlockCopy(value, 0, buffer, byteAddress, value.Length * 4);
+            MarkChanged(byteAddress, value.Length * 4);
         }
 
         public void SetValue(string name, float[] value)
         {
-            Buffer.BlockCopy(value, 0, buffer, Bindings.GetByteAddress(name), value.Length * 4);
-            Changed = true;
+            int byteAddress = Bindings.GetByteAddress(name);
+            Buffer.BlockCopy(value, 0, buffer, byteAddress, value.Length * 4);
+            MarkChanged(byteAddress, value.Length * 4);
         }
 
         public void SetValue(int nameHash, int[] value)
         {
-            Buffer.BlockCopy(value, 0, buffer, Bindings.GetByteAddress(nameHash), value.Length * 4);
-            Changed = true;
+            int byteAddress = Bindings.GetByteAddress(nameHash);
+            Buffer.BlockCopy(value, 0, buffer, byteAddress, value.Length * 4);
+            MarkChanged(byteAddress, value.Length * 4);
         }
 
         public void SetValue(int nameHash, float[] value)
         {
-            Buffer.BlockCopy(value, 0, buffer, Bindings.GetByteAddress(nameHash), value.Length * 4);
-            Changed = true;
+            int byteAddress = Bindings.GetByteAddress(nameHash);
+            Buffer.BlockCopy(value, 0, buffer, byteAddress, value.Length * 4);
+            MarkChanged(byteAddress, value.Length * 4);
         }
 
         public bool TrySetValue(int nameHash, int[] value)
@@ -45,7 +51,7 @@ namespace Dragonfly.Graphics.API
             if (Bindings.TryGetByteAddress(nameHash, out byteAddress))
             {
                 Buffer.BlockCopy(value, 0, buffer, byteAddress, value.Length * 4);
-                Changed = true;
+                MarkChanged(byteAddress, value.Length * 4);
                 return true;
             }
             return false;
@@ -57,7 +63,45 @@ namespace Dragonfly.Graphics.API
             if (Bindings.TryGetByteAddress(nameHash, out byteAddress))
             {
                 Buffer.BlockCopy(value, 0, buffer, byteAddress, value.Length * 4);
-                Changed = true;
+                MarkChanged(byteAddress, value.Length * 4);
+                return true;
+            }
+            return false;
+        }
+
+        public void SetValue(ShaderParam param, int[] value)
+        {
+            int byteAddress = Bindings.GetByteAddress(param);
+            Buffer.BlockCopy(value, 0, buffer, byteAddress, value.Length * 4);
+            MarkChanged(byteAddress, value.Length * 4);
+        }
+
+        public void SetValue(ShaderParam param, float[] value)
+        {
+            int byteAddress = Bindings.GetByteAddress(param);
+            Buffer.BlockCopy(value, 0, buffer, byteAddress, value.Length * 4);
+            MarkChanged(byteAddress, value.Length * 4);
+        }
+
+        public bool TrySetValue(ShaderParam param, int[] value)
+        {
+            int byteAddress;
+            if (Bindings.TryGetByteAddress(param, out byteAddress))
+            {
+                Buffer.BlockCopy(value, 0, buffer, byteAddress, value.Length * 4);
+                MarkChanged(byteAddress, value.Length * 4);
+                return true;
+            }
+            return false;
+        }
+
+        public bool TrySetValue(ShaderParam param, float[] value)
+        {
+            int byteAddress;
+            if (Bindings.TryGetByteAddress(param, out byteAddress))
+            {
+                Buffer.BlockCopy(value, 0, buffer, byteAddress, value.Length * 4);
+                MarkChanged(byteAddress, value.Length * 4);
                 return true;
             }
             return false;
@@ -65,14 +109,16 @@ namespace Dragonfly.Graphics.API
 
         public void SetValue(string name, int[] value, int length)
         {
-            Buffer.BlockCopy(value, 0, buffer, Bindings.GetByteAddress(name), length * 4);
-            Changed = true;
+            int byteAddress = Bindings.GetByteAddress(name);
+            Buffer.BlockCopy(value, 0, buffer, byteAddress, length * 4);
+            MarkChanged(byteAddress, length * 4);
         }
 
         public void SetValue(string name, float[] value, int length)
         {
-            Buffer.BlockCopy(value, 0, buffer, Bindings.GetByteAddress(name), length * 4);
-            Changed = true;
+            int byteAddress = Bindings.GetByteAddress(name);
+            Buffer.BlockCopy(value, 0, buffer, byteAddress, length * 4);
+            MarkChanged(byteAddress, length * 4);
         }
 
         public byte[] ToByteArray()
@@ -80,7 +126,43 @@ namespace Dragonfly.Graphics.API
             return buffer;
         }
 
-        public bool Changed { get; set; }
+        /// <summary>
+        /// Returns true if any value has been modified since this flag was last cleared. Setting it to true marks the whole buffer as modified.
+        /// </summary>
+        public bool Changed
+        {
+            get
+            {
+                return changedEnd > changedStart;
+            }
+            set
+            {
+                changedStart = value ? 0 : buffer.Length;
+                changedEnd = value ? buffer.Length : 0;
+            }
+        }
+
+        /// <summary>
+        /// Byte offset of the first modified byte.
+        /// </summary>
+        public int ChangedByteOffset
+        {
+            get { return changedStart; }
+        }
+
+        /// <summary>
+        /// Size in bytes of the smallest range that contains all the modified bytes.
+        /// </summary>
+        public int ChangedByteCount
+        {
+            get { return System.Math.Max(0, changedEnd - changedStart); }
+        }
+
+        private void MarkChanged(int byteAddress, int byteCount)
+        {
+            changedStart = System.Math.Min(changedStart, byteAddress);
+            changedEnd = System.Math.Max(changedEnd, byteAddress + byteCount);
+        }
 
         public void CopyTo(CBuffer other)
         {
@@ -1,46 +1,52 @@
 ﻿using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
+using System.Threading;
 using Dragonfly.Utils;
-using System.Linq;
 
 namespace Dragonfly.Graphics.API.Common
 {
     /// <summary>
     /// Coordinate command lists execution taking their prerequisites into account and implementing thread safety.
+    /// Lists and their prerequisites form a dependency graph, in which each node counts the prerequisites that still have to be queued:
+    /// a list becomes ready for execution as soon as it's queued and its counter reaches zero, without any lock being taken.
     /// </summary>
     internal class CmdListCoordinator
     {
-        struct CmdListDecl
+        private class ListNode
         {
-            public GraphicResourceID ID;
-            public IReadOnlyList<GraphicResourceID> RequiredIDs;
+            public GraphicResourceID ID; // null for the barriers added by Flush()
+            public long FrameID; // last frame in which this node has been used
+            public bool Declared;
+            public int Queued;
+            public int Pending; // prerequisites that are not ready yet, plus one until the list is queued
+            public int DependentCount; // number of published dependents, or -1 when this node is ready and no more dependents can be added
+            public ListNode[] Dependents = new ListNode[4];
+            public List<ListNode> Requires = new List<ListNode>(); // used to validate the graph topology
         }
 
-        private object CMDLIST_SYNC; // used to synchronize command list on the main context
-        private Dictionary<GraphicResourceID, CmdListDecl> lists; // all lists declared for this frame
-        private HashSet<GraphicResourceID> allRequirements; // a set which merge all the required lists by all passes (used to solve the graph stages)
-        private HashSet<GraphicResourceID> staged; // lists that have already been organized into stages
-        private HashSet<GraphicResourceID> waitingLists; // list that have been queued for execution, but cannot be executed because required lists have still to be queued
-        private ObjectPool<HashSet<GraphicResourceID>> stagePool; // pool to generate lists to be used to store toghether lists that should be executed in parallel
-        private List<HashSet<GraphicResourceID>> stages; // sets of cmd lists that should be executed toghether on this frame
+        private ConcurrentDictionary<GraphicResourceID, ListNode> nodes; // nodes of all the lists declared so far, only added by the main thread
+        private List<ListNode> frameNodes; // nodes used in the current frame
+        private List<ListNode> barriers; // barrier nodes, re-used each frame
+        private List<ListNode> curGroup; // nodes declared since the last flush
+        private ListNode lastBarrier;
+        private int usedBarrierCount;
+        private long frameID;
+        private ConcurrentQueue<GraphicResourceID> readyLists;
+        private ManualResetEventSlim readyEvent;
+        private int remainingListCount; // lists declared this frame and not yet returned by WaitReadyLists()
+        private Digest128 topologyDigest, validatedDigest;
 
         public CmdListCoordinator()
         {
-            CMDLIST_SYNC = new object();
-            lists = new Dictionary<GraphicResourceID, CmdListDecl>();
-            waitingLists = new HashSet<GraphicResourceID>();
-            staged = new HashSet<GraphicResourceID>();
-            stagePool = new ObjectPool<HashSet<GraphicResourceID>>(() => new HashSet<GraphicResourceID>(), l => l.Clear());
-            stages = new List<HashSet<GraphicResourceID>>();
-            allRequirements = new HashSet<GraphicResourceID>();
-            ToBeExecuted = new BlockingQueue<HashSet<GraphicResourceID>>();
+            nodes = new ConcurrentDictionary<GraphicResourceID, ListNode>();
+            frameNodes = new List<ListNode>();
+            barriers = new List<ListNode>();
+            curGroup = new List<ListNode>();
+            readyLists = new ConcurrentQueue<GraphicResourceID>();
+            readyEvent = new ManualResetEventSlim(false);
         }
 
-        /// <summary>
-        /// List of queues ready to be executed
-        /// </summary>
-        public BlockingQueue<HashSet<GraphicResourceID>> ToBeExecuted { get; private set; }
-
         /// <summary>
         /// Set to true when all the command lists have been executed for this frame.
         /// </summary>
@@ -48,28 +54,27 @@ namespace Dragonfly.Graphics.API.Common
         {
             get
             {
-                lock(CMDLIST_SYNC)
-                {
-                    return stages.Count == 0 && ToBeExecuted.Count == 0;
-                }
+                return Volatile.Read(ref remainingListCount) == 0;
             }
         }
 
         public void NewFrame()
         {
-            lock (CMDLIST_SYNC)
-            {
-                lists.Clear();
-                waitingLists.Clear();
-                staged.Clear();
-                stages.Clear();
-                stagePool.FreeAll();
-                ToBeExecuted.Clear();
-            }
+            frameID++;
+            frameNodes.Clear();
+            curGroup.Clear();
+            lastBarrier = null;
+            usedBarrierCount = 0;
+            remainingListCount = 0;
+            topologyDigest = Digest128.Seed;
+            GraphicResourceID discarded;
+            while (readyLists.TryDequeue(out discarded)) ;
+            readyEvent.Reset();
         }
 
         /// <summary>
-        /// Call this function to signal that the given command list will be executed this frame.
+        /// Call this function to signal that the given command list will be executed this frame. Must be called on the main rendering thread.
+        /// The required lists can be declared before or after this one.
         /// </summary>
         public void DeclareList(GraphicResourceID cmdListID, IReadOnlyList<GraphicResourceID> requiredListIDs)
         {
@@ -77,114 +82,257 @@ namespace Dragonfly.Graphics.API.Common
             if (cmdListID == null)
                 throw new ArgumentNullException();
 #endif
-            lock (CMDLIST_SYNC)
+            ListNode node = GetFrameNode(cmdListID);
+#if DEBUG
+            if (node.Declared)
+                throw new InvalidOperationException("DeclareList() cannot be called twice on the same list in a frame!");
+#endif
+            node.Declared = true;
+            Interlocked.Increment(ref remainingListCount);
+            topologyDigest.Add(cmdListID.GetHashCode());
+            topologyDigest.Add(requiredListIDs.Count);
+
+            // the list cannot be queued during its declaration, so its counter can't reach zero here
+            for (int i = 0; i < requiredListIDs.Count; i++)
             {
-                lists.Add(cmdListID, new CmdListDecl() { ID = cmdListID, RequiredIDs = requiredListIDs });
-                for (int i = 0; i < requiredListIDs.Count; i++)
-                    allRequirements.Add(requiredListIDs[i]);
+                topologyDigest.Add(requiredListIDs[i].GetHashCode());
+                AddDependency(node, GetFrameNode(requiredListIDs[i]));
             }
+            if (lastBarrier != null)
+                AddDependency(node, lastBarrier);
+
+            curGroup.Add(node);
         }
 
         /// <summary>
-        /// Solve the dependencies between the declared lists, separating them in stages that can be executed in parallel.
-        /// This should be called after each group of lists that should precede the others has been declared, and at least once after all the lists have been declared.
+        /// Make all the lists declared after this call execute after the ones already declared, regardless of their dependencies.
+        /// Must be called on the main rendering thread.
         /// </summary>
-        public void SolveRenderStages()
+        public void Flush()
         {
-            lock (CMDLIST_SYNC)
-            {
-                int stageID = 0;
+            if (usedBarrierCount == barriers.Count)
+                barriers.Add(new ListNode());
+            ListNode barrier = barriers[usedBarrierCount++];
+            ResetNode(barrier);
+            topologyDigest.Add(-1);
 
-                // find the last stage (a cmd list not required by any other)
-                {
-                    foreach (CmdListDecl cmdList in lists.Values)
-                    {
-                        if (staged.Contains(cmdList.ID))
-                            continue; // already staged
+            // the barrier depends on all the lists declared since the last one
+            foreach (ListNode node in curGroup)
+                AddDependency(barrier, node);
+            if (lastBarrier != null)
+                AddDependency(barrier, lastBarrier);
+            curGroup.Clear();
+            lastBarrier = barrier;
 
+            // barriers are never queued, remove its token
+            Release(barrier);
+        }
 
-                        if (allRequirements.Contains(cmdList.ID))
-                            continue; // required by another, cannot be the last stage
+        /// <summary>
+        /// Must be called on the main rendering thread once all the lists of this frame have been declared.
+        /// Validates the dependency graph when it differs from the one of the previous frames.
+        /// </summary>
+        public void EndDeclarations()
+        {
+            if (topologyDigest != validatedDigest)
+            {
+                ValidateTopology();
+                validatedDigest = topologyDigest;
+            }
 
+            // lists required but not declared this frame won't be queued, consider them ready
+            for (int i = 0; i < frameNodes.Count; i++)
+            {
+                if (!frameNodes[i].Declared && Interlocked.Exchange(ref frameNodes[i].Queued, 1) == 0)
+                    Release(frameNodes[i]);
+            }
+        }
+
+        /// <summary>
+        /// Signal that the given list has been closed and can be executed once its prerequisites are. Can be called from any thread.
+        /// </summary>
+        public void QueueExecution(GraphicResourceID cmdListID)
+        {
+            ListNode node;
 #if DEBUG
-                        if (stageID > 0)
-                            throw new Exception("Invalid Command Lists: more than one command list is not required by the others: the dependecies between them must form a single tree!");
+            if (cmdListID == null)
+                throw new ArgumentNullException();
+            if (!nodes.TryGetValue(cmdListID, out node) || node.FrameID != frameID || !node.Declared)
+                throw new InvalidOperationException("QueueExecution() cannot be called on a list that has not been declared with DeclareList()!");
+            if (Interlocked.Exchange(ref node.Queued, 1) != 0)
+                throw new InvalidOperationException("QueueExecution() cannot be called twice on the same list!");
+#else
+            node = nodes[cmdListID];
+            node.Queued = 1;
 #endif
+            Release(node);
+        }
 
-                        // push the last stage made by a single list
-                        HashSet<GraphicResourceID> lastStage = stagePool.CreateNew();
-                        lastStage.Add(cmdList.ID);
-                        stages.Insert(stageID++, lastStage);
-                        staged.Add(cmdList.ID);
-#if !DEBUG
-                        break;
-#endif
-                    }
-                    allRequirements.Clear();
-                }
+        /// <summary>
+        /// Wait until at least one list is ready for execution, then move all the ready lists to the specified list, in a valid execution order.
+        /// Must be called from a single thread, while EndOfFrame is false.
+        /// </summary>
+        public void WaitReadyLists(List<GraphicResourceID> readyListIDs)
+        {
+            readyListIDs.Clear();
+            while (true)
+            {
+                GraphicResourceID id;
+                while (readyLists.TryDequeue(out id))
+                    readyListIDs.Add(id);
 
-                // iteratively fill the other stages
-                while (true)
+                if (readyListIDs.Count > 0)
                 {
-                    // fill a new stage with  all the requirements from the current
-                    HashSet<GraphicResourceID> prevStage = stages[stageID - 1], curStage = stagePool.CreateNew();
-                    foreach (GraphicResourceID id in prevStage)
-                    {
-                        IReadOnlyList<GraphicResourceID> requiredIDs = lists[id].RequiredIDs;
-                        for (int i = 0; i < requiredIDs.Count; i++)
-                            curStage.Add(requiredIDs[i]);
-                    }
-
-                    // if there are no other requirements, the previous stage was the last one
-                    if (curStage.Count == 0)
-                        break;
-
-                    // remove these new requirements from the already stacked stages
-                    foreach (GraphicResourceID id in curStage)
-                    {
-                        for (int i = 0; i < stageID; i++)
-                            stages[i].Remove(id);
-                    }
-
-                    // push the new stage
-                    stages.Insert(stageID++, curStage);
-                    foreach (GraphicResourceID id in curStage)
-                        staged.Add(id);
+                    Interlocked.Add(ref remainingListCount, -readyListIDs.Count);
+                    return;
                 }
 
-                QueueStagesForExecution();          
+                // reset the event before checking again, so that lists queued in the meanwhile are not missed
+                readyEvent.Reset();
+                if (readyLists.IsEmpty)
+                    readyEvent.Wait();
             }
         }
 
-        public void QueueExecution(GraphicResourceID cmdListID)
+        /// <summary>
+        /// Forget a list that is being released.
+        /// </summary>
+        public void ReleaseList(GraphicResourceID cmdListID)
+        {
+            ListNode node;
+            nodes.TryRemove(cmdListID, out node);
+        }
+
+        #region Graph
+
+        private ListNode GetFrameNode(GraphicResourceID id)
         {
-            lock (CMDLIST_SYNC)
+            ListNode node;
+            if (!nodes.TryGetValue(id, out node))
             {
-#if DEBUG
-                if (cmdListID == null)
-                    throw new ArgumentNullException();
-                if (!lists.ContainsKey(cmdListID))
-                    throw new InvalidOperationException("QueueExecution() cannot be called on a list that has not been declared with DeclareList()!");
-                if (waitingLists.Contains(cmdListID))
-                    throw new InvalidOperationException("QueueExecution() cannot be called twice on the same list!");
-#endif
-                waitingLists.Add(cmdListID);
+                node = new ListNode() { ID = id, FrameID = -1 };
+                nodes[id] = node;
+            }
+
+            // lazily reset nodes on their first use in this frame
+            if (node.FrameID != frameID)
+            {
+                ResetNode(node);
+                frameNodes.Add(node);
+            }
+
+            return node;
+        }
+
+        private void ResetNode(ListNode node)
+        {
+            node.FrameID = frameID;
+            node.Declared = false;
+            node.Queued = 0;
+            node.Pending = 1;
+            node.DependentCount = 0;
+            node.Requires.Clear();
+        }
 
-                QueueStagesForExecution();
+        /// <summary>
+        /// Make a node wait for the specified prerequisite, if not already ready. Only called from the main thread.
+        /// </summary>
+        private void AddDependency(ListNode node, ListNode prerequisite)
+        {
+            node.Requires.Add(prerequisite);
+            Interlocked.Increment(ref node.Pending);
+
+            // publish the node as a dependent of the prerequisite, which fails if the prerequisite became ready in the meanwhile
+            int count = Volatile.Read(ref prerequisite.DependentCount);
+            if (count >= 0)
+            {
+                ListNode[] dependents = prerequisite.Dependents;
+                if (count == dependents.Length)
+                {
+                    ListNode[] newDependents = new ListNode[2 * dependents.Length];
+                    Array.Copy(dependents, newDependents, count);
+                    Volatile.Write(ref prerequisite.Dependents, newDependents);
+                    dependents = newDependents;
+                }
+                dependents[count] = node;
+
+                if (Interlocked.CompareExchange(ref prerequisite.DependentCount, count + 1, count) == count)
+                    return;
             }
+
+            // the prerequisite is already ready
+            Interlocked.Decrement(ref node.Pending);
         }
 
-        private void QueueStagesForExecution()
+        private void Release(ListNode node)
         {
-            // execute all stages for which all the lists have been queued
-            while (stages.Count > 0 && stages.Last().IsSubsetOf(waitingLists))
+            if (Interlocked.Decrement(ref node.Pending) != 0)
+                return;
+
+            // the node is ready: queue it before its dependents, so that they will be executed after
+            if (node.ID != null && node.Declared)
             {
-                HashSet<GraphicResourceID> readyStage = stages.Pop(); // pop the stage to be executed
-                foreach (GraphicResourceID id in readyStage) // remove its lists from the waiting queue
-                    waitingLists.Remove(id); 
-                ToBeExecuted.Enqueue(readyStage); // queue the stage for execution
+                readyLists.Enqueue(node.ID);
+                readyEvent.Set();
             }
+
+            // close the list of dependents and release them
+            int dependentCount = Interlocked.Exchange(ref node.DependentCount, -1);
+            ListNode[] dependents = Volatile.Read(ref node.Dependents);
+            for (int i = 0; i < dependentCount; i++)
+                Release(dependents[i]);
         }
 
+        /// <summary>
+        /// Check that the dependencies form a directed acyclic graph, sorting the nodes in topological order.
+        /// </summary>
+        private void ValidateTopology()
+        {
+            Dictionary<ListNode, int> dependentCounts = new Dictionary<ListNode, int>();
+            List<ListNode> allNodes = new List<ListNode>(frameNodes);
+            for (int i = 0; i < usedBarrierCount; i++)
+                allNodes.Add(barriers[i]);
+
+            foreach (ListNode node in allNodes)
+            {
+                if (!dependentCounts.ContainsKey(node))
+                    dependentCounts[node] = 0;
+                foreach (ListNode prerequisite in node.Requires)
+                {
+                    int count;
+                    dependentCounts.TryGetValue(prerequisite, out count);
+                    dependentCounts[prerequisite] = count + 1;
+                }
+
+#if DEBUG
+                if (node.ID != null && !node.Declared)
+                    throw new InvalidOperationException("Invalid Command Lists: a required list has not been declared in this frame!");
+#endif
+            }
+
+            // remove nodes not required by any other, until the graph is empty
+            Stack<ListNode> sinks = new Stack<ListNode>();
+            foreach (KeyValuePair<ListNode, int> nodeCount in dependentCounts)
+                if (nodeCount.Value == 0)
+                    sinks.Push(nodeCount.Key);
+
+            int sortedCount = 0;
+            while (sinks.Count > 0)
+            {
+                ListNode node = sinks.Pop();
+                sortedCount++;
+                foreach (ListNode prerequisite in node.Requires)
+                {
+                    if (--dependentCounts[prerequisite] == 0)
+                        sinks.Push(prerequisite);
+                }
+            }
+
+            if (sortedCount < dependentCounts.Count)
+                throw new InvalidOperationException("Invalid Command Lists: the dependencies between them contain a cycle!");
+        }
+
+        #endregion
+
     }
 }
@@ -1,5 +1,7 @@
 ﻿using Dragonfly.Graphics.API.Common;
+using Dragonfly.Graphics.Resources;
 using Dragonfly.Graphics.Shaders;
+using System;
 using System.Collections.Generic;
 using System.IO;
 
@@ -18,6 +20,7 @@ namespace Dragonfly.Graphics.API
 
         private Dictionary<string, int> byteAddress;
         private Dictionary<int, int> hashedByteAddress;
+        private int[] paramByteAddress; // (byte address + 1) indexed by ShaderParam.Index, 0 = not resolved yet, -1 = not available
 
         public int ByteSize { get; private set; }
 
@@ -27,6 +30,7 @@ namespace Dragonfly.Graphics.API
         {
             byteAddress = new Dictionary<string, int>();
             hashedByteAddress = new Dictionary<int, int>();
+            paramByteAddress = new int[0];
             ByteSize = 0;
         }
 
@@ -101,5 +105,45 @@ namespace Dragonfly.Graphics.API
             return hashedByteAddress.ContainsKey(nameHash);
         }
 
+        public int GetByteAddress(ShaderParam param)
+        {
+            int byteAddress;
+            if (!TryGetByteAddress(param, out byteAddress))
+                throw new KeyNotFoundException(string.Format("The constant {0} is not available in this buffer.", param.Name));
+            return byteAddress;
+        }
+
+        /// <summary>
+        /// Returns the address of the specified parameter, which is resolved on the first call and then read from an array.
+        /// </summary>
+        public bool TryGetByteAddress(ShaderParam param, out int byteAddress)
+        {
+            int[] addressCache = paramByteAddress;
+            if (param.Index >= addressCache.Length)
+            {
+                // grow the cache to fit the new param index: the array is replaced, so concurrent readers will at worst resolve the address again
+                int[] newCache = new int[System.Math.Max(2 * addressCache.Length, param.Index + 1)];
+                Array.Copy(addressCache, newCache, addressCache.Length);
+                paramByteAddress = addressCache = newCache;
+            }
+
+            int cachedAddress = addressCache[param.Index];
+            if (cachedAddress == 0)
+            {
+                // first access, resolve the address from the name
+                cachedAddress = hashedByteAddress.TryGetValue(param.NameHash, out byteAddress) ? byteAddress + 1 : -1;
+                addressCache[param.Index] = cachedAddress;
+            }
+
+            byteAddress = cachedAddress - 1;
+            return cachedAddress > 0;
+        }
+
+        public bool HasConstant(ShaderParam param)
+        {
+            int byteAddress;
+            return TryGetByteAddress(param, out byteAddress);
+        }
+
     }
 }
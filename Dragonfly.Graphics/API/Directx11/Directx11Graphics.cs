@@ -23,6 +23,7 @@ namespace Dragonfly.Graphics.API.Directx11
 
         private DF_D3D11Device device;
         private CmdListCoordinator cmdListCoordinator;
+        private List<GraphicResourceID> readyLists; // command lists ready to be executed, as returned by the coordinator
         private ThreadLocal<DirectxPadder> padder;
         private object CMDLIST_SYNC; // synchronization object for command list queue
 
@@ -78,6 +79,7 @@ namespace Dragonfly.Graphics.API.Directx11
             padder = new ThreadLocal<DirectxPadder>(() => new DirectxPadder(), false);
             globalTexManager = new GlobalTexManager<Directx11CmdList>(ShaderBindingTable, SetGlobalTexture, SetGlobalTarget);
             cmdListCoordinator = new CmdListCoordinator();
+            readyLists = new List<GraphicResourceID>();
 
             // create and bind globals cbuffer
             string globalCBufferName = CBufferBinding.CreateName(true, 0);
@@ -219,14 +221,13 @@ namespace Dragonfly.Graphics.API.Directx11
 
         public override void StartRender() 
         {
-            cmdListCoordinator.SolveRenderStages();
+            cmdListCoordinator.EndDeclarations();
 
             // synchronously execute all closed command lists
             while (!cmdListCoordinator.EndOfFrame)
             {
-                HashSet<GraphicResourceID> lists;
-                cmdListCoordinator.ToBeExecuted.TryDequeue(out lists);
-                foreach (GraphicResourceID cmdList in lists)
+                cmdListCoordinator.WaitReadyLists(readyLists);
+                foreach (GraphicResourceID cmdList in readyLists)
                     commandList_Execute(cmdList);
             }
         }
@@ -334,9 +335,10 @@ namespace Dragonfly.Graphics.API.Directx11
 
         #region Resource creation
 
-        protected override GraphicResourceID createIndexBuffer(int indexCount)
+        protected override GraphicResourceID createIndexBuffer(int indexCount, IndexFormat format)
         {
-            DF_Buffer11 ib = device.CreateIndexBuffer((uint)(sizeof(ushort) * indexCount), DF_Usage11.Default);
+            int indexSize = format == IndexFormat.Index32 ? sizeof(uint) : sizeof(ushort);
+            DF_Buffer11 ib = device.CreateIndexBuffer((uint)(indexSize * indexCount), DF_Usage11.Default);
             GraphicResourceID id = new GraphicResourceID(ib.GetResourceHash());
             indexBuffers[id] = ib;
             return id;
@@ -474,6 +476,11 @@ namespace Dragonfly.Graphics.API.Directx11
             device.UpdateResource(indexBuffers[resID], indices, indexCount);
         }
 
+        protected override void indexBuffer_SetIndices(GraphicResourceID resID, uint[] indices, int indexCount)
+        {
+            device.UpdateResource(indexBuffers[resID], indices, indexCount);
+        }
+
         #endregion
 
         #region Shader
@@ -596,6 +603,95 @@ namespace Dragonfly.Graphics.API.Directx11
             updatedShaders.Add(shader.ResourceID);
         }
 
+        protected override void shader_SetParam(Shader shader, ShaderParam param, bool value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, int value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, float value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float2 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float3 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float4 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float4x4 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float3x3 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Int3 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, int[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, float[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float2[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float3[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float4[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float4x4[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        private void shader_SetParamNoPad(Shader shader, ShaderParam param, float[] values)
+        {
+            CBuffer cb = localCBuffers[shader.ResourceID].CPUValue;
+            cb.SetValue(param, values);
+            updatedShaders.Add(shader.ResourceID);
+        }
+
+        private void shader_SetParamNoPad(Shader shader, ShaderParam param, int[] values)
+        {
+            CBuffer cb = localCBuffers[shader.ResourceID].CPUValue;
+            cb.SetValue(param, values);
+            updatedShaders.Add(shader.ResourceID);
+        }
+
         #endregion // Shader
 
         #region VertexBuffer
@@ -811,7 +907,7 @@ namespace Dragonfly.Graphics.API.Directx11
             Directx11CmdList cmdList = cmdLists[resID];
             cmdListCoordinator.DeclareList(resID, requiredLists); // signal that this command list will be used in this frame
             if (flushRequired)
-                cmdListCoordinator.SolveRenderStages();
+                cmdListCoordinator.Flush();
             cmdList.RTState.SetDefaultBuffers(device); // update backbuffer resources
 
             // set default GPU states
@@ -900,7 +996,7 @@ namespace Dragonfly.Graphics.API.Directx11
         protected override void commandList_SetIndices(GraphicResourceID resID, IndexBuffer indices)
         {
             Directx11CmdList cmdList = cmdLists[resID];
-            cmdList.Context.SetIndexBuffer(indexBuffers[indices.ResourceID]);
+            cmdList.Context.SetIndexBuffer(indexBuffers[indices.ResourceID], indices.Format == IndexFormat.Index32);
             cmdList.IndexBuffer = indices;
         }
 
@@ -946,6 +1042,7 @@ namespace Dragonfly.Graphics.API.Directx11
 
         protected override void commandList_Release(GraphicResourceID resID)
         {           
+            cmdListCoordinator.ReleaseList(resID);
             Directx11CmdList cmdList = cmdLists[resID];
             cmdList.Context.Release();
             cmdLists.Remove(resID);
@@ -1171,6 +1268,96 @@ namespace Dragonfly.Graphics.API.Directx11
             cmdList.GlobalCBuffer.CPUValue.SetValue(name, padder.Value.Pad(values));
         }
 
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, bool value)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, int value)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, float value)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float2 value)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3 value)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4 value)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4x4 value)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3x3 value)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Int3 value)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, int[] values)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, float[] values)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float2[] values)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3[] values)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4[] values)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4x4[] values)
+        {
+            Directx11CmdList cmdList = cmdLists[resID];
+            cmdList.GlobalCBuffer.CPUValue.SetValue(param, padder.Value.Pad(values));
+        }
+
         #endregion // CommandList
 
     }
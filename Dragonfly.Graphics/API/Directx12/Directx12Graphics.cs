@@ -8,6 +8,7 @@ using DragonflyGraphicsWrappers.DX12;
 using DragonflyUtils;
 using System;
 using System.Collections.Generic;
+using System.IO;
 using System.Linq;
 using System.Threading;
 
@@ -15,6 +16,11 @@ namespace Dragonfly.Graphics.API.Directx12
 {
     internal class Directx12Graphics : DirectxGraphics
     {
+        private const int INSTANCE_BYTE_SIZE = 64; // size of a Float4x4 instance matrix
+        private const int MAX_INSTANCE_RUNS = 16; // max number of draws used to render a set of visible instances from an instance buffer
+        private const int CONSTANTS_PAGE_BYTE_SIZE = 64 * 1024; // also the maximum size of a constant buffer, so that any version fits a page
+        private const int STAGING_PAGE_BYTE_SIZE = 4 * 1024 * 1024;
+
         internal class RTInfo
         {
             public DF_Resource12 Resource;
@@ -31,6 +37,7 @@ namespace Dragonfly.Graphics.API.Directx12
             public ViewportState Viewport;
             public CBuffer RootConstants;
             public VersionedCBuffer GlobalConstants;
+            public UploadRing ConstantsRing;
             public PSOState CurrentPSO;
             public VertexType VertexTypeSimple, VertexTypeInstanced;
             internal VBInfo VB;
@@ -79,6 +86,13 @@ namespace Dragonfly.Graphics.API.Directx12
         {
             public DF_Resource12 Buffer;
             internal int IndexCount;
+            internal bool Use32BitIndices;
+        }
+
+        internal class InstBufferInfo : DynamicUploadResource
+        {
+            public DF_Resource12 Buffer;
+            internal int Capacity;
         }
 
         internal class TexInfo : DynamicUploadResource
@@ -88,12 +102,14 @@ namespace Dragonfly.Graphics.API.Directx12
         }
 
 
-        private object CMDLIST_SYNC; // synchronization object for command list queues
         private CmdListCoordinator cmdListCoordinator;
+        private List<GraphicResourceID> readyLists; // command lists ready to be executed, as returned by the coordinator
         private DF_D3D12Device device;
         private Directx12StaticSamplers samplers;
         private ThreadLocal<DirectxPadder> padder;
         private FrameDeferredReleaseList releaseList;
+        private HeapSuballocator heapAllocator; // places buffers and textures on shared heaps
+        private UploadRing stagingRing; // staging memory for texture uploads
 
         // resources
         private Dictionary<GraphicResourceID, CmdListInfo> commandLists;
@@ -103,12 +119,14 @@ namespace Dragonfly.Graphics.API.Directx12
         private Dictionary<GraphicResourceID, ShaderInfo> shaders;
         private Dictionary<GraphicResourceID, VBInfo> vertexBuffers;
         private Dictionary<GraphicResourceID, IBInfo> indexBuffers;
+        private Dictionary<GraphicResourceID, InstBufferInfo> instanceBuffers;
         private Dictionary<GraphicResourceID, TexInfo> textures;
 
         // cache and render states
         private DF_CommandList12[] cmdListCache;
         private CBuffer lastGlobalCBuffer;
         private Directx12PSOCache psoCache;
+        private string psoLibraryPath, psoListPath;
         private HashSet<GraphicResourceID> updatedShaders; // list of IDs of shaders for which the local cbuffer has been modified
         private long frameID;
         private ObjectPool<PSOState> psoAllocator; // cache of pso state object, that can be re-used
@@ -123,6 +141,11 @@ namespace Dragonfly.Graphics.API.Directx12
             // create device object
             if (!DF_Directx3D12.IsAvailable()) return;
             device = new DF_D3D12Device(CurTarget, false, CurWidth, CurHeight, AntialiasingEnabled, rootCbBinding != null ? (uint)rootCbBinding.ByteSize: 0, samplers.ToOptionsArray());
+            heapAllocator = new HeapSuballocator(device);
+            device.SetHeapAllocator(heapAllocator);
+            stagingRing = new UploadRing(device, STAGING_PAGE_BYTE_SIZE);
+            stagingRing.NewFrame();
+            device.SetUploadAllocator(stagingRing);
 
             // resources
             commandLists = new Dictionary<GraphicResourceID, CmdListInfo>();
@@ -133,13 +156,18 @@ namespace Dragonfly.Graphics.API.Directx12
             shaders = new Dictionary<GraphicResourceID, ShaderInfo>();
             vertexBuffers = new Dictionary<GraphicResourceID, VBInfo>();
             indexBuffers = new Dictionary<GraphicResourceID, IBInfo>();
+            instanceBuffers = new Dictionary<GraphicResourceID, InstBufferInfo>();
             textures = new Dictionary<GraphicResourceID, TexInfo>();
 
             // other members
-            CMDLIST_SYNC = new object();
             cmdListCoordinator = new CmdListCoordinator();
+            readyLists = new List<GraphicResourceID>();
             cmdListCache = new DF_CommandList12[32];
-            psoCache = new Directx12PSOCache(device, ShaderBindingTable);
+            psoCache = new Directx12PSOCache(device, ShaderBindingTable, ShaderBindingTableDigest);
+            psoCache.MissPolicy = CurTarget == IntPtr.Zero ? PSOMissPolicy.Wait : PSOMissPolicy.Skip; // offline rendering should not skip draws
+            psoLibraryPath = Path.Combine(ShaderCompiler.GetShaderFolder(ResourceFolder), GraphicsAPI.Description + "_pipelineLibrary.bin");
+            psoListPath = Path.Combine(ShaderCompiler.GetShaderFolder(ResourceFolder), GraphicsAPI.Description + "_pipelineList.bin");
+            psoCache.Load(psoLibraryPath, psoListPath);
             updatedShaders = new HashSet<GraphicResourceID>();
             psoAllocator = new ObjectPool<PSOState>(() => new PSOState(), pso => pso.Reset()) {  ObjectHashFunction = pso => pso.ID };
 
@@ -166,6 +194,17 @@ namespace Dragonfly.Graphics.API.Directx12
             }
         }
 
+        /// <summary>
+        /// Usage and fragmentation statistics of the heaps used for placed resources.
+        /// </summary>
+        internal AllocatorStats HeapStats
+        {
+            get
+            {
+                return heapAllocator.GetStats();
+            }
+        }
+
         public override List<Int2> SupportedDisplayResolutions
         {
             get
@@ -230,6 +269,7 @@ namespace Dragonfly.Graphics.API.Directx12
             cmdListCoordinator.NewFrame();
             shaderCbuffers.OnNewFrame();
             releaseList.NewFrame(device.GetBackBufferIndex());
+            stagingRing.NewFrame();
             return base.NewFrame();
         }
 
@@ -239,15 +279,14 @@ namespace Dragonfly.Graphics.API.Directx12
             InnerCommandList_QueueExecution();
             InnerCommandList_StartRecording(); // start recording next frame immediately: this list is always recording
 
-            // pack command lists executions in stages
-            cmdListCoordinator.SolveRenderStages();
+            // validate the command list dependencies
+            cmdListCoordinator.EndDeclarations();
 
             // Execute all closed command lists
             while (!cmdListCoordinator.EndOfFrame)
             {
-                HashSet<GraphicResourceID> lists;
-                cmdListCoordinator.ToBeExecuted.TryDequeue(out lists);
-                    ExecuteCommandLists(lists);
+                cmdListCoordinator.WaitReadyLists(readyLists);
+                ExecuteCommandLists(readyLists);
             }
         }
 
@@ -277,8 +316,11 @@ namespace Dragonfly.Graphics.API.Directx12
 
         }
 
-        private void ExecuteCommandLists(HashSet<GraphicResourceID> lists)
+        private void ExecuteCommandLists(List<GraphicResourceID> lists)
         {
+            if (lists.Count > cmdListCache.Length)
+                cmdListCache = new DF_CommandList12[2 * lists.Count];
+
             int listCount = 0;
             foreach (GraphicResourceID cmdListID in lists)
             {
@@ -331,8 +373,9 @@ namespace Dragonfly.Graphics.API.Directx12
             if (rootCbBinding != null)
                 clState.RootConstants = new CBuffer(rootCbBinding);
             CBufferBinding globalCbBinding = Directx12ShaderCompiler.GetGlobalCBFromTable(ShaderBindingTable);
+            clState.ConstantsRing = new UploadRing(device, CONSTANTS_PAGE_BYTE_SIZE);
             if (globalCbBinding != null)
-                clState.GlobalConstants = new VersionedCBuffer(globalCbBinding, device);
+                clState.GlobalConstants = new VersionedCBuffer(globalCbBinding, clState.ConstantsRing);
             clState.CurrentPSO =  psoAllocator.CreateNew();
             clState.ResCache = new DF_Resource12[2];
             clState.InstancesVB = new InstancesVBuffer(device, clState.CmdList, releaseList);
@@ -349,7 +392,7 @@ namespace Dragonfly.Graphics.API.Directx12
 
             cmdListCoordinator.DeclareList(resID, requiredLists); // signal that this command list will be used in this frame
             if (flushRequired)
-                cmdListCoordinator.SolveRenderStages();
+                cmdListCoordinator.Flush();
             clState.CmdList.Reset();
 
             // reset command list state
@@ -357,6 +400,7 @@ namespace Dragonfly.Graphics.API.Directx12
             clState.RTState.Changed = true;
             clState.Viewport = new ViewportState { Current = ViewportState.Default };
             clState.RootConstants.Changed = true;
+            clState.ConstantsRing.NewFrame();
             clState.GlobalConstants.NewFrame();
             clState.InstancesVB.NewFrame();
             clState.CurrentPSO.Changed = true;
@@ -407,7 +451,8 @@ namespace Dragonfly.Graphics.API.Directx12
             CmdListInfo clState = commandLists[resID];
             clState.CurrentPSO.Instanced.Value = false;
             clState.CurrentPSO.VertexType.Value = clState.VertexTypeSimple;
-            UpdatePSO(clState);
+            if (!UpdatePSO(clState))
+                return;
             clState.CmdList.DrawInstanced((uint)clState.VB.VertexCount, 1);
         }
 
@@ -416,7 +461,8 @@ namespace Dragonfly.Graphics.API.Directx12
             CmdListInfo clState = commandLists[resID];
             clState.CurrentPSO.Instanced.Value = false;
             clState.CurrentPSO.VertexType.Value = clState.VertexTypeSimple;
-            UpdatePSO(clState);
+            if (!UpdatePSO(clState))
+                return;
             clState.CmdList.DrawIndexedInstanced((uint)clState.IB.IndexCount, 1);
         }
 
@@ -425,12 +471,49 @@ namespace Dragonfly.Graphics.API.Directx12
             CmdListInfo clState = commandLists[resID];
             clState.CurrentPSO.Instanced.Value = true;
             clState.CurrentPSO.VertexType.Value = clState.VertexTypeInstanced;
-            UpdatePSO(clState);
+            if (!UpdatePSO(clState))
+                return;
             clState.InstancesVB.SetInstances(clState.CmdList, instances);
             clState.CmdList.DrawIndexedInstanced((uint)clState.IB.IndexCount, (uint)instances.Count);
         }
 
-        private void UpdatePSO(CmdListInfo clState)
+        protected override void commandList_DrawIndexedInstanced(GraphicResourceID resID, InstanceBuffer instances, ArrayRange<int> visibleInstances)
+        {
+            // count the runs of consecutive indices, each of them can be drawn directly from the persistent buffer
+            int runCount = 0;
+            for (int i = 0; i < visibleInstances.Count; i++)
+                if (i == 0 || visibleInstances[i] != visibleInstances[i - 1] + 1)
+                    runCount++;
+
+            if (runCount > MAX_INSTANCE_RUNS)
+            {
+                // visible instances are too scattered: gather and upload them
+                base.commandList_DrawIndexedInstanced(resID, instances, visibleInstances);
+                return;
+            }
+
+            CmdListInfo clState = commandLists[resID];
+            InstBufferInfo instInfo = instanceBuffers[instances.ResourceID];
+            clState.CurrentPSO.Instanced.Value = true;
+            clState.CurrentPSO.VertexType.Value = clState.VertexTypeInstanced;
+            if (!UpdatePSO(clState))
+                return;
+
+            for (int runStart = 0, runEnd = 1; runStart < visibleInstances.Count; runStart = runEnd++)
+            {
+                while (runEnd < visibleInstances.Count && visibleInstances[runEnd] == visibleInstances[runEnd - 1] + 1)
+                    runEnd++;
+
+                int runLength = runEnd - runStart;
+                clState.CmdList.SetInstanceBuffer(instInfo.Buffer, (uint)(visibleInstances[runStart] * INSTANCE_BYTE_SIZE), (uint)INSTANCE_BYTE_SIZE, (uint)(runLength * INSTANCE_BYTE_SIZE));
+                clState.CmdList.DrawIndexedInstanced((uint)clState.IB.IndexCount, (uint)runLength);
+            }
+        }
+
+        /// <summary>
+        /// Commit the modified states to the command list. Returns false if the required PSO is still being compiled, and the draw should be skipped.
+        /// </summary>
+        private bool UpdatePSO(CmdListInfo clState)
         {
             // update render targets
             if (clState.RTState.Changed)
@@ -445,10 +528,10 @@ namespace Dragonfly.Graphics.API.Directx12
                 clState.Viewport.Changed = false;
             }
 
-            // update root constants
+            // update root constants, only uploading the modified range (usually only the per-draw transforms)
             if (clState.RootConstants.Changed)
             {
-                clState.CmdList.SetRootConstants(clState.RootConstants.ToByteArray());
+                clState.CmdList.SetRootConstants(clState.RootConstants.ToByteArray(), clState.RootConstants.ChangedByteOffset, clState.RootConstants.ChangedByteCount);
                 clState.RootConstants.Changed = false;
             }
 
@@ -461,9 +544,15 @@ namespace Dragonfly.Graphics.API.Directx12
             // update PSO
             if (clState.CurrentPSO.Changed)
             {
-                clState.CmdList.SetPipelineState(psoCache.GetState(clState.CurrentPSO));
+                DF_PipelineState12 pso = psoCache.GetState(clState.CurrentPSO);
+                if (pso == null)
+                    return false; // not ready: keep it marked as changed, so that it's retrieved again on the next draw
+
+                clState.CmdList.SetPipelineState(pso);
                 clState.CurrentPSO.Changed = false;
             }
+
+            return true;
         }
 
         protected override void commandList_QueueExecution(GraphicResourceID resID)
@@ -471,17 +560,15 @@ namespace Dragonfly.Graphics.API.Directx12
             CmdListInfo clState = commandLists[resID];
             clState.CmdList.Close();
 
-            lock (CMDLIST_SYNC)
-            {
-                cmdListCoordinator.QueueExecution(resID);
-                lastGlobalCBuffer = clState.GlobalConstants.Current;
-            }
+            lastGlobalCBuffer = clState.GlobalConstants.Current;
+            cmdListCoordinator.QueueExecution(resID);
         }
 
         protected override void commandList_Release(GraphicResourceID resID)
         {
+            cmdListCoordinator.ReleaseList(resID);
             CmdListInfo clState = commandLists[resID];
-            clState.GlobalConstants.Release();
+            clState.ConstantsRing.Release();
             clState.CmdList.Release();
             psoAllocator.Free(clState.CurrentPSO);
             commandLists.Remove(resID);
@@ -623,6 +710,115 @@ namespace Dragonfly.Graphics.API.Directx12
             }
         }
 
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, bool value)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, int value)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, float value)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float2 value)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3 value)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4 value)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4x4 value)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3x3 value)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Int3 value)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, int[] values)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, float[] values)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float2[] values)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3[] values)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4[] values)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4x4[] values)
+        {
+            commandList_SetParamNoPad(resID, param, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Texture value)
+        {
+            TexInfo texInfo = textures[value.ResourceID];
+            DirectxPadder curPadder = padder.Value;
+            commandList_SetParamNoPad(resID, param, curPadder.Pad(texInfo.Resource.GetSrvIndex()));
+            commandList_SetParamNoPad(resID, param.TexelSize, curPadder.Pad(1.0f / (Float2)texInfo.Resolution)); // update automatic texel size
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, RenderTarget value)
+        {
+            RTInfo rtInfo = renderTargets[value.ResourceID];
+            DirectxPadder curPadder = padder.Value;
+            commandList_SetParamNoPad(resID, param, curPadder.Pad(rtInfo.Resource.GetSrvIndex()));
+            commandList_SetParamNoPad(resID, param.TexelSize, curPadder.Pad(1.0f / new Float2(rtInfo.Desc.CurWidth, rtInfo.Desc.CurHeight))); // update automatic texel size
+        }
+
+        private void commandList_SetParamNoPad(GraphicResourceID resID, ShaderParam param, int[] values)
+        {
+            CmdListInfo clState = commandLists[resID];
+            if (!clState.RootConstants.TrySetValue(param, values))
+            {
+                clState.GlobalConstants.Current.SetValue(param, values);
+            }
+        }
+
+        private void commandList_SetParamNoPad(GraphicResourceID resID, ShaderParam param, float[] values)
+        {
+            CmdListInfo clState = commandLists[resID];
+            if (!clState.RootConstants.TrySetValue(param, values))
+            {
+                clState.GlobalConstants.Current.SetValue(param, values);
+            }
+        }
+
         protected override void commandList_SetRenderTarget(GraphicResourceID resID, RenderTarget rt, int index)
         {
             CmdListInfo clState = commandLists[resID];
@@ -692,11 +888,12 @@ namespace Dragonfly.Graphics.API.Directx12
 
         #region Index Buffer
 
-        protected override GraphicResourceID createIndexBuffer(int indexCount)
+        protected override GraphicResourceID createIndexBuffer(int indexCount, IndexFormat format)
         {
             IBInfo ibInfo = new IBInfo();
             ibInfo.IndexCount = indexCount;
-            ibInfo.Buffer = device.CreateIndexBuffer(indexCount, DF_CPUAccess.None);
+            ibInfo.Use32BitIndices = format == IndexFormat.Index32;
+            ibInfo.Buffer = device.CreateIndexBuffer(indexCount, DF_CPUAccess.None, ibInfo.Use32BitIndices);
             GraphicResourceID id = new GraphicResourceID(ibInfo.Buffer.GetResourceHash());
             indexBuffers.Add(id, ibInfo);
             return id;
@@ -710,6 +907,16 @@ namespace Dragonfly.Graphics.API.Directx12
         }
 
         protected override void indexBuffer_SetIndices(GraphicResourceID resID, ushort[] indices, int indexCount)
+        {
+            indexBuffer_SetIndices<ushort>(resID, indices, indexCount, sizeof(ushort));
+        }
+
+        protected override void indexBuffer_SetIndices(GraphicResourceID resID, uint[] indices, int indexCount)
+        {
+            indexBuffer_SetIndices<uint>(resID, indices, indexCount, sizeof(uint));
+        }
+
+        private void indexBuffer_SetIndices<T>(GraphicResourceID resID, T[] indices, int indexCount, int indexByteSize) where T : struct
         {
             IBInfo ibInfo = indexBuffers[resID];
             if (ibInfo.IndexCount < indexCount)
@@ -731,13 +938,13 @@ namespace Dragonfly.Graphics.API.Directx12
                     ibUploadBuffer = ibInfo.UploadBuffers[device.GetBackBufferIndex()];
                 }
                 if (ibUploadBuffer == null)
-                    ibUploadBuffer = device.CreateIndexBuffer(indexCount, DF_CPUAccess.Write);
+                    ibUploadBuffer = device.CreateIndexBuffer(indexCount, DF_CPUAccess.Write, ibInfo.Use32BitIndices);
                 if (ibInfo.FrequentUpdates)
                     ibInfo.UploadBuffers[device.GetBackBufferIndex()] = ibUploadBuffer;
             }
             
-            ibUploadBuffer.SetData<ushort>(indices, 0, 0, indexCount, false);
-            InnerCommandList.CopyBufferRegion(ibInfo.Buffer, 0, ibUploadBuffer, 0, (ulong)(indexCount * sizeof(short)));
+            ibUploadBuffer.SetData<T>(indices, 0, 0, indexCount, false);
+            InnerCommandList.CopyBufferRegion(ibInfo.Buffer, 0, ibUploadBuffer, 0, (ulong)(indexCount * indexByteSize));
 
             if (!ibInfo.FrequentUpdates)
             {
@@ -748,6 +955,49 @@ namespace Dragonfly.Graphics.API.Directx12
 
         #endregion
 
+        #region Instance Buffer
+
+        protected override GraphicResourceID createInstanceBuffer(int capacity)
+        {
+            InstBufferInfo instInfo = new InstBufferInfo();
+            instInfo.Capacity = capacity;
+            instInfo.Buffer = device.CreateVertexBuffer(INSTANCE_BYTE_SIZE, capacity, DF_CPUAccess.None);
+            instInfo.FrequentUpdates = true;
+            instInfo.UploadBuffers = new DF_Resource12[DF_Directx3D12.GetBackbufferCount()];
+            GraphicResourceID id = new GraphicResourceID(instInfo.Buffer.GetResourceHash());
+            instanceBuffers.Add(id, instInfo);
+            return id;
+        }
+
+        protected override void instanceBuffer_SetInstances(GraphicResourceID resID, Float4x4[] instances, int startIndex, int count)
+        {
+            InstBufferInfo instInfo = instanceBuffers[resID];
+
+            // retrieve or create the upload buffer for the current frame
+            int frameIndex = device.GetBackBufferIndex();
+            DF_Resource12 uploadBuffer = instInfo.UploadBuffers[frameIndex];
+            if (uploadBuffer == null)
+            {
+                uploadBuffer = device.CreateVertexBuffer(INSTANCE_BYTE_SIZE, instInfo.Capacity, DF_CPUAccess.Write);
+                instInfo.UploadBuffers[frameIndex] = uploadBuffer;
+            }
+
+            // upload only the modified range and copy it to the persistent buffer
+            int byteOffset = startIndex * INSTANCE_BYTE_SIZE;
+            uploadBuffer.SetData<Float4x4>(instances, startIndex, byteOffset, count, true);
+            InnerCommandList.CopyBufferRegion(instInfo.Buffer, (ulong)byteOffset, uploadBuffer, (ulong)byteOffset, (ulong)(count * INSTANCE_BYTE_SIZE));
+        }
+
+        protected override void instanceBuffer_Release(GraphicResourceID resID)
+        {
+            InstBufferInfo instInfo = instanceBuffers[resID];
+            releaseList.DeferredRelease(instInfo.Buffer);
+            instInfo.ReleaseUploadBuffers(releaseList);
+            instanceBuffers.Remove(resID);
+        }
+
+        #endregion
+
         #region Render Target
 
         protected override GraphicResourceID CreateDirectxRenderTarget(RenderTargetParams rtParams)
@@ -1033,6 +1283,123 @@ namespace Dragonfly.Graphics.API.Directx12
             updatedShaders.Add(shader.ResourceID);
         }
 
+        protected override void shader_SetParam(Shader shader, ShaderParam param, bool value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, int value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, float value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float2 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float3 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float4 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float4x4 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float3x3 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Int3 value)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, int[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, float[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float2[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float3[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float4[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Float4x4[] values)
+        {
+            shader_SetParamNoPad(shader, param, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, Texture value)
+        {
+            DirectxPadder curPadder = padder.Value;
+            TexInfo texInfo = textures[value.ResourceID];
+            ShaderInfo sInfo = shaders[shader.ResourceID];
+            shader_SetParamNoPad(shader, param, curPadder.Pad(texInfo.Resource.GetSrvIndex()));
+
+            // update automatic texel size if used for this texture
+            if (sInfo.LocalCBuffer.Bindings.HasConstant(param.TexelSize))
+            {
+                shader_SetParamNoPad(shader, param.TexelSize, curPadder.Pad(1.0f / (Float2)texInfo.Resolution));
+            }
+        }
+
+        protected override void shader_SetParam(Shader shader, ShaderParam param, RenderTarget value)
+        {
+            DirectxPadder curPadder = padder.Value;
+            RTInfo rtInfo = renderTargets[value.ResourceID];
+            ShaderInfo sInfo = shaders[shader.ResourceID];
+            shader_SetParamNoPad(shader, param, curPadder.Pad(rtInfo.Resource.GetSrvIndex()));
+
+            // update automatic texel size if used for this texture
+            if (sInfo.LocalCBuffer.Bindings.HasConstant(param.TexelSize))
+            {
+                shader_SetParamNoPad(shader, param.TexelSize, curPadder.Pad(1.0f / new Float2(rtInfo.Desc.CurWidth, rtInfo.Desc.CurHeight)));
+            }
+        }
+
+        private void shader_SetParamNoPad(Shader shader, ShaderParam param, float[] values)
+        {
+            ShaderInfo sInfo = shaders[shader.ResourceID];
+            sInfo.LocalCBuffer.SetValue(param, values);
+            updatedShaders.Add(shader.ResourceID);
+        }
+
+        private void shader_SetParamNoPad(Shader shader, ShaderParam param, int[] values)
+        {
+            ShaderInfo sInfo = shaders[shader.ResourceID];
+            sInfo.LocalCBuffer.SetValue(param, values);
+            updatedShaders.Add(shader.ResourceID);
+        }
+
         protected override void shader_Release(GraphicResourceID resID)
         {
             ShaderInfo sInfo = shaders[resID];
@@ -1068,7 +1435,8 @@ namespace Dragonfly.Graphics.API.Directx12
             DF_Resource12 uploadResource;
             DF_Resource12 textureResource = device.CreateTexture(fileData, DirectxUtils.IsFileDDS(fileData), InnerCommandList, out uploadResource, out width, out height);
             GraphicResourceID id = new GraphicResourceID(textureResource.GetResourceHash());
-            releaseList.DeferredRelease(uploadResource);        
+            if (uploadResource != null)
+                releaseList.DeferredRelease(uploadResource);
             textures.Add(id, new TexInfo() { Resource = textureResource, Resolution = new Int2(width, height), FrequentUpdates = false });
             return id;
         }
@@ -1099,10 +1467,11 @@ namespace Dragonfly.Graphics.API.Directx12
             }
             else
             {
-                // create a new upload resource for this update and discard it once its done
+                // upload from the staging ring, or from a new upload resource that is discarded once its done
                 DF_Resource12 uploadResource = null;
                 texInfo.Resource.UploadData<T>(device, data, InnerCommandList, ref uploadResource);
-                releaseList.DeferredRelease(uploadResource);
+                if (uploadResource != null)
+                    releaseList.DeferredRelease(uploadResource);
                 texInfo.Initialized = true;
             }
         }
@@ -1190,6 +1559,14 @@ namespace Dragonfly.Graphics.API.Directx12
             foreach (IBInfo ibInfo in indexBuffers.Values)
                 ibInfo.Buffer.Release();
 
+            foreach (InstBufferInfo instInfo in instanceBuffers.Values)
+            {
+                instInfo.Buffer.Release();
+                foreach (DF_Resource12 uploadBuf in instInfo.UploadBuffers)
+                    if (uploadBuf != null)
+                        uploadBuf.Release();
+            }
+
             foreach (TexInfo texInfo in textures.Values)
             {
                 texInfo.Resource.Release();
@@ -1201,8 +1578,12 @@ namespace Dragonfly.Graphics.API.Directx12
                 }
             }
 
+            psoCache.Save(psoLibraryPath, psoListPath);
+            psoCache.Release();
             shaderCbuffers.Release();
             InnerCommandList.Release();
+            stagingRing.Release();
+            heapAllocator.Release();
             device.Release();
         }
     }
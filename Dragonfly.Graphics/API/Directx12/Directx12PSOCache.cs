@@ -1,6 +1,10 @@
 ﻿using Dragonfly.Utils;
 using DragonflyGraphicsWrappers.DX12;
+using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
+using System.IO;
+using System.Threading;
 using DragonflyGraphicsWrappers;
 using Dragonfly.Graphics.Resources;
 using Dragonfly.Graphics.API.Common;
@@ -62,37 +66,321 @@ namespace Dragonfly.Graphics.API.Directx12
             for (int i = 0; i < 8; i++)
                 RenderTargetFormats[i].Value = SurfaceFormat.Color;
         }
+
+        /// <summary>
+        /// Returns a 128-bit digest of this state, stable across runs so that it can be used to identify the state in a pipeline library.
+        /// </summary>
+        public Digest128 ComputeDigest()
+        {
+            Digest128 digest = Digest128.Seed;
+            VertexElement[] elems = VertexType.Value.Elements;
+            digest.Add(elems.Length);
+            for (int i = 0; i < elems.Length; i++)
+                digest.Add((int)elems[i]);
+            digest.Add(ShaderEffectName.Value);
+            digest.Add(ShaderVariantID.Value);
+            digest.Add(ShaderTemplateName.Value);
+            digest.Add(Instanced.Value);
+            digest.Add((int)BlendMode.Value);
+            digest.Add(DepthEnabled.Value);
+            digest.Add(DepthWriteEnabled.Value);
+            digest.Add((int)CullMode.Value);
+            digest.Add((int)FillMode.Value);
+            digest.Add(RenderTargetCount.Value);
+            for (int i = 0; i < RenderTargetCount; i++)
+                digest.Add((int)RenderTargetFormats[i].Value);
+            return digest;
+        }
+    }
+
+    /// <summary>
+    /// The minimal description of a PSOState that can be saved to a pre-warm list. All the other fields are derived from the effect binding.
+    /// </summary>
+    internal struct PSOStateRecord
+    {
+        public string EffectName, TemplateName, VariantID;
+        public bool Instanced;
+        public BlendMode BlendMode;
+        public bool DepthEnabled, DepthWriteEnabled;
+        public CullMode CullMode;
+        public FillMode FillMode;
+
+        public PSOStateRecord(PSOState state)
+        {
+            EffectName = state.ShaderEffectName;
+            TemplateName = state.ShaderTemplateName;
+            VariantID = state.ShaderVariantID;
+            Instanced = state.Instanced;
+            BlendMode = state.BlendMode;
+            DepthEnabled = state.DepthEnabled;
+            DepthWriteEnabled = state.DepthWriteEnabled;
+            CullMode = state.CullMode;
+            FillMode = state.FillMode;
+        }
+
+        public void CopyTo(PSOState state, ShaderBindingTable bindings)
+        {
+            EffectBinding effect = bindings.GetEffect(EffectName, TemplateName, VariantID);
+            state.ShaderEffectName.Value = EffectName;
+            state.ShaderTemplateName.Value = TemplateName;
+            state.ShaderVariantID.Value = VariantID;
+            state.Instanced.Value = Instanced;
+            state.VertexType.Value = Instanced ? DirectxUtils.AddInstanceMatrixTo(effect.InputLayout) : effect.InputLayout;
+            state.BlendMode.Value = BlendMode;
+            state.DepthEnabled.Value = DepthEnabled;
+            state.DepthWriteEnabled.Value = DepthWriteEnabled;
+            state.CullMode.Value = CullMode;
+            state.FillMode.Value = FillMode;
+            state.RenderTargetCount.Value = effect.TargetFormats.Length;
+            for (int i = 0; i < effect.TargetFormats.Length; i++)
+                state.RenderTargetFormats[i].Value = effect.TargetFormats[i];
+        }
+
+        public void Save(BinaryWriter writer)
+        {
+            writer.Write(EffectName);
+            writer.Write(TemplateName);
+            writer.Write(VariantID);
+            writer.Write(Instanced);
+            writer.Write((int)BlendMode);
+            writer.Write(DepthEnabled);
+            writer.Write(DepthWriteEnabled);
+            writer.Write((int)CullMode);
+            writer.Write((int)FillMode);
+        }
+
+        public static PSOStateRecord FromStream(BinaryReader reader)
+        {
+            PSOStateRecord record = new PSOStateRecord();
+            record.EffectName = reader.ReadString();
+            record.TemplateName = reader.ReadString();
+            record.VariantID = reader.ReadString();
+            record.Instanced = reader.ReadBoolean();
+            record.BlendMode = (BlendMode)reader.ReadInt32();
+            record.DepthEnabled = reader.ReadBoolean();
+            record.DepthWriteEnabled = reader.ReadBoolean();
+            record.CullMode = (CullMode)reader.ReadInt32();
+            record.FillMode = (FillMode)reader.ReadInt32();
+            return record;
+        }
     }
 
-    internal class Directx12PSOCache : CachedPipelineState<PSOState, DF_PipelineState12, DF_D3D12Device>
+    internal enum PSOMissPolicy
     {
-        private DF_PSODesc12 cachedDesc;
+        /// <summary>
+        /// Draws that require a PSO which is still being compiled are skipped.
+        /// </summary>
+        Skip,
+        /// <summary>
+        /// Draws that require a PSO which is still being compiled wait for it.
+        /// </summary>
+        Wait
+    }
+
+    /// <summary>
+    /// Cache of the pipeline states, indexed by the digest of their PSOState.
+    /// PSOs are compiled on worker threads and stored in a pipeline library, that is saved to disk with the list of used states to be pre-warmed on the next run.
+    /// </summary>
+    internal class Directx12PSOCache
+    {
+        private const int MAX_COMPILE_THREADS = 2;
+        private const int PREWARM_LIST_VERSION = 1;
+
+        private class CachedPSO
+        {
+            public volatile DF_PipelineState12 State;
+            public volatile Exception Error;
+            public PSOStateRecord Record;
+            public DF_PSODesc12 Desc;
+            public Digest128 Digest;
+            public int Started; // set to 1 by the thread that compiles this PSO
+
+            public bool Completed
+            {
+                get { return State != null || Error != null; }
+            }
+        }
+
+        private class CompileTask : SlimParallel.ITaskBody
+        {
+            private Directx12PSOCache cache;
+
+            public CompileTask(Directx12PSOCache cache)
+            {
+                this.cache = cache;
+            }
+
+            public void Execute()
+            {
+                cache.CompileQueued();
+            }
+        }
+
+        private DF_D3D12Device device;
         private ShaderBindingTable bindings;
+        private Digest128 bindingsDigest;
+        private ConcurrentDictionary<Digest128, CachedPSO> cachedStates;
+        private ConcurrentQueue<CachedPSO> requiredQueue, prewarmQueue;
+        private CompileTask compileTask;
+        private int compileThreadCount, pendingCount;
+        private DF_PipelineLibrary12 library;
+        private PSOState tempState;
+
+        public Directx12PSOCache(DF_D3D12Device device, ShaderBindingTable bindings, Digest128 bindingsDigest)
+        {
+            this.device = device;
+            this.bindings = bindings;
+            this.bindingsDigest = bindingsDigest;
+            cachedStates = new ConcurrentDictionary<Digest128, CachedPSO>();
+            requiredQueue = new ConcurrentQueue<CachedPSO>();
+            prewarmQueue = new ConcurrentQueue<CachedPSO>();
+            compileTask = new CompileTask(this);
+            tempState = new PSOState();
+            MissPolicy = PSOMissPolicy.Skip;
+        }
+
+        /// <summary>
+        /// What to do when a draw requires a PSO that is still being compiled.
+        /// </summary>
+        public PSOMissPolicy MissPolicy { get; set; }
+
+        /// <summary>
+        /// Number of PSOs queued or being compiled.
+        /// </summary>
+        public int PendingCount
+        {
+            get { return pendingCount; }
+        }
+
+        #region Cache
+
+        /// <summary>
+        /// Queue the compilation of the specified state, if not already cached. Compilation of the states queued this way takes priority over pre-warming.
+        /// </summary>
+        public void CacheState(PSOState stateDesc)
+        {
+            CacheState(new PSOStateRecord(stateDesc), stateDesc, true);
+        }
+
+        /// <summary>
+        /// Returns the PSO for the specified state, or null if it is still being compiled and the miss policy allows skipping.
+        /// </summary>
+        public DF_PipelineState12 GetState(PSOState stateDesc)
+        {
+            CachedPSO cached;
+            if (!cachedStates.TryGetValue(stateDesc.ComputeDigest(), out cached))
+                throw new Exception("The requested object is not available! CacheState() was never called with this description.)");
+
+            if (!cached.Completed && MissPolicy == PSOMissPolicy.Wait)
+            {
+                // compile it on this thread, or wait for the worker that is compiling it
+                Compile(cached);
+                SpinWait spin = new SpinWait();
+                while (!cached.Completed)
+                    spin.SpinOnce();
+            }
+
+            if (cached.Error != null)
+                throw new Exception("The pipeline state creation failed!", cached.Error);
+
+            return cached.State;
+        }
+
+        /// <summary>
+        /// Queue the pre-warming of all the effects available in the binding table, with their default states.
+        /// </summary>
+        public void CacheAllStates()
+        {
+            foreach (PSOStateRecord record in GenerateAllStateDescriptions())
+                Prewarm(record);
+        }
 
-        public Directx12PSOCache(DF_D3D12Device device, ShaderBindingTable bindings) : base(device)
+        private IEnumerable<PSOStateRecord> GenerateAllStateDescriptions()
         {
-            this.bindings = bindings; 
-            cachedDesc = new DF_PSODesc12();
-            cachedDesc.RenderTargetFormats = new DF_SurfaceFormat[8];
+            PSOState defaultState = new PSOState();
+            foreach (KeyValuePair<string, EffectBinding> variantBinding in bindings.GetAllEffects())
+            {
+                EffectBinding effect = variantBinding.Value;
+                PSOStateRecord record = new PSOStateRecord(defaultState);
+                record.EffectName = effect.EffectName;
+                record.TemplateName = effect.Template;
+                record.VariantID = variantBinding.Key;
+                yield return record;
+
+                if (effect.SupportsInstancing)
+                {
+                    record.Instanced = true;
+                    yield return record;
+                }
+            }
+        }
+
+        private void Prewarm(PSOStateRecord record)
+        {
+            try
+            {
+                tempState.Reset();
+                record.CopyTo(tempState, bindings);
+            }
+            catch (KeyNotFoundException)
+            {
+                return; // the effect is no longer available
+            }
+
+            CacheState(record, tempState, false);
+        }
+
+        private void CacheState(PSOStateRecord record, PSOState stateDesc, bool required)
+        {
+            Digest128 digest = stateDesc.ComputeDigest();
+            CachedPSO cached;
+            if (!cachedStates.TryGetValue(digest, out cached))
+            {
+                CachedPSO newPSO = new CachedPSO();
+                newPSO.Record = record;
+                newPSO.Desc = CreateDesc(stateDesc);
+                newPSO.Digest = digest;
+                cached = cachedStates.GetOrAdd(digest, newPSO);
+                if (cached == newPSO)
+                    Interlocked.Increment(ref pendingCount);
+                else
+                    required = required && cached.Started == 0; // added by another thread
+            }
+            else if (!required || cached.Started != 0)
+            {
+                return; // already queued or compiled
+            }
+
+            // queue compilation, a state already queued for pre-warming is re-queued with priority
+            (required ? requiredQueue : prewarmQueue).Enqueue(cached);
+            if (TryAddCompileThread())
+                SlimParallel.RunAsync(compileTask);
         }
 
-        protected override DF_PipelineState12 CreateState(PSOState stateDesc)
+        #endregion
+
+        #region Compilation
+
+        private DF_PSODesc12 CreateDesc(PSOState stateDesc)
         {
+            DF_PSODesc12 desc = new DF_PSODesc12();
+            desc.RenderTargetFormats = new DF_SurfaceFormat[8];
+
             // rasterizer and depth stencil
             {
-                cachedDesc.BlendEnable = stateDesc.BlendMode != BlendMode.Opaque;
+                desc.BlendEnable = stateDesc.BlendMode != BlendMode.Opaque;
                 switch (stateDesc.BlendMode.Value)
                 {
                     case BlendMode.AlphaBlend:
-                        cachedDesc.SrcBlend = DF_BlendMode.SrcAlpha;
-                        cachedDesc.DestBlend = DF_BlendMode.InvSrcAlpha;
+                        desc.SrcBlend = DF_BlendMode.SrcAlpha;
+                        desc.DestBlend = DF_BlendMode.InvSrcAlpha;
                         break;
                 }
-                cachedDesc.CullMode = DirectxUtils.CullModeToDX(stateDesc.CullMode);
-                cachedDesc.DepthEnabled = stateDesc.DepthEnabled;
-                cachedDesc.DepthTest = DF_CompareFunc.GreaterEqual;
-                cachedDesc.DepthWriteEnabled = stateDesc.DepthWriteEnabled;
-                cachedDesc.FillMode = DirectxUtils.FillModeToDX(stateDesc.FillMode);
+                desc.CullMode = DirectxUtils.CullModeToDX(stateDesc.CullMode);
+                desc.DepthEnabled = stateDesc.DepthEnabled;
+                desc.DepthTest = DF_CompareFunc.GreaterEqual;
+                desc.DepthWriteEnabled = stateDesc.DepthWriteEnabled;
+                desc.FillMode = DirectxUtils.FillModeToDX(stateDesc.FillMode);
             }
 
             // load shaders
@@ -100,36 +388,229 @@ namespace Dragonfly.Graphics.API.Directx12
                 EffectBinding effect = bindings.GetEffect(stateDesc.ShaderEffectName, stateDesc.ShaderTemplateName, stateDesc.ShaderVariantID);
 
                 // retrieve VS
-                cachedDesc.CompiledVS = bindings.GetProgram(effect.VSName);
-                ProgramDB vsPrograms = new ProgramDB(cachedDesc.CompiledVS);
+                desc.CompiledVS = bindings.GetProgram(effect.VSName);
+                ProgramDB vsPrograms = new ProgramDB(desc.CompiledVS);
                 int vsProgramID = stateDesc.Instanced ? 1 : 0;
-                cachedDesc.CompiledVSFirstByteIndex = vsPrograms.GetProgramStartID(vsProgramID);
-                cachedDesc.CompiledVSByteLength = vsPrograms.GetProgramSize(vsProgramID);
+                desc.CompiledVSFirstByteIndex = vsPrograms.GetProgramStartID(vsProgramID);
+                desc.CompiledVSByteLength = vsPrograms.GetProgramSize(vsProgramID);
 
                 // retrieve PS
                 ProgramDB psPrograms = new ProgramDB(bindings.GetProgram(effect.PSName));
-                cachedDesc.CompiledPS = psPrograms.RawBytes;
-                cachedDesc.CompiledPSFirstByteIndex = psPrograms.GetProgramStartID(0);
-                cachedDesc.CompiledPSByteLength = psPrograms.GetProgramSize(0);
+                desc.CompiledPS = psPrograms.RawBytes;
+                desc.CompiledPSFirstByteIndex = psPrograms.GetProgramStartID(0);
+                desc.CompiledPSByteLength = psPrograms.GetProgramSize(0);
 
                 // in-out layouts
-                cachedDesc.InputLayout = DirectxUtils.VertexTypeToDXElems(stateDesc.VertexType);
-                cachedDesc.RenderTargetCount = effect.TargetFormats.Length;
-                for (int i = 0; i < cachedDesc.RenderTargetCount; i++)
-                    cachedDesc.RenderTargetFormats[i] = DirectxUtils.SurfaceFormatToDX(effect.TargetFormats[i]);
+                desc.InputLayout = DirectxUtils.VertexTypeToDXElems(stateDesc.VertexType);
+                desc.RenderTargetCount = effect.TargetFormats.Length;
+                for (int i = 0; i < desc.RenderTargetCount; i++)
+                    desc.RenderTargetFormats[i] = DirectxUtils.SurfaceFormatToDX(effect.TargetFormats[i]);
+            }
+
+            return desc;
+        }
+
+        private bool TryAddCompileThread()
+        {
+            for (int count = compileThreadCount; count < MAX_COMPILE_THREADS; count = compileThreadCount)
+            {
+                if (Interlocked.CompareExchange(ref compileThreadCount, count + 1, count) == count)
+                    return true;
+            }
+            return false;
+        }
+
+        private void CompileQueued()
+        {
+            do
+            {
+                CachedPSO cached;
+                while (requiredQueue.TryDequeue(out cached) || prewarmQueue.TryDequeue(out cached))
+                    Compile(cached);
+
+                Interlocked.Decrement(ref compileThreadCount);
+
+                // states queued after the queues were found empty are compiled by this thread, unless another one took care of them
+            } while ((!requiredQueue.IsEmpty || !prewarmQueue.IsEmpty) && TryAddCompileThread());
+        }
+
+        private void Compile(CachedPSO cached)
+        {
+            if (Interlocked.Exchange(ref cached.Started, 1) != 0)
+                return; // already compiled or being compiled by another thread
+
+            try
+            {
+                cached.State = device.CreatePSO(cached.Desc, library, cached.Digest.ToString());
+            }
+            catch (Exception e)
+            {
+                cached.Error = e;
+            }
+            finally
+            {
+                cached.Desc = new DF_PSODesc12(); // release shader references
+                Interlocked.Decrement(ref pendingCount);
+            }
+        }
+
+        /// <summary>
+        /// Remove the queued pre-warm requests, and wait for the PSOs being compiled. 
+        /// The removed requests that were not started are returned, and can still be compiled on demand or queued again with ResumeCompilation().
+        /// </summary>
+        private List<CachedPSO> SuspendCompilation()
+        {
+            List<CachedPSO> suspended = new List<CachedPSO>();
+            CachedPSO cached;
+            while (prewarmQueue.TryDequeue(out cached))
+            {
+                if (cached.Started == 0)
+                    suspended.Add(cached);
+            }
+
+            SpinWait spin = new SpinWait();
+            while (compileThreadCount > 0)
+                spin.SpinOnce();
+
+            return suspended;
+        }
+
+        /// <summary>
+        /// Queue again the pre-warm requests removed by SuspendCompilation(), skipping the ones compiled on demand in the meantime.
+        /// </summary>
+        private void ResumeCompilation(List<CachedPSO> suspended)
+        {
+            foreach (CachedPSO cached in suspended)
+            {
+                if (cached.Started == 0)
+                    prewarmQueue.Enqueue(cached);
             }
 
-            return Device.CreatePSO(cachedDesc);
+            if (!prewarmQueue.IsEmpty && TryAddCompileThread())
+                SlimParallel.RunAsync(compileTask);
         }
 
-        protected override IEnumerable<PSOState> GenerateAllStateDescriptions()
+        #endregion
+
+        #region Persistence
+
+        /// <summary>
+        /// Load the pipeline library saved by a previous run, and queue the pre-warming of the states listed in the specified file.
+        /// If the list is not available, it's generated from all the effects in the binding table.
+        /// </summary>
+        public void Load(string libraryPath, string prewarmListPath)
         {
-            throw new System.NotImplementedException();
+            // load the library, discarding it if shaders have been recompiled since it was saved
+            byte[] libraryBytes = null;
+            try
+            {
+                if (File.Exists(libraryPath))
+                {
+                    using (BinaryReader reader = new BinaryReader(File.OpenRead(libraryPath)))
+                    {
+                        Digest128 savedDigest = new Digest128(reader.ReadUInt64(), reader.ReadUInt64());
+                        if (savedDigest == bindingsDigest)
+                            libraryBytes = reader.ReadBytes((int)(reader.BaseStream.Length - reader.BaseStream.Position));
+                    }
+                }
+            }
+            catch (IOException) { } // start with an empty library
+            library = device.CreatePipelineLibrary(libraryBytes);
+
+            // pre-warm listed states
+            List<PSOStateRecord> records = null;
+            try
+            {
+                if (File.Exists(prewarmListPath))
+                {
+                    using (BinaryReader reader = new BinaryReader(File.OpenRead(prewarmListPath)))
+                    {
+                        if (reader.ReadInt32() == PREWARM_LIST_VERSION)
+                        {
+                            records = new List<PSOStateRecord>();
+                            int count = reader.ReadInt32();
+                            for (int i = 0; i < count; i++)
+                                records.Add(PSOStateRecord.FromStream(reader));
+                        }
+                    }
+                }
+            }
+            catch (IOException)
+            {
+                records = null;
+            }
+
+            if (records != null)
+            {
+                foreach (PSOStateRecord record in records)
+                    Prewarm(record);
+            }
+            else
+            {
+                CacheAllStates();
+            }
         }
 
-        protected override void ReleaseState(DF_PipelineState12 state)
+        /// <summary>
+        /// Save the pipeline library and the list of all the states cached so far, to be pre-warmed on the next run.
+        /// Pending pre-warm requests are suspended while the library is serialized.
+        /// </summary>
+        public void Save(string libraryPath, string prewarmListPath)
         {
-            state.Release();
+            List<PSOStateRecord> records = new List<PSOStateRecord>();
+            foreach (CachedPSO cached in cachedStates.Values)
+                records.Add(cached.Record);
+
+            List<CachedPSO> suspended = SuspendCompilation();
+
+            try
+            {
+                using (BinaryWriter writer = new BinaryWriter(File.Create(prewarmListPath)))
+                {
+                    writer.Write(PREWARM_LIST_VERSION);
+                    writer.Write(records.Count);
+                    foreach (PSOStateRecord record in records)
+                        record.Save(writer);
+                }
+
+                if (library != null)
+                {
+                    using (BinaryWriter writer = new BinaryWriter(File.Create(libraryPath)))
+                    {
+                        writer.Write(bindingsDigest.Low);
+                        writer.Write(bindingsDigest.High);
+                        writer.Write(library.Serialize());
+                    }
+                }
+            }
+            catch (IOException) { } // the cache is optional, ignore read-only folders
+            catch (UnauthorizedAccessException) { }
+            finally
+            {
+                ResumeCompilation(suspended);
+            }
+        }
+
+        #endregion
+
+        public void Release()
+        {
+            foreach (CachedPSO cached in SuspendCompilation())
+            {
+                if (Interlocked.Exchange(ref cached.Started, 1) == 0)
+                    Interlocked.Decrement(ref pendingCount);
+            }
+
+            foreach (CachedPSO cached in cachedStates.Values)
+                if (cached.State != null)
+                    cached.State.Release();
+            cachedStates.Clear();
+
+            if (library != null)
+            {
+                library.Release();
+                library = null;
+            }
         }
     }
 }
@@ -0,0 +1,141 @@
+﻿using System.Collections.Generic;
+using Dragonfly.Utils;
+using DragonflyGraphicsWrappers.DX12;
+
+namespace Dragonfly.Graphics.API.Directx12
+{
+    /// <summary>
+    /// Places resources on a list of large heaps for each kind of resource, so that most of them are created without a new memory allocation.
+    /// Heap ranges are managed by a TLSF allocator. Heaps are created on demand and released when empty, except the last one of each kind.
+    /// </summary>
+    internal class HeapSuballocator : DF_IHeapAllocator12
+    {
+        private const long HEAP_BYTE_SIZE = 64 * 1024 * 1024;
+        private const long MAX_PLACED_BYTE_SIZE = HEAP_BYTE_SIZE / 4; // bigger resources are committed, to avoid wasting heap space
+        private const long MIN_BLOCK_SIZE = 4 * 1024; // smallest placement alignment, used by small textures
+
+        private class HeapInfo
+        {
+            public DF_Heap12 Heap;
+            public TlsfAllocator Ranges;
+        }
+
+        private struct AllocationInfo
+        {
+            public HeapInfo Heap;
+            public TlsfAllocator.Allocation Range;
+        }
+
+        private DF_D3D12Device device;
+        private List<HeapInfo>[] heaps; // list of heaps for each DF_HeapKind12
+        private Dictionary<int, AllocationInfo> allocations;
+        private int nextAllocationID;
+        private object heapLock; // resources can be finalized on other threads
+
+        public HeapSuballocator(DF_D3D12Device device)
+        {
+            this.device = device;
+            heaps = new List<HeapInfo>[3];
+            for (int i = 0; i < heaps.Length; i++)
+                heaps[i] = new List<HeapInfo>();
+            allocations = new Dictionary<int, AllocationInfo>();
+            heapLock = new object();
+        }
+
+        public DF_Heap12 Allocate(DF_HeapKind12 kind, ulong byteSize, ulong alignment, out ulong heapOffset, out int allocationID)
+        {
+            heapOffset = 0;
+            allocationID = -1;
+            if ((long)byteSize > MAX_PLACED_BYTE_SIZE)
+                return null;
+
+            lock (heapLock)
+            {
+                // search the first heap with enough space
+                List<HeapInfo> kindHeaps = heaps[(int)kind];
+                AllocationInfo a = new AllocationInfo();
+                foreach (HeapInfo heap in kindHeaps)
+                {
+                    if (heap.Ranges.TryAllocate((long)byteSize, (long)alignment, out a.Range))
+                    {
+                        a.Heap = heap;
+                        break;
+                    }
+                }
+
+                if (a.Heap == null)
+                {
+                    // all heaps are full, add a new one
+                    a.Heap = new HeapInfo();
+                    a.Heap.Heap = device.CreateHeap((ulong)HEAP_BYTE_SIZE, kind);
+                    a.Heap.Ranges = new TlsfAllocator(HEAP_BYTE_SIZE, MIN_BLOCK_SIZE);
+                    kindHeaps.Add(a.Heap);
+                    if (!a.Heap.Ranges.TryAllocate((long)byteSize, (long)alignment, out a.Range))
+                        return null;
+                }
+
+                allocationID = nextAllocationID++;
+                allocations.Add(allocationID, a);
+                heapOffset = (ulong)a.Range.Offset;
+                return a.Heap.Heap;
+            }
+        }
+
+        public void Free(int allocationID)
+        {
+            lock (heapLock)
+            {
+                AllocationInfo a;
+                if (!allocations.TryGetValue(allocationID, out a))
+                    return; // heaps already released
+
+                allocations.Remove(allocationID);
+                a.Heap.Ranges.Free(a.Range);
+
+                // release empty heaps
+                List<HeapInfo> kindHeaps = heaps[(int)a.Heap.Heap.GetKind()];
+                if (a.Heap.Ranges.IsEmpty && kindHeaps.Count > 1)
+                {
+                    kindHeaps.Remove(a.Heap);
+                    a.Heap.Heap.Release();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Returns the allocation statistics of the heaps of the specified kind.
+        /// </summary>
+        public AllocatorStats GetStats(DF_HeapKind12 kind)
+        {
+            lock (heapLock)
+            {
+                AllocatorStats stats = new AllocatorStats();
+                foreach (HeapInfo heap in heaps[(int)kind])
+                    stats += heap.Ranges.GetStats();
+                return stats;
+            }
+        }
+
+        /// <summary>
+        /// Returns the allocation statistics of all the heaps.
+        /// </summary>
+        public AllocatorStats GetStats()
+        {
+            return GetStats(DF_HeapKind12.Buffers) + GetStats(DF_HeapKind12.UploadBuffers) + GetStats(DF_HeapKind12.Textures);
+        }
+
+        public void Release()
+        {
+            lock (heapLock)
+            {
+                foreach (List<HeapInfo> kindHeaps in heaps)
+                {
+                    foreach (HeapInfo heap in kindHeaps)
+                        heap.Heap.Release();
+                    kindHeaps.Clear();
+                }
+                allocations.Clear();
+            }
+        }
+    }
+}
@@ -0,0 +1,135 @@
+﻿using System.Collections.Generic;
+using DragonflyGraphicsWrappers.DX12;
+
+namespace Dragonfly.Graphics.API.Directx12
+{
+    /// <summary>
+    /// A linear allocator of upload memory for data that is only used in the current frame, like constant buffers versions and staging copies.
+    /// Allocations are bump-allocated from fixed size pages. Each frame in the swap chain has its own list of pages, which is reused once the same back buffer comes back.
+    /// </summary>
+    internal class UploadRing : DF_IUploadAllocator12
+    {
+        private DF_D3D12Device device;
+        private int pageByteSize;
+        private List<DF_Resource12>[] framePages; // the pages of each frame in the swap chain
+        private List<DF_Resource12>[] frameLargeBuffers; // dedicated buffers for the allocations bigger than a page, released when their frame comes back
+        private int frameIndex; // index of the current frame in the swap chain
+        private int curPage; // index of the page currently used for allocations
+        private long curPageOffset; // first free byte in the current page
+
+        public UploadRing(DF_D3D12Device device, int pageByteSize)
+        {
+            this.device = device;
+            this.pageByteSize = pageByteSize;
+            framePages = new List<DF_Resource12>[DF_Directx3D12.GetBackbufferCount()];
+            frameLargeBuffers = new List<DF_Resource12>[framePages.Length];
+            for (int i = 0; i < framePages.Length; i++)
+            {
+                framePages[i] = new List<DF_Resource12>();
+                frameLargeBuffers[i] = new List<DF_Resource12>();
+            }
+        }
+
+        /// <summary>
+        /// Free all the allocations made the last time the current back buffer was used.
+        /// </summary>
+        public void NewFrame()
+        {
+            frameIndex = device.GetBackBufferIndex();
+            curPage = 0;
+            curPageOffset = 0;
+
+            foreach (DF_Resource12 largeBuffer in frameLargeBuffers[frameIndex])
+                largeBuffer.Release();
+            frameLargeBuffers[frameIndex].Clear();
+        }
+
+        /// <summary>
+        /// Allocate a range of upload memory that can be bound as a constant buffer, valid until the end of the frame.
+        /// </summary>
+        /// <param name="byteSize">The required size, that must be already aligned with DF_Directx3D12.PadCBufferSize().</param>
+        /// <param name="byteOffset">The byte offset of the allocated range in the returned resource.</param>
+        /// <returns>The upload resource that contains the allocation.</returns>
+        public DF_Resource12 Allocate(int byteSize, out int byteOffset)
+        {
+            long longOffset;
+            DF_Resource12 page = Allocate(byteSize, 1, out longOffset);
+            byteOffset = (int)longOffset;
+            return page;
+        }
+
+        /// <summary>
+        /// Allocate a range of upload memory with the specified alignment, valid until the end of the frame.
+        /// </summary>
+        public DF_Resource12 Allocate(long byteSize, long alignment, out long byteOffset)
+        {
+            if (byteSize > pageByteSize)
+            {
+                // too big for a page: use a dedicated buffer
+                DF_Resource12 largeBuffer = device.CreateBuffer((int)byteSize, DF_CPUAccess.Write);
+                frameLargeBuffers[frameIndex].Add(largeBuffer);
+                byteOffset = 0;
+                return largeBuffer;
+            }
+
+            List<DF_Resource12> pages = framePages[frameIndex];
+            long alignedOffset = (curPageOffset + alignment - 1) / alignment * alignment;
+
+            if (curPage < pages.Count && alignedOffset + byteSize > pageByteSize)
+            {
+                // current page is full, move to the next one
+                curPage++;
+                alignedOffset = 0;
+            }
+
+            if (curPage == pages.Count)
+            {
+                // all the pages are in use, add a new one
+                pages.Add(device.CreateBuffer(pageByteSize, DF_CPUAccess.Write));
+            }
+
+            byteOffset = alignedOffset;
+            curPageOffset = alignedOffset + byteSize;
+            return pages[curPage];
+        }
+
+        DF_Resource12 DF_IUploadAllocator12.Allocate(ulong byteSize, ulong alignment, out ulong byteOffset)
+        {
+            long longOffset;
+            DF_Resource12 page = Allocate((long)byteSize, (long)alignment, out longOffset);
+            byteOffset = (ulong)longOffset;
+            return page;
+        }
+
+        /// <summary>
+        /// Total size in bytes of the upload memory allocated by this ring.
+        /// </summary>
+        public long ByteSize
+        {
+            get
+            {
+                long byteSize = 0;
+                for (int i = 0; i < framePages.Length; i++)
+                {
+                    byteSize += (long)framePages[i].Count * pageByteSize;
+                    foreach (DF_Resource12 largeBuffer in frameLargeBuffers[i])
+                        byteSize += (long)largeBuffer.GetSizeInBytes();
+                }
+                return byteSize;
+            }
+        }
+
+        public void Release()
+        {
+            for (int i = 0; i < framePages.Length; i++)
+            {
+                foreach (DF_Resource12 page in framePages[i])
+                    page.Release();
+                framePages[i].Clear();
+                foreach (DF_Resource12 largeBuffer in frameLargeBuffers[i])
+                    largeBuffer.Release();
+                frameLargeBuffers[i].Clear();
+            }
+        }
+    }
+}
@@ -78,6 +78,7 @@ namespace Dragonfly.Graphics.API.Directx9
         private DirectxPadder padder;
         private GlobalTexManager<int> globalTextures;
         private CmdListCoordinator cmdListCoordinator;
+        private List<GraphicResourceID> readyLists; // command lists ready to be executed, as returned by the coordinator
 
         public Directx9Graphics(DFGraphicSettings settings, Directx9API api) : base(settings, api)
         {
@@ -114,6 +115,7 @@ namespace Dragonfly.Graphics.API.Directx9
             padder = new DirectxPadder();
             globalTextures = new GlobalTexManager<int>(ShaderBindingTable, SetGlobalTexture, SetGlobalTarget);
             cmdListCoordinator = new CmdListCoordinator();
+            readyLists = new List<GraphicResourceID>();
         }
 
         private void resetGraphicState()
@@ -203,14 +205,13 @@ namespace Dragonfly.Graphics.API.Directx9
 
         public override void StartRender()
         {
-            cmdListCoordinator.SolveRenderStages();
+            cmdListCoordinator.EndDeclarations();
 
             // synchronously execute all closed command lists
             while(!cmdListCoordinator.EndOfFrame)
             {
-                HashSet<GraphicResourceID> lists;
-                cmdListCoordinator.ToBeExecuted.TryDequeue(out lists);
-                foreach (GraphicResourceID cmdList in lists)
+                cmdListCoordinator.WaitReadyLists(readyLists);
+                foreach (GraphicResourceID cmdList in readyLists)
                     commandList_Execute(cmdList);
             }
 
@@ -606,9 +607,10 @@ namespace Dragonfly.Graphics.API.Directx9
 
         #region IndexBuffer
 
-        protected override GraphicResourceID createIndexBuffer(int indexCount)
+        protected override GraphicResourceID createIndexBuffer(int indexCount, IndexFormat format)
         {
-            DF_IndexBuffer ib = device.CreateIndexBuffer((uint)indexCount * 2);
+            bool use32BitIndices = format == IndexFormat.Index32;
+            DF_IndexBuffer ib = device.CreateIndexBuffer((uint)indexCount * (use32BitIndices ? 4u : 2u), use32BitIndices);
             GraphicResourceID id = new GraphicResourceID(ib.GetResourceHash());
             indexBuffers.Add(id, ib);
             return id;
@@ -619,6 +621,11 @@ namespace Dragonfly.Graphics.API.Directx9
             this.indexBuffers[resID].SetIndices(0, (uint)indexCount, indices);
         }
 
+        protected override void indexBuffer_SetIndices(GraphicResourceID resID, uint[] indices, int indexCount)
+        {
+            this.indexBuffers[resID].SetIndices(0, (uint)indexCount, indices);
+        }
+
         protected override void indexBuffer_Release(GraphicResourceID resID)
         {
             if (device.Released) return;
@@ -1012,7 +1019,7 @@ namespace Dragonfly.Graphics.API.Directx9
             c.Reset();
             cmdListCoordinator.DeclareList(resID, requiredLists);
             if (flushRequired)
-                cmdListCoordinator.SolveRenderStages();
+                cmdListCoordinator.Flush();
         }
 
         protected override void commandList_QueueExecution(GraphicResourceID resID)
@@ -1124,6 +1131,7 @@ namespace Dragonfly.Graphics.API.Directx9
 
         protected override void commandList_Release(GraphicResourceID resID)
         {
+            cmdListCoordinator.ReleaseList(resID);
             cmdLists.Remove(resID);
         }
 
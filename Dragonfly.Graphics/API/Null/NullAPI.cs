@@ -0,0 +1,75 @@
+﻿using Dragonfly.Graphics.API.Directx11;
+using Dragonfly.Graphics.Math;
+using Dragonfly.Graphics.Shaders;
+using System.Collections.Generic;
+
+namespace Dragonfly.Graphics.API.Null
+{
+    /// <summary>
+    /// An headless API that doesn't require any device: all the graphic calls are recorded in memory and discarded at the end of the frame.
+    /// Can be used to measure the CPU cost of a frame, or to run scenes on machines without a GPU.
+    /// </summary>
+    public class NullAPI : IGraphicsAPI
+    {
+        public NullAPI() : this(new Directx11API()) { }
+
+        /// <param name="bindingTableAPI">The API from which the precompiled shader binding table will be loaded.</param>
+        public NullAPI(IGraphicsAPI bindingTableAPI)
+        {
+            BindingTableAPI = bindingTableAPI;
+            LastFrameStats = new NullFrameStats();
+        }
+
+        public string Description
+        {
+            get { return "Null"; }
+        }
+
+        /// <summary>
+        /// The API whose shader binding table is used to resolve effects, variants and parameters.
+        /// </summary>
+        public IGraphicsAPI BindingTableAPI { get; private set; }
+
+        /// <summary>
+        /// Counters collected during the last frame displayed by a graphics instance created from this API.
+        /// </summary>
+        public NullFrameStats LastFrameStats { get; internal set; }
+
+        public bool IsSupported
+        {
+            get
+            {
+                return true;
+            }
+        }
+
+        public List<Int2> DefaultDisplayResolutions
+        {
+            get
+            {
+                return new List<Int2>()
+                {
+                    new Int2(1280, 720),
+                    new Int2(1920, 1080),
+                    new Int2(2560, 1440),
+                    new Int2(3840, 2160)
+                };
+            }
+        }
+
+        public IDFGraphics CreateGraphics(DFGraphicSettings settings)
+        {
+            return new NullGraphics(settings, this);
+        }
+
+        public ShaderCompiler CreateShaderCompiler()
+        {
+            return BindingTableAPI.CreateShaderCompiler();
+        }
+
+        public override string ToString()
+        {
+            return Description;
+        }
+    }
+}
@@ -0,0 +1,139 @@
+﻿using System;
+
+namespace Dragonfly.Graphics.API.Null
+{
+    /// <summary>
+    /// Records the commands issued to a command list as a compact byte stream, tracking the bound states to count the effective state changes.
+    /// </summary>
+    internal class NullCmdList
+    {
+        private const int INITIAL_STREAM_BYTE_SIZE = 4096;
+
+        private byte[] stream;
+
+        /// <summary>
+        /// ID if the command list resource.
+        /// </summary>
+        public GraphicResourceID ResourceID;
+
+        /// <summary>
+        /// Counters collected while recording the current commands.
+        /// </summary>
+        public NullFrameStats Stats;
+
+        // bound states
+        public GraphicResourceID Shader, Vertices, Indices;
+        public GraphicResourceID[] RenderTargets;
+        public int VertexCount, IndexCount;
+
+        public NullCmdList(GraphicResourceID resID)
+        {
+            ResourceID = resID;
+            Stats = new NullFrameStats();
+            stream = new byte[INITIAL_STREAM_BYTE_SIZE];
+            RenderTargets = new GraphicResourceID[8];
+        }
+
+        /// <summary>
+        /// Number of bytes recorded since the last reset.
+        /// </summary>
+        public int ByteLength { get; private set; }
+
+        public void Reset()
+        {
+            ByteLength = 0;
+            Stats.Reset();
+            Shader = Vertices = Indices = null;
+            Array.Clear(RenderTargets, 0, RenderTargets.Length);
+            VertexCount = IndexCount = 0;
+        }
+
+        /// <summary>
+        /// Signal that the recording of this list is completed, updating its statistics.
+        /// </summary>
+        public void Close()
+        {
+            Stats.RecordedBytes = ByteLength;
+        }
+
+        private void Reserve(int byteCount)
+        {
+            if (ByteLength + byteCount <= stream.Length)
+                return;
+
+            byte[] newStream = new byte[System.Math.Max(2 * stream.Length, ByteLength + byteCount)];
+            Buffer.BlockCopy(stream, 0, newStream, 0, ByteLength);
+            stream = newStream;
+        }
+
+        public void Write(NullCmdType cmd)
+        {
+            Reserve(1);
+            stream[ByteLength++] = (byte)cmd;
+        }
+
+        public void Write(int value)
+        {
+            Reserve(4);
+            stream[ByteLength++] = (byte)value;
+            stream[ByteLength++] = (byte)(value >> 8);
+            stream[ByteLength++] = (byte)(value >> 16);
+            stream[ByteLength++] = (byte)(value >> 24);
+        }
+
+        public void Write(GraphicResourceID resID)
+        {
+            Write(resID == null ? -1 : resID.GetHashCode());
+        }
+
+        public void Write(float[] values)
+        {
+            int byteCount = values.Length * sizeof(float);
+            Reserve(byteCount + 4);
+            Write(byteCount);
+            Buffer.BlockCopy(values, 0, stream, ByteLength, byteCount);
+            ByteLength += byteCount;
+        }
+
+        public void Write(int[] values)
+        {
+            int byteCount = values.Length * sizeof(int);
+            Reserve(byteCount + 4);
+            Write(byteCount);
+            Buffer.BlockCopy(values, 0, stream, ByteLength, byteCount);
+            ByteLength += byteCount;
+        }
+
+        /// <summary>
+        /// Record a state change, if the new value differs from the currently bound one.
+        /// </summary>
+        /// <returns>True if the state was changed.</returns>
+        public bool ChangeState(ref GraphicResourceID curState, GraphicResourceID newState)
+        {
+            if (curState == newState)
+                return false;
+
+            curState = newState;
+            Stats.StateChanges++;
+            return true;
+        }
+    }
+
+    internal enum NullCmdType : byte
+    {
+        ClearSurfaces,
+        Draw,
+        DrawIndexed,
+        DrawIndexedInstanced,
+        DrawInstanceBuffer,
+        SetViewport,
+        SetVertices,
+        SetIndices,
+        SetShader,
+        SetRenderTarget,
+        DisableRenderTarget,
+        ResetRenderTargets,
+        SetParam,
+        SetParamTexture
+    }
+}
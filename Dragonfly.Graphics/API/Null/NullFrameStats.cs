@@ -0,0 +1,85 @@
+﻿namespace Dragonfly.Graphics.API.Null
+{
+    /// <summary>
+    /// Per-frame counters collected by the Null API while recording and executing command lists.
+    /// </summary>
+    public class NullFrameStats
+    {
+        /// <summary>
+        /// Number of draw calls executed.
+        /// </summary>
+        public int Draws { get; internal set; }
+
+        /// <summary>
+        /// Number of instances drawn by instanced draw calls.
+        /// </summary>
+        public int Instances { get; internal set; }
+
+        /// <summary>
+        /// Bytes of instance data uploaded, either as transient instance lists or as updates to instance buffers.
+        /// </summary>
+        public long InstanceBytes { get; internal set; }
+
+        /// <summary>
+        /// Number of calls that changed the bound shader, buffers, render targets or viewport.
+        /// </summary>
+        public int StateChanges { get; internal set; }
+
+        /// <summary>
+        /// Number of shader constants bytes uploaded, after padding.
+        /// </summary>
+        public long ConstantBytes { get; internal set; }
+
+        /// <summary>
+        /// Size in bytes of all the recorded command streams.
+        /// </summary>
+        public long RecordedBytes { get; internal set; }
+
+        /// <summary>
+        /// Number of command lists executed.
+        /// </summary>
+        public int ExecutedLists { get; internal set; }
+
+        /// <summary>
+        /// CPU time elapsed between the start of the frame and its presentation.
+        /// </summary>
+        public double CpuMilliseconds { get; internal set; }
+
+        internal void Reset()
+        {
+            Draws = 0;
+            Instances = 0;
+            InstanceBytes = 0;
+            StateChanges = 0;
+            ConstantBytes = 0;
+            RecordedBytes = 0;
+            ExecutedLists = 0;
+            CpuMilliseconds = 0;
+        }
+
+        internal void Add(NullFrameStats other)
+        {
+            Draws += other.Draws;
+            Instances += other.Instances;
+            InstanceBytes += other.InstanceBytes;
+            StateChanges += other.StateChanges;
+            ConstantBytes += other.ConstantBytes;
+            RecordedBytes += other.RecordedBytes;
+            ExecutedLists += other.ExecutedLists;
+        }
+
+        internal NullFrameStats Clone()
+        {
+            NullFrameStats clone = new NullFrameStats();
+            clone.Add(this);
+            clone.CpuMilliseconds = CpuMilliseconds;
+            return clone;
+        }
+
+        public override string ToString()
+        {
+            return string.Format("Draws: {0}, Instances: {1} ({2} bytes), State changes: {3}, Constants: {4} bytes, Recorded: {5} bytes, Lists: {6}, CPU: {7:0.00}ms",
+                Draws, Instances, InstanceBytes, StateChanges, ConstantBytes, RecordedBytes, ExecutedLists, CpuMilliseconds);
+        }
+    }
+}
@@ -0,0 +1,787 @@
+﻿using Dragonfly.Graphics.API.Common;
+using Dragonfly.Graphics.Math;
+using Dragonfly.Graphics.Resources;
+using Dragonfly.Utils;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Threading;
+
+namespace Dragonfly.Graphics.API.Null
+{
+    /// <summary>
+    /// Graphics implementation that records all the commands without a device.
+    /// </summary>
+    internal class NullGraphics : DFGraphics
+    {
+        private const int DEFAULT_WIDTH = 1280, DEFAULT_HEIGHT = 720;
+        private const int INSTANCE_BYTE_SIZE = 64; // size of a Float4x4 instance matrix
+
+        internal class RTInfo
+        {
+            public bool UsePercent;
+            public float BackBufferPercent;
+            public int Width, Height;
+            public bool HasDepthBuffer;
+            public GraphicResourceID OverrideZBuffer;
+            public long LastCaptureFrameID;
+        }
+
+        internal class ShaderInfo
+        {
+            public ShaderInfo Parent;
+            public int ParamCount;
+        }
+
+        private NullAPI api;
+        private CmdListCoordinator cmdListCoordinator;
+        private List<GraphicResourceID> readyLists; // command lists ready to be executed, as returned by the coordinator
+        private ThreadLocal<DirectxPadder> padder;
+        private NullFrameStats frameStats;
+        private Stopwatch frameTimer;
+        private long frameID;
+
+        // resources
+        private Dictionary<GraphicResourceID, NullCmdList> commandLists;
+        private Dictionary<GraphicResourceID, RTInfo> renderTargets;
+        private Dictionary<GraphicResourceID, Int2> textures;
+        private Dictionary<GraphicResourceID, ShaderInfo> shaders;
+        private Dictionary<GraphicResourceID, int> vertexBuffers; // vb ID -> vertex count
+        private Dictionary<GraphicResourceID, int> indexBuffers; // ib ID -> index count
+
+        public NullGraphics(DFGraphicSettings settings, NullAPI api) : base(settings, api.BindingTableAPI)
+        {
+            this.api = api;
+            GraphicsAPI = api;
+            CurWidth = settings.PreferredWidth > 0 ? settings.PreferredWidth : DEFAULT_WIDTH;
+            CurHeight = settings.PreferredHeight > 0 ? settings.PreferredHeight : DEFAULT_HEIGHT;
+
+            cmdListCoordinator = new CmdListCoordinator();
+            readyLists = new List<GraphicResourceID>();
+            padder = new ThreadLocal<DirectxPadder>(() => new DirectxPadder(), false);
+            frameStats = new NullFrameStats();
+            frameTimer = new Stopwatch();
+
+            commandLists = new Dictionary<GraphicResourceID, NullCmdList>();
+            renderTargets = new Dictionary<GraphicResourceID, RTInfo>();
+            textures = new Dictionary<GraphicResourceID, Int2>();
+            shaders = new Dictionary<GraphicResourceID, ShaderInfo>();
+            vertexBuffers = new Dictionary<GraphicResourceID, int>();
+            indexBuffers = new Dictionary<GraphicResourceID, int>();
+        }
+
+        public override int CurWidth { get; protected set; }
+
+        public override int CurHeight { get; protected set; }
+
+        public override bool IsAvailable
+        {
+            get { return true; }
+        }
+
+        public override List<Int2> SupportedDisplayResolutions
+        {
+            get { return api.DefaultDisplayResolutions; }
+        }
+
+        #region Graphic Calls
+
+        public override bool NewFrame()
+        {
+            cmdListCoordinator.NewFrame();
+            frameStats.Reset();
+            frameTimer.Restart();
+            return base.NewFrame();
+        }
+
+        public override void StartRender()
+        {
+            cmdListCoordinator.EndDeclarations();
+
+            // execute all closed command lists
+            while (!cmdListCoordinator.EndOfFrame)
+            {
+                cmdListCoordinator.WaitReadyLists(readyLists);
+                foreach (GraphicResourceID cmdListID in readyLists)
+                    ExecuteCommandList(commandLists[cmdListID]);
+            }
+        }
+
+        private void ExecuteCommandList(NullCmdList cmdList)
+        {
+            frameStats.Add(cmdList.Stats);
+            frameStats.ExecutedLists++;
+        }
+
+        public override void DisplayRender()
+        {
+            frameStats.CpuMilliseconds = frameTimer.Elapsed.TotalMilliseconds;
+            api.LastFrameStats = frameStats.Clone();
+            frameID++;
+        }
+
+        protected override void setScreen(IntPtr target, bool fullScreen, int width, int height)
+        {
+            CurWidth = width;
+            CurHeight = height;
+
+            // update resolution-dependent render targets
+            foreach (RTInfo rtInfo in renderTargets.Values)
+                UpdateRtDimensions(rtInfo);
+        }
+
+        protected override void release()
+        {
+            commandLists.Clear();
+            renderTargets.Clear();
+            textures.Clear();
+            shaders.Clear();
+            vertexBuffers.Clear();
+            indexBuffers.Clear();
+        }
+
+        #endregion
+
+        #region VertexBuffer
+
+        protected override GraphicResourceID createVertexBuffer(VertexType vtype, int vertexCount)
+        {
+            GraphicResourceID id = new GraphicResourceID();
+            vertexBuffers.Add(id, vertexCount);
+            return id;
+        }
+
+        protected override void vertexBuffer_SetVertices<T>(GraphicResourceID resID, T[] vertices, int vertexCount)
+        {
+            vertexBuffers[resID] = vertexCount;
+        }
+
+        protected override void vertexBuffer_Release(GraphicResourceID resID)
+        {
+            vertexBuffers.Remove(resID);
+        }
+
+        #endregion
+
+        #region IndexBuffer
+
+        protected override GraphicResourceID createIndexBuffer(int indexCount, IndexFormat format)
+        {
+            GraphicResourceID id = new GraphicResourceID();
+            indexBuffers.Add(id, indexCount);
+            return id;
+        }
+
+        protected override void indexBuffer_SetIndices(GraphicResourceID resID, ushort[] indices, int indexCount)
+        {
+            indexBuffers[resID] = indexCount;
+        }
+
+        protected override void indexBuffer_SetIndices(GraphicResourceID resID, uint[] indices, int indexCount)
+        {
+            indexBuffers[resID] = indexCount;
+        }
+
+        protected override void indexBuffer_Release(GraphicResourceID resID)
+        {
+            indexBuffers.Remove(resID);
+        }
+
+        #endregion
+
+        #region InstanceBuffer
+
+        protected override void instanceBuffer_SetInstances(GraphicResourceID resID, Float4x4[] instances, int startIndex, int count)
+        {
+            frameStats.InstanceBytes += count * INSTANCE_BYTE_SIZE;
+        }
+
+        #endregion
+
+        #region Texture
+
+        protected override GraphicResourceID createTexture<T>(int width, int height, SurfaceFormat format, T[] initialPixelData)
+        {
+            GraphicResourceID id = new GraphicResourceID();
+            textures.Add(id, new Int2(width, height));
+            return id;
+        }
+
+        protected override GraphicResourceID createTexture(byte[] fileData, out int width, out int height)
+        {
+            ReadImageSize(fileData, out width, out height);
+            GraphicResourceID id = new GraphicResourceID();
+            textures.Add(id, new Int2(width, height));
+            return id;
+        }
+
+        /// <summary>
+        /// Read the image resolution from the header of DDS and PNG files. Other formats are loaded as a single pixel.
+        /// </summary>
+        private static void ReadImageSize(byte[] fileData, out int width, out int height)
+        {
+            width = height = 1;
+            if (fileData.Length >= 20 && fileData[0] == 'D' && fileData[1] == 'D' && fileData[2] == 'S' && fileData[3] == ' ')
+            {
+                height = BitConverter.ToInt32(fileData, 12);
+                width = BitConverter.ToInt32(fileData, 16);
+            }
+            else if (fileData.Length >= 24 && fileData[1] == 'P' && fileData[2] == 'N' && fileData[3] == 'G')
+            {
+                width = (fileData[16] << 24) | (fileData[17] << 16) | (fileData[18] << 8) | fileData[19];
+                height = (fileData[20] << 24) | (fileData[21] << 16) | (fileData[22] << 8) | fileData[23];
+            }
+        }
+
+        protected override void texture_SetData<T>(GraphicResourceID resID, T[] data, int rowLength) { }
+
+        protected override void texture_Release(GraphicResourceID resID)
+        {
+            textures.Remove(resID);
+        }
+
+        #endregion
+
+        #region RenderTarget
+
+        protected override GraphicResourceID createRenderTarget(int width, int height, SurfaceFormat format, bool depthTestSupported)
+        {
+            RTInfo rtInfo = new RTInfo() { Width = width, Height = height, HasDepthBuffer = depthTestSupported, LastCaptureFrameID = -1 };
+            return AddRenderTarget(rtInfo);
+        }
+
+        protected override GraphicResourceID createRenderTarget(float backBufferSizePercent, SurfaceFormat format, bool depthTestSupported)
+        {
+            RTInfo rtInfo = new RTInfo() { UsePercent = true, BackBufferPercent = backBufferSizePercent, HasDepthBuffer = depthTestSupported, LastCaptureFrameID = -1 };
+            UpdateRtDimensions(rtInfo);
+            return AddRenderTarget(rtInfo);
+        }
+
+        private GraphicResourceID AddRenderTarget(RTInfo rtInfo)
+        {
+            GraphicResourceID id = new GraphicResourceID();
+            renderTargets.Add(id, rtInfo);
+            textures.Add(id, new Int2(rtInfo.Width, rtInfo.Height)); // render targets can be bound as textures
+            return id;
+        }
+
+        private void UpdateRtDimensions(RTInfo rtInfo)
+        {
+            if (!rtInfo.UsePercent)
+                return; // only RTs that have their size expressed as a percent are resolution-dependent
+
+            rtInfo.Width = System.Math.Max(2, (int)(CurWidth * rtInfo.BackBufferPercent));
+            rtInfo.Height = System.Math.Max(2, (int)(CurHeight * rtInfo.BackBufferPercent));
+        }
+
+        protected override void renderTarget_Release(GraphicResourceID resID)
+        {
+            renderTargets.Remove(resID);
+            textures.Remove(resID);
+        }
+
+        protected override int renderTarget_GetWidth(GraphicResourceID resID)
+        {
+            return renderTargets[resID].Width;
+        }
+
+        protected override int renderTarget_GetHeight(GraphicResourceID resID)
+        {
+            return renderTargets[resID].Height;
+        }
+
+        protected override void renderTarget_SaveSnapshot(GraphicResourceID resID)
+        {
+            renderTargets[resID].LastCaptureFrameID = frameID;
+        }
+
+        protected override bool renderTarget_TryGetSnapshotData<T>(GraphicResourceID resID, T[] destBuffer)
+        {
+            if (renderTargets[resID].LastCaptureFrameID < 0)
+                return false;
+
+            if (destBuffer != null)
+                Array.Clear(destBuffer, 0, destBuffer.Length); // no pixel data is ever produced
+
+            return true;
+        }
+
+        protected override void renderTarget_GetSnapshotData<T>(GraphicResourceID resID, T[] destBuffer)
+        {
+            if (!renderTarget_TryGetSnapshotData<T>(resID, destBuffer))
+                throw new InvalidGraphicCallException("The render target has not been rendered yet!");
+        }
+
+        protected override void renderTarget_CopyToTexture(GraphicResourceID resID, GraphicResourceID destTexture) { }
+
+        protected override void renderTarget_SetDepthWriteTarget(GraphicResourceID resID, RenderTarget depthWriteTarget)
+        {
+            renderTargets[resID].OverrideZBuffer = depthWriteTarget.ResourceID;
+        }
+
+        #endregion
+
+        #region Shader
+
+        protected override GraphicResourceID createShader(string effectName, ShaderStates states, string variantID, string templateName, GraphicResourceID useParametersFromShader)
+        {
+            ShaderBindingTable.GetEffect(effectName, templateName, variantID); // validate the effect as the other APIs would do
+
+            ShaderInfo shaderInfo = new ShaderInfo();
+            if (useParametersFromShader != null)
+                shaderInfo.Parent = shaders[useParametersFromShader];
+
+            GraphicResourceID id = new GraphicResourceID();
+            shaders.Add(id, shaderInfo);
+            return id;
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, bool value)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, int value)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, float value)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, Float2 value)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, Float3 value)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, Float4 value)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, Float4x4 value)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, Float3x3 value)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, Int3 value)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(value));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, int[] values)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, float[] values)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, Texture value)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(value.ResourceID.GetHashCode()));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, RenderTarget value)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(value.ResourceID.GetHashCode()));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, Float2[] values)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, Float3[] values)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, Float4[] values)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(values));
+        }
+
+        protected override void shader_SetParam(Shader shader, string name, Float4x4[] values)
+        {
+            shader_SetParamNoPad(shader, padder.Value.Pad(values));
+        }
+
+        private void shader_SetParamNoPad(Shader shader, float[] values)
+        {
+            shaders[shader.ResourceID].ParamCount++;
+        }
+
+        private void shader_SetParamNoPad(Shader shader, int[] values)
+        {
+            shaders[shader.ResourceID].ParamCount++;
+        }
+
+        protected override void shader_Release(GraphicResourceID resID)
+        {
+            shaders.Remove(resID);
+        }
+
+        #endregion
+
+        #region CommandList
+
+        protected override GraphicResourceID createCommandList()
+        {
+            GraphicResourceID id = new GraphicResourceID();
+            commandLists.Add(id, new NullCmdList(id));
+            return id;
+        }
+
+        protected override void commandList_StartRecording(GraphicResourceID resID, IReadOnlyList<GraphicResourceID> requiredLists, bool flushRequired)
+        {
+            cmdListCoordinator.DeclareList(resID, requiredLists); // signal that this command list will be used in this frame
+            if (flushRequired)
+                cmdListCoordinator.Flush();
+            commandLists[resID].Reset();
+        }
+
+        protected override void commandList_QueueExecution(GraphicResourceID resID)
+        {
+            commandLists[resID].Close();
+
+            cmdListCoordinator.QueueExecution(resID);
+        }
+
+        protected override void commandList_Release(GraphicResourceID resID)
+        {
+            cmdListCoordinator.ReleaseList(resID);
+            commandLists.Remove(resID);
+        }
+
+        protected override void commandList_ClearSurfaces(GraphicResourceID resID, Float4 clearValue, ClearFlags flags)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            cmdList.Write(NullCmdType.ClearSurfaces);
+            cmdList.Write((int)flags);
+            cmdList.Write(padder.Value.Pad(clearValue));
+        }
+
+        protected override void commandList_Draw(GraphicResourceID resID)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            cmdList.Write(NullCmdType.Draw);
+            cmdList.Write(cmdList.VertexCount);
+            cmdList.Stats.Draws++;
+        }
+
+        protected override void commandList_DrawIndexed(GraphicResourceID resID)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            cmdList.Write(NullCmdType.DrawIndexed);
+            cmdList.Write(cmdList.IndexCount);
+            cmdList.Stats.Draws++;
+        }
+
+        protected override void commandList_DrawIndexedInstanced(GraphicResourceID resID, ArrayRange<Float4x4> instances)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            cmdList.Write(NullCmdType.DrawIndexedInstanced);
+            cmdList.Write(cmdList.IndexCount);
+            cmdList.Write(instances.Count);
+            cmdList.Stats.Draws++;
+            cmdList.Stats.Instances += instances.Count;
+            cmdList.Stats.InstanceBytes += instances.Count * INSTANCE_BYTE_SIZE;
+        }
+
+        protected override void commandList_DrawIndexedInstanced(GraphicResourceID resID, InstanceBuffer instances, ArrayRange<int> visibleInstances)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            cmdList.Write(NullCmdType.DrawInstanceBuffer);
+            cmdList.Write(cmdList.IndexCount);
+            cmdList.Write(instances.ResourceID);
+            cmdList.Write(visibleInstances.Count);
+            cmdList.Stats.Draws++;
+            cmdList.Stats.Instances += visibleInstances.Count;
+        }
+
+        protected override void commandList_SetViewport(GraphicResourceID resID, AARect viewport)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            cmdList.Write(NullCmdType.SetViewport);
+            cmdList.Write(padder.Value.Pad(new Float4(viewport.X1, viewport.Y1, viewport.X2, viewport.Y2)));
+            cmdList.Stats.StateChanges++;
+        }
+
+        protected override void commandList_SetVertices(GraphicResourceID resID, VertexBuffer vertices)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            cmdList.VertexCount = vertexBuffers[vertices.ResourceID];
+            if (!cmdList.ChangeState(ref cmdList.Vertices, vertices.ResourceID))
+                return;
+
+            cmdList.Write(NullCmdType.SetVertices);
+            cmdList.Write(vertices.ResourceID);
+        }
+
+        protected override void commandList_SetIndices(GraphicResourceID resID, IndexBuffer indices)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            cmdList.IndexCount = indexBuffers[indices.ResourceID];
+            if (!cmdList.ChangeState(ref cmdList.Indices, indices.ResourceID))
+                return;
+
+            cmdList.Write(NullCmdType.SetIndices);
+            cmdList.Write(indices.ResourceID);
+        }
+
+        protected override void commandList_SetShader(GraphicResourceID resID, Shader shader)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            if (!cmdList.ChangeState(ref cmdList.Shader, shader.ResourceID))
+                return;
+
+            cmdList.Write(NullCmdType.SetShader);
+            cmdList.Write(shader.ResourceID);
+        }
+
+        protected override void commandList_SetRenderTarget(GraphicResourceID resID, RenderTarget rt, int index)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            if (!cmdList.ChangeState(ref cmdList.RenderTargets[index], rt.ResourceID))
+                return;
+
+            cmdList.Write(NullCmdType.SetRenderTarget);
+            cmdList.Write(rt.ResourceID);
+            cmdList.Write(index);
+        }
+
+        protected override void commandList_DisableRenderTarget(GraphicResourceID resID, RenderTarget rt)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            int index = Array.IndexOf(cmdList.RenderTargets, rt.ResourceID);
+            if (index < 0)
+                return;
+
+            cmdList.ChangeState(ref cmdList.RenderTargets[index], null);
+            cmdList.Write(NullCmdType.DisableRenderTarget);
+            cmdList.Write(index);
+        }
+
+        protected override void commandList_ResetRenderTargets(GraphicResourceID resID)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            Array.Clear(cmdList.RenderTargets, 0, cmdList.RenderTargets.Length);
+            cmdList.Write(NullCmdType.ResetRenderTargets);
+            cmdList.Stats.StateChanges++;
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, bool value)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, int value)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, float value)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, Float2 value)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, Float3 value)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, Float4 value)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, Float4x4 value)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, Float3x3 value)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, Int3 value)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, int[] values)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, float[] values)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, Texture value)
+        {
+            commandList_SetParamSurface(resID, name.GetHashCode(), value);
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, RenderTarget value)
+        {
+            commandList_SetParamSurface(resID, name.GetHashCode(), value);
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, Float2[] values)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, Float3[] values)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, Float4[] values)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, string name, Float4x4[] values)
+        {
+            commandList_SetParamNoPad(resID, name.GetHashCode(), padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, bool value)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, int value)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, float value)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float2 value)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3 value)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4 value)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4x4 value)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3x3 value)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Int3 value)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(value));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, int[] values)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, float[] values)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float2[] values)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3[] values)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4[] values)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4x4[] values)
+        {
+            commandList_SetParamNoPad(resID, param.NameHash, padder.Value.Pad(values));
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Texture value)
+        {
+            commandList_SetParamSurface(resID, param.NameHash, value);
+        }
+
+        protected override void commandList_SetParam(GraphicResourceID resID, ShaderParam param, RenderTarget value)
+        {
+            commandList_SetParamSurface(resID, param.NameHash, value);
+        }
+
+        private void commandList_SetParamSurface(GraphicResourceID resID, int nameHash, GraphicSurface surface)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            cmdList.Write(NullCmdType.SetParamTexture);
+            cmdList.Write(nameHash);
+            cmdList.Write(surface.ResourceID);
+        }
+
+        private void commandList_SetParamNoPad(GraphicResourceID resID, int nameHash, float[] values)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            cmdList.Write(NullCmdType.SetParam);
+            cmdList.Write(nameHash);
+            cmdList.Write(values);
+            cmdList.Stats.ConstantBytes += values.Length * sizeof(float);
+        }
+
+        private void commandList_SetParamNoPad(GraphicResourceID resID, int nameHash, int[] values)
+        {
+            NullCmdList cmdList = commandLists[resID];
+            cmdList.Write(NullCmdType.SetParam);
+            cmdList.Write(nameHash);
+            cmdList.Write(values);
+            cmdList.Stats.ConstantBytes += values.Length * sizeof(int);
+        }
+
+        #endregion
+
+    }
+}
@@ -6,6 +6,7 @@ using System.IO;
 using System.Collections.Generic;
 using Dragonfly.Utils;
 using System.Linq;
+using System.Threading;
 
 namespace Dragonfly.Graphics
 {
@@ -23,7 +24,14 @@ namespace Dragonfly.Graphics
                 // load precompiled shaders
                 byte[] sbtBytes = File.ReadAllBytes(shaderTablePath);
                 this.ShaderBindingTable = new ShaderBindingTable(api, sbtBytes);
+
+                // compute the table digest, used to invalidate data cached from the shaders
+                Digest128 sbtDigest = Digest128.Seed;
+                sbtDigest.Add(sbtBytes, 0, sbtBytes.Length);
+                ShaderBindingTableDigest = sbtDigest;
             }
+
+            ResourceFolder = factory.ResourceFolder;
         }
 	
 		#region Properties
@@ -44,6 +52,16 @@ namespace Dragonfly.Graphics
 			private set;
 		}
 
+        /// <summary>
+        /// A digest of the serialized shader binding table, that changes each time shaders are recompiled.
+        /// </summary>
+        protected internal Digest128 ShaderBindingTableDigest { get; private set; }
+
+        /// <summary>
+        /// The resource folder specified on creation.
+        /// </summary>
+        protected internal string ResourceFolder { get; private set; }
+
         #endregion
 
         public abstract List<Int2> SupportedDisplayResolutions { get; }
@@ -63,8 +81,19 @@ namespace Dragonfly.Graphics
 
         public IndexBuffer CreateIndexBuffer(int indexCount)
         {
-            GraphicResourceID resID = createIndexBuffer(indexCount);
-            return new MDF_IndexBuffer(this, resID, indexCount);
+            return CreateIndexBuffer(indexCount, IndexFormat.Index16);
+        }
+
+        public IndexBuffer CreateIndexBuffer(int indexCount, IndexFormat format)
+        {
+            GraphicResourceID resID = createIndexBuffer(indexCount, format);
+            return new MDF_IndexBuffer(this, resID, indexCount, format);
+        }
+
+        public InstanceBuffer CreateInstanceBuffer(int capacity)
+        {
+            GraphicResourceID resID = createInstanceBuffer(capacity);
+            return new MDF_InstanceBuffer(this, resID, capacity);
         }
 
         public Texture CreateTexture(int width, int height, SurfaceFormat format)
@@ -298,18 +327,20 @@ namespace Dragonfly.Graphics
 
 #region IndexBuffer
 
-        protected abstract GraphicResourceID createIndexBuffer(int indexCount);
+        protected abstract GraphicResourceID createIndexBuffer(int indexCount, IndexFormat format);
 
         protected abstract void indexBuffer_SetIndices(GraphicResourceID resID, ushort[] indices, int indexCount);
 
+        protected abstract void indexBuffer_SetIndices(GraphicResourceID resID, uint[] indices, int indexCount);
+
         protected abstract void indexBuffer_Release(GraphicResourceID resID);
 
         protected class MDF_IndexBuffer : IndexBuffer
         {
             private DFGraphics g;
 
-            public MDF_IndexBuffer(DFGraphics g, GraphicResourceID resID, int indexCount)
-                : base(resID, indexCount)
+            public MDF_IndexBuffer(DFGraphics g, GraphicResourceID resID, int indexCount, IndexFormat format)
+                : base(resID, indexCount, format)
             {
                 this.g = g;
             }
@@ -319,6 +350,11 @@ namespace Dragonfly.Graphics
                 g.indexBuffer_SetIndices(this.ResourceID, indices, IndexCount);
             }
 
+            protected override void SetIndicesInternal(uint[] indices)
+            {
+                g.indexBuffer_SetIndices(this.ResourceID, indices, IndexCount);
+            }
+
             public override void Release()
             {
                 if (!g.Released) g.indexBuffer_Release(this.ResourceID);
@@ -327,6 +363,61 @@ namespace Dragonfly.Graphics
 
 #endregion
 
+#region InstanceBuffer
+
+        private ThreadLocal<ArrayRange<Float4x4>> gatheredInstances = new ThreadLocal<ArrayRange<Float4x4>>(() => new ArrayRange<Float4x4>(1024));
+
+        /// <summary>
+        /// APIs that can store instances on the GPU should override this and the other instanceBuffer_ methods. 
+        /// By default, instances are only kept in their CPU copy and gathered at each draw.
+        /// </summary>
+        protected virtual GraphicResourceID createInstanceBuffer(int capacity)
+        {
+            return new GraphicResourceID();
+        }
+
+        protected virtual void instanceBuffer_SetInstances(GraphicResourceID resID, Float4x4[] instances, int startIndex, int count) { }
+
+        protected virtual void instanceBuffer_Release(GraphicResourceID resID) { }
+
+        protected virtual void commandList_DrawIndexedInstanced(GraphicResourceID resID, InstanceBuffer instances, ArrayRange<int> visibleInstances)
+        {
+            // gather the visible instance values and draw them as a list of matrices
+            ArrayRange<Float4x4> gathered = gatheredInstances.Value;
+            if (gathered.Buffer.Length < visibleInstances.Count)
+            {
+                gathered = new ArrayRange<Float4x4>(visibleInstances.Count);
+                gatheredInstances.Value = gathered;
+            }
+            gathered.Count = 0;
+            for (int i = 0; i < visibleInstances.Count; i++)
+                gathered.Add(instances.Values[visibleInstances[i]]);
+            commandList_DrawIndexedInstanced(resID, gathered);
+        }
+
+        protected class MDF_InstanceBuffer : InstanceBuffer
+        {
+            private DFGraphics g;
+
+            public MDF_InstanceBuffer(DFGraphics g, GraphicResourceID resID, int capacity)
+                : base(resID, capacity)
+            {
+                this.g = g;
+            }
+
+            protected override void SetInstancesInternal(Float4x4[] instances, int startIndex, int count)
+            {
+                g.instanceBuffer_SetInstances(this.ResourceID, instances, startIndex, count);
+            }
+
+            public override void Release()
+            {
+                if (!g.Released) g.instanceBuffer_Release(this.ResourceID);
+            }
+        }
+
+#endregion
+
 #region Texture
 
         protected abstract GraphicResourceID createTexture<T>(int width, int height, SurfaceFormat format, T[] initialPixelData) where T : struct;
@@ -485,6 +576,95 @@ namespace Dragonfly.Graphics
 
         protected abstract void shader_SetParam(Shader shader, string name, Float4x4[] value);
 
+        #region Shader param handles (fallback to param names if not overridden)
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, bool value)
+        {
+            shader_SetParam(shader, param.Name, value);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, int value)
+        {
+            shader_SetParam(shader, param.Name, value);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, float value)
+        {
+            shader_SetParam(shader, param.Name, value);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, Float2 value)
+        {
+            shader_SetParam(shader, param.Name, value);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, Float3 value)
+        {
+            shader_SetParam(shader, param.Name, value);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, Float4 value)
+        {
+            shader_SetParam(shader, param.Name, value);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, Float4x4 value)
+        {
+            shader_SetParam(shader, param.Name, value);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, Float3x3 value)
+        {
+            shader_SetParam(shader, param.Name, value);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, Int3 value)
+        {
+            shader_SetParam(shader, param.Name, value);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, int[] values)
+        {
+            shader_SetParam(shader, param.Name, values);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, float[] values)
+        {
+            shader_SetParam(shader, param.Name, values);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, Texture value)
+        {
+            shader_SetParam(shader, param.Name, value);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, RenderTarget value)
+        {
+            shader_SetParam(shader, param.Name, value);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, Float2[] values)
+        {
+            shader_SetParam(shader, param.Name, values);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, Float3[] values)
+        {
+            shader_SetParam(shader, param.Name, values);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, Float4[] values)
+        {
+            shader_SetParam(shader, param.Name, values);
+        }
+
+        protected virtual void shader_SetParam(Shader shader, ShaderParam param, Float4x4[] values)
+        {
+            shader_SetParam(shader, param.Name, values);
+        }
+
+        #endregion
+
         protected abstract void shader_Release(GraphicResourceID resID);
 
         protected class MDF_Shader : Shader
@@ -599,6 +779,108 @@ namespace Dragonfly.Graphics
                 g.shader_SetParam(this, name, value);
             }
 
+            public override void SetParam(ShaderParam param, bool value)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, int value)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, float value)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float2 value)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float3 value)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float4 value)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float4x4 value)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float3x3 value)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Int3 value)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, int[] values)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, values);
+            }
+
+            public override void SetParam(ShaderParam param, float[] values)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, values);
+            }
+
+            public override void SetParam(ShaderParam param, Texture value)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, RenderTarget value)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float2[] values)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, values);
+            }
+
+            public override void SetParam(ShaderParam param, Float3[] values)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, values);
+            }
+
+            public override void SetParam(ShaderParam param, Float4[] values)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, values);
+            }
+
+            public override void SetParam(ShaderParam param, Float4x4[] values)
+            {
+                if (Parent != null) throw new InvalidGraphicCallException("Parameters cannot be modified on this shader!");
+                g.shader_SetParam(this, param, values);
+            }
+
             public override void Release()
             {
                 if (!g.Released) g.shader_Release(this.ResourceID);
@@ -673,6 +955,95 @@ namespace Dragonfly.Graphics
 
         protected abstract void commandList_SetShader(GraphicResourceID resID, Shader shader);
 
+        #region Command list param handles (fallback to param names if not overridden)
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, bool value)
+        {
+            commandList_SetParam(resID, param.Name, value);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, int value)
+        {
+            commandList_SetParam(resID, param.Name, value);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, float value)
+        {
+            commandList_SetParam(resID, param.Name, value);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float2 value)
+        {
+            commandList_SetParam(resID, param.Name, value);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3 value)
+        {
+            commandList_SetParam(resID, param.Name, value);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4 value)
+        {
+            commandList_SetParam(resID, param.Name, value);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4x4 value)
+        {
+            commandList_SetParam(resID, param.Name, value);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3x3 value)
+        {
+            commandList_SetParam(resID, param.Name, value);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Int3 value)
+        {
+            commandList_SetParam(resID, param.Name, value);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, int[] values)
+        {
+            commandList_SetParam(resID, param.Name, values);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, float[] values)
+        {
+            commandList_SetParam(resID, param.Name, values);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Texture value)
+        {
+            commandList_SetParam(resID, param.Name, value);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, RenderTarget value)
+        {
+            commandList_SetParam(resID, param.Name, value);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float2[] values)
+        {
+            commandList_SetParam(resID, param.Name, values);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float3[] values)
+        {
+            commandList_SetParam(resID, param.Name, values);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4[] values)
+        {
+            commandList_SetParam(resID, param.Name, values);
+        }
+
+        protected virtual void commandList_SetParam(GraphicResourceID resID, ShaderParam param, Float4x4[] values)
+        {
+            commandList_SetParam(resID, param.Name, values);
+        }
+
+        #endregion
+
         protected class MDF_CommandList : CommandList
         {
             private DFGraphics g;
@@ -709,6 +1080,11 @@ namespace Dragonfly.Graphics
                 g.commandList_DrawIndexedInstanced(ResourceID, instances);
             }
 
+            public override void DrawIndexedInstanced(InstanceBuffer instances, ArrayRange<int> visibleInstances)
+            {
+                g.commandList_DrawIndexedInstanced(ResourceID, instances, visibleInstances);
+            }
+
             public override void StartRecording()
             {
                 base.StartRecording();
@@ -825,6 +1201,91 @@ namespace Dragonfly.Graphics
                 g.commandList_SetParam(ResourceID, name, values);
             }
 
+            public override void SetParam(ShaderParam param, bool value)
+            {
+                g.commandList_SetParam(ResourceID, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, int value)
+            {
+                g.commandList_SetParam(ResourceID, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, float value)
+            {
+                g.commandList_SetParam(ResourceID, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float2 value)
+            {
+                g.commandList_SetParam(ResourceID, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float3 value)
+            {
+                g.commandList_SetParam(ResourceID, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float4 value)
+            {
+                g.commandList_SetParam(ResourceID, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float4x4 value)
+            {
+                g.commandList_SetParam(ResourceID, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float3x3 value)
+            {
+                g.commandList_SetParam(ResourceID, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Int3 value)
+            {
+                g.commandList_SetParam(ResourceID, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, int[] values)
+            {
+                g.commandList_SetParam(ResourceID, param, values);
+            }
+
+            public override void SetParam(ShaderParam param, float[] values)
+            {
+                g.commandList_SetParam(ResourceID, param, values);
+            }
+
+            public override void SetParam(ShaderParam param, Texture value)
+            {
+                g.commandList_SetParam(ResourceID, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, RenderTarget value)
+            {
+                g.commandList_SetParam(ResourceID, param, value);
+            }
+
+            public override void SetParam(ShaderParam param, Float2[] values)
+            {
+                g.commandList_SetParam(ResourceID, param, values);
+            }
+
+            public override void SetParam(ShaderParam param, Float3[] values)
+            {
+                g.commandList_SetParam(ResourceID, param, values);
+            }
+
+            public override void SetParam(ShaderParam param, Float4[] values)
+            {
+                g.commandList_SetParam(ResourceID, param, values);
+            }
+
+            public override void SetParam(ShaderParam param, Float4x4[] values)
+            {
+                g.commandList_SetParam(ResourceID, param, values);
+            }
+
             public override void SetRenderTarget(RenderTarget rt, int index)
             {
                 g.commandList_SetRenderTarget(ResourceID, rt, index);
@@ -894,5 +1355,11 @@ namespace Dragonfly.Graphics
         AntialiasedColor = 8
     }
 
+    public enum IndexFormat
+    {
+        Index16,
+        Index32
+    }
+
     
 }
@@ -1,6 +1,7 @@
 ﻿using Dragonfly.Graphics.API.Directx9;
 using Dragonfly.Graphics.API.Directx11;
 using Dragonfly.Graphics.API.Directx12;
+using Dragonfly.Graphics.API.Null;
 using System.Collections.Generic;
 using System;
 
@@ -16,6 +17,7 @@ namespace Dragonfly.Graphics
             allAPI.Add(new Directx9API());
             allAPI.Add(new Directx11API());
             allAPI.Add(new Directx12API());
+            allAPI.Add(new NullAPI());
         }
 
         public static IGraphicsAPI GetDefault()
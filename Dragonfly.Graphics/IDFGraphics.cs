@@ -49,6 +49,16 @@ namespace Dragonfly.Graphics
 
         IndexBuffer CreateIndexBuffer(int indexCount);
 
+        /// <summary>
+        /// Create an index buffer that stores indices of the specified size. 32-bit indices are required to address more than 65536 vertices.
+        /// </summary>
+        IndexBuffer CreateIndexBuffer(int indexCount, IndexFormat format);
+
+        /// <summary>
+        /// Create a persistent buffer of instance transforms, that can be used for instanced draws.
+        /// </summary>
+        InstanceBuffer CreateInstanceBuffer(int capacity);
+
         Texture CreateTexture<T>(int width, int height, T[] pixelData) where T : struct;
 
         Texture CreateTexture(int width, int height, SurfaceFormat format);
@@ -66,6 +66,11 @@ namespace Dragonfly.Graphics.Resources
 
         public abstract void DrawIndexedInstanced(ArrayRange<Float4x4> instances);
 
+        /// <summary>
+        /// Draw the instances at the specified indices of a persistent instance buffer.
+        /// </summary>
+        public abstract void DrawIndexedInstanced(InstanceBuffer instances, ArrayRange<int> visibleInstances);
+
         public abstract void SetViewport(AARect viewport);
 
         public abstract void SetVertices(VertexBuffer vertices);
@@ -119,6 +124,44 @@ namespace Dragonfly.Graphics.Resources
         public abstract void SetParam(string name, Float4x4[] values);
 
         #endregion
+
+        #region Global parameters (handles)
+
+        public abstract void SetParam(ShaderParam param, bool value);
+
+        public abstract void SetParam(ShaderParam param, int value);
+
+        public abstract void SetParam(ShaderParam param, float value);
+
+        public abstract void SetParam(ShaderParam param, Float2 value);
+
+        public abstract void SetParam(ShaderParam param, Float3 value);
+
+        public abstract void SetParam(ShaderParam param, Float4 value);
+
+        public abstract void SetParam(ShaderParam param, Float4x4 value);
+
+        public abstract void SetParam(ShaderParam param, Float3x3 value);
+
+        public abstract void SetParam(ShaderParam param, Int3 value);
+
+        public abstract void SetParam(ShaderParam param, int[] values);
+
+        public abstract void SetParam(ShaderParam param, float[] values);
+
+        public abstract void SetParam(ShaderParam param, Texture value);
+
+        public abstract void SetParam(ShaderParam param, RenderTarget value);
+
+        public abstract void SetParam(ShaderParam param, Float2[] values);
+
+        public abstract void SetParam(ShaderParam param, Float3[] values);
+
+        public abstract void SetParam(ShaderParam param, Float4[] values);
+
+        public abstract void SetParam(ShaderParam param, Float4x4[] values);
+
+        #endregion
     }
 
     public enum ClearFlags
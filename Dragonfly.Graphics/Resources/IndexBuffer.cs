@@ -8,10 +8,19 @@ namespace Dragonfly.Graphics.Resources
 {
     public abstract class IndexBuffer : GraphicResource
     {
-        protected IndexBuffer(GraphicResourceID resID, int capacity)
+        protected IndexBuffer(GraphicResourceID resID, int capacity, IndexFormat format)
             : base(resID)
         {
             Capacity = capacity;
+            Format = format;
+        }
+
+        /// <summary>
+        /// Returns the smallest index format that can address the specified number of vertices.
+        /// </summary>
+        public static IndexFormat GetRequiredFormat(int vertexCount)
+        {
+            return vertexCount <= ushort.MaxValue + 1 ? IndexFormat.Index16 : IndexFormat.Index32;
         }
 
         /// <summary>
@@ -24,9 +33,16 @@ namespace Dragonfly.Graphics.Resources
         /// </summary>
         public int IndexCount { get; protected set; }
 
+        /// <summary>
+        /// The size of the indices stored in this buffer.
+        /// </summary>
+        public IndexFormat Format { get; private set; }
+
         public void SetIndices(ushort[] indices)
         {
 #if DEBUG
+            if (Format != IndexFormat.Index16)
+                throw new InvalidGraphicCallException("16-bit indices cannot be copied to a 32-bit index buffer.");
             if (indices.Length > Capacity)
                 throw new InvalidGraphicCallException("The specified vertex count exceed the source array or this buffer size.");
 #endif
@@ -37,6 +53,8 @@ namespace Dragonfly.Graphics.Resources
         public void SetIndices(ushort[] buffer, int indexCount)
         {
 #if DEBUG
+            if (Format != IndexFormat.Index16)
+                throw new InvalidGraphicCallException("16-bit indices cannot be copied to a 32-bit index buffer.");
             if (indexCount > Capacity || indexCount > buffer.Length)
                     throw new InvalidGraphicCallException("The specified vertex count exceed the source array or this buffer size.");
 #endif
@@ -44,6 +62,25 @@ namespace Dragonfly.Graphics.Resources
             SetIndicesInternal(buffer);
         }
 
+        public void SetIndices(uint[] indices)
+        {
+            SetIndices(indices, indices.Length);
+        }
+
+        public void SetIndices(uint[] buffer, int indexCount)
+        {
+#if DEBUG
+            if (Format != IndexFormat.Index32)
+                throw new InvalidGraphicCallException("32-bit indices cannot be copied to a 16-bit index buffer.");
+            if (indexCount > Capacity || indexCount > buffer.Length)
+                throw new InvalidGraphicCallException("The specified vertex count exceed the source array or this buffer size.");
+#endif
+            IndexCount = indexCount;
+            SetIndicesInternal(buffer);
+        }
+
         protected abstract void SetIndicesInternal(ushort[] indices);
+
+        protected abstract void SetIndicesInternal(uint[] indices);
     }
 }
@@ -0,0 +1,52 @@
+﻿using Dragonfly.Graphics.Math;
+using System;
+
+namespace Dragonfly.Graphics.Resources
+{
+    /// <summary>
+    /// A persistent list of instance transforms. Values are kept on the GPU between frames, so only the modified ranges need to be uploaded again.
+    /// Instanced draws can then select the visible instances with an index list, instead of copying their matrices.
+    /// </summary>
+    public abstract class InstanceBuffer : GraphicResource
+    {
+        protected InstanceBuffer(GraphicResourceID resID, int capacity)
+            : base(resID)
+        {
+            Capacity = capacity;
+            Values = new Float4x4[capacity];
+        }
+
+        /// <summary>
+        /// Maximum number of instances that this buffer can store.
+        /// </summary>
+        public int Capacity { get; private set; }
+
+        /// <summary>
+        /// CPU copy of the instances stored in this buffer, used by APIs that cannot draw directly from it.
+        /// </summary>
+        internal Float4x4[] Values { get; private set; }
+
+        /// <summary>
+        /// Returns the last value uploaded for the specified instance.
+        /// </summary>
+        public Float4x4 GetInstance(int index)
+        {
+            return Values[index];
+        }
+
+        /// <summary>
+        /// Update a range of instances. The instance at startIndex in the source array is stored at the same index in this buffer.
+        /// </summary>
+        public void SetInstances(Float4x4[] instances, int startIndex, int count)
+        {
+#if DEBUG
+            if (startIndex + count > Capacity || startIndex + count > instances.Length)
+                throw new InvalidGraphicCallException("The specified range exceed the source array or this buffer size.");
+#endif
+            Array.Copy(instances, startIndex, Values, startIndex, count);
+            SetInstancesInternal(instances, startIndex, count);
+        }
+
+        protected abstract void SetInstancesInternal(Float4x4[] instances, int startIndex, int count);
+    }
+}
@@ -59,6 +59,40 @@ namespace Dragonfly.Graphics.Resources
         public abstract void SetParam(string name, Texture value);
 
         public abstract void SetParam(string name, RenderTarget value);
+
+        public abstract void SetParam(ShaderParam param, bool value);
+
+        public abstract void SetParam(ShaderParam param, int value);
+
+        public abstract void SetParam(ShaderParam param, float value);
+
+        public abstract void SetParam(ShaderParam param, Float2 value);
+
+        public abstract void SetParam(ShaderParam param, Float3 value);
+
+        public abstract void SetParam(ShaderParam param, Float4 value);
+
+        public abstract void SetParam(ShaderParam param, Float4x4 value);
+
+        public abstract void SetParam(ShaderParam param, Float3x3 value);
+
+        public abstract void SetParam(ShaderParam param, Int3 value);
+
+        public abstract void SetParam(ShaderParam param, int[] values);
+
+        public abstract void SetParam(ShaderParam param, float[] values);
+
+        public abstract void SetParam(ShaderParam param, Texture value);
+
+        public abstract void SetParam(ShaderParam param, RenderTarget value);
+
+        public abstract void SetParam(ShaderParam param, Float2[] values);
+
+        public abstract void SetParam(ShaderParam param, Float3[] values);
+
+        public abstract void SetParam(ShaderParam param, Float4[] values);
+
+        public abstract void SetParam(ShaderParam param, Float4x4[] values);
     }
 
     public enum BlendMode
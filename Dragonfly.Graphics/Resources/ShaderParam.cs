@@ -0,0 +1,74 @@
+﻿using Dragonfly.Graphics.API.Common;
+using System.Collections.Generic;
+
+namespace Dragonfly.Graphics.Resources
+{
+    /// <summary>
+    /// An integer handle to a shader parameter, that can be used in place of its name to skip the string lookups when a parameter is updated frequently.
+    /// Handles are shared between shaders and command lists: should be retrieved once with Get() and stored.
+    /// </summary>
+    public sealed class ShaderParam
+    {
+        private static Dictionary<string, ShaderParam> allParams = new Dictionary<string, ShaderParam>();
+        private static object PARAMS_SYNC = new object();
+
+        /// <summary>
+        /// Returns the handle to the parameter with the specified name. The same instance is returned for all the calls with the same name.
+        /// </summary>
+        public static ShaderParam Get(string name)
+        {
+            lock (PARAMS_SYNC)
+            {
+                ShaderParam param;
+                if (!allParams.TryGetValue(name, out param))
+                {
+                    param = new ShaderParam(name, allParams.Count);
+                    allParams.Add(name, param);
+                }
+                return param;
+            }
+        }
+
+        private ShaderParam texelSize;
+
+        private ShaderParam(string name, int index)
+        {
+            Name = name;
+            Index = index;
+            NameHash = name.GetHashCode();
+        }
+
+        /// <summary>
+        /// The name of this parameter, as declared in shaders.
+        /// </summary>
+        public string Name { get; private set; }
+
+        /// <summary>
+        /// A sequential index that uniquely identify this parameter, can be used to index lookup tables.
+        /// </summary>
+        public int Index { get; private set; }
+
+        /// <summary>
+        /// Pre-computed hash of the parameter name.
+        /// </summary>
+        public int NameHash { get; private set; }
+
+        /// <summary>
+        /// Handle to the automatic texel size constant of a texture parameter.
+        /// </summary>
+        internal ShaderParam TexelSize
+        {
+            get
+            {
+                if (texelSize == null)
+                    texelSize = Get(DirectxUtils.GetTexelSizeConstantName(Name));
+                return texelSize;
+            }
+        }
+
+        public override string ToString()
+        {
+            return Name;
+        }
+    }
+}
@@ -167,6 +167,17 @@ namespace Dragonfly.Graphics.Shaders
             return effects[effectName].Templates[templateName].VariantBindings[variantID];
         }
 
+        /// <summary>
+        /// Enumerates the bindings of all the effects in this table, for each of their templates and variants, paired with their variant ID.
+        /// </summary>
+        public IEnumerable<KeyValuePair<string, EffectBinding>> GetAllEffects()
+        {
+            foreach (EffectBindingRecord eRecord in effects.Values)
+                foreach (EffectTemplateRecord eTemplate in eRecord.Templates.Values)
+                    foreach (KeyValuePair<string, EffectBinding> variantBinding in eTemplate.VariantBindings)
+                        yield return variantBinding;
+        }
+
         public List<string> GetAllShaderNames()
         {
             return inputs.Keys.ToList();
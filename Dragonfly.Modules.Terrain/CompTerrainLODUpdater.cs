@@ -11,12 +11,14 @@ namespace Dragonfly.Terrain
 {
     /// <summary>
     /// Coordinates LOD updates for all the available terrains in the current scene.
+    /// The tessellation of the terrains that can be updated next is evaluated in parallel with other updates, while LOD changes are applied on the main thread.
     /// </summary>
-    public class CompTerrainLODUpdater : Component, ICompUpdatable
+    public class CompTerrainLODUpdater : Component, ICompParallelUpdatable
     {
         private PreciseFloat lastLodUpdateTime; // real time at which the last lod update took place
         private CompTerrain curTerrain;
         private Dictionary<int, int> delayedTileLodups; // tiled id -> number of frame that it grouping has been delayed
+        private Dictionary<CompTerrain, float> precomputedTessRatios; // tessellation discrepancy of the terrains that need an update, evaluated by ParallelUpdate()
 
         public CompTerrainLODUpdater(Component parent, ITerrainLODStrategy strategy) : base(parent)
         {
@@ -24,6 +26,7 @@ namespace Dragonfly.Terrain
             lastLodUpdateTime = PreciseFloat.Zero;
             LodUpDelay = 2;
             delayedTileLodups = new Dictionary<int, int>();
+            precomputedTessRatios = new Dictionary<CompTerrain, float>();
         }
 
         /// <summary>
@@ -72,8 +75,9 @@ namespace Dragonfly.Terrain
             {
                 if (!Strategy.NeedsToBeUpdated(terrainList[i]))
                     continue;
-                Range<float> tessRatioRange = terrainList[i].CalcCurrentTessellationRatioRange();
-                float absTessRatio = Math.Max(tessRatioRange.From < 1.0f ? 1.0f / tessRatioRange.From : tessRatioRange.From, tessRatioRange.To < 1.0f ? 1.0f / tessRatioRange.To : tessRatioRange.To);
+                float absTessRatio;
+                if (!precomputedTessRatios.TryGetValue(terrainList[i], out absTessRatio))
+                    absTessRatio = CalcAbsTessellationRatio(terrainList[i]);
                 if (absTessRatio > maxTessRatio)
                 {
                     maxTessRatio = absTessRatio;
@@ -84,6 +88,15 @@ namespace Dragonfly.Terrain
             return toBeUpdated;
         }
 
+        /// <summary>
+        /// Returns the maximum discrepancy between the needed and current tessellation of the specified terrain, as a ratio greater or equal to 1.
+        /// </summary>
+        private float CalcAbsTessellationRatio(CompTerrain terrain)
+        {
+            Range<float> tessRatioRange = terrain.CalcCurrentTessellationRatioRange();
+            return Math.Max(tessRatioRange.From < 1.0f ? 1.0f / tessRatioRange.From : tessRatioRange.From, tessRatioRange.To < 1.0f ? 1.0f / tessRatioRange.To : tessRatioRange.To);
+        }
+
         private bool IsLodTransitionTimeElapsed(CompTerrain terrain)
         {
             if (lastLodUpdateTime == PreciseFloat.Zero || !terrain.IsAnyLODAvailable)
@@ -92,6 +105,32 @@ namespace Dragonfly.Terrain
             return (Context.Time.RealSecondsFromStart - lastLodUpdateTime) > terrain.DataSource.MinLodSwitchTimeSeconds;
         }
 
+        public void GetUpdateAccess(UpdateType updateType, UpdateAccess access)
+        {
+            access.Write(typeof(CompTerrain)); // LODs are applied by Update()
+            access.Write(typeof(CompTerrainTile));
+            access.Read(typeof(CompCamera));
+            access.Write(Strategy);
+            access.Write(this);
+        }
+
+        public void ParallelUpdate(UpdateType updateType)
+        {
+            precomputedTessRatios.Clear();
+            if (FreezeLOD || curTerrain != null)
+                return; // no search for the next terrain to be updated is required
+
+            // evaluate the terrains that can be updated, skipping the ones whose tiles are being modified
+            IReadOnlyList<CompTerrain> terrainList = GetComponents<CompTerrain>();
+            for (int i = 0; i < terrainList.Count; i++)
+            {
+                if (!terrainList[i].IsAnyLODAvailable || terrainList[i].IsProcessingNewLOD)
+                    continue;
+                if (Strategy.NeedsToBeUpdated(terrainList[i]))
+                    precomputedTessRatios[terrainList[i]] = CalcAbsTessellationRatio(terrainList[i]);
+            }
+        }
+
         public void Update(UpdateType updateType)
         {
             IReadOnlyList<CompTerrain> terrainList = GetComponents<CompTerrain>();
@@ -123,8 +162,12 @@ namespace Dragonfly.Terrain
                             if (!curTerrain.IsLodIncomplete && curTerrain.IsAnyLODAvailable)
                                 Strategy.SignalUpdateCompletion(curTerrain);
                             curTerrain.ApplyNewLOD();
+                            precomputedTessRatios.Remove(curTerrain);
                             foreach (CompTerrain adjTerrain in curTerrain.AdjacentTerrains)
+                            {
                                 adjTerrain.UpdateEdgeTessellation();
+                                precomputedTessRatios.Remove(adjTerrain);
+                            }
                             lastLodUpdateTime = Context.Time.RealSecondsFromStart;
                             curTerrain = null;
                         }
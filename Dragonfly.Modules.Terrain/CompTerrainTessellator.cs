@@ -63,7 +63,13 @@ namespace Dragonfly.Terrain
             return Indices.ContainsKey(t) && Indices[t] != null;
         }
 
-        public bool LoadingRequired { get; private set; }
+        private bool loadingRequired;
+
+        public bool LoadingRequired
+        {
+            get { return loadingRequired; }
+            private set { SetLoadingRequired(ref loadingRequired, value); }
+        }
 
         public void LoadGraphicResources(EngineResourceAllocator g)
         {
@@ -134,6 +140,9 @@ namespace Dragonfly.Terrain
             GenerateEdgeTessellation(ref cacheIndex, edge.LeftDivisor, 0, rowLen, 1, true); // left
             GenerateEdgeTessellation(ref cacheIndex, edge.RightDivisor, rowLen * rowLen - 1, -rowLen, -1, true); // right
 
+            // reorder triangles for the vertex cache, the vertex buffer is shared by all the tessellations and is not modified
+            MeshOptimizer.OptimizeVertexCache(indexGenCache, cacheIndex, rowLen * rowLen);
+
             // create index buffer resource
             IndexBuffer ibuffer = g.CreateIndexBuffer(cacheIndex);
             ibuffer.SetIndices(indexGenCache, cacheIndex);
@@ -11,13 +11,15 @@ namespace Dragonfly.Terrain
     /// <summary>
     /// A single chunk of terrain, dynamically created / rendered depending on the LOD.
     /// </summary>
-    public class CompTerrainTile : Component, ICompUpdatable
+    public class CompTerrainTile : Component, ICompUpdatable, ICompOccluder
     {
         private CompTerrainTileGeom geom;
         private CompTransformStack tileWorldTransform;
         private QuadTreeNodeEvent lastNodeEvent;
         private BaseMod baseMod;
         private bool isOccluded;
+        private TiledFloat3[] occluderCorners; // corners of the tile area at the minimum height, wound to face up
+        private bool occluderReady;
 
 #if DrawTileAABB
         private CompMesh aabbMesh;
@@ -29,6 +31,7 @@ namespace Dragonfly.Terrain
             ParentTerrain = parentTerrain;
             ParentTile = parentTile;
             geom = new CompTerrainTileGeom(this, parentTerrain.Tessellator);
+            occluderCorners = new TiledFloat3[4];
             EdgeTessellation = geom.EdgeTesselation;
             tileWorldTransform = new CompTransformStack(this);
             baseMod = Context.GetModule<BaseMod>();
@@ -196,6 +199,7 @@ namespace Dragonfly.Terrain
                         MinDisplacementHeight = terrainData.DisplacementMin * terrainData.DisplacementScale + terrainData.DisplacementOffset;
                         MaxDisplacementHeight = terrainData.DisplacementMax * terrainData.DisplacementScale + terrainData.DisplacementOffset;
                         geom.BoundingBox = CalcBoundingBox(MinDisplacementHeight, MaxDisplacementHeight, tessToWorld);
+                        CalcOccluder(MinDisplacementHeight);
 
 #if DrawTileAABB
                         CompMeshGeometry bbGeom = new CompMeshGeometry(this);
@@ -270,6 +274,43 @@ namespace Dragonfly.Terrain
             return tileBB;
         }
         
+        /// <summary>
+        /// Calc a quad that lies below the tile surface, used to occlude what is behind the terrain.
+        /// </summary>
+        private void CalcOccluder(float minDisplacementHeight)
+        {
+            Area.GetCorners(occluderCorners, 0);
+            TiledFloat3 endCorner = occluderCorners[3]; // sort the corners along the area perimeter
+            occluderCorners[3] = occluderCorners[2];
+            occluderCorners[2] = endCorner;
+            for (int i = 0; i < occluderCorners.Length; i++)
+            {
+                // corners are moved at the minimum height: with a spherical curvature, the quad is also below the surface between them
+                CompTerrainCurvature.LocalInfo curvature = ParentTerrain.Curvature.CalcLocalInfoAtTilePos(occluderCorners[i]);
+                occluderCorners[i] = occluderCorners[i] + curvature.WorldOffset + curvature.Normal * minDisplacementHeight;
+            }
+
+            // make the quad face up
+            Int3 refTile = occluderCorners[0].Tile;
+            Float3 c0 = occluderCorners[0].ToFloat3(refTile), c1 = occluderCorners[1].ToFloat3(refTile), c2 = occluderCorners[2].ToFloat3(refTile);
+            if ((c1 - c0).Cross(c2 - c0).Dot(ParentTerrain.Curvature.CalcLocalInfoAtTilePos(Area.Center).Normal) < 0)
+            {
+                TiledFloat3 swap = occluderCorners[1];
+                occluderCorners[1] = occluderCorners[3];
+                occluderCorners[3] = swap;
+            }
+
+            occluderReady = true;
+        }
+
+        public void AddOccluders(OcclusionBuffer buffer, Int3 referenceTile)
+        {
+            if (!occluderReady || !Drawable.Active)
+                return; // not displayed
+
+            buffer.AddQuad(occluderCorners[0].ToFloat3(referenceTile), occluderCorners[1].ToFloat3(referenceTile), occluderCorners[2].ToFloat3(referenceTile), occluderCorners[3].ToFloat3(referenceTile));
+        }
+
         public TerrainEdgeTessellation EdgeTessellation { get; set; }
 
         /// <summary>
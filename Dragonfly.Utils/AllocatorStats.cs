@@ -0,0 +1,54 @@
+﻿namespace Dragonfly.Utils
+{
+    /// <summary>
+    /// Usage and fragmentation statistics of a memory allocator.
+    /// </summary>
+    public struct AllocatorStats
+    {
+        /// <summary>
+        /// Size of the managed memory.
+        /// </summary>
+        public long TotalBytes;
+        /// <summary>
+        /// Bytes reserved by active allocations, including rounding.
+        /// </summary>
+        public long AllocatedBytes;
+        /// <summary>
+        /// Bytes requested by active allocations.
+        /// </summary>
+        public long RequestedBytes;
+        public int AllocationCount;
+        public int FreeBlockCount;
+        public long LargestFreeBlock;
+
+        public long FreeBytes => TotalBytes - AllocatedBytes;
+
+        /// <summary>
+        /// Bytes lost to the rounding of allocation sizes.
+        /// </summary>
+        public long WastedBytes => AllocatedBytes - RequestedBytes;
+
+        /// <summary>
+        /// The fraction of free memory that cannot be used by an allocation as big as the largest free block, from 0 (a single free block) to almost 1.
+        /// </summary>
+        public float Fragmentation => FreeBytes == 0 ? 0 : 1.0f - (float)LargestFreeBlock / FreeBytes;
+
+        public static AllocatorStats operator +(AllocatorStats s1, AllocatorStats s2)
+        {
+            AllocatorStats sum;
+            sum.TotalBytes = s1.TotalBytes + s2.TotalBytes;
+            sum.AllocatedBytes = s1.AllocatedBytes + s2.AllocatedBytes;
+            sum.RequestedBytes = s1.RequestedBytes + s2.RequestedBytes;
+            sum.AllocationCount = s1.AllocationCount + s2.AllocationCount;
+            sum.FreeBlockCount = s1.FreeBlockCount + s2.FreeBlockCount;
+            sum.LargestFreeBlock = System.Math.Max(s1.LargestFreeBlock, s2.LargestFreeBlock);
+            return sum;
+        }
+
+        public override string ToString()
+        {
+            return string.Format("{0} allocations, {1} / {2} KB used, {3} KB wasted, {4} free blocks, fragmentation {5:P1}",
+                AllocationCount, AllocatedBytes / 1024, TotalBytes / 1024, WastedBytes / 1024, FreeBlockCount, Fragmentation);
+        }
+    }
+}
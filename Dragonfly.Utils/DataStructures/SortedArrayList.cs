@@ -0,0 +1,180 @@
+﻿using System;
+using System.Collections;
+using System.Collections.Generic;
+
+namespace Dragonfly.Utils
+{
+    /// <summary>
+    /// An array-backed list where items are kept sorted with the given comparer. Insertion and removal positions are found with a binary search, 
+    /// and items that compare as equal keep their insertion order. Items can be accessed by index in constant time, so that the list can be split in ranges.
+    /// Items are also indexed by their hash code, and can be removed even if their sorting key changed after being added.
+    /// </summary>
+    public class SortedArrayList<T> : IReadOnlyList<T>
+    {
+        private const int MIN_CAPACITY = 16;
+
+        private T[] items;
+        private int count;
+        private Comparer<T> comparer;
+        private EqualityComparer<T> equalityComparer;
+        private HashSet<T> members;
+
+        public SortedArrayList(Comparer<T> comparer)
+        {
+            this.comparer = comparer;
+            equalityComparer = EqualityComparer<T>.Default;
+            items = new T[MIN_CAPACITY];
+            members = new HashSet<T>();
+        }
+
+        public int Count => count;
+
+        public T this[int index] => items[index];
+
+        /// <summary>
+        /// Incremented on each modification of this list.
+        /// </summary>
+        public int Version { get; private set; }
+
+        public void Add(T item)
+        {
+            if (!members.Add(item))
+                throw new ArgumentException("The specified item is already in the list.");
+
+            if (count == items.Length)
+                Array.Resize(ref items, 2 * items.Length);
+
+            // insert after all the items that compare as equal
+            int index = UpperBound(item);
+            Array.Copy(items, index, items, index + 1, count - index);
+            items[index] = item;
+            count++;
+            Version++;
+        }
+
+        public bool Remove(T item)
+        {
+            if (!members.Remove(item))
+                return false;
+
+            int index = IndexOf(item);
+            if (index < 0)
+                index = Array.IndexOf(items, item, 0, count); // sorting key changed after insertion
+
+            count--;
+            Array.Copy(items, index + 1, items, index, count - index);
+            items[count] = default(T);
+            Version++;
+            return true;
+        }
+
+        public bool Contains(T item)
+        {
+            return members.Contains(item);
+        }
+
+        /// <summary>
+        /// Returns the index of the specified item, or -1 if not found. Items whose sorting key changed after being added are not found.
+        /// </summary>
+        public int IndexOf(T item)
+        {
+            // search between the items that compare as equal
+            for (int i = LowerBound(item); i < count && comparer.Compare(items[i], item) == 0; i++)
+            {
+                if (equalityComparer.Equals(items[i], item))
+                    return i;
+            }
+
+            return -1;
+        }
+
+        public void Clear()
+        {
+            Array.Clear(items, 0, count);
+            count = 0;
+            members.Clear();
+            Version++;
+        }
+
+        /// <summary>
+        /// Returns the index of the first item that is not less than the specified one.
+        /// </summary>
+        private int LowerBound(T item)
+        {
+            int lo = 0, hi = count;
+            while (lo < hi)
+            {
+                int mid = (lo + hi) >> 1;
+                if (comparer.Compare(items[mid], item) < 0)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
+
+        /// <summary>
+        /// Returns the index of the first item that is greater than the specified one.
+        /// </summary>
+        private int UpperBound(T item)
+        {
+            int lo = 0, hi = count;
+            while (lo < hi)
+            {
+                int mid = (lo + hi) >> 1;
+                if (comparer.Compare(items[mid], item) <= 0)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
+
+        public Enumerator GetEnumerator()
+        {
+            return new Enumerator(this);
+        }
+
+        IEnumerator IEnumerable.GetEnumerator()
+        {
+            return GetEnumerator();
+        }
+
+        IEnumerator<T> IEnumerable<T>.GetEnumerator()
+        {
+            return GetEnumerator();
+        }
+
+        public struct Enumerator : IEnumerator<T>
+        {
+            private SortedArrayList<T> parent;
+            private int index;
+
+            public Enumerator(SortedArrayList<T> parent)
+            {
+                this.parent = parent;
+                index = -1;
+            }
+
+            public T Current => parent.items[index];
+
+            object IEnumerator.Current => Current;
+
+            public void Dispose()
+            {
+
+            }
+
+            public bool MoveNext()
+            {
+                index++;
+                return index < parent.count;
+            }
+
+            public void Reset()
+            {
+                index = -1;
+            }
+        }
+    }
+}
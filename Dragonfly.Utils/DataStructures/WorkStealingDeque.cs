@@ -0,0 +1,120 @@
+﻿using System.Threading;
+
+namespace Dragonfly.Utils
+{
+    /// <summary>
+    /// A Chase-Lev work-stealing deque: a single owner thread pushes and pops items from the bottom, while any other thread can steal them from the top.
+    /// Owner operations do not lock, and only synchronize with thieves when a single item is left.
+    /// </summary>
+    public class WorkStealingDeque<T> where T : class
+    {
+        private const int MIN_CAPACITY = 32;
+
+        private T[] items;
+        private long top, bottom;
+
+        public WorkStealingDeque()
+        {
+            items = new T[MIN_CAPACITY];
+        }
+
+        /// <summary>
+        /// Approximate number of items in this deque.
+        /// </summary>
+        public int Count
+        {
+            get
+            {
+                long count = Volatile.Read(ref bottom) - Volatile.Read(ref top);
+                return count > 0 ? (int)count : 0;
+            }
+        }
+
+        /// <summary>
+        /// Add an item to the bottom of the deque. Can only be called by the owner thread.
+        /// </summary>
+        public void Push(T item)
+        {
+            long b = Volatile.Read(ref bottom);
+            long t = Volatile.Read(ref top);
+            T[] curItems = items;
+
+            if (b - t >= curItems.Length - 1)
+            {
+                // full: copy the items to a bigger array, thieves that read the old one still find valid items
+                T[] newItems = new T[curItems.Length * 2];
+                for (long i = t; i < b; i++)
+                    newItems[i & (newItems.Length - 1)] = curItems[i & (curItems.Length - 1)];
+                Volatile.Write(ref items, newItems);
+                curItems = newItems;
+            }
+
+            curItems[b & (curItems.Length - 1)] = item;
+            Volatile.Write(ref bottom, b + 1);
+        }
+
+        /// <summary>
+        /// Remove the most recently pushed item. Can only be called by the owner thread.
+        /// </summary>
+        public bool TryPop(out T item)
+        {
+            long b = Volatile.Read(ref bottom) - 1;
+            T[] curItems = items;
+            Interlocked.Exchange(ref bottom, b); // the new bottom must be visible to thieves before reading top
+            long t = Volatile.Read(ref top);
+
+            if (t > b)
+            {
+                // empty
+                Volatile.Write(ref bottom, t);
+                item = null;
+                return false;
+            }
+
+            item = curItems[b & (curItems.Length - 1)];
+            if (t < b)
+            {
+                curItems[b & (curItems.Length - 1)] = null;
+                return true;
+            }
+
+            // last item: race against thieves
+            bool won = Interlocked.CompareExchange(ref top, t + 1, t) == t;
+            Volatile.Write(ref bottom, t + 1);
+            if (!won)
+            {
+                item = null;
+                return false;
+            }
+            curItems[b & (curItems.Length - 1)] = null;
+            return true;
+        }
+
+        /// <summary>
+        /// Remove the oldest item. Can be called by any thread.
+        /// </summary>
+        /// <returns>False if the deque is empty or another thread took the same item.</returns>
+        public bool TrySteal(out T item)
+        {
+            long t = Volatile.Read(ref top);
+            Interlocked.MemoryBarrier();
+            long b = Volatile.Read(ref bottom);
+
+            if (t >= b)
+            {
+                item = null;
+                return false;
+            }
+
+            T[] curItems = Volatile.Read(ref items);
+            item = curItems[t & (curItems.Length - 1)];
+            if (Interlocked.CompareExchange(ref top, t + 1, t) != t)
+            {
+                item = null;
+                return false;
+            }
+
+            return item != null;
+        }
+    }
+}
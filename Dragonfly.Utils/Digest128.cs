@@ -0,0 +1,118 @@
+﻿using System;
+using System.Runtime.CompilerServices;
+
+namespace Dragonfly.Utils
+{
+    /// <summary>
+    /// A 128-bit digest of a sequence of values, stable across runs and platforms so that it can be used as a persistent key.
+    /// Values are accumulated with Add(), starting from Digest128.Seed.
+    /// </summary>
+    public struct Digest128 : IEquatable<Digest128>
+    {
+        private const ulong PRIME1 = 0x9E3779B185EBCA87UL;
+        private const ulong PRIME2 = 0xC2B2AE3D27D4EB4FUL;
+        private const ulong FNV_PRIME = 0x100000001B3UL;
+
+        public static readonly Digest128 Seed = new Digest128(0xCBF29CE484222325UL, 0x27D4EB2F165667C5UL);
+
+        public ulong Low, High;
+
+        public Digest128(ulong low, ulong high)
+        {
+            Low = low;
+            High = high;
+        }
+
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        public void Add(long value)
+        {
+            unchecked
+            {
+                // two independent lanes: FNV-1a on the low one, a multiply-rotate mix on the high one
+                Low = (Low ^ (ulong)value) * FNV_PRIME;
+                High = RotateLeft(High ^ ((ulong)value * PRIME2), 31) * PRIME1;
+            }
+        }
+
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        public void Add(int value)
+        {
+            Add((long)value);
+        }
+
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        public void Add(bool value)
+        {
+            Add(value ? 1L : 0L);
+        }
+
+        public void Add(string value)
+        {
+            if (value == null)
+            {
+                Add(-1L);
+                return;
+            }
+
+            // the length is added first, so that consecutive strings cannot be confused
+            Add((long)value.Length);
+            for (int i = 0; i < value.Length; i++)
+                Add((long)value[i]);
+        }
+
+        public void Add(byte[] bytes, int startIndex, int count)
+        {
+            Add((long)count);
+            int i = 0;
+            for (; i + 8 <= count; i += 8)
+                Add(BitConverter.ToInt64(bytes, startIndex + i));
+            for (; i < count; i++)
+                Add((long)bytes[startIndex + i]);
+        }
+
+        public void Add(Digest128 other)
+        {
+            Add((long)other.Low);
+            Add((long)other.High);
+        }
+
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        private static ulong RotateLeft(ulong value, int bits)
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        public bool Equals(Digest128 other)
+        {
+            return Low == other.Low && High == other.High;
+        }
+
+        public override bool Equals(object obj)
+        {
+            return obj is Digest128 && Equals((Digest128)obj);
+        }
+
+        public override int GetHashCode()
+        {
+            return unchecked((int)(Low ^ (Low >> 32) ^ High));
+        }
+
+        public static bool operator ==(Digest128 d1, Digest128 d2)
+        {
+            return d1.Equals(d2);
+        }
+
+        public static bool operator !=(Digest128 d1, Digest128 d2)
+        {
+            return !d1.Equals(d2);
+        }
+
+        /// <summary>
+        /// Returns the digest as a 32 characters hexadecimal string.
+        /// </summary>
+        public override string ToString()
+        {
+            return High.ToString("x16") + Low.ToString("x16");
+        }
+    }
+}
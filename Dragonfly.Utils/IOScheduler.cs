@@ -0,0 +1,530 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Threading;
+
+namespace Dragonfly.Utils
+{
+    /// <summary>
+    /// Reads files asynchronously on a group of I/O threads, so that several reads are in flight at the same time.
+    /// Requests are served by priority class, then in the order in which they have been queued, and can be cancelled or re-prioritized until their result is delivered.
+    /// Ranged reads are stored to pooled buffers, and the queued ranges of the same file are read together, opening the file once.
+    /// </summary>
+    public class IOScheduler
+    {
+        public const int DEFAULT_THREAD_COUNT = 4;
+        private const int MAX_BATCH_SIZE = 16; // maximum number of ranges of the same file read together
+        private const int MIN_POOLED_BUFFER_LOG2 = 12; // size of the smallest pooled buffer (4KB)
+        private const int MAX_POOLED_BUFFER_LOG2 = 26; // size of the biggest pooled buffer (64MB), bigger ranges are not pooled
+        private const int MAX_BUFFERS_PER_SIZE = 8;
+
+        private static IOScheduler defaultScheduler;
+
+        /// <summary>
+        /// A scheduler shared by all the engine components.
+        /// </summary>
+        public static IOScheduler Default
+        {
+            get
+            {
+                if (defaultScheduler == null)
+                    Interlocked.CompareExchange(ref defaultScheduler, new IOScheduler(DEFAULT_THREAD_COUNT), null);
+                return defaultScheduler;
+            }
+        }
+
+        private object queueLock; // lock to be taken before accessing the queues or the state of a request
+        private LinkedList<IORequest>[] queues; // one FIFO queue for each priority class
+        private int queuedCount, inFlightCount;
+        private Stack<byte[]>[] bufferPool; // unused buffers indexed by their log2 size
+        private Thread[] threads;
+
+        public IOScheduler(int threadCount)
+        {
+            queueLock = new object();
+            queues = new LinkedList<IORequest>[3];
+            for (int i = 0; i < queues.Length; i++)
+                queues[i] = new LinkedList<IORequest>();
+            bufferPool = new Stack<byte[]>[MAX_POOLED_BUFFER_LOG2 + 1];
+            for (int i = MIN_POOLED_BUFFER_LOG2; i <= MAX_POOLED_BUFFER_LOG2; i++)
+                bufferPool[i] = new Stack<byte[]>();
+
+            threads = new Thread[Math.Max(1, threadCount)];
+            for (int i = 0; i < threads.Length; i++)
+            {
+                threads[i] = new Thread(ReadLoop);
+                threads[i].Name = "IOScheduler " + i;
+                threads[i].IsBackground = true;
+                threads[i].Start();
+            }
+        }
+
+        /// <summary>
+        /// True if there are no requests queued or being read.
+        /// </summary>
+        public bool Idle
+        {
+            get
+            {
+                lock (queueLock)
+                {
+                    return queuedCount + inFlightCount == 0;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Queue the read of a whole file. The handler is called from an I/O thread once the file is loaded, as binary or text, or once the read has failed.
+        /// </summary>
+        public IORequest RequestFile(int requestID, string filePath, ILoadedFileHandler resultHandler, bool isBinary, IOPriority priority)
+        {
+            IORequest request = new IORequest(requestID, filePath, priority);
+            request.Length = -1;
+            request.IsBinary = isBinary;
+            request.FileHandler = resultHandler;
+            Enqueue(request);
+            return request;
+        }
+
+        /// <summary>
+        /// Queue the read of a range of a file. The handler is called from an I/O thread with the range content, stored to a pooled buffer, or once the read has failed.
+        /// </summary>
+        public IORequest RequestRange(int requestID, string filePath, long offset, int length, IRangeReadHandler resultHandler, IOPriority priority)
+        {
+            if (offset < 0 || length < 0)
+                throw new ArgumentOutOfRangeException();
+
+            IORequest request = new IORequest(requestID, filePath, priority);
+            request.Offset = offset;
+            request.Length = length;
+            request.IsBinary = true;
+            request.RangeHandler = resultHandler;
+            Enqueue(request);
+            return request;
+        }
+
+        /// <summary>
+        /// Cancel the specified request. 
+        /// </summary>
+        /// <returns>True if the result handler of the request will not be called, false if the request has already been completed.</returns>
+        public bool Cancel(IORequest request)
+        {
+            lock (queueLock)
+            {
+                switch (request.State)
+                {
+                    case IORequestState.Queued:
+                        RemoveQueued(request);
+                        request.State = IORequestState.Cancelled;
+                        return true;
+                    case IORequestState.Reading:
+                        request.State = IORequestState.Cancelled; // the result will be discarded
+                        return true;
+                    case IORequestState.Cancelled:
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Change the priority class of the specified request, moving it after the other queued requests of the same class. Has no effect if the request is not queued.
+        /// </summary>
+        public void SetPriority(IORequest request, IOPriority priority)
+        {
+            lock (queueLock)
+            {
+                if (request.State != IORequestState.Queued || request.Priority == priority)
+                    return;
+
+                RemoveQueued(request);
+                request.Priority = priority;
+                request.Node = queues[(int)priority].AddLast(request);
+                queuedCount++;
+            }
+        }
+
+        private void Enqueue(IORequest request)
+        {
+            lock (queueLock)
+            {
+                request.Node = queues[(int)request.Priority].AddLast(request);
+                queuedCount++;
+                Monitor.Pulse(queueLock);
+            }
+        }
+
+        private void RemoveQueued(IORequest request)
+        {
+            queues[(int)request.Priority].Remove(request.Node);
+            request.Node = null;
+            queuedCount--;
+        }
+
+        private void ReadLoop()
+        {
+            List<IORequest> threadBatch = new List<IORequest>();
+
+            while (true)
+            {
+                DequeueBatch(threadBatch);
+
+                if (threadBatch[0].RangeHandler == null)
+                    ReadFile(threadBatch[0]);
+                else
+                    ReadRanges(threadBatch);
+
+                lock (queueLock)
+                {
+                    inFlightCount -= threadBatch.Count;
+                }
+                threadBatch.Clear();
+            }
+        }
+
+        /// <summary>
+        /// Wait for the highest priority request, adding to the batch the other queued ranges of the same file.
+        /// </summary>
+        private void DequeueBatch(List<IORequest> threadBatch)
+        {
+            lock (queueLock)
+            {
+                while (queuedCount == 0)
+                    Monitor.Wait(queueLock);
+
+                IORequest first = null;
+                for (int i = 0; i < queues.Length && first == null; i++)
+                    if (queues[i].Count > 0)
+                        first = queues[i].First.Value;
+                TakeQueued(first, threadBatch);
+
+                if (first.RangeHandler == null)
+                    return;
+
+                // batch other ranges of the same file, from all the priority classes
+                for (int i = 0; i < queues.Length && threadBatch.Count < MAX_BATCH_SIZE; i++)
+                {
+                    LinkedListNode<IORequest> node = queues[i].First;
+                    while (node != null && threadBatch.Count < MAX_BATCH_SIZE)
+                    {
+                        LinkedListNode<IORequest> next = node.Next;
+                        if (node.Value.RangeHandler != null && node.Value.FilePath == first.FilePath)
+                            TakeQueued(node.Value, threadBatch);
+                        node = next;
+                    }
+                }
+            }
+        }
+
+        private void TakeQueued(IORequest request, List<IORequest> threadBatch)
+        {
+            RemoveQueued(request);
+            request.State = IORequestState.Reading;
+            threadBatch.Add(request);
+            inFlightCount++;
+        }
+
+        /// <summary>
+        /// Mark a request as completed, returning false if it has been cancelled while reading.
+        /// </summary>
+        private bool TryComplete(IORequest request, IORequestState state)
+        {
+            lock (queueLock)
+            {
+                if (request.State == IORequestState.Cancelled)
+                    return false;
+                request.State = state;
+                return true;
+            }
+        }
+
+        private void ReadFile(IORequest request)
+        {
+            byte[] loadedBytes = null;
+            string loadedText = null;
+            try
+            {
+                if (request.IsBinary)
+                    loadedBytes = File.ReadAllBytes(request.FilePath);
+                else
+                    loadedText = File.ReadAllText(request.FilePath);
+            }
+            catch (Exception e)
+            {
+                request.Error = e;
+                if (TryComplete(request, IORequestState.Failed))
+                    NotifyFailure(request);
+                return;
+            }
+
+            if (!TryComplete(request, IORequestState.Completed))
+                return;
+
+            try
+            {
+                if (request.IsBinary)
+                    request.FileHandler.OnFileLoaded(request.RequestID, request.FilePath, loadedBytes);
+                else
+                    request.FileHandler.OnFileLoaded(request.RequestID, request.FilePath, loadedText);
+            }
+            catch (Exception e)
+            {
+                // the handler could not process the file: an exception would terminate the process from this thread, store it to the request instead
+                lock (queueLock)
+                {
+                    request.Error = e;
+                    request.State = IORequestState.Failed;
+                }
+            }
+        }
+
+        private void ReadRanges(List<IORequest> ranges)
+        {
+            // read ranges sequentially through the file
+            if (ranges.Count > 1)
+                ranges.Sort((r1, r2) => r1.Offset.CompareTo(r2.Offset));
+
+            FileStream file;
+            try
+            {
+                file = new FileStream(ranges[0].FilePath, FileMode.Open, FileAccess.Read, FileShare.Read, 4096, FileOptions.SequentialScan);
+            }
+            catch (Exception e)
+            {
+                foreach (IORequest request in ranges)
+                {
+                    request.Error = e;
+                    if (TryComplete(request, IORequestState.Failed))
+                        NotifyFailure(request);
+                }
+                return;
+            }
+
+            using (file)
+            {
+                foreach (IORequest request in ranges)
+                {
+                    if (request.State == IORequestState.Cancelled)
+                        continue;
+
+                    byte[] buffer = RentBuffer(request.Length);
+                    try
+                    {
+                        // read the range, which is truncated at the end of the file
+                        int readCount = 0;
+                        try
+                        {
+                            file.Position = request.Offset;
+                            while (readCount < request.Length)
+                            {
+                                int read = file.Read(buffer, readCount, request.Length - readCount);
+                                if (read == 0)
+                                    break;
+                                readCount += read;
+                            }
+                        }
+                        catch (Exception e)
+                        {
+                            request.Error = e;
+                            if (TryComplete(request, IORequestState.Failed))
+                                NotifyFailure(request);
+                            continue;
+                        }
+
+                        if (!TryComplete(request, IORequestState.Completed))
+                            continue;
+
+                        try
+                        {
+                            request.RangeHandler.OnRangeLoaded(request.RequestID, request.FilePath, request.Offset, new ArrayRange<byte>() { Buffer = buffer, Count = readCount });
+                        }
+                        catch (Exception e)
+                        {
+                            // same as whole file reads, the handler exception is stored to the request
+                            lock (queueLock)
+                            {
+                                request.Error = e;
+                                request.State = IORequestState.Failed;
+                            }
+                        }
+                    }
+                    finally
+                    {
+                        ReturnBuffer(buffer);
+                    }
+                }
+            }
+        }
+
+        private void NotifyFailure(IORequest request)
+        {
+            try
+            {
+                if (request.RangeHandler != null)
+                    request.RangeHandler.OnRangeLoadFailed(request.RequestID, request.FilePath, request.Error);
+                else
+                    request.FileHandler.OnFileLoadFailed(request.RequestID, request.FilePath, request.Error);
+            }
+            catch (Exception) { } // the request already stores the read error
+        }
+
+        private byte[] RentBuffer(int size)
+        {
+            int sizeLog2 = MIN_POOLED_BUFFER_LOG2;
+            while ((1 << sizeLog2) < size && sizeLog2 <= MAX_POOLED_BUFFER_LOG2)
+                sizeLog2++;
+            if (sizeLog2 > MAX_POOLED_BUFFER_LOG2)
+                return new byte[size];
+
+            lock (bufferPool[sizeLog2])
+            {
+                if (bufferPool[sizeLog2].Count > 0)
+                    return bufferPool[sizeLog2].Pop();
+            }
+            return new byte[1 << sizeLog2];
+        }
+
+        private void ReturnBuffer(byte[] buffer)
+        {
+            int length = buffer.Length;
+            if (length < (1 << MIN_POOLED_BUFFER_LOG2) || length > (1 << MAX_POOLED_BUFFER_LOG2) || (length & (length - 1)) != 0)
+                return; // not pooled
+
+            int sizeLog2 = MIN_POOLED_BUFFER_LOG2;
+            while ((1 << sizeLog2) < length)
+                sizeLog2++;
+
+            lock (bufferPool[sizeLog2])
+            {
+                if (bufferPool[sizeLog2].Count < MAX_BUFFERS_PER_SIZE)
+                    bufferPool[sizeLog2].Push(buffer);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Priority classes of the I/O requests. Lower values are served first.
+    /// </summary>
+    public enum IOPriority
+    {
+        /// <summary>
+        /// Data required to display what is currently visible.
+        /// </summary>
+        Visible = 0,
+        /// <summary>
+        /// Data that will be required soon, e.g. by objects near the camera.
+        /// </summary>
+        Nearby = 1,
+        /// <summary>
+        /// Speculative reads, served when no other requests are waiting.
+        /// </summary>
+        Prefetch = 2
+    }
+
+    public enum IORequestState
+    {
+        Queued,
+        Reading,
+        Completed,
+        Cancelled,
+        Failed
+    }
+
+    /// <summary>
+    /// A read queued to an IOScheduler.
+    /// </summary>
+    public class IORequest
+    {
+        internal long Offset;
+        internal int Length; // -1 for whole file reads
+        internal bool IsBinary;
+        internal ILoadedFileHandler FileHandler;
+        internal IRangeReadHandler RangeHandler;
+        internal LinkedListNode<IORequest> Node; // position in the scheduler queue while queued
+
+        internal IORequest(int requestID, string filePath, IOPriority priority)
+        {
+            RequestID = requestID;
+            FilePath = filePath;
+            Priority = priority;
+            State = IORequestState.Queued;
+        }
+
+        public int RequestID { get; private set; }
+
+        public string FilePath { get; private set; }
+
+        public IOPriority Priority { get; internal set; }
+
+        public IORequestState State { get; internal set; }
+
+        /// <summary>
+        /// The exception that caused this request to fail, if State is Failed. This is either the read error or an exception thrown by the handler while processing the loaded file.
+        /// </summary>
+        public Exception Error { get; internal set; }
+    }
+
+    public interface IRangeReadHandler
+    {
+        /// <summary>
+        /// Called from an I/O thread when a range has been read. The data is stored in a pooled buffer, and is only valid until this call returns.
+        /// The range is shorter than requested if the end of the file has been reached.
+        /// </summary>
+        void OnRangeLoaded(int requestID, string filePath, long offset, ArrayRange<byte> data);
+
+        /// <summary>
+        /// Called instead of OnRangeLoaded() if the range could not be read.
+        /// </summary>
+        void OnRangeLoadFailed(int requestID, string filePath, Exception error);
+    }
+
+    public interface ILoadedFileHandler
+    {
+        void OnFileLoaded(int requestID, string filePath, byte[] loadedBytes);
+
+        void OnFileLoaded(int requestID, string filePath, string loadedText);
+
+        /// <summary>
+        /// Called instead of OnFileLoaded() if the file could not be read.
+        /// </summary>
+        void OnFileLoadFailed(int requestID, string filePath, Exception error);
+    }
+
+    public class TextFileHandler : ILoadedFileHandler
+    {
+        private Action<string> callBack;
+        public TextFileHandler(Action<string> callBack)
+        {
+            this.callBack = callBack;
+        }
+
+        public void OnFileLoaded(int requestID, string filePath, byte[] loadedBytes) { }
+
+        public void OnFileLoaded(int requestID, string filePath, string loadedText)
+        {
+            callBack(loadedText);
+        }
+
+        public void OnFileLoadFailed(int requestID, string filePath, Exception error) { }
+    }
+
+    public class BinaryFileHandler : ILoadedFileHandler
+    {
+        private Action<byte[]> callBack;
+
+        public BinaryFileHandler(Action<byte[]> callBack)
+        {
+            this.callBack = callBack;
+        }
+
+        public void OnFileLoaded(int requestID, string filePath, byte[] loadedBytes)
+        {
+            callBack(loadedBytes);
+        }
+
+        public void OnFileLoaded(int requestID, string filePath, string loadedText) { }
+
+        public void OnFileLoadFailed(int requestID, string filePath, Exception error) { }
+    }
+}
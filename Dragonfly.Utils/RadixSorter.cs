@@ -0,0 +1,163 @@
+﻿using System;
+
+namespace Dragonfly.Utils
+{
+    /// <summary>
+    /// Sorts 64-bit keys together with an int value for each key, using a stable least-significant-digit radix sort on 8-bit digits.
+    /// Digits that are the same for all the keys are skipped, and large arrays are split in chunks that are counted and scattered in parallel.
+    /// Temporary buffers are kept between calls, so that sorting every frame does not allocate.
+    /// </summary>
+    public class RadixSorter
+    {
+        private const int DIGIT_BITS = 8;
+        private const int BUCKET_COUNT = 1 << DIGIT_BITS;
+        private const int DIGIT_COUNT = 64 / DIGIT_BITS;
+        private const int MIN_CHUNK_SIZE = 4096; // arrays smaller than two chunks are sorted on the calling thread
+
+        private ulong[] tmpKeys;
+        private int[] tmpValues;
+        private int[] globalHistograms; // key count for each bucket of each digit
+        private int[] chunkOffsets; // scatter offset for each bucket of each chunk
+        private int chunkCount, chunkSize, count, shift;
+        private ulong[] srcKeys, dstKeys;
+        private int[] srcValues, dstValues;
+        private HistogramBody histogramBody;
+        private ScatterBody scatterBody;
+
+        public RadixSorter()
+        {
+            tmpKeys = new ulong[0];
+            tmpValues = new int[0];
+            globalHistograms = new int[DIGIT_COUNT * BUCKET_COUNT];
+            chunkOffsets = new int[0];
+            histogramBody = new HistogramBody() { Sorter = this };
+            scatterBody = new ScatterBody() { Sorter = this };
+        }
+
+        /// <summary>
+        /// Sort the first count keys in ascending order, moving the values with their keys.
+        /// </summary>
+        public void Sort(ulong[] keys, int[] values, int count)
+        {
+            if (count <= 1)
+                return;
+
+            if (tmpKeys.Length < count)
+            {
+                tmpKeys = new ulong[keys.Length];
+                tmpValues = new int[keys.Length];
+            }
+
+            this.count = count;
+            chunkCount = System.Math.Max(1, System.Math.Min(SlimParallel.WorkerCount, count / MIN_CHUNK_SIZE));
+            chunkSize = (count + chunkCount - 1) / chunkCount;
+            if (chunkOffsets.Length < chunkCount * BUCKET_COUNT)
+                chunkOffsets = new int[chunkCount * BUCKET_COUNT];
+
+            // count all the digits with a single read, to skip the ones shared by all the keys
+            Array.Clear(globalHistograms, 0, globalHistograms.Length);
+            for (int i = 0; i < count; i++)
+            {
+                ulong key = keys[i];
+                for (int d = 0; d < DIGIT_COUNT; d++)
+                    globalHistograms[d * BUCKET_COUNT + (int)((key >> (d * DIGIT_BITS)) & (BUCKET_COUNT - 1))]++;
+            }
+
+            srcKeys = keys;
+            srcValues = values;
+            dstKeys = tmpKeys;
+            dstValues = tmpValues;
+            for (int d = 0; d < DIGIT_COUNT; d++)
+            {
+                if (Array.IndexOf(globalHistograms, count, d * BUCKET_COUNT, BUCKET_COUNT) >= 0)
+                    continue; // all keys fall in the same bucket
+
+                shift = d * DIGIT_BITS;
+                SortDigit();
+
+                // swap buffers
+                ulong[] k = srcKeys; srcKeys = dstKeys; dstKeys = k;
+                int[] v = srcValues; srcValues = dstValues; dstValues = v;
+            }
+
+            if (srcKeys != keys)
+            {
+                // an odd number of passes: copy back to the input arrays
+                Array.Copy(srcKeys, keys, count);
+                Array.Copy(srcValues, values, count);
+            }
+
+            srcKeys = dstKeys = null;
+            srcValues = dstValues = null;
+        }
+
+        private void SortDigit()
+        {
+            // count the keys of each chunk
+            if (chunkCount > 1)
+                SlimParallel.For(0, chunkCount, 1, histogramBody);
+            else
+                CountChunk(0);
+
+            // prefix sum: for each bucket, chunks are placed in order to keep the sort stable
+            int offset = 0;
+            for (int b = 0; b < BUCKET_COUNT; b++)
+            {
+                for (int c = 0; c < chunkCount; c++)
+                {
+                    int bucketCount = chunkOffsets[c * BUCKET_COUNT + b];
+                    chunkOffsets[c * BUCKET_COUNT + b] = offset;
+                    offset += bucketCount;
+                }
+            }
+
+            // move keys to their sorted position
+            if (chunkCount > 1)
+                SlimParallel.For(0, chunkCount, 1, scatterBody);
+            else
+                ScatterChunk(0);
+        }
+
+        private void CountChunk(int chunk)
+        {
+            int histStart = chunk * BUCKET_COUNT;
+            Array.Clear(chunkOffsets, histStart, BUCKET_COUNT);
+            int end = System.Math.Min(count, (chunk + 1) * chunkSize);
+            for (int i = chunk * chunkSize; i < end; i++)
+                chunkOffsets[histStart + (int)((srcKeys[i] >> shift) & (BUCKET_COUNT - 1))]++;
+        }
+
+        private void ScatterChunk(int chunk)
+        {
+            int histStart = chunk * BUCKET_COUNT;
+            int end = System.Math.Min(count, (chunk + 1) * chunkSize);
+            for (int i = chunk * chunkSize; i < end; i++)
+            {
+                ulong key = srcKeys[i];
+                int dst = chunkOffsets[histStart + (int)((key >> shift) & (BUCKET_COUNT - 1))]++;
+                dstKeys[dst] = key;
+                dstValues[dst] = srcValues[i];
+            }
+        }
+
+        private class HistogramBody : SlimParallel.IForBody
+        {
+            public RadixSorter Sorter;
+
+            public void Execute(int i)
+            {
+                Sorter.CountChunk(i);
+            }
+        }
+
+        private class ScatterBody : SlimParallel.IForBody
+        {
+            public RadixSorter Sorter;
+
+            public void Execute(int i)
+            {
+                Sorter.ScatterChunk(i);
+            }
+        }
+    }
+}
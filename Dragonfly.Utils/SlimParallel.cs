@@ -1,13 +1,19 @@
 ﻿using System;
-using System.Threading.Tasks;
 using System.Threading;
 using System.Collections.Generic;
 using System.Collections.Concurrent;
 
 namespace Dragonfly.Utils
 {
+    /// <summary>
+    /// A work-stealing job system. Each worker thread owns a deque of jobs, and idle workers steal from the others.
+    /// Jobs can depend on other jobs, spawn child jobs that must complete before their parent, and threads waiting for a job help executing the pending ones.
+    /// </summary>
     public static class SlimParallel
     {
+        private const int IDLE_SPIN_COUNT = 64; // attempts to find a job before a worker goes to sleep
+        private const int CHUNKS_PER_WORKER = 4; // number of chunks in which for loops are split for each worker, to balance the load dynamically
+
         public interface ITaskBody
         {
             void Execute();
@@ -18,88 +24,400 @@ namespace Dragonfly.Utils
             void Execute(int i);
         }
 
-        enum PooledTaskType
+        /// <summary>
+        /// A reference to a scheduled job, that can be used to wait for its completion or to schedule other jobs after it.
+        /// The default value refers to an already completed job.
+        /// </summary>
+        public struct JobHandle
         {
-            ForChunk,
-            SingleTask
-        }
+            internal Job Job;
+            internal int Version;
 
-        struct TaskArgs
-        {
-            public PooledTaskType TaskType;
+            internal JobHandle(Job job)
+            {
+                Job = job;
+                Version = job.Version;
+            }
 
-            // for task args
-            public int From, To;
-            public IForBody ForBody;
-            public CountdownEvent ChunkCompletionEvent;
+            /// <summary>
+            /// True if the job and all of its children have been executed.
+            /// </summary>
+            public bool IsCompleted
+            {
+                get
+                {
+                    // pooled jobs are re-used with a different version once completed
+                    return Job == null || Volatile.Read(ref Job.Version) != Version || Volatile.Read(ref Job.Finished) || Volatile.Read(ref Job.Version) != Version;
+                }
+            }
+        }
 
-            // single task args
-            public ITaskBody SingleTaskBody;
+        internal class Job
+        {
+            public ITaskBody Body;
+            public Job Parent;
+            public bool Background; // long-running jobs started with RunAsync(), that are never executed by threads waiting for other jobs
+            public int PendingWork; // the job itself plus its children still running
+            public int PendingDependencies; // jobs that should complete before this one can start (plus one while scheduling)
+            public List<Job> Dependents = new List<Job>();
+            public int Version;
+            public bool Finished;
         }
 
-        class PooledThread
+        private class Worker
         {
+            public int Index;
             public Thread Thread;
+            public WorkStealingDeque<Job> Jobs;
         }
 
-        private static List<PooledThread> threadPool;
-        private static BlockingQueue<TaskArgs> taskQueue;
-        private static ThreadLocal<CountdownEvent> syncEvent;
+        private class ForState : ITaskBody
+        {
+            public IForBody Body;
+            public int From, To, ChunkSize, ChunkCount;
+            public int NextChunk, CompletedIterations;
+            public int RefCount; // number of jobs plus the calling thread still referencing this state
+
+            public void Execute()
+            {
+                ExecuteChunks();
+                Release();
+            }
+
+            public void ExecuteChunks()
+            {
+                int chunk;
+                while ((chunk = Interlocked.Increment(ref NextChunk) - 1) < ChunkCount)
+                {
+                    int from = From + chunk * ChunkSize, to = Math.Min(from + ChunkSize, To);
+                    for (int i = from; i < to; i++)
+                        Body.Execute(i);
+                    Interlocked.Add(ref CompletedIterations, to - from);
+                }
+            }
+
+            public void Release()
+            {
+                if (Interlocked.Decrement(ref RefCount) == 0)
+                {
+                    Body = null;
+                    forStatePool.Enqueue(this);
+                }
+            }
+        }
+
+        private static Worker[] workers;
+        private static ConcurrentQueue<Job> globalJobs; // jobs scheduled from threads that are not workers
+        private static ConcurrentQueue<Job> backgroundJobs;
+        private static ConcurrentQueue<Job> jobPool;
+        private static ConcurrentQueue<ForState> forStatePool;
+        private static SemaphoreSlim wakeSignal;
+        private static int sleepingWorkers;
+        [ThreadStatic] private static Worker curWorker;
+        [ThreadStatic] private static Job curJob;
 
         static SlimParallel()
         {
-            syncEvent = new ThreadLocal<CountdownEvent>(() => new CountdownEvent(1), false);
-            taskQueue = new BlockingQueue<TaskArgs>();
+            globalJobs = new ConcurrentQueue<Job>();
+            backgroundJobs = new ConcurrentQueue<Job>();
+            jobPool = new ConcurrentQueue<Job>();
+            forStatePool = new ConcurrentQueue<ForState>();
+            wakeSignal = new SemaphoreSlim(0);
 
-            threadPool = new List<PooledThread>(Environment.ProcessorCount + 1);
-            for (int i = 0; i <= Environment.ProcessorCount; i++)
+            workers = new Worker[Environment.ProcessorCount + 1];
+            for (int i = 0; i < workers.Length; i++)
             {
-                PooledThread t = new PooledThread();
-                t.Thread = new Thread(new ThreadStart(PooledThreadLoop));
-                t.Thread.IsBackground = true;
-                t.Thread.Name = "PooledThread" + i;
-                t.Thread.Start();
-                threadPool.Add(t);
+                Worker w = new Worker();
+                w.Index = i;
+                w.Jobs = new WorkStealingDeque<Job>();
+                w.Thread = new Thread(new ParameterizedThreadStart(WorkerLoop));
+                w.Thread.IsBackground = true;
+                w.Thread.Name = "PooledThread" + i;
+                workers[i] = w;
             }
+
+            foreach (Worker w in workers)
+                w.Thread.Start(w);
         }
 
-        private static void PooledThreadLoop()
+        /// <summary>
+        /// Number of worker threads.
+        /// </summary>
+        public static int WorkerCount => workers.Length;
+
+        #region Workers
+
+        private static void WorkerLoop(object worker)
         {
-            TaskArgs task;
+            curWorker = (Worker)worker;
+            int idleCount = 0;
 
             while (true)
             {
-                // dequeue a new task
-                if (!taskQueue.TryDequeue(out task))
+                Job job = FindJob(curWorker, true);
+                if (job != null)
+                {
+                    ExecuteJob(job);
+                    idleCount = 0;
                     continue;
+                }
 
-                // perform the required task
-                switch (task.TaskType)
+                if (++idleCount < IDLE_SPIN_COUNT)
                 {
-                    case PooledTaskType.ForChunk:
-                        {
-                            for (int i = task.From; i < task.To; i++)
-                                task.ForBody.Execute(i);
-                            task.ChunkCompletionEvent.Signal();
-                        }
-                        break;
-
-                    case PooledTaskType.SingleTask:
-                        {
-                            task.SingleTaskBody.Execute();
-                        }
-                        break;
-
-                    default:
-                        break;
+                    Thread.SpinWait(20);
+                    continue;
                 }
+
+                // no work found for a while: sleep until a job is scheduled
+                Interlocked.Increment(ref sleepingWorkers);
+                if (!HasPendingJobs())
+                    wakeSignal.Wait();
+                Interlocked.Decrement(ref sleepingWorkers);
+                idleCount = 0;
+            }
+        }
+
+        private static Job FindJob(Worker worker, bool includeBackground)
+        {
+            Job job;
+
+            // local jobs first, most recently pushed are still hot in the cache
+            if (worker != null && worker.Jobs.TryPop(out job))
+                return job;
+
+            if (globalJobs.TryDequeue(out job))
+                return job;
+
+            // steal the oldest job from other workers
+            int start = worker != null ? worker.Index + 1 : Environment.CurrentManagedThreadId;
+            for (int i = 0; i < workers.Length; i++)
+            {
+                Worker victim = workers[(start + i) % workers.Length];
+                if (victim != worker && victim.Jobs.TrySteal(out job))
+                    return job;
+            }
+
+            if (includeBackground && backgroundJobs.TryDequeue(out job))
+                return job;
+
+            return null;
+        }
+
+        private static bool HasPendingJobs()
+        {
+            if (!globalJobs.IsEmpty || !backgroundJobs.IsEmpty)
+                return true;
+            foreach (Worker w in workers)
+                if (w.Jobs.Count > 0)
+                    return true;
+            return false;
+        }
+
+        private static void WakeWorker()
+        {
+            Interlocked.MemoryBarrier(); // the pushed job must be visible before checking for sleeping workers
+            if (Volatile.Read(ref sleepingWorkers) > wakeSignal.CurrentCount)
+                wakeSignal.Release();
+        }
+
+        #endregion
+
+        #region Jobs
+
+        private static Job NewJob(ITaskBody body, bool background)
+        {
+            Job job;
+            if (!jobPool.TryDequeue(out job))
+                job = new Job();
+            job.Body = body;
+            job.Background = background;
+            job.PendingWork = 1;
+            job.PendingDependencies = 1;
+            return job;
+        }
+
+        private static void PushJob(Job job)
+        {
+            if (job.Background)
+                backgroundJobs.Enqueue(job);
+            else if (curWorker != null)
+                curWorker.Jobs.Push(job);
+            else
+                globalJobs.Enqueue(job);
+
+            WakeWorker();
+        }
+
+        private static void ExecuteJob(Job job)
+        {
+            Job prevJob = curJob;
+            curJob = job;
+            try
+            {
+                job.Body.Execute();
+            }
+            finally
+            {
+                curJob = prevJob;
+                CompleteWork(job);
+            }
+        }
+
+        private static void CompleteWork(Job job)
+        {
+            if (Interlocked.Decrement(ref job.PendingWork) > 0)
+                return; // children still running
+
+            // mark as finished, no dependents can be added after this
+            lock (job)
+                Volatile.Write(ref job.Finished, true);
+
+            foreach (Job dependent in job.Dependents)
+                if (Interlocked.Decrement(ref dependent.PendingDependencies) == 0)
+                    PushJob(dependent);
+
+            // recycle the job
+            Job parent = job.Parent;
+            lock (job)
+            {
+                job.Version++;
+                job.Finished = false;
+                job.Body = null;
+                job.Parent = null;
+                job.Dependents.Clear();
+            }
+            jobPool.Enqueue(job);
+
+            if (parent != null)
+                CompleteWork(parent);
+        }
+
+        private static void AddDependency(Job job, JobHandle dependency)
+        {
+            Job depJob = dependency.Job;
+            if (depJob == null)
+                return;
+
+            lock (depJob)
+            {
+                if (depJob.Version != dependency.Version || depJob.Finished)
+                    return; // already completed
+
+                Interlocked.Increment(ref job.PendingDependencies);
+                depJob.Dependents.Add(job);
+            }
+        }
+
+        private static void ReleaseScheduling(Job job)
+        {
+            if (Interlocked.Decrement(ref job.PendingDependencies) == 0)
+                PushJob(job);
+        }
+
+        /// <summary>
+        /// Schedule a job for execution on the worker threads.
+        /// </summary>
+        public static JobHandle Schedule(ITaskBody body)
+        {
+            Job job = NewJob(body, false);
+            JobHandle handle = new JobHandle(job);
+            ReleaseScheduling(job);
+            return handle;
+        }
+
+        /// <summary>
+        /// Schedule a job that will start only after the specified job is completed.
+        /// </summary>
+        public static JobHandle Schedule(ITaskBody body, JobHandle dependency)
+        {
+            Job job = NewJob(body, false);
+            JobHandle handle = new JobHandle(job);
+            AddDependency(job, dependency);
+            ReleaseScheduling(job);
+            return handle;
+        }
+
+        /// <summary>
+        /// Schedule a job that will start only after all the specified jobs are completed.
+        /// </summary>
+        public static JobHandle Schedule(ITaskBody body, params JobHandle[] dependencies)
+        {
+            Job job = NewJob(body, false);
+            JobHandle handle = new JobHandle(job);
+            foreach (JobHandle dep in dependencies)
+                AddDependency(job, dep);
+            ReleaseScheduling(job);
+            return handle;
+        }
+
+        /// <summary>
+        /// Schedule a job as a child of the job running on the current thread, which will not be completed until this child is.
+        /// If called outside of a job, this is equivalent to Schedule().
+        /// </summary>
+        public static JobHandle ScheduleChild(ITaskBody body)
+        {
+            Job job = NewJob(body, false);
+            JobHandle handle = new JobHandle(job);
+            if (curJob != null)
+            {
+                Interlocked.Increment(ref curJob.PendingWork);
+                job.Parent = curJob;
+            }
+            ReleaseScheduling(job);
+            return handle;
+        }
+
+        /// <summary>
+        /// Wait for the specified job to complete, executing other pending jobs in the meantime.
+        /// </summary>
+        public static void Wait(JobHandle handle)
+        {
+            SpinWait spin = new SpinWait();
+            while (!handle.IsCompleted)
+            {
+                if (!TryExecutePendingJob())
+                    spin.SpinOnce();
             }
         }
 
+        /// <summary>
+        /// Wait for all the specified jobs to complete, executing other pending jobs in the meantime.
+        /// </summary>
+        public static void WaitAll(params JobHandle[] handles)
+        {
+            foreach (JobHandle handle in handles)
+                Wait(handle);
+        }
+
+        private static bool TryExecutePendingJob()
+        {
+            // background jobs are never executed while waiting, since they can take an unbounded amount of time
+            Job job = FindJob(curWorker, false);
+            if (job == null)
+                return false;
+
+            ExecuteJob(job);
+            return true;
+        }
+
+        /// <summary>
+        /// Execute the specified body on a worker thread. Should be used for long-running or blocking tasks, which will not be picked up by threads waiting for other jobs.
+        /// </summary>
+        public static void RunAsync(ITaskBody body)
+        {
+            ReleaseScheduling(NewJob(body, true));
+        }
+
+        #endregion
+
+        /// <summary>
+        /// Execute the body for each index in the specified range, splitting the iterations between the calling thread and the workers.
+        /// Chunks of at least minChunkSize iterations are assigned dynamically, so that threads that finish earlier keep processing the remaining ones.
+        /// </summary>
         public static void For(int fromInclusive, int toExclusive, int minChunkSize, IForBody body)
         {
             int iterCount = toExclusive - fromInclusive;
-            int chunkSize = Math.Max(minChunkSize, 1 + iterCount / Math.Max(20, threadPool.Count));
+            int chunkSize = Math.Max(Math.Max(minChunkSize, 1), iterCount / (workers.Length * CHUNKS_PER_WORKER));
 
             // execute the for loop synchronously if a single chunk should be executed
             if (chunkSize >= iterCount)
@@ -110,32 +428,34 @@ namespace Dragonfly.Utils
                 return;
             }
 
-            CountdownEvent curSyncEvent = syncEvent.Value;
-            int chunkCount = (iterCount + chunkSize - 1) / chunkSize;
-            curSyncEvent.Reset(chunkCount + 1);
-            taskQueue.Lock();
-            for (int iFrom = fromInclusive, iChunk = 0; iFrom < toExclusive; iFrom += chunkSize, iChunk++)
-            {
-                // prepare chunk
-                TaskArgs chunk = new TaskArgs() { TaskType = PooledTaskType.ForChunk };
-                chunk.From = iFrom;
-                chunk.To = Math.Min(iFrom + chunkSize, toExclusive);
-                chunk.ChunkCompletionEvent = curSyncEvent;
-                chunk.ForBody = body;
+            ForState state;
+            if (!forStatePool.TryDequeue(out state))
+                state = new ForState();
+            state.Body = body;
+            state.From = fromInclusive;
+            state.To = toExclusive;
+            state.ChunkSize = chunkSize;
+            state.ChunkCount = (iterCount + chunkSize - 1) / chunkSize;
+            state.NextChunk = 0;
+            state.CompletedIterations = 0;
+
+            // schedule helper jobs, the calling thread will process chunks too
+            int helperCount = Math.Min(workers.Length, state.ChunkCount - 1);
+            state.RefCount = helperCount + 1;
+            for (int i = 0; i < helperCount; i++)
+                ReleaseScheduling(NewJob(state, false));
 
-                // queue chunk execution
-                taskQueue.Enqueue(chunk);
+            state.ExecuteChunks();
+
+            // wait for the chunks taken by other threads
+            SpinWait spin = new SpinWait();
+            while (Volatile.Read(ref state.CompletedIterations) < iterCount)
+            {
+                if (!TryExecutePendingJob())
+                    spin.SpinOnce();
             }
-            taskQueue.Unlock();
-            curSyncEvent.Signal();
-            curSyncEvent.Wait();
-        }
 
-        public static void RunAsync(ITaskBody body)
-        {
-            TaskArgs singleTask = new TaskArgs() { TaskType = PooledTaskType.SingleTask };
-            singleTask.SingleTaskBody = body;
-            taskQueue.Enqueue(singleTask);
+            state.Release();
         }
 
     }
@@ -0,0 +1,400 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace Dragonfly.Utils
+{
+    /// <summary>
+    /// A Two-Level Segregated Fit allocator, that manages ranges over a memory space of a given size without owning any memory itself.
+    /// Allocations and frees run in constant time, and adjacent free ranges are always merged.
+    /// </summary>
+    public class TlsfAllocator
+    {
+        private const int SL_LOG2 = 4; // log2 of the number of second level lists for each first level
+        private const int SL_COUNT = 1 << SL_LOG2;
+        private const int NONE = 0; // null block index
+
+        public struct Allocation
+        {
+            /// <summary>
+            /// Start of the allocated range.
+            /// </summary>
+            public long Offset;
+            /// <summary>
+            /// Size requested for this allocation.
+            /// </summary>
+            public long Size;
+            internal int BlockID;
+
+            public bool IsValid => BlockID != NONE;
+        }
+
+        private struct Block
+        {
+            public long Offset, Size, RequestedSize;
+            public int PrevPhys, NextPhys; // physically adjacent blocks
+            public int PrevFree, NextFree; // blocks in the same free list
+            public bool Free;
+        }
+
+        private static readonly ulong DEBRUIJN64 = 0x03f79d71b4cb0a89UL;
+        private static readonly int[] debruijnTable;
+
+        static TlsfAllocator()
+        {
+            debruijnTable = new int[64];
+            for (int i = 0; i < 64; i++)
+                debruijnTable[(DEBRUIJN64 << i) >> 58] = i;
+        }
+
+        private Block[] blocks;
+        private int blockCount;
+        private Stack<int> unusedBlocks;
+        private int minBlockLog2;
+        private int flCount;
+        private ulong flBitmap;
+        private uint[] slBitmap;
+        private int[] freeHeads; // first block of each free list, indexed as fl * SL_COUNT + sl
+        private long allocatedBytes, requestedBytes;
+        private int allocationCount, freeBlockCount;
+
+        /// <param name="byteSize">The size of the managed memory space.</param>
+        /// <param name="minBlockSize">The allocation granularity, must be a power of two. All the offsets and sizes are rounded to this value.</param>
+        public TlsfAllocator(long byteSize, long minBlockSize)
+        {
+            if (minBlockSize <= 0 || (minBlockSize & (minBlockSize - 1)) != 0)
+                throw new ArgumentException("The minimum block size must be a power of two.");
+
+            minBlockLog2 = Log2(minBlockSize);
+            MinBlockSize = minBlockSize;
+            ByteSize = (byteSize >> minBlockLog2) << minBlockLog2;
+            if (ByteSize == 0)
+                throw new ArgumentException("The memory space is smaller than the minimum block size.");
+
+            long maxUnits = ByteSize >> minBlockLog2;
+            flCount = maxUnits < SL_COUNT ? 1 : Log2(maxUnits) - SL_LOG2 + 2;
+            slBitmap = new uint[flCount];
+            freeHeads = new int[flCount * SL_COUNT];
+            blocks = new Block[16];
+            blockCount = 1; // index 0 is reserved as null
+            unusedBlocks = new Stack<int>();
+
+            // the whole space starts as a single free block
+            int id = NewBlock();
+            blocks[id].Offset = 0;
+            blocks[id].Size = ByteSize;
+            InsertFree(id);
+        }
+
+        public long ByteSize { get; private set; }
+
+        public long MinBlockSize { get; private set; }
+
+        /// <summary>
+        /// True if there are no allocations active.
+        /// </summary>
+        public bool IsEmpty => allocationCount == 0;
+
+        /// <summary>
+        /// Try to allocate a range of the specified size.
+        /// </summary>
+        /// <param name="byteSize">The required size.</param>
+        /// <param name="alignment">The alignment of the range offset, must be a power of two.</param>
+        /// <param name="allocation">The allocated range, that should be later passed to Free().</param>
+        /// <returns>False if there is no free range that fits the request.</returns>
+        public bool TryAllocate(long byteSize, long alignment, out Allocation allocation)
+        {
+            allocation = new Allocation();
+            if (byteSize <= 0)
+                throw new ArgumentException("Allocations should have a positive size.");
+            if ((alignment & (alignment - 1)) != 0)
+                throw new ArgumentException("The alignment must be a power of two.");
+
+            alignment = System.Math.Max(alignment, MinBlockSize);
+            long blockSize = RoundUp(byteSize, MinBlockSize);
+            long searchSize = blockSize + alignment - MinBlockSize; // any block of this size fits the request after being aligned
+            if (searchSize > ByteSize)
+                return false;
+
+            // search a free block
+            int fl, sl;
+            MappingSearch(searchSize >> minBlockLog2, out fl, out sl);
+            if (fl >= flCount)
+                return false;
+            int id = FindFree(fl, sl);
+            if (id == NONE)
+                return false;
+            RemoveFree(id);
+
+            // split the padding required for alignment
+            long padding = RoundUp(blocks[id].Offset, alignment) - blocks[id].Offset;
+            if (padding > 0)
+            {
+                int padID = SplitFront(id, padding);
+                InsertFree(padID);
+            }
+
+            // split the exceeding part
+            if (blocks[id].Size > blockSize)
+            {
+                int usedID = SplitFront(id, blockSize);
+                InsertFree(id);
+                id = usedID;
+            }
+
+            blocks[id].Free = false;
+            blocks[id].RequestedSize = byteSize;
+            allocatedBytes += blocks[id].Size;
+            requestedBytes += byteSize;
+            allocationCount++;
+
+            allocation.Offset = blocks[id].Offset;
+            allocation.Size = byteSize;
+            allocation.BlockID = id;
+            return true;
+        }
+
+        /// <summary>
+        /// Release a range previously returned by TryAllocate().
+        /// </summary>
+        public void Free(Allocation allocation)
+        {
+            int id = allocation.BlockID;
+            if (id == NONE || id >= blockCount || blocks[id].Free || blocks[id].Offset != allocation.Offset)
+                throw new ArgumentException("The specified allocation is not valid or has been already released.");
+
+            allocatedBytes -= blocks[id].Size;
+            requestedBytes -= blocks[id].RequestedSize;
+            allocationCount--;
+            blocks[id].Free = true;
+
+            // merge with the previous free block
+            int prev = blocks[id].PrevPhys;
+            if (prev != NONE && blocks[prev].Free)
+            {
+                RemoveFree(prev);
+                MergeNext(prev);
+                id = prev;
+            }
+
+            // merge with the next free block
+            int next = blocks[id].NextPhys;
+            if (next != NONE && blocks[next].Free)
+            {
+                RemoveFree(next);
+                MergeNext(id);
+            }
+
+            InsertFree(id);
+        }
+
+        /// <summary>
+        /// Returns the current allocation statistics.
+        /// </summary>
+        public AllocatorStats GetStats()
+        {
+            AllocatorStats stats = new AllocatorStats();
+            stats.TotalBytes = ByteSize;
+            stats.AllocatedBytes = allocatedBytes;
+            stats.RequestedBytes = requestedBytes;
+            stats.AllocationCount = allocationCount;
+            stats.FreeBlockCount = freeBlockCount;
+            stats.LargestFreeBlock = GetLargestFreeBlock();
+            return stats;
+        }
+
+        private long GetLargestFreeBlock()
+        {
+            if (flBitmap == 0)
+                return 0;
+
+            // the largest block is in the highest non-empty list
+            int fl = HighestBit(flBitmap);
+            int sl = HighestBit(slBitmap[fl]);
+            long largest = 0;
+            for (int id = freeHeads[fl * SL_COUNT + sl]; id != NONE; id = blocks[id].NextFree)
+                largest = System.Math.Max(largest, blocks[id].Size);
+            return largest;
+        }
+
+        #region Blocks
+
+        private int NewBlock()
+        {
+            if (unusedBlocks.Count > 0)
+                return unusedBlocks.Pop();
+
+            if (blockCount == blocks.Length)
+                Array.Resize(ref blocks, blocks.Length * 2);
+            return blockCount++;
+        }
+
+        /// <summary>
+        /// Split the specified block in two, moving its first part of the specified size to a new block which is returned.
+        /// </summary>
+        private int SplitFront(int id, long frontSize)
+        {
+            int frontID = NewBlock();
+            blocks[frontID] = new Block()
+            {
+                Offset = blocks[id].Offset,
+                Size = frontSize,
+                PrevPhys = blocks[id].PrevPhys,
+                NextPhys = id
+            };
+            if (blocks[id].PrevPhys != NONE)
+                blocks[blocks[id].PrevPhys].NextPhys = frontID;
+
+            blocks[id].PrevPhys = frontID;
+            blocks[id].Offset += frontSize;
+            blocks[id].Size -= frontSize;
+            return frontID;
+        }
+
+        /// <summary>
+        /// Merge the specified block with its next physical block, which is discarded.
+        /// </summary>
+        private void MergeNext(int id)
+        {
+            int next = blocks[id].NextPhys;
+            blocks[id].Size += blocks[next].Size;
+            blocks[id].NextPhys = blocks[next].NextPhys;
+            if (blocks[next].NextPhys != NONE)
+                blocks[blocks[next].NextPhys].PrevPhys = id;
+
+            blocks[next] = new Block();
+            unusedBlocks.Push(next);
+        }
+
+        #endregion
+
+        #region Free lists
+
+        private void InsertFree(int id)
+        {
+            int fl, sl;
+            MappingInsert(blocks[id].Size >> minBlockLog2, out fl, out sl);
+            int listID = fl * SL_COUNT + sl;
+
+            blocks[id].Free = true;
+            blocks[id].PrevFree = NONE;
+            blocks[id].NextFree = freeHeads[listID];
+            if (freeHeads[listID] != NONE)
+                blocks[freeHeads[listID]].PrevFree = id;
+            freeHeads[listID] = id;
+
+            flBitmap |= 1UL << fl;
+            slBitmap[fl] |= 1u << sl;
+            freeBlockCount++;
+        }
+
+        private void RemoveFree(int id)
+        {
+            int fl, sl;
+            MappingInsert(blocks[id].Size >> minBlockLog2, out fl, out sl);
+            int listID = fl * SL_COUNT + sl;
+
+            int prev = blocks[id].PrevFree, next = blocks[id].NextFree;
+            if (prev != NONE)
+                blocks[prev].NextFree = next;
+            else
+                freeHeads[listID] = next;
+            if (next != NONE)
+                blocks[next].PrevFree = prev;
+
+            if (freeHeads[listID] == NONE)
+            {
+                // list emptied, update bitmaps
+                slBitmap[fl] &= ~(1u << sl);
+                if (slBitmap[fl] == 0)
+                    flBitmap &= ~(1UL << fl);
+            }
+
+            blocks[id].PrevFree = blocks[id].NextFree = NONE;
+            freeBlockCount--;
+        }
+
+        /// <summary>
+        /// Returns the first free block in the specified list, or in the smallest list of bigger blocks.
+        /// </summary>
+        private int FindFree(int fl, int sl)
+        {
+            uint slMap = slBitmap[fl] & (~0u << sl);
+            if (slMap == 0)
+            {
+                ulong flMap = fl + 1 < 64 ? flBitmap & (~0UL << (fl + 1)) : 0;
+                if (flMap == 0)
+                    return NONE; // out of memory
+
+                fl = LowestBit(flMap);
+                slMap = slBitmap[fl];
+            }
+
+            sl = LowestBit(slMap);
+            return freeHeads[fl * SL_COUNT + sl];
+        }
+
+        /// <summary>
+        /// Returns the list that contains blocks of the specified size (in units of the minimum block size).
+        /// </summary>
+        private static void MappingInsert(long units, out int fl, out int sl)
+        {
+            if (units < SL_COUNT)
+            {
+                // small blocks: one list for each size
+                fl = 0;
+                sl = (int)units;
+            }
+            else
+            {
+                int log2 = Log2(units);
+                fl = log2 - SL_LOG2 + 1;
+                sl = (int)(units >> (log2 - SL_LOG2)) - SL_COUNT;
+            }
+        }
+
+        /// <summary>
+        /// Returns the first list that only contains blocks bigger or equal to the specified size (in units of the minimum block size).
+        /// </summary>
+        private static void MappingSearch(long units, out int fl, out int sl)
+        {
+            if (units >= SL_COUNT)
+                units += (1L << (Log2(units) - SL_LOG2)) - 1;
+            MappingInsert(units, out fl, out sl);
+        }
+
+        #endregion
+
+        #region Bit utils
+
+        private static long RoundUp(long value, long powerOf2)
+        {
+            return (value + powerOf2 - 1) & ~(powerOf2 - 1);
+        }
+
+        private static int LowestBit(ulong value)
+        {
+            return debruijnTable[((value & (~value + 1)) * DEBRUIJN64) >> 58];
+        }
+
+        private static int HighestBit(ulong value)
+        {
+            int bit = 0;
+            for (int shift = 32; shift > 0; shift >>= 1)
+            {
+                if ((value >> shift) != 0)
+                {
+                    value >>= shift;
+                    bit += shift;
+                }
+            }
+            return bit;
+        }
+
+        private static int Log2(long value)
+        {
+            return HighestBit((ulong)value);
+        }
+
+        #endregion
+    }
+}